@@ -1,113 +1,185 @@
-#include <iostream>
+#include <algorithm>
+#include <chrono>
 #include <fstream>
-#include <sstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <thread>
 #include <vector>
-#include <mutex>
-
-#include <compiler/include/lexer.h>
-#include <compiler/include/parser.h>
 
-std::mutex cout_mutex;
-
-struct ParseResult
-{
-    std::string filename;
-    bool success;
-    std::string error_message;
-    yu::compiler::VarDeclList var_decls;
-    yu::compiler::SymbolList symbols;
-};
-
-std::string read_file(const std::string &filename)
+#include <compiler/include/compilation_unit.h>
+#include <compiler/include/file_reader.h>
+#include <compiler/include/memory.h>
+#include <compiler/include/module_loader.h>
+#include <compiler/include/project.h>
+#include <compiler/include/thread_pool.h>
+#include <compiler/include/timer.h>
+#include <compiler/include/trace.h>
+#include <compiler/include/unit_cache.h>
+#include "../lsp.h"
+#include "../options.h"
+#include "../report.h"
+#include "../time_report.h"
+#include "../trace.h"
+
+// reader is null for files only found through imports, they are read on the worker; diagnostics
+// stay in the unit for the file's report instead of going to stderr from the worker
+yu::compiler::CompilationUnit parse_file(const std::string &filename, yu::compiler::FileReader *reader,
+                                        const uint32_t position, const yu::compiler::UnitCache *cache)
 {
-    std::ifstream file(filename);
-    if (!file.is_open())
-    {
-        throw std::runtime_error("Could not open file: " + filename);
-    }
-
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
-}
-
-void parse_file(const std::string &filename, ParseResult &result)
-{
-    result.filename = filename;
-    result.success = false;
-
+    const yu::compiler::Timer timer("file", filename);
     try
     {
-        const std::string code = read_file(filename);
-
-        yu::compiler::Lexer lexer(code);
-        const auto tokens = lexer.tokenize();
-
-        yu::compiler::Parser parser(*tokens, code.c_str(), filename.c_str(), lexer);
-
-        auto parse_result = parser.parse_program();
-        if (!parse_result)
+        auto source = [&]
+        {
+            // only the time spent waiting for the I/O stage, the read itself overlaps other files
+            const yu::compiler::Timer read_timer("read");
+            auto buffer = reader ? reader->take(position) : yu::compiler::SourceBuffer::from_file(filename);
+            read_timer.add_bytes(buffer.size());
+            return buffer;
+        }();
+        timer.add_bytes(source.size());
+        if (!cache)
+            return yu::compiler::parse_unit(std::move(source), false);
+
+        yu::compiler::CompilationUnit unit;
         {
-            result.error_message = "Failed to parse program";
-            return;
+            const yu::compiler::Timer cache_timer("cache");
+            if (cache->load(source, unit))
+                return unit;
         }
 
-        result.var_decls = parser.get_var_decls();
-        result.symbols = parser.get_symbols();
-        result.success = true;
+        unit = yu::compiler::parse_unit(std::move(source), false);
+        cache->store(unit);
+        return unit;
     }
     catch (const std::exception &e)
     {
-        result.error_message = e.what();
+        yu::compiler::CompilationUnit unit;
+        unit.source = yu::compiler::SourceBuffer(filename, std::string_view {});
+        unit.error_message = e.what();
+        return unit;
     }
 }
 
 int main(const int argc, char *argv[])
 {
-    if (argc < 2)
+    Options options;
+    std::unique_ptr<yu::compiler::UnitCache> cache;
+    yu::compiler::Project project;
+    try
     {
-        std::cerr << "Usage: " << argv[0] << " <file1> [file2] ...\n";
-        return 1;
+        options = parse_options(argc, argv);
+        if (!options.cache_dir.empty())
+            cache = std::make_unique<yu::compiler::UnitCache>(options.cache_dir);
+
+        for (const auto &file: options.files)
+            project.add_file(file);
+        for (const auto &path: options.projects)
+            project.add(path);
     }
-
-    std::vector<ParseResult> parse_results(argc - 1);
-    std::vector<std::thread> parse_threads;
-    for (auto i = 1; i < argc; ++i)
+    catch (const std::exception &e)
     {
-        parse_threads.emplace_back(parse_file, argv[i], std::ref(parse_results[i - 1]));
+        std::cerr << e.what() << "\n";
+        print_usage(argv[0]);
+        return 1;
     }
 
-    for (auto &thread: parse_threads)
-        thread.join();
-
-    auto overall_success = true;
-    for (const auto &[filename, success, error_message, var_decls, symbols]: parse_results)
+    if (options.lsp)
+        return run_language_server(std::cin, std::cout, cache.get());
+
+    if (options.time_report)
+        yu::compiler::Timer::set_enabled(true);
+    if (options.perf_counters)
+        yu::compiler::Timer::set_counters_enabled(true);
+    if (options.memory_report)
+        yu::compiler::Timer::set_memory_enabled(true);
+    if (!options.trace_file.empty())
+        yu::compiler::Tracer::set_enabled(true);
+    const auto start_time = std::chrono::steady_clock::now();
+
+    const auto &files = project.files();
+    yu::compiler::ModuleLoader loader({ options.module_paths.begin(), options.module_paths.end() });
+    std::vector<uint32_t> file_modules(files.size());
+    std::vector<FileReport> reports;
+    uint32_t threads = 0;
+    if (!files.empty())
     {
+        const uint32_t jobs = options.jobs ? options.jobs : std::thread::hardware_concurrency();
+        std::vector<std::string> paths;
+        paths.reserve(files.size());
+        for (const uint32_t i: project.schedule())
         {
-            std::lock_guard lock(cout_mutex);
-            std::cout << "File: " << filename << std::endl;
+            // roots are numbered in schedule order, which is the order the reader delivers them in
+            file_modules[i] = loader.add_root(files[i].path);
+            if (file_modules[i] == paths.size())
+                paths.push_back(files[i].path);
         }
-
-        if (!success)
+        const auto roots = static_cast<uint32_t>(paths.size());
+
+        std::mutex reports_mutex;
+        // declared before the pool so workers still blocked in take() are joined first
+        yu::compiler::FileReader reader(std::move(paths), options.read_ahead.value_or(2 * std::max(jobs, 1u)));
+        yu::compiler::ThreadPool pool(std::min<uint64_t>(jobs, files.size()));
+        threads = pool.size();
+        loader.run(pool, [&reader, &cache, roots](const uint32_t module, const std::string &path)
         {
-            {
-                std::lock_guard<std::mutex> lock(cout_mutex);
-                std::cerr << "Error parsing " << filename
-                        << ": " << error_message << std::endl;
-            }
-            overall_success = false;
-        }
-        else
+            return parse_file(path, module < roots ? &reader : nullptr, module, cache.get());
+        }, [&reports, &reports_mutex, &options](const uint32_t module, yu::compiler::Module &loaded)
         {
-            std::lock_guard lock(cout_mutex);
-            for (size_t j = 0; j < var_decls.names.size(); ++j)
+            FileReport report;
+            render_report(loaded.unit, options.format, report);
+            if (options.emit_interface && loaded.unit.success &&
+                !loaded.interface.write(yu::compiler::ModuleInterface::interface_path(loaded.path).string()))
+                report.err.append("Failed to write the interface of ").append(loaded.path) += '\n';
             {
-                std::cout << "Parsed variable: " << var_decls.names[j] << std::endl;
+                std::lock_guard lock(reports_mutex);
+                if (reports.size() <= module)
+                    reports.resize(module + 1);
+                reports[module] = std::move(report);
             }
-        }
+            if (yu::compiler::Tracer::enabled())
+                yu::compiler::Tracer::counter("resident memory", yu::compiler::resident_memory_bytes());
+        });
+    }
+    reports.resize(loader.size());
+
+    // one gathered write per stream
+    std::vector<const std::string *> out_buffers, err_buffers;
+    gather_reports(reports, file_modules, out_buffers, err_buffers);
+
+    bool trace_written = true;
+    if (!options.trace_file.empty())
+    {
+        yu::compiler::Tracer::set_enabled(false);
+        std::string trace;
+        render_trace(yu::compiler::Tracer::collect(), trace);
+        std::ofstream file(options.trace_file, std::ios::binary);
+        trace_written = static_cast<bool>(file.write(trace.data(), static_cast<std::streamsize>(trace.size())));
+        if (!trace_written)
+            std::cerr << "Failed to write trace to " << options.trace_file << "\n";
+    }
+
+    std::string time_report;
+    if (options.time_report)
+    {
+        const auto wall_time = std::chrono::steady_clock::now() - start_time;
+        TimeReport report;
+        report.phases = yu::compiler::Timer::collect();
+        report.wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(wall_time).count();
+        report.threads = threads;
+        report.counters_requested = options.perf_counters;
+        report.counters_error = yu::compiler::Timer::counters_error();
+        report.memory_requested = options.memory_report;
+        report.peak_resident_bytes = yu::compiler::peak_resident_memory_bytes();
+        render_time_report(report, *options.time_report, time_report);
+        err_buffers.push_back(&time_report);
     }
+    const bool written = write_buffers(1, out_buffers) && write_buffers(2, err_buffers);
 
-    return overall_success ? 0 : 1;
+    bool overall_success = true;
+    for (uint32_t module = 0; module < loader.size(); ++module)
+        overall_success &= loader.module(module).unit.success;
+    return overall_success && written && trace_written ? 0 : 1;
 }
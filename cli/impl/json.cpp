@@ -0,0 +1,367 @@
+#include "../json.h"
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace
+{
+    class JsonReader
+    {
+    public:
+        explicit JsonReader(const std::string_view text) : text(text) {}
+
+        Json read_document()
+        {
+            Json result = read_value(0);
+            skip_whitespace();
+            if (pos != text.size())
+                fail("Trailing characters");
+            return result;
+        }
+
+    private:
+        static constexpr uint32_t max_depth = 256;
+
+        std::string_view text;
+        size_t pos = 0;
+
+        [[noreturn]] void fail(const std::string &message) const
+        {
+            throw std::runtime_error("Invalid JSON at " + std::to_string(pos) + ": " + message);
+        }
+
+        void skip_whitespace()
+        {
+            while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r'))
+                ++pos;
+        }
+
+        bool consume(const char c)
+        {
+            skip_whitespace();
+            if (pos < text.size() && text[pos] == c)
+            {
+                ++pos;
+                return true;
+            }
+            return false;
+        }
+
+        void expect(const char c)
+        {
+            if (!consume(c))
+                fail(std::string("Expected '") + c + "'");
+        }
+
+        bool consume_word(const std::string_view word)
+        {
+            if (text.substr(pos, word.size()) != word)
+                return false;
+            pos += word.size();
+            return true;
+        }
+
+        Json read_value(const uint32_t depth)
+        {
+            if (depth > max_depth)
+                fail("Nesting too deep");
+
+            skip_whitespace();
+            if (pos >= text.size())
+                fail("Unexpected end of input");
+
+            switch (text[pos])
+            {
+                case '{':
+                {
+                    ++pos;
+                    Json::Object object;
+                    if (consume('}'))
+                        return object;
+                    do
+                    {
+                        skip_whitespace();
+                        std::string key = read_string();
+                        expect(':');
+                        object.emplace_back(std::move(key), read_value(depth + 1));
+                    }
+                    while (consume(','));
+                    expect('}');
+                    return object;
+                }
+                case '[':
+                {
+                    ++pos;
+                    Json::Array array;
+                    if (consume(']'))
+                        return array;
+                    do
+                        array.emplace_back(read_value(depth + 1));
+                    while (consume(','));
+                    expect(']');
+                    return array;
+                }
+                case '"':
+                    return read_string();
+                default:
+                    break;
+            }
+
+            if (consume_word("true"))
+                return true;
+            if (consume_word("false"))
+                return false;
+            if (consume_word("null"))
+                return nullptr;
+            return read_number();
+        }
+
+        Json read_number()
+        {
+            const size_t end = text.find_first_not_of("+-0123456789.eE", pos);
+            const std::string digits(text.substr(pos, end - pos));
+            char *parsed_end = nullptr;
+            const double number = std::strtod(digits.c_str(), &parsed_end);
+            if (digits.empty() || parsed_end != digits.c_str() + digits.size())
+                fail("Expected a value");
+            pos += digits.size();
+            return number;
+        }
+
+        uint32_t read_hex4()
+        {
+            if (pos + 4 > text.size())
+                fail("Truncated escape");
+            uint32_t code = 0;
+            const auto [end, error] = std::from_chars(text.data() + pos, text.data() + pos + 4, code, 16);
+            if (error != std::errc() || end != text.data() + pos + 4)
+                fail("Invalid escape");
+            pos += 4;
+            return code;
+        }
+
+        static void append_utf8(std::string &out, const uint32_t code)
+        {
+            if (code < 0x80)
+                out += static_cast<char>(code);
+            else if (code < 0x800)
+            {
+                out += static_cast<char>(0xC0 | code >> 6);
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else if (code < 0x10000)
+            {
+                out += static_cast<char>(0xE0 | code >> 12);
+                out += static_cast<char>(0x80 | (code >> 6 & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else
+            {
+                out += static_cast<char>(0xF0 | code >> 18);
+                out += static_cast<char>(0x80 | (code >> 12 & 0x3F));
+                out += static_cast<char>(0x80 | (code >> 6 & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+        }
+
+        std::string read_string()
+        {
+            if (pos >= text.size() || text[pos] != '"')
+                fail("Expected a string");
+            ++pos;
+
+            std::string result;
+            while (true)
+            {
+                const size_t end = text.find_first_of("\"\\", pos);
+                if (end == std::string_view::npos)
+                    fail("Unterminated string");
+                result.append(text.substr(pos, end - pos));
+                pos = end + 1;
+                if (text[end] == '"')
+                    return result;
+
+                if (pos >= text.size())
+                    fail("Unterminated string");
+                switch (const char escape = text[pos++])
+                {
+                    case '"':
+                    case '\\':
+                    case '/':
+                        result += escape;
+                        break;
+                    case 'b':
+                        result += '\b';
+                        break;
+                    case 'f':
+                        result += '\f';
+                        break;
+                    case 'n':
+                        result += '\n';
+                        break;
+                    case 'r':
+                        result += '\r';
+                        break;
+                    case 't':
+                        result += '\t';
+                        break;
+                    case 'u':
+                    {
+                        uint32_t code = read_hex4();
+                        if (code >= 0xD800 && code < 0xDC00 && consume_word("\\u"))
+                        {
+                            const uint32_t low = read_hex4();
+                            if (low >= 0xDC00 && low < 0xE000)
+                                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        append_utf8(result, code);
+                        break;
+                    }
+                    default:
+                        fail("Invalid escape");
+                }
+            }
+        }
+    };
+}
+
+Json Json::parse(const std::string_view text)
+{
+    return JsonReader(text).read_document();
+}
+
+void append_json_string(std::string &out, const std::string_view text)
+{
+    static constexpr char hex[] = "0123456789abcdef";
+
+    out += '"';
+    for (const char c: text)
+    {
+        switch (c)
+        {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<uint8_t>(c) < 0x20)
+                {
+                    out += "\\u00";
+                    out += hex[c >> 4];
+                    out += hex[c & 0xF];
+                }
+                else
+                    out += c;
+        }
+    }
+    out += '"';
+}
+
+void Json::dump(std::string &out) const
+{
+    switch (value.index())
+    {
+        case 0:
+            out += "null";
+            break;
+        case 1:
+            out += std::get<bool>(value) ? "true" : "false";
+            break;
+        case 2:
+        {
+            const double number = std::get<double>(value);
+            if (!std::isfinite(number))
+            {
+                out += "null";
+                break;
+            }
+            char buffer[32];
+            const auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), number);
+            out.append(buffer, end);
+            break;
+        }
+        case 3:
+            append_json_string(out, std::get<std::string>(value));
+            break;
+        case 4:
+        {
+            out += '[';
+            const auto &array = std::get<Array>(value);
+            for (size_t i = 0; i < array.size(); ++i)
+            {
+                if (i)
+                    out += ',';
+                array[i].dump(out);
+            }
+            out += ']';
+            break;
+        }
+        default:
+        {
+            out += '{';
+            const auto &object = std::get<Object>(value);
+            for (size_t i = 0; i < object.size(); ++i)
+            {
+                if (i)
+                    out += ',';
+                append_json_string(out, object[i].first);
+                out += ':';
+                object[i].second.dump(out);
+            }
+            out += '}';
+        }
+    }
+}
+
+std::string Json::dump() const
+{
+    std::string out;
+    dump(out);
+    return out;
+}
+
+const Json &Json::operator[](const std::string_view key) const
+{
+    static const Json null;
+    if (const auto *object = std::get_if<Object>(&value))
+    {
+        for (const auto &[name, member]: *object)
+        {
+            if (name == key)
+                return member;
+        }
+    }
+    return null;
+}
+
+const std::string &Json::as_string() const
+{
+    static const std::string empty;
+    const auto *string = std::get_if<std::string>(&value);
+    return string ? *string : empty;
+}
+
+double Json::as_number() const
+{
+    const auto *number = std::get_if<double>(&value);
+    return number ? *number : 0;
+}
+
+const Json::Array &Json::as_array() const
+{
+    static const Array empty;
+    const auto *array = std::get_if<Array>(&value);
+    return array ? *array : empty;
+}
@@ -0,0 +1,325 @@
+#include "../lsp.h"
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <optional>
+#include <string>
+
+#include <compiler/include/language_service.h>
+#include <compiler/include/version.h>
+#include "../json.h"
+
+namespace
+{
+    namespace lsp_error
+    {
+        constexpr int parse_error = -32700;
+        constexpr int method_not_found = -32601;
+        constexpr int invalid_request = -32600;
+        constexpr int internal_error = -32603;
+    }
+
+    // larger messages are dropped; no editor request comes close
+    constexpr size_t max_message_length = 64 * 1024 * 1024;
+
+    /**
+     * @brief Reads the next message with a valid Content-Length; messages whose header is
+     * malformed or too large are skipped.
+     */
+    bool read_message(std::istream &in, std::string &body)
+    {
+        size_t length = 0;
+        bool has_length = false;
+        bool valid = false;
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.empty())
+            {
+                if (!has_length)
+                    continue;
+                has_length = false;
+                if (!valid)
+                    continue;
+                if (length > max_message_length)
+                {
+                    constexpr auto most = static_cast<size_t>(std::numeric_limits<std::streamsize>::max());
+                    in.ignore(static_cast<std::streamsize>(std::min(length, most)));
+                    continue;
+                }
+                body.resize(length);
+                return static_cast<bool>(in.read(body.data(), static_cast<std::streamsize>(length)));
+            }
+
+            constexpr std::string_view content_length = "Content-Length:";
+            if (line.starts_with(content_length))
+            {
+                std::string_view value = std::string_view(line).substr(content_length.size());
+                while (!value.empty() && value.front() == ' ')
+                    value.remove_prefix(1);
+                const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), length);
+                valid = error == std::errc() && end == value.data() + value.size();
+                has_length = true;
+            }
+        }
+        return false;
+    }
+
+    void write_message(std::ostream &out, const Json &message)
+    {
+        const std::string body = message.dump();
+        out << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+        out.flush();
+    }
+
+    std::string uri_to_path(const std::string_view uri)
+    {
+        std::string_view path = uri;
+        if (path.starts_with("file://"))
+            path.remove_prefix(7);
+
+        // a malformed escape such as "%zz" is kept as written
+        std::string result;
+        for (size_t i = 0; i < path.size(); ++i)
+        {
+            unsigned char byte = 0;
+            if (path[i] == '%' && i + 2 < path.size())
+            {
+                const char *digits = path.data() + i + 1;
+                const auto [end, error] = std::from_chars(digits, digits + 2, byte, 16);
+                if (error == std::errc() && end == digits + 2)
+                {
+                    result += static_cast<char>(byte);
+                    i += 2;
+                    continue;
+                }
+            }
+            result += path[i];
+        }
+        return result;
+    }
+
+    Json to_json(const yu::compiler::Position &position)
+    {
+        return Json::Object { { "line", position.line }, { "character", position.character } };
+    }
+
+    Json to_json(const yu::compiler::Range &range)
+    {
+        return Json::Object { { "start", to_json(range.start) }, { "end", to_json(range.end) } };
+    }
+
+    yu::compiler::Position position_from_json(const Json &position)
+    {
+        return {
+            static_cast<uint32_t>(position["line"].as_number()),
+            static_cast<uint32_t>(position["character"].as_number())
+        };
+    }
+
+    class LanguageServer
+    {
+    public:
+        LanguageServer(std::ostream &out, const yu::compiler::UnitCache *cache) : out(out), service(cache) {}
+
+        /**
+         * @brief Handles one message.
+         * @return bool False once the client sent `exit`.
+         */
+        bool handle(const Json &message)
+        {
+            const std::string &method = message["method"].as_string();
+            const Json &id = message["id"];
+            const Json &params = message["params"];
+
+            if (method == "exit")
+                return false;
+
+            if (method == "initialize")
+                respond(id, initialize_result());
+            else if (method == "shutdown")
+            {
+                shutdown_requested = true;
+                respond(id, nullptr);
+            }
+            else if (method == "textDocument/didOpen")
+            {
+                const Json &document = params["textDocument"];
+                const std::string &uri = document["uri"].as_string();
+                publish_diagnostics(uri, &service.open(uri, uri_to_path(uri), document["text"].as_string()));
+            }
+            else if (method == "textDocument/didChange")
+                did_change(params);
+            else if (method == "textDocument/didClose")
+            {
+                const std::string &uri = params["textDocument"]["uri"].as_string();
+                service.close(uri);
+                publish_diagnostics(uri, nullptr);
+            }
+            else if (method == "textDocument/documentSymbol")
+                respond(id, document_symbols(params));
+            else if (method == "textDocument/definition")
+                respond(id, definition(params));
+            else if (!id.is_null())
+                respond_error(id, lsp_error::method_not_found, "Method not found: " + method);
+
+            return true;
+        }
+
+        void respond_error(const Json &id, const int code, const std::string &message)
+        {
+            write_message(out, Json::Object {
+                { "jsonrpc", "2.0" },
+                { "id", id },
+                { "error", Json::Object { { "code", code }, { "message", message } } }
+            });
+        }
+
+        [[nodiscard]] bool shut_down() const
+        {
+            return shutdown_requested;
+        }
+
+    private:
+        std::ostream &out;
+        yu::compiler::LanguageService service;
+        bool shutdown_requested = false;
+
+        void respond(const Json &id, Json result)
+        {
+            write_message(out, Json::Object { { "jsonrpc", "2.0" }, { "id", id }, { "result", std::move(result) } });
+        }
+
+        static Json initialize_result()
+        {
+            return Json::Object {
+                {
+                    "capabilities", Json::Object {
+                        { "textDocumentSync", Json::Object { { "openClose", true }, { "change", 2 } } },
+                        { "documentSymbolProvider", true },
+                        { "definitionProvider", true }
+                    }
+                },
+                { "serverInfo", Json::Object { { "name", "yu" }, { "version", yu::compiler::compiler_version } } }
+            };
+        }
+
+        void did_change(const Json &params)
+        {
+            const std::string &uri = params["textDocument"]["uri"].as_string();
+            const yu::compiler::CompilationUnit *unit = service.find(uri);
+            for (const auto &change: params["contentChanges"].as_array())
+            {
+                std::optional<yu::compiler::Range> range;
+                if (const Json &json_range = change["range"]; json_range.is_object())
+                    range = yu::compiler::Range { position_from_json(json_range["start"]),
+                                                  position_from_json(json_range["end"]) };
+                unit = service.change(uri, range, change["text"].as_string());
+            }
+
+            if (unit)
+                publish_diagnostics(uri, unit);
+        }
+
+        void publish_diagnostics(const std::string &uri, const yu::compiler::CompilationUnit *unit)
+        {
+            Json::Array diagnostics;
+            if (unit)
+            {
+                for (const auto &diagnostic: yu::compiler::LanguageService::diagnostics(*unit))
+                {
+                    diagnostics.emplace_back(Json::Object {
+                        { "range", to_json(diagnostic.range) },
+                        { "severity", diagnostic.severity == yu::compiler::ErrorSeverity::WARNING ? 2 : 1 },
+                        { "code", diagnostic.code },
+                        { "source", "yu" },
+                        { "message", diagnostic.message }
+                    });
+                }
+            }
+
+            write_message(out, Json::Object {
+                { "jsonrpc", "2.0" },
+                { "method", "textDocument/publishDiagnostics" },
+                { "params", Json::Object { { "uri", uri }, { "diagnostics", std::move(diagnostics) } } }
+            });
+        }
+
+        Json document_symbols(const Json &params) const
+        {
+            const auto *unit = service.find(params["textDocument"]["uri"].as_string());
+            if (!unit)
+                return nullptr;
+
+            Json::Array symbols;
+            for (const auto &symbol: yu::compiler::LanguageService::document_symbols(*unit))
+            {
+                int kind = 13; // Variable
+                if (symbol.kind == yu::compiler::SymbolKind::FUNCTION)
+                    kind = 12;
+                else if (symbol.kind == yu::compiler::SymbolKind::CONSTANT)
+                    kind = 14;
+
+                symbols.emplace_back(Json::Object {
+                    { "name", symbol.name },
+                    { "kind", kind },
+                    { "range", to_json(symbol.range) },
+                    { "selectionRange", to_json(symbol.selection_range) }
+                });
+            }
+            return symbols;
+        }
+
+        Json definition(const Json &params) const
+        {
+            const std::string &uri = params["textDocument"]["uri"].as_string();
+            const auto *unit = service.find(uri);
+            if (!unit)
+                return nullptr;
+
+            const auto range = yu::compiler::LanguageService::definition(*unit, position_from_json(params["position"]));
+            if (!range)
+                return nullptr;
+            return Json::Object { { "uri", uri }, { "range", to_json(*range) } };
+        }
+    };
+}
+
+int run_language_server(std::istream &in, std::ostream &out, const yu::compiler::UnitCache *cache)
+{
+    LanguageServer server(out, cache);
+    std::string body;
+    while (read_message(in, body))
+    {
+        Json message;
+        try
+        {
+            message = Json::parse(body);
+        }
+        catch (const std::exception &e)
+        {
+            server.respond_error(nullptr, lsp_error::parse_error, e.what());
+            continue;
+        }
+
+        if (!message.is_object())
+        {
+            server.respond_error(nullptr, lsp_error::invalid_request, "Expected a JSON-RPC object");
+            continue;
+        }
+
+        try
+        {
+            if (!server.handle(message))
+                return server.shut_down() ? 0 : 1;
+        }
+        catch (const std::exception &e)
+        {
+            if (const Json &id = message["id"]; !id.is_null())
+                server.respond_error(id, lsp_error::internal_error, e.what());
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,160 @@
+#include "../options.h"
+#include <charconv>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+
+static bool match_value(const std::string_view arg, const std::string_view name, std::string &value)
+{
+    if (!arg.starts_with(name) || arg.size() <= name.size() || arg[name.size()] != '=')
+        return false;
+
+    value = arg.substr(name.size() + 1);
+    return true;
+}
+
+static OutputFormat parse_format(const std::string_view value)
+{
+    if (value == "text")
+        return OutputFormat::TEXT;
+    if (value == "json")
+        return OutputFormat::JSON;
+    throw std::runtime_error("Unknown output format: " + std::string(value));
+}
+
+static uint32_t parse_jobs(const std::string_view value)
+{
+    uint32_t jobs = 0;
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), jobs);
+    if (error != std::errc() || end != value.data() + value.size() || jobs == 0)
+        throw std::runtime_error("Invalid job count: " + std::string(value));
+    return jobs;
+}
+
+static uint32_t parse_read_ahead(const std::string_view value)
+{
+    uint32_t files = 0;
+    const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), files);
+    if (error != std::errc() || end != value.data() + value.size())
+        throw std::runtime_error("Invalid read-ahead: " + std::string(value));
+    return files;
+}
+
+Options parse_options(const int argc, char *argv[])
+{
+    Options options;
+    for (auto i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (match_value(arg, "--cache-dir", options.cache_dir))
+            continue;
+
+        if (match_value(arg, "--trace", options.trace_file))
+            continue;
+
+        if (std::string format; match_value(arg, "--format", format))
+        {
+            options.format = parse_format(format);
+            continue;
+        }
+
+        if (arg == "--time-report")
+        {
+            options.time_report = OutputFormat::TEXT;
+            continue;
+        }
+
+        if (std::string format; match_value(arg, "--time-report", format))
+        {
+            options.time_report = format == "table" ? OutputFormat::TEXT : parse_format(format);
+            continue;
+        }
+
+        if (std::string files; match_value(arg, "--read-ahead", files))
+        {
+            options.read_ahead = parse_read_ahead(files);
+            continue;
+        }
+
+        if (std::string directory; match_value(arg, "--module-path", directory))
+        {
+            options.module_paths.emplace_back(std::move(directory));
+            continue;
+        }
+
+        if (std::string project; match_value(arg, "--project", project))
+        {
+            options.projects.emplace_back(std::move(project));
+            continue;
+        }
+
+        if (arg == "-j")
+        {
+            if (++i == argc)
+                throw std::runtime_error("Missing job count after -j");
+            options.jobs = parse_jobs(argv[i]);
+            continue;
+        }
+
+        if (arg.starts_with("-j"))
+        {
+            options.jobs = parse_jobs(arg.substr(2));
+            continue;
+        }
+
+        if (arg == "--perf-counters")
+        {
+            options.perf_counters = true;
+            continue;
+        }
+
+        if (arg == "--mem-report")
+        {
+            options.memory_report = true;
+            continue;
+        }
+
+        if (arg == "--lsp")
+        {
+            options.lsp = true;
+            continue;
+        }
+
+        if (arg == "--emit-interface")
+        {
+            options.emit_interface = true;
+            continue;
+        }
+
+        if (arg.starts_with("--"))
+            throw std::runtime_error("Unknown option: " + std::string(arg));
+
+        options.files.emplace_back(arg);
+    }
+
+    if ((options.perf_counters || options.memory_report) && !options.time_report)
+        options.time_report = OutputFormat::TEXT;
+
+    if (options.files.empty() && options.projects.empty() && !options.lsp)
+        throw std::runtime_error("No input files");
+
+    return options;
+}
+
+void print_usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " [options] <file1> [file2] ...\n"
+            << "Options:\n"
+            << "  --cache-dir=<dir>   Reuse lexed and parsed units stored in <dir>\n"
+            << "  --project=<path>    Compile the .yu files of a directory or listed in a manifest\n"
+            << "  --format=<fmt>      Report results as 'text' (default) or 'json' (one object per line)\n"
+            << "  --lsp               Serve the language server protocol on stdin/stdout\n"
+            << "  --time-report[=<f>] Print per-phase timings to stderr as a 'table' (default) or 'json'\n"
+            << "  --perf-counters     Add hardware counters (cycles, IPC, misses) to the time report\n"
+            << "  --mem-report        Add peak/retained memory and bytes per token to the time report\n"
+            << "  --trace=<file>      Write a Chrome/Perfetto trace of the compile to <file>\n"
+            << "  --module-path=<dir> Also look for imported modules in <dir> (repeatable)\n"
+            << "  --emit-interface    Write a precompiled interface (.yui) next to each compiled file\n"
+            << "  --read-ahead=<n>    Read up to <n> files ahead of the workers (default: two per worker)\n"
+            << "  -j <n>              Parse with <n> worker threads (default: one per core)\n";
+}
@@ -0,0 +1,201 @@
+#include "../report.h"
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+
+#include <common/arch.hpp>
+#include <common/styles.h>
+#include "../json.h"
+
+#if defined(YUMINA_OS_WINDOWS)
+    #include <cstdio>
+#else
+    #include <climits>
+    #include <sys/uio.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    /**
+     * @brief Appends a diagnostic the way the parser prints it when emitting diagnostics itself.
+     */
+    void append_diagnostic(std::string &out, const yu::compiler::ParseError &error, const std::string_view file_name)
+    {
+        using namespace yu::styles::color;
+        const bool warning = error.severity == yu::compiler::ErrorSeverity::WARNING;
+        const std::string line = std::to_string(error.line);
+
+        out.append(warning ? YELLOW : RED).append(warning ? "warning" : "error").append(RESET);
+        out.append(": ").append(error.message) += '\n';
+        out.append("  ").append(BLUE).append("-->").append(RESET) += ' ';
+        out.append(file_name).append(":").append(line).append(":").append(std::to_string(error.column)) += '\n';
+        if (!error.source_line.empty())
+        {
+            out.append(BLUE).append("   |").append(RESET) += '\n';
+            out.append(BLUE).append(line.size() < 3 ? 3 - line.size() : 0, ' ').append(line).append("|");
+            out.append(RESET).append(" ").append(error.source_line) += '\n';
+            out.append(BLUE).append("   |").append(RESET).append(" ").append(error.error_pointer) += '\n';
+        }
+        if (!error.suggestion.empty())
+        {
+            out.append(BLUE).append("   |").append(RESET) += '\n';
+            out.append(BLUE).append("   = ").append(RESET).append(GREEN).append("help").append(RESET);
+            out.append(": ").append(error.suggestion) += '\n';
+        }
+        out.append(BLUE).append("   = ").append(RESET).append("note: error[");
+        out.append(yu::compiler::Parser::get_error_code(error.flags)).append("]\n");
+    }
+
+    void render_text(const yu::compiler::CompilationUnit &unit, FileReport &report)
+    {
+        constexpr std::string_view file_prefix = "File: ";
+        constexpr std::string_view variable_prefix = "Parsed variable: ";
+
+        const std::string_view file_name = unit.file_name();
+        size_t size = file_prefix.size() + file_name.size() + 1;
+        for (const auto &name: unit.var_decls.names)
+            size += variable_prefix.size() + name.size() + 1;
+        report.out.reserve(size);
+
+        report.out.append(file_prefix).append(file_name) += '\n';
+        // diagnostics go with the rest of the file's report instead of straight to stderr from the worker
+        for (const auto *list: { &unit.errors, &unit.warnings })
+        {
+            for (const auto &error: *list)
+                append_diagnostic(report.err, error, file_name);
+        }
+        if (!unit.success)
+        {
+            report.err.append("Error parsing ").append(file_name).append(": ").append(unit.error_message) += '\n';
+            return;
+        }
+
+        for (const auto &name: unit.var_decls.names)
+            report.out.append(variable_prefix).append(name) += '\n';
+    }
+
+    void render_json(const yu::compiler::CompilationUnit &unit, FileReport &report)
+    {
+        size_t size = 64 + unit.error_message.size() + std::char_traits<char>::length(unit.file_name());
+        for (const auto &name: unit.var_decls.names)
+            size += name.size() + 3;
+        report.out.reserve(size);
+
+        std::string &out = report.out;
+        out += "{\"file\":";
+        append_json_string(out, unit.file_name());
+        out += ",\"success\":";
+        out += unit.success ? "true" : "false";
+
+        out += ",\"variables\":[";
+        for (size_t i = 0; i < unit.var_decls.names.size(); ++i)
+        {
+            if (i)
+                out += ',';
+            append_json_string(out, unit.var_decls.names[i]);
+        }
+        out += ']';
+
+        out += ",\"diagnostics\":[";
+        bool first = true;
+        for (const auto *list: { &unit.errors, &unit.warnings })
+        {
+            for (const auto &error: *list)
+            {
+                if (!first)
+                    out += ',';
+                first = false;
+                out += "{\"severity\":";
+                out += error.severity == yu::compiler::ErrorSeverity::WARNING ? "\"warning\"" : "\"error\"";
+                out += ",\"code\":";
+                append_json_string(out, yu::compiler::Parser::get_error_code(error.flags));
+                out.append(",\"line\":").append(std::to_string(error.line));
+                out.append(",\"column\":").append(std::to_string(error.column));
+                out += ",\"message\":";
+                append_json_string(out, error.message);
+                out += '}';
+            }
+        }
+        out += ']';
+
+        if (!unit.success)
+        {
+            out += ",\"error\":";
+            append_json_string(out, unit.error_message);
+        }
+        out += "}\n";
+    }
+}
+
+void render_report(const yu::compiler::CompilationUnit &unit, const OutputFormat format, FileReport &report)
+{
+    if (format == OutputFormat::JSON)
+        render_json(unit, report);
+    else
+        render_text(unit, report);
+}
+
+void gather_reports(const std::span<const FileReport> reports, const std::span<const uint32_t> file_modules,
+                    std::vector<const std::string *> &out, std::vector<const std::string *> &err)
+{
+    out.reserve(out.size() + reports.size());
+    err.reserve(err.size() + reports.size());
+    std::vector<bool> listed(reports.size());
+    const auto add = [&](const uint32_t module)
+    {
+        if (listed[module])
+            return;
+        listed[module] = true;
+        out.push_back(&reports[module].out);
+        err.push_back(&reports[module].err);
+    };
+    for (const uint32_t module: file_modules)
+        add(module);
+    for (uint32_t module = 0; module < reports.size(); ++module)
+        add(module);
+}
+
+bool write_buffers(const int fd, const std::span<const std::string *const> buffers)
+{
+#if defined(YUMINA_OS_WINDOWS)
+    FILE *stream = fd == 2 ? stderr : stdout;
+    for (const auto *buffer: buffers)
+    {
+        if (fwrite(buffer->data(), 1, buffer->size(), stream) != buffer->size())
+            return false;
+    }
+    return fflush(stream) == 0;
+#else
+    std::vector<iovec> chunks;
+    chunks.reserve(buffers.size());
+    for (const auto *buffer: buffers)
+    {
+        if (!buffer->empty())
+            chunks.push_back({ const_cast<char *>(buffer->data()), buffer->size() });
+    }
+
+    size_t next = 0;
+    while (next < chunks.size())
+    {
+        const int count = static_cast<int>(std::min<size_t>(chunks.size() - next, IOV_MAX));
+        ssize_t written = writev(fd, chunks.data() + next, count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        // skip what was written; a partially written chunk is resumed from where it stopped
+        while (next < chunks.size() && static_cast<size_t>(written) >= chunks[next].iov_len)
+            written -= static_cast<ssize_t>(chunks[next++].iov_len);
+        if (written > 0)
+        {
+            chunks[next].iov_base = static_cast<char *>(chunks[next].iov_base) + written;
+            chunks[next].iov_len -= written;
+        }
+    }
+    return true;
+#endif
+}
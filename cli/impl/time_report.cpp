@@ -0,0 +1,249 @@
+#include "../time_report.h"
+#include <algorithm>
+#include <cstdio>
+#include <string_view>
+
+#include "../json.h"
+
+namespace
+{
+    using yu::compiler::PerfCounter;
+    using yu::compiler::PhaseStats;
+
+    double to_ms(const uint64_t ns)
+    {
+        return static_cast<double>(ns) / 1e6;
+    }
+
+    double megabytes_per_second(const PhaseStats &phase)
+    {
+        return phase.total_ns ? static_cast<double>(phase.bytes) * 1e3 / static_cast<double>(phase.total_ns) : 0;
+    }
+
+    bool has_counter(const PhaseStats &phase, const PerfCounter counter)
+    {
+        return phase.counter_mask & 1u << static_cast<uint32_t>(counter);
+    }
+
+    uint64_t counter(const PhaseStats &phase, const PerfCounter counter)
+    {
+        return phase.counters[static_cast<uint32_t>(counter)];
+    }
+
+    double ratio(const uint64_t numerator, const uint64_t denominator)
+    {
+        return denominator ? static_cast<double>(numerator) / static_cast<double>(denominator) : 0;
+    }
+
+    void append_formatted(std::string &out, const char *format, const auto... values)
+    {
+        char buffer[128];
+        const int length = std::snprintf(buffer, sizeof(buffer), format, values...);
+        if (length > 0)
+            out.append(buffer, std::min<size_t>(static_cast<size_t>(length), sizeof(buffer) - 1));
+    }
+
+    void append_count(std::string &out, const bool present, const uint64_t value)
+    {
+        if (present)
+            append_formatted(out, " %10llu", static_cast<unsigned long long>(value));
+        else
+            append_formatted(out, " %10s", "-");
+    }
+
+    void append_ratio(std::string &out, const bool present, const double value)
+    {
+        if (present)
+            append_formatted(out, " %10.3f", value);
+        else
+            append_formatted(out, " %10s", "-");
+    }
+
+    std::string indented_name(const PhaseStats &phase)
+    {
+        std::string label(phase.depth * 2, ' ');
+        label += phase.name;
+        return label;
+    }
+
+    void render_counter_table(const TimeReport &report, std::string &out)
+    {
+        const bool any = std::ranges::any_of(report.phases, [](const auto &phase) { return phase.counter_mask != 0; });
+        if (!any)
+        {
+            out.append("Hardware counters unavailable");
+            if (!report.counters_error.empty())
+                out.append(": ").append(report.counters_error);
+            out += '\n';
+            return;
+        }
+
+        // misses per kilobyte keep the small rates readable
+        append_formatted(out, "%-24s %10s %10s %10s %10s %10s %10s %10s %10s\n", "Phase", "Mcycles", "Minstr",
+                         "IPC", "Cycles/B", "Instr/B", "BrMiss/KB", "L1dMiss/KB", "LLCMiss/KB");
+        for (const auto &phase: report.phases)
+        {
+            const bool cycles = has_counter(phase, PerfCounter::CYCLES);
+            const bool instructions = has_counter(phase, PerfCounter::INSTRUCTIONS);
+            const bool bytes = phase.bytes != 0;
+            const double kilobytes = static_cast<double>(phase.bytes) / 1024;
+
+            // estimated counts are starred
+            append_formatted(out, "%-24s", (indented_name(phase) + (phase.counters_multiplexed ? "*" : "")).c_str());
+            append_ratio(out, cycles, static_cast<double>(counter(phase, PerfCounter::CYCLES)) / 1e6);
+            append_ratio(out, instructions, static_cast<double>(counter(phase, PerfCounter::INSTRUCTIONS)) / 1e6);
+            append_ratio(out, cycles && instructions,
+                         ratio(counter(phase, PerfCounter::INSTRUCTIONS), counter(phase, PerfCounter::CYCLES)));
+            append_ratio(out, cycles && bytes, ratio(counter(phase, PerfCounter::CYCLES), phase.bytes));
+            append_ratio(out, instructions && bytes, ratio(counter(phase, PerfCounter::INSTRUCTIONS), phase.bytes));
+            for (const auto miss: { PerfCounter::BRANCH_MISSES, PerfCounter::L1D_MISSES, PerfCounter::LLC_MISSES })
+            {
+                append_ratio(out, has_counter(phase, miss) && bytes,
+                             static_cast<double>(counter(phase, miss)) / kilobytes);
+            }
+            out += '\n';
+        }
+        if (std::ranges::any_of(report.phases, [](const auto &phase) { return phase.counters_multiplexed; }))
+            out.append("* counters were multiplexed; counts are scaled by time enabled / time running\n");
+    }
+
+    double to_kilobytes(const int64_t bytes)
+    {
+        return static_cast<double>(bytes) / 1024;
+    }
+
+    double signed_ratio(const int64_t numerator, const uint64_t denominator)
+    {
+        return denominator ? static_cast<double>(numerator) / static_cast<double>(denominator) : 0;
+    }
+
+    void render_memory_table(const TimeReport &report, std::string &out)
+    {
+        append_formatted(out, "Memory: peak RSS %.1f MB, counting %s\n",
+                         static_cast<double>(report.peak_resident_bytes) / (1024 * 1024),
+                         yu::compiler::tracks_global_new() ? "all heap allocations" : "front-end columns");
+        // peak is the largest of one call (one file for per-file phases), the rest are summed
+        append_formatted(out, "%-24s %10s %10s %10s %10s %10s %10s %10s\n", "Phase", "Peak KB", "Kept KB",
+                         "Alloc KB", "Allocs", "Kept B/tok", "Alloc B/tok", "Kept B/decl");
+        for (const auto &phase: report.phases)
+        {
+            if (!phase.memory_tracked)
+                continue;
+
+            const bool tokens = phase.tokens != 0;
+            append_formatted(out, "%-24s %10.1f %10.1f %10.1f", indented_name(phase).c_str(),
+                             to_kilobytes(phase.peak_bytes), to_kilobytes(phase.retained_bytes),
+                             to_kilobytes(static_cast<int64_t>(phase.allocated_bytes)));
+            append_count(out, true, phase.allocations);
+            append_ratio(out, tokens, signed_ratio(phase.retained_bytes, phase.tokens));
+            append_ratio(out, tokens, ratio(phase.allocated_bytes, phase.tokens));
+            append_ratio(out, phase.declarations != 0, signed_ratio(phase.retained_bytes, phase.declarations));
+            out += '\n';
+        }
+    }
+
+    void render_table(const TimeReport &report, std::string &out)
+    {
+        append_formatted(out, "Time report: %.3f ms wall on %u thread(s)\n", to_ms(report.wall_ns), report.threads);
+        append_formatted(out, "%-24s %8s %11s %10s %10s %10s %10s %10s\n",
+                         "Phase", "Calls", "Total ms", "Min ms", "Avg ms", "Max ms", "MB/s", "Tokens");
+        for (const auto &phase: report.phases)
+        {
+            append_formatted(out, "%-24s %8llu %11.3f %10.3f %10.3f %10.3f",
+                             indented_name(phase).c_str(), static_cast<unsigned long long>(phase.calls),
+                             to_ms(phase.total_ns), to_ms(phase.min_ns), to_ms(phase.avg_ns()), to_ms(phase.max_ns));
+            append_ratio(out, phase.bytes != 0, megabytes_per_second(phase));
+            append_count(out, phase.tokens != 0, phase.tokens);
+            out += '\n';
+        }
+
+        if (report.counters_requested)
+            render_counter_table(report, out);
+        if (report.memory_requested)
+            render_memory_table(report, out);
+    }
+
+    void render_json(const TimeReport &report, std::string &out)
+    {
+        Json::Array rows;
+        rows.reserve(report.phases.size());
+        for (const auto &phase: report.phases)
+        {
+            Json::Object row {
+                { "phase", phase.path },
+                { "depth", phase.depth },
+                { "calls", static_cast<int64_t>(phase.calls) },
+                { "samples", static_cast<int64_t>(phase.samples) },
+                { "total_ms", to_ms(phase.total_ns) },
+                { "min_ms", to_ms(phase.min_ns) },
+                { "avg_ms", to_ms(phase.avg_ns()) },
+                { "max_ms", to_ms(phase.max_ns) },
+                { "bytes", static_cast<int64_t>(phase.bytes) },
+                { "tokens", static_cast<int64_t>(phase.tokens) },
+                { "declarations", static_cast<int64_t>(phase.declarations) }
+            };
+
+            if (phase.memory_tracked)
+            {
+                Json::Object memory {
+                    { "peak_bytes", phase.peak_bytes },
+                    { "retained_bytes", phase.retained_bytes },
+                    { "allocated_bytes", static_cast<int64_t>(phase.allocated_bytes) },
+                    { "allocations", static_cast<int64_t>(phase.allocations) }
+                };
+                if (phase.tokens)
+                    memory.emplace_back("retained_bytes_per_token", signed_ratio(phase.retained_bytes, phase.tokens));
+                if (phase.declarations)
+                {
+                    memory.emplace_back("retained_bytes_per_declaration",
+                                        signed_ratio(phase.retained_bytes, phase.declarations));
+                }
+                row.emplace_back("memory", std::move(memory));
+            }
+
+            if (phase.counter_mask)
+            {
+                Json::Object counters, per_byte;
+                for (uint32_t i = 0; i < yu::compiler::perf_counter_count; ++i)
+                {
+                    const auto id = static_cast<PerfCounter>(i);
+                    if (!has_counter(phase, id))
+                        continue;
+                    counters.emplace_back(yu::compiler::perf_counter_name(id), static_cast<int64_t>(counter(phase, id)));
+                    if (phase.bytes)
+                        per_byte.emplace_back(yu::compiler::perf_counter_name(id), ratio(counter(phase, id), phase.bytes));
+                }
+                row.emplace_back("counters", std::move(counters));
+                if (phase.counters_multiplexed)
+                    row.emplace_back("counters_multiplexed", true);
+                if (phase.bytes)
+                    row.emplace_back("counters_per_byte", std::move(per_byte));
+            }
+            rows.emplace_back(std::move(row));
+        }
+
+        Json::Object document {
+            { "wall_ms", to_ms(report.wall_ns) },
+            { "threads", report.threads },
+            { "phases", std::move(rows) }
+        };
+        if (report.counters_requested && !report.counters_error.empty())
+            document.emplace_back("counters_error", report.counters_error);
+        if (report.memory_requested)
+        {
+            document.emplace_back("peak_resident_bytes", static_cast<int64_t>(report.peak_resident_bytes));
+            document.emplace_back("all_allocations_counted", yu::compiler::tracks_global_new());
+        }
+
+        Json(std::move(document)).dump(out);
+        out += '\n';
+    }
+}
+
+void render_time_report(const TimeReport &report, const OutputFormat format, std::string &out)
+{
+    if (format == OutputFormat::JSON)
+        render_json(report, out);
+    else
+        render_table(report, out);
+}
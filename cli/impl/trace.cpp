@@ -0,0 +1,83 @@
+#include "../trace.h"
+#include <cstdio>
+
+#include "../json.h"
+
+namespace
+{
+    constexpr std::string_view process_id = "1";
+
+    void append_microseconds(std::string &out, const uint64_t ns)
+    {
+        char buffer[32];
+        const int length = std::snprintf(buffer, sizeof(buffer), "%llu.%03llu",
+                                         static_cast<unsigned long long>(ns / 1000),
+                                         static_cast<unsigned long long>(ns % 1000));
+        out.append(buffer, static_cast<size_t>(length));
+    }
+
+    void append_event_header(std::string &out, const char *name, const char phase, const uint32_t thread)
+    {
+        out += "{\"name\":";
+        append_json_string(out, name);
+        out.append(",\"ph\":\"") += phase;
+        out.append("\",\"pid\":").append(process_id);
+        out.append(",\"tid\":").append(std::to_string(thread));
+    }
+}
+
+void render_trace(const std::span<const yu::compiler::TraceThread> threads, std::string &out)
+{
+    size_t size = 64;
+    for (const auto &thread: threads)
+        size += 96 * (thread.events.size() + 1);
+    out.reserve(out.size() + size);
+
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    const auto separate = [&]
+    {
+        if (!first)
+            out += ",\n";
+        first = false;
+    };
+
+    for (const auto &thread: threads)
+    {
+        separate();
+        append_event_header(out, "thread_name", 'M', thread.id);
+        out += ",\"args\":{\"name\":";
+        append_json_string(out, thread.name);
+        out += "}}";
+
+        for (const auto &event: thread.events)
+        {
+            separate();
+            if (event.type == yu::compiler::TraceEventType::SPAN)
+            {
+                append_event_header(out, event.name, 'X', thread.id);
+                out += ",\"ts\":";
+                append_microseconds(out, event.start_ns);
+                out += ",\"dur\":";
+                append_microseconds(out, event.duration_ns);
+                if (!event.detail.empty())
+                {
+                    out += ",\"args\":{\"detail\":";
+                    append_json_string(out, event.detail);
+                    out += '}';
+                }
+            }
+            else
+            {
+                append_event_header(out, event.name, 'C', thread.id);
+                out += ",\"ts\":";
+                append_microseconds(out, event.start_ns);
+                out += ",\"args\":{";
+                append_json_string(out, event.name);
+                out.append(":").append(std::to_string(event.value)) += '}';
+            }
+            out += '}';
+        }
+    }
+    out += "]}\n";
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/**
+ * @brief A JSON document: enough of it for the language server protocol.
+ *
+ * Objects keep their members in insertion order and look keys up linearly, which suits the small
+ * messages exchanged with an editor.
+ */
+class Json
+{
+public:
+    using Array = std::vector<Json>;
+    using Object = std::vector<std::pair<std::string, Json>>;
+
+    Json() = default;
+
+    Json(std::nullptr_t) {}
+
+    Json(bool value) : value(value) {}
+
+    Json(double value) : value(value) {}
+
+    Json(int value) : value(static_cast<double>(value)) {}
+
+    Json(uint32_t value) : value(static_cast<double>(value)) {}
+
+    Json(int64_t value) : value(static_cast<double>(value)) {}
+
+    Json(const char *value) : value(std::string(value)) {}
+
+    Json(std::string_view value) : value(std::string(value)) {}
+
+    Json(std::string value) : value(std::move(value)) {}
+
+    Json(Array value) : value(std::move(value)) {}
+
+    Json(Object value) : value(std::move(value)) {}
+
+    /**
+     * @brief Parses a JSON text.
+     * @throws std::runtime_error on malformed input.
+     */
+    static Json parse(std::string_view text);
+
+    /**
+     * @brief Appends the compact serialization of this value to `out`.
+     */
+    void dump(std::string &out) const;
+
+    [[nodiscard]] std::string dump() const;
+
+    /**
+     * @brief Gets an object member, or null if this is not an object or has no such member.
+     */
+    const Json &operator[](std::string_view key) const;
+
+    [[nodiscard]] bool is_null() const { return std::holds_alternative<std::monostate>(value); }
+
+    [[nodiscard]] bool is_object() const { return std::holds_alternative<Object>(value); }
+
+    [[nodiscard]] bool is_string() const { return std::holds_alternative<std::string>(value); }
+
+    [[nodiscard]] bool is_number() const { return std::holds_alternative<double>(value); }
+
+    /**
+     * @brief The value as a string, or an empty string if it is not one.
+     */
+    [[nodiscard]] const std::string &as_string() const;
+
+    /**
+     * @brief The value as a number, or 0 if it is not one.
+     */
+    [[nodiscard]] double as_number() const;
+
+    /**
+     * @brief The value as an array, or an empty array if it is not one.
+     */
+    [[nodiscard]] const Array &as_array() const;
+
+private:
+    std::variant<std::monostate, bool, double, std::string, Array, Object> value;
+};
+
+/**
+ * @brief Appends `text` to `out` as a quoted JSON string.
+ */
+void append_json_string(std::string &out, std::string_view text);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <istream>
+#include <ostream>
+
+namespace yu::compiler
+{
+    class UnitCache;
+}
+
+/**
+ * @brief Serves the language server protocol over a pair of streams until the client sends `exit`.
+ *
+ * Open documents stay parsed in memory for the whole session; edits are applied incrementally and
+ * diagnostics, document symbols and go-to-definition are answered from that state.
+ * @param in The client's messages (JSON-RPC with Content-Length framing).
+ * @param out Responses and notifications.
+ * @param cache Optional unit cache used when a document is opened.
+ * @return int The process exit code: 0 if `shutdown` preceded `exit`, 1 otherwise.
+ */
+int run_language_server(std::istream &in, std::ostream &out, const yu::compiler::UnitCache *cache);
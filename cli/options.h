@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "report.h"
+
+struct Options
+{
+    std::vector<std::string> files;
+    std::vector<std::string> projects;
+    std::vector<std::string> module_paths; // searched for imports not found next to the importing file
+    std::string cache_dir;
+    uint32_t jobs = 0; // 0 = hardware concurrency
+    std::optional<uint32_t> read_ahead; // files read ahead of the workers, default two per worker
+    OutputFormat format = OutputFormat::TEXT;
+    bool lsp = false;
+    bool emit_interface = false; // write a .yui module interface next to each cleanly compiled file
+    std::optional<OutputFormat> time_report; // TEXT renders a table
+    bool perf_counters = false;              // adds hardware counters to the time report
+    bool memory_report = false;              // adds allocation statistics to the time report
+    std::string trace_file;                  // Chrome trace-event output, empty = no tracing
+};
+
+/**
+ * @brief Parses the command line.
+ * @throws std::runtime_error on an unknown or malformed option.
+ */
+Options parse_options(int argc, char *argv[]);
+
+void print_usage(const char *program);
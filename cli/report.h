@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <compiler/include/compilation_unit.h>
+
+enum class OutputFormat
+{
+    TEXT, // human-readable lines
+    JSON  // one JSON object per file (JSON lines)
+};
+
+/**
+ * @brief The rendered result of one file, ready to be written out.
+ */
+struct FileReport
+{
+    std::string out; // for stdout
+    std::string err; // for stderr
+};
+
+/**
+ * @brief Renders the result of one unit. Meant to run on the worker that parsed it.
+ * @param unit The parsed unit.
+ * @param format The output format.
+ * @param report Receives the text; its buffers are sized up front and then appended to.
+ */
+void render_report(const yu::compiler::CompilationUnit &unit, OutputFormat format, FileReport &report);
+
+/**
+ * @brief Lists the report buffers in output order, which does not depend on which worker finished
+ * first: the modules of the files in file order, then the modules only reached through imports in
+ * the order they were found. A module named by several files is listed once.
+ * @param reports The report of each module, by module index.
+ * @param file_modules The module of each file, in file order.
+ * @param out Receives the stdout buffers.
+ * @param err Receives the stderr buffers.
+ */
+void gather_reports(std::span<const FileReport> reports, std::span<const uint32_t> file_modules,
+                    std::vector<const std::string *> &out, std::vector<const std::string *> &err);
+
+/**
+ * @brief Writes a sequence of buffers to a file descriptor with as few system calls as possible.
+ * @param fd The file descriptor.
+ * @param buffers The buffers, written in order; empty ones are skipped.
+ * @return bool False if a write failed.
+ */
+bool write_buffers(int fd, std::span<const std::string *const> buffers);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <compiler/include/timer.h>
+#include "report.h"
+
+/**
+ * @brief Everything the time report shows about one run.
+ */
+struct TimeReport
+{
+    std::vector<yu::compiler::PhaseStats> phases; // parents before children
+    uint64_t wall_ns = 0;                         // wall-clock time of the whole run
+    uint32_t threads = 0;                         // threads that did the work
+    bool counters_requested = false;
+    std::string counters_error; // why hardware counters are missing, if they are
+    bool memory_requested = false;
+    uint64_t peak_resident_bytes = 0; // of the whole process, 0 if unknown
+};
+
+/**
+ * @brief Renders the phase timings collected during a run.
+ *
+ * TEXT gives an indented table with one row per phase: calls, total time summed over all threads,
+ * min/avg/max per file, throughput and token counts, followed by a table of hardware counters per
+ * phase and per byte when those were collected, and a table of peak, retained and allocated
+ * memory per phase and per token and declaration when that was. JSON gives one object holding the
+ * same numbers.
+ * @param report The run's timings.
+ * @param format The output format.
+ * @param out Receives the report.
+ */
+void render_time_report(const TimeReport &report, OutputFormat format, std::string &out);
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <span>
+#include <string>
+
+#include <compiler/include/trace.h>
+
+/**
+ * @brief Renders recorded events in the Chrome trace-event format, which chrome://tracing and
+ * Perfetto open directly.
+ *
+ * Each thread becomes a named track of nested spans; counters become process-wide graphs.
+ * @param threads The recorded events, as returned by Tracer::collect().
+ * @param out Receives the JSON document.
+ */
+void render_trace(std::span<const yu::compiler::TraceThread> threads, std::string &out);
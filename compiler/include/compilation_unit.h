@@ -0,0 +1,261 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "parser.h"
+#include "token.h"
+
+namespace yu::compiler
+{
+    /**
+     * @brief Owns the bytes of one source file together with its file name.
+     *
+     * Both live in a single heap block, so moving a SourceBuffer never relocates them and every
+     * std::string_view handed out by the lexer and parser stays valid for the buffer's lifetime.
+     * The source is followed by a zeroed tail, which lets chunked scanners read past the last byte.
+     */
+    class SourceBuffer
+    {
+    public:
+        static constexpr uint32_t padding = 64;
+
+        SourceBuffer() = default;
+
+        /**
+         * @brief Creates a buffer holding a copy of the given contents.
+         * @param name The file name reported in diagnostics.
+         * @param contents The source code.
+         * @throws std::runtime_error if the contents are too large (>4GiB).
+         */
+        SourceBuffer(std::string_view name, std::string_view contents);
+
+        /**
+         * @brief Reads a whole file into a new buffer with a single allocation.
+         * @param path The file to read.
+         * @return SourceBuffer The buffer, named after the path.
+         * @throws std::runtime_error if the file cannot be opened, read or is too large (>4GiB).
+         */
+        static SourceBuffer from_file(const std::string &path);
+
+        [[nodiscard]] const char *data() const
+        {
+            return storage.get();
+        }
+
+        [[nodiscard]] uint32_t size() const
+        {
+            return length;
+        }
+
+        [[nodiscard]] std::string_view view() const
+        {
+            return { storage.get(), length };
+        }
+
+        [[nodiscard]] const char *name() const
+        {
+            return storage ? storage.get() + name_offset : "";
+        }
+
+    private:
+        friend class FileReader; // reads straight into a sized buffer
+
+        std::unique_ptr<char[]> storage;
+        uint32_t length = 0;
+        uint32_t name_offset = 0;
+
+        SourceBuffer(std::string_view name, uint32_t size);
+    };
+
+    /**
+     * @brief Everything the front-end produces for one file.
+     *
+     * The unit owns the source buffer, the token list, the line index and all parser tables. It is
+     * move-only; moving it transfers the storage without touching a byte, so results can be kept
+     * around cheaply for later phases.
+     */
+    struct CompilationUnit
+    {
+        SourceBuffer source;
+        lang::TokenList tokens;
+        CountedVector<uint32_t> line_starts;
+
+        VarDeclList var_decls;
+        TypeList types;
+        ExprList expressions;
+        SymbolList symbols;
+        ImportList imports;
+        DeclList decls;
+        std::vector<ParseError> warnings;
+        std::vector<ParseError> errors;
+
+        bool success = false;
+        std::string error_message;
+
+        CompilationUnit() = default;
+        CompilationUnit(CompilationUnit &&) noexcept = default;
+        CompilationUnit &operator=(CompilationUnit &&) noexcept = default;
+        CompilationUnit(const CompilationUnit &) = delete;
+        CompilationUnit &operator=(const CompilationUnit &) = delete;
+
+        [[nodiscard]] const char *file_name() const
+        {
+            return source.name();
+        }
+    };
+
+    /**
+     * @brief What the values of a table column index into.
+     *
+     * Columns that hold row indices name the row space they refer to, which is what lets untouched
+     * rows be relocated when rows before them are replaced.
+     */
+    enum class ColumnRef : uint8_t
+    {
+        NONE,
+        TYPES,           // rows of TypeList::names
+        GENERIC_PARAMS,  // rows of TypeList::generic_params
+        FUNCTION_PARAMS, // rows of TypeList::function_params
+        EXPRESSIONS,     // rows of ExprList::expr_types
+        IMPORT_NAMES     // rows of ImportList::names
+    };
+
+    /**
+     * @brief Calls `visit(column, ref)` with every parser table column of a unit, in a fixed order.
+     *
+     * Code that treats the parser tables generically (serialization, relocation, declaration
+     * bookkeeping) goes through this list, so a new column only has to be registered here.
+     * @param unit The unit, const or mutable.
+     * @param visit Callable taking a (const) CountedVector<T> & and a ColumnRef.
+     */
+    template<typename Unit, typename Visitor>
+    constexpr void for_each_table_column(Unit &unit, Visitor &&visit)
+    {
+        visit(unit.var_decls.names, ColumnRef::NONE);
+        visit(unit.var_decls.name_atoms, ColumnRef::NONE);
+        visit(unit.var_decls.type_indices, ColumnRef::TYPES);
+        visit(unit.var_decls.init_indices, ColumnRef::EXPRESSIONS);
+        visit(unit.var_decls.flags, ColumnRef::NONE);
+        visit(unit.var_decls.lines, ColumnRef::NONE);
+        visit(unit.var_decls.columns, ColumnRef::NONE);
+
+        visit(unit.types.names, ColumnRef::NONE);
+        visit(unit.types.name_atoms, ColumnRef::NONE);
+        visit(unit.types.generic_starts, ColumnRef::GENERIC_PARAMS);
+        visit(unit.types.generic_counts, ColumnRef::NONE);
+        visit(unit.types.generic_params, ColumnRef::TYPES);
+        visit(unit.types.function_param_starts, ColumnRef::FUNCTION_PARAMS);
+        visit(unit.types.function_param_counts, ColumnRef::NONE);
+        visit(unit.types.function_params, ColumnRef::TYPES);
+        visit(unit.types.function_return_types, ColumnRef::TYPES);
+
+        visit(unit.expressions.expr_types, ColumnRef::NONE);
+        visit(unit.expressions.values, ColumnRef::NONE);
+        visit(unit.expressions.type_indices, ColumnRef::TYPES);
+
+        visit(unit.symbols.names, ColumnRef::NONE);
+        visit(unit.symbols.name_atoms, ColumnRef::NONE);
+        visit(unit.symbols.type_indices, ColumnRef::TYPES);
+        visit(unit.symbols.scopes, ColumnRef::NONE);
+        visit(unit.symbols.symbol_flags, ColumnRef::NONE);
+
+        visit(unit.imports.paths, ColumnRef::NONE);
+        visit(unit.imports.aliases, ColumnRef::NONE);
+        visit(unit.imports.name_starts, ColumnRef::IMPORT_NAMES);
+        visit(unit.imports.name_counts, ColumnRef::NONE);
+        visit(unit.imports.names, ColumnRef::NONE);
+    }
+
+    namespace detail
+    {
+        // just the parser tables, to count their columns at compile time
+        struct ParserTables
+        {
+            VarDeclList var_decls;
+            TypeList types;
+            ExprList expressions;
+            SymbolList symbols;
+            ImportList imports;
+        };
+
+        constexpr uint32_t count_table_columns()
+        {
+            ParserTables tables;
+            uint32_t count = 0;
+            for_each_table_column(tables, [&count](const auto &, ColumnRef) { ++count; });
+            return count;
+        }
+    }
+
+    /**
+     * @brief Number of columns visited by for_each_table_column().
+     */
+    inline constexpr uint32_t table_column_count = detail::count_table_columns();
+
+    /**
+     * @brief Position of one of the unit's parser table columns in for_each_table_column() order.
+     * @param unit The unit owning the column.
+     * @param column Address of the column, e.g. `&unit.symbols.names`.
+     * @return uint32_t The index, or UINT32_MAX if `column` is not a table column of `unit`.
+     */
+    uint32_t table_column_index(const CompilationUnit &unit, const void *column);
+
+    /**
+     * @brief First row a top-level declaration produced in a table column.
+     * @param decls The declaration index.
+     * @param decl The declaration; `decl == count` gives the column's total size.
+     * @param column The column's index in for_each_table_column() order.
+     */
+    inline uint32_t decl_rows_begin(const DeclList &decls, const uint32_t decl, const uint32_t column)
+    {
+        return decl == 0 ? 0 : decls.column_ends[(decl - 1) * table_column_count + column];
+    }
+
+    /**
+     * @brief The keyword token of a top-level declaration (`function`, `var`, ...), after the
+     * attributes and modifiers leading it.
+     */
+    uint32_t decl_keyword(const CompilationUnit &unit, uint32_t decl);
+
+    /**
+     * @return uint8_t The DeclAttributes written before a top-level declaration.
+     */
+    uint8_t decl_attributes(const CompilationUnit &unit, uint32_t decl);
+
+    /**
+     * @brief Calls `visit(column)` with every column a unit owns: tokens, line index, parser tables
+     * and the declaration index.
+     * @param unit The unit, const or mutable.
+     * @param visit Callable taking a (const) CountedVector<T> &.
+     */
+    template<typename Unit, typename Visitor>
+    void for_each_column(Unit &unit, Visitor &&visit)
+    {
+        visit(unit.tokens.starts);
+        visit(unit.tokens.lengths);
+        visit(unit.tokens.types);
+        visit(unit.tokens.flags);
+        visit(unit.line_starts);
+
+        for_each_table_column(unit, [&visit](auto &column, ColumnRef) { visit(column); });
+
+        visit(unit.decls.token_starts);
+        visit(unit.decls.column_ends);
+        visit(unit.decls.reference_ends);
+        visit(unit.decls.references);
+    }
+
+    /**
+     * @brief Lexes and parses a source buffer.
+     * @param source The buffer to compile; ownership moves into the returned unit.
+     * @param emit_diagnostics Whether diagnostics are printed to stderr; they are kept in the unit either way.
+     * @return CompilationUnit The unit. On failure `success` is false and `error_message` is set.
+     */
+    CompilationUnit parse_unit(SourceBuffer source, bool emit_diagnostics = true);
+}
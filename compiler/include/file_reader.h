@@ -0,0 +1,128 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "compilation_unit.h"
+
+namespace yu::compiler
+{
+    enum class ReadBackend : uint8_t
+    {
+        AUTO,    // io_uring where the kernel allows it, threads otherwise
+        THREADS, // blocking pread on a few I/O threads
+    };
+
+    /**
+     * @brief Reads a list of files ahead of the workers that consume them.
+     *
+     * Files are read in list order on a dedicated I/O stage while the workers lex and parse the ones
+     * already taken. At most `depth` files are read ahead and not yet taken, which bounds the memory
+     * held by the stage. A file a worker is blocked on is read next regardless of that limit, so
+     * taking files out of order (a worker stealing a later task) never waits on the read-ahead.
+     */
+    class FileReader
+    {
+    public:
+        /**
+         * @brief Starts reading.
+         * @param paths The files, in the order they are expected to be taken.
+         * @param depth Files read ahead at most; 0 reads a file only once it is taken.
+         * @param backend How to read, see ReadBackend.
+         */
+        FileReader(std::vector<std::string> paths, uint32_t depth, ReadBackend backend = ReadBackend::AUTO);
+
+        FileReader(const FileReader &) = delete;
+        FileReader &operator=(const FileReader &) = delete;
+
+        /**
+         * @brief Waits for the reads in flight and drops the files that were not taken.
+         */
+        ~FileReader();
+
+        /**
+         * @brief Blocks until a file is read and hands over its buffer. Each file can be taken once.
+         * @param index Position of the file in the list given to the constructor.
+         * @return SourceBuffer The file, named after its path.
+         * @throws std::runtime_error if the file cannot be opened, read or is too large (>4GiB), with
+         * the same message as SourceBuffer::from_file().
+         */
+        SourceBuffer take(uint32_t index);
+
+        /**
+         * @brief Name of the backend in use: "io_uring" or "pread".
+         */
+        [[nodiscard]] const char *backend() const
+        {
+            return backend_name;
+        }
+
+    private:
+        enum class SlotState : uint8_t
+        {
+            WAITING,
+            READING,
+            READY,
+            TAKEN
+        };
+
+        struct Slot
+        {
+            SlotState state = SlotState::WAITING;
+            SourceBuffer buffer;
+            std::string error;
+        };
+
+        struct Ring;
+
+        std::vector<std::string> paths;
+        uint32_t depth;
+        const char *backend_name = "pread";
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::vector<Slot> slots;        // guarded by mutex
+        std::vector<uint32_t> requests; // files a taker waits on that are not being read yet
+        uint32_t next = 0;              // first file in list order that may still be waiting
+        uint32_t ahead = 0;             // files being read or ready but not taken
+        bool stopping = false;
+
+        std::vector<std::thread> threads;
+
+        /**
+         * @brief Picks the next file to read and marks it as being read.
+         * @param index Receives the file.
+         * @param block Wait for a file to become eligible instead of returning false.
+         * @return bool False if there is nothing to read now (or ever, when stopping).
+         */
+        bool next_read(uint32_t &index, bool block);
+
+        /**
+         * @brief Opens a file and sizes a buffer for it.
+         * @return bool False, with `error` set, if the file cannot be opened or is too large.
+         */
+        static bool open_file(const std::string &path, int &fd, SourceBuffer &buffer, std::string &error);
+
+        static char *buffer_data(SourceBuffer &buffer)
+        {
+            return buffer.storage.get();
+        }
+
+        void finish(uint32_t index, SourceBuffer buffer, std::string error);
+
+        /**
+         * @brief Puts a file being read back to waiting, ahead of the files not requested yet.
+         */
+        void retry(uint32_t index);
+
+        void run_threads();
+
+        void run_ring(Ring &ring);
+    };
+}
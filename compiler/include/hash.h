@@ -0,0 +1,69 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include "../../common/arch.hpp"
+
+namespace yu::compiler
+{
+    /**
+     * @brief Mixes a 64-bit value so that every input bit affects every output bit.
+     */
+    ALWAYS_INLINE constexpr uint64_t hash_mix(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    /**
+     * @brief Fast non-cryptographic 64-bit hash, consuming eight bytes per step.
+     * @param data The bytes to hash.
+     * @param size Number of bytes.
+     * @param seed Seed mixed into the initial state.
+     * @return uint64_t The hash.
+     */
+    inline uint64_t hash_bytes(const void *data, const size_t size, const uint64_t seed = 0)
+    {
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        uint64_t h = seed ^ (size * 0x9E3779B97F4A7C15ULL);
+
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t chunk;
+            std::memcpy(&chunk, bytes + i, 8);
+            h = (h ^ hash_mix(chunk)) * 0x9E3779B97F4A7C15ULL;
+            h ^= h >> 29;
+        }
+
+        // the same bytes a memcpy of the rest would give, from two overlapping fixed-size loads
+        const size_t rest = size - i;
+        uint64_t tail = 0;
+        if (rest >= 4)
+        {
+            uint32_t low, high;
+            std::memcpy(&low, bytes + i, 4);
+            std::memcpy(&high, bytes + i + rest - 4, 4);
+            tail = low | static_cast<uint64_t>(high) << (rest - 4) * 8;
+        }
+        else if (rest)
+        {
+            tail = bytes[i] | static_cast<uint64_t>(bytes[i + rest / 2]) << rest / 2 * 8 |
+                   static_cast<uint64_t>(bytes[i + rest - 1]) << (rest - 1) * 8;
+        }
+        return hash_mix(h ^ tail);
+    }
+
+    inline uint64_t hash_bytes(const std::string_view bytes, const uint64_t seed = 0)
+    {
+        return hash_bytes(bytes.data(), bytes.size(), seed);
+    }
+}
@@ -0,0 +1,48 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include "compilation_unit.h"
+
+namespace yu::compiler
+{
+    /**
+     * @brief A single text replacement: `removed` bytes at `offset` are replaced by `inserted`.
+     */
+    struct TextEdit
+    {
+        uint32_t offset;
+        uint32_t removed;
+        std::string_view inserted;
+    };
+
+    /**
+     * @brief How reparse() brought a unit up to date.
+     */
+    struct ReparseStats
+    {
+        bool incremental = false;     // false if the whole file was lexed and parsed again
+        uint32_t first_decl = 0;      // first declaration that was reparsed
+        uint32_t reparsed_decls = 0;  // number of declarations that were reparsed
+    };
+
+    /**
+     * @brief Applies an edit to a parsed unit, relexing and reparsing only the top-level declarations
+     * the edit touches.
+     *
+     * The edited declarations, and any later declaration that resolved a name they define, are lexed
+     * and parsed again; the rows of every other declaration are kept and relocated. The result is
+     * identical to running parse_unit() on the edited text, which is what happens whenever the edit
+     * cannot be confined (failed or warning-carrying units, edits that open a comment or string
+     * running into later declarations, syntax errors).
+     * @param unit The unit to update; it is replaced by the unit of the edited source.
+     * @param edit The edit, in byte offsets of the current source.
+     * @param emit_diagnostics Whether a full reparse prints its diagnostics to stderr.
+     * @return ReparseStats What was reparsed.
+     * @throws std::out_of_range if the edit lies outside the source.
+     */
+    ReparseStats reparse(CompilationUnit &unit, const TextEdit &edit, bool emit_diagnostics = true);
+}
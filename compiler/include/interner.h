@@ -0,0 +1,116 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace yu::compiler
+{
+    /**
+     * @brief Process-wide table of unique strings, shared by every worker.
+     *
+     * Interning a string returns a 32-bit atom that stays valid, and keeps meaning the same
+     * string, for the lifetime of the process, so names from different files compare and hash as
+     * integers. Each distinct string is stored once, in arena chunks that never move.
+     *
+     * The table is split into shards by hash, each with its own lock and open-addressing index,
+     * so threads interning different names rarely contend. Turning an atom back into its string
+     * takes no lock. Atoms are not stable across processes; anything persisted stores the string.
+     */
+    class StringInterner
+    {
+    public:
+        static constexpr uint32_t no_atom = std::numeric_limits<uint32_t>::max();
+        static constexpr uint32_t empty_atom = 0; // the empty string
+
+        StringInterner();
+
+        StringInterner(const StringInterner &) = delete;
+        StringInterner &operator=(const StringInterner &) = delete;
+
+        /**
+         * @brief The interner shared by the whole compiler.
+         */
+        static StringInterner &global();
+
+        /**
+         * @brief Returns the atom of a string, adding the string if it is new.
+         */
+        uint32_t intern(std::string_view text);
+
+        /**
+         * @brief Returns the atom of a string without adding it.
+         * @return uint32_t The atom, or no_atom if the string was never interned.
+         */
+        [[nodiscard]] uint32_t find(std::string_view text);
+
+        /**
+         * @brief The string of an atom. The view stays valid as long as the interner.
+         */
+        [[nodiscard]] std::string_view view(uint32_t atom) const;
+
+        /**
+         * @brief Number of distinct strings.
+         */
+        [[nodiscard]] uint32_t size();
+
+        /**
+         * @brief Bytes of string storage in use, for reports.
+         */
+        [[nodiscard]] uint64_t bytes();
+
+    private:
+        static constexpr uint32_t shard_bits = 6;
+        static constexpr uint32_t shard_count = 1u << shard_bits;
+        static constexpr uint32_t first_block_size = 256; // entries; each further block doubles
+        static constexpr uint32_t block_count = 32 - shard_bits - 8 + 1;
+        static constexpr uint32_t chunk_size = 64 * 1024;
+
+        struct Entry
+        {
+            const char *data;
+            uint32_t length;
+            uint32_t hash;
+        };
+
+        struct alignas(64) Shard
+        {
+            std::mutex mutex;
+            std::vector<uint32_t> index; // open addressing over entries, entry + 1, 0 = free
+            uint32_t count = 0;
+
+            // written only under the lock and only past `count`, so readers of older entries never race
+            std::unique_ptr<Entry[]> blocks[block_count];
+
+            std::vector<std::unique_ptr<char[]>> chunks;
+            char *cursor = nullptr;
+            size_t remaining = 0;
+            uint64_t bytes = 0;
+        };
+
+        std::unique_ptr<Shard[]> shards;
+
+        /**
+         * @brief Locates an entry in the shard's blocks.
+         */
+        static const Entry &entry(const Shard &shard, uint32_t local);
+
+        /**
+         * @brief Finds the index slot of a string, or the free slot it would take; the lock must be held.
+         */
+        static uint32_t probe(const Shard &shard, std::string_view text, uint32_t hash);
+
+        /**
+         * @brief Copies a string into the shard's arena; the lock must be held.
+         */
+        static const char *store(Shard &shard, std::string_view text);
+
+        static void grow(Shard &shard);
+    };
+}
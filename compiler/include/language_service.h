@@ -0,0 +1,126 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "compilation_unit.h"
+#include "incremental.h"
+
+namespace yu::compiler
+{
+    class UnitCache;
+
+    /**
+     * @brief A position as editors count it: zero-based line and UTF-16 code unit within the line.
+     */
+    struct Position
+    {
+        uint32_t line;
+        uint32_t character;
+    };
+
+    struct Range
+    {
+        Position start;
+        Position end;
+    };
+
+    enum class SymbolKind : uint8_t
+    {
+        FUNCTION,
+        VARIABLE,
+        CONSTANT
+    };
+
+    struct DocumentSymbol
+    {
+        std::string_view name;
+        SymbolKind kind;
+        Range range;           // the whole declaration
+        Range selection_range; // the declared name
+    };
+
+    struct Diagnostic
+    {
+        Range range;
+        ErrorSeverity severity;
+        std::string message;
+        std::string code;
+    };
+
+    /**
+     * @brief Keeps the units of open documents in memory and answers editor queries from them.
+     *
+     * Documents are keyed by an opaque id (the editor's URI). Edits go through reparse(), so a
+     * keystroke only relexes and reparses the declarations it touches; queries read the unit's
+     * tables and line index directly and never touch the file system.
+     */
+    class LanguageService
+    {
+    public:
+        /**
+         * @param cache Optional cache consulted when a document is opened; must outlive the service.
+         */
+        explicit LanguageService(const UnitCache *cache = nullptr);
+
+        /**
+         * @brief Opens (or replaces) a document.
+         * @param id The document id.
+         * @param name The file name reported in diagnostics.
+         * @param text The document's contents.
+         * @return const CompilationUnit & The parsed document.
+         */
+        const CompilationUnit &open(const std::string &id, std::string_view name, std::string_view text);
+
+        /**
+         * @brief Replaces a range of an open document.
+         * @param id The document id.
+         * @param range The replaced range, or std::nullopt to replace the whole document.
+         * @param text The new text of the range.
+         * @return const CompilationUnit * The updated document, or nullptr if it is not open.
+         */
+        const CompilationUnit *change(const std::string &id, const std::optional<Range> &range,
+                                      std::string_view text);
+
+        void close(const std::string &id);
+
+        [[nodiscard]] const CompilationUnit *find(const std::string &id) const;
+
+        /**
+         * @brief Converts an editor position to a byte offset, clamping to the end of the line.
+         */
+        static uint32_t offset_at(const CompilationUnit &unit, Position position);
+
+        /**
+         * @brief Converts a byte offset to an editor position.
+         */
+        static Position position_at(const CompilationUnit &unit, uint32_t offset);
+
+        /**
+         * @brief Gets the top-level declarations of a document.
+         */
+        static std::vector<DocumentSymbol> document_symbols(const CompilationUnit &unit);
+
+        /**
+         * @brief Finds where the identifier at a position is declared: the innermost declaration
+         * of that name before the use whose block is still open there.
+         * @return std::optional<Range> The declared name, or std::nullopt if there is no identifier.
+         */
+        static std::optional<Range> definition(const CompilationUnit &unit, Position position);
+
+        /**
+         * @brief Gets the errors and warnings of a document.
+         */
+        static std::vector<Diagnostic> diagnostics(const CompilationUnit &unit);
+
+    private:
+        const UnitCache *cache;
+        std::unordered_map<std::string, CompilationUnit> documents;
+    };
+}
@@ -38,6 +38,15 @@ namespace yu::compiler
          */
         HOT_FUNCTION std::pair<uint32_t, uint32_t> get_line_col(const lang::token_t &token) const;
 
+        /**
+         * @brief Get the line and column for a byte offset using a line index built by the lexer.
+         * @param line_starts The byte offset of the first character of every line.
+         * @param offset The byte offset into the source.
+         * @return pair of line and column.
+         */
+        HOT_FUNCTION static std::pair<uint32_t, uint32_t> get_line_col(const CountedVector<uint32_t> &line_starts,
+                                                                       uint32_t offset);
+
         /**
          * @brief Get the string value of a token.
          * @param token The token.
@@ -54,7 +63,13 @@ namespace yu::compiler
          */
         HOT_FUNCTION static lang::token_i get_token_type(char c);
 
-     std::vector<uint32_t> line_starts;
+        /**
+         * @brief Moves the token list out of the lexer. The lexer must not be used for lookups afterwards.
+         * @return TokenList The tokens produced by tokenize().
+         */
+        lang::TokenList take_tokens();
+
+     CountedVector<uint32_t> line_starts;
 
     private:
         const char *src {};
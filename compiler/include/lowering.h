@@ -0,0 +1,34 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include "compilation_unit.h"
+#include "uir.h"
+
+namespace yu::compiler
+{
+    /**
+     * @brief Lowers the top-level functions of a parsed unit into UIR, directly in SSA form.
+     *
+     * Local variables never touch memory: each function is translated in one pass and SSA values
+     * are built on the fly (Braun et al., "Simple and Efficient Construction of Static Single
+     * Assignment Form"). A read of a variable looks up its current value in the block, and
+     * otherwise in the block's predecessors, placing a phi where they may differ. Blocks whose
+     * predecessors are not all known yet, i.e. loop headers, get incomplete phis that are filled
+     * in when the block is sealed. Phis that turn out to merge a single value are removed at once.
+     *
+     * The parser keeps no statement or expression trees, so bodies are translated from the
+     * function's tokens; signatures come from the parser tables. Every function is declared before
+     * any body is lowered, so calls may refer to functions further down.
+     *
+     * Generic functions are not lowered. Constructs the lowering does not handle yet (strings,
+     * pointers, globals, ...) leave their function as a body-less declaration and are reported as
+     * warnings; type errors, and self calls of `@tailrec` functions that are not tail calls, are
+     * reported as errors.
+     * @param unit The parsed unit; diagnostics are added to its warnings and errors.
+     * @param module The module receiving one function per lowered declaration.
+     * @return bool False if an error was reported.
+     */
+    bool lower_unit(CompilationUnit &unit, uir::Module &module);
+}
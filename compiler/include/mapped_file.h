@@ -0,0 +1,63 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace yu::compiler
+{
+    /**
+     * @brief A read-only view of a whole file, memory-mapped where the platform supports it.
+     */
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        MappedFile(MappedFile &&other) noexcept;
+        MappedFile &operator=(MappedFile &&other) noexcept;
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+        ~MappedFile();
+
+        /**
+         * @brief Maps a file.
+         * @param path The file to map.
+         * @return bool False if the file does not exist or cannot be mapped.
+         */
+        bool open(const std::string &path);
+
+        [[nodiscard]] const std::byte *data() const
+        {
+            return bytes;
+        }
+
+        [[nodiscard]] size_t size() const
+        {
+            return length;
+        }
+
+        [[nodiscard]] explicit operator bool() const
+        {
+            return bytes != nullptr;
+        }
+
+    private:
+        const std::byte *bytes = nullptr;
+        size_t length = 0;
+        std::unique_ptr<std::byte[]> fallback;
+
+        void close();
+    };
+
+    /**
+     * @brief Writes a whole file under a private temporary name and renames it into place, so
+     * concurrent readers only ever map complete files. The temporary is removed on failure.
+     * @return bool False if the file could not be written or renamed.
+     */
+    bool write_file_atomically(const std::filesystem::path &path, std::span<const std::byte> bytes);
+}
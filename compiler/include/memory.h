@@ -0,0 +1,116 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace yu::compiler
+{
+    /**
+     * @brief Allocation counters of one thread.
+     *
+     * Memory freed on another thread than the one that allocated it is subtracted there, so `live`
+     * of a single thread can go negative; sums over threads and differences within one thread are
+     * what is meaningful.
+     */
+    struct MemoryCounters
+    {
+        int64_t live = 0;         // bytes currently allocated
+        int64_t peak = 0;         // high-water mark of `live`, see Timer for how phases reset it
+        uint64_t allocated = 0;   // bytes ever allocated
+        uint64_t allocations = 0; // number of allocations
+    };
+
+    /**
+     * @brief The calling thread's counters.
+     */
+    inline MemoryCounters &thread_memory()
+    {
+        thread_local MemoryCounters counters;
+        return counters;
+    }
+
+    inline void count_allocation(const size_t bytes)
+    {
+        MemoryCounters &counters = thread_memory();
+        counters.live += static_cast<int64_t>(bytes);
+        counters.allocated += bytes;
+        ++counters.allocations;
+        if (counters.live > counters.peak)
+            counters.peak = counters.live;
+    }
+
+    inline void count_deallocation(const size_t bytes)
+    {
+        thread_memory().live -= static_cast<int64_t>(bytes);
+    }
+
+    /**
+     * @brief True if this build replaces the global operator new (YU_TRACK_GLOBAL_NEW), in which case
+     * every heap allocation of the process is counted, not only those of counted containers.
+     */
+    bool tracks_global_new();
+
+#if defined(YU_TRACK_GLOBAL_NEW)
+    inline constexpr bool global_new_tracked = true;
+#else
+    inline constexpr bool global_new_tracked = false;
+#endif
+
+    /**
+     * @brief A stateless allocator that counts its bytes in the thread's MemoryCounters.
+     *
+     * When the global operator new is tracked it already counts everything, and this allocator only
+     * forwards to it.
+     */
+    template<typename T>
+    struct CountingAllocator
+    {
+        using value_type = T;
+
+        CountingAllocator() noexcept = default;
+
+        template<typename U>
+        CountingAllocator(const CountingAllocator<U> &) noexcept {}
+
+        T *allocate(const size_t count)
+        {
+            if constexpr (!global_new_tracked)
+                count_allocation(count * sizeof(T));
+            return std::allocator<T>().allocate(count);
+        }
+
+        void deallocate(T *pointer, const size_t count) noexcept
+        {
+            if constexpr (!global_new_tracked)
+                count_deallocation(count * sizeof(T));
+            std::allocator<T>().deallocate(pointer, count);
+        }
+
+        template<typename U>
+        bool operator==(const CountingAllocator<U> &) const noexcept
+        {
+            return true;
+        }
+    };
+
+    /**
+     * @brief The container of the front-end's columns: tokens, line index and parser tables.
+     */
+    template<typename T>
+    using CountedVector = std::vector<T, CountingAllocator<T>>;
+
+    /**
+     * @brief Resident set size of the process, or 0 where it cannot be queried.
+     */
+    uint64_t resident_memory_bytes();
+
+    /**
+     * @brief Highest resident set size the process has reached, or 0 where it cannot be queried.
+     */
+    uint64_t peak_resident_memory_bytes();
+}
@@ -0,0 +1,143 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "compilation_unit.h"
+#include "mapped_file.h"
+
+namespace yu::compiler
+{
+    /**
+     * @brief Identifies the source file an interface was built from, without reading it.
+     */
+    struct SourceStamp
+    {
+        uint64_t size = 0;
+        int64_t modified = 0; // file clock ticks, 0 if the file does not exist
+
+        bool operator==(const SourceStamp &) const = default;
+    };
+
+    /**
+     * @brief The exported symbols of a module, with their types, as a flat image that importers
+     * use in place of the module's source.
+     *
+     * The image is written to a `.yui` file next to the source and memory-mapped by importers, so
+     * loading one costs a map and a header check no matter how many symbols it exports. Every
+     * top-level declaration is exported. Types are interned: structurally equal types share one
+     * row, and function symbols carry their full signature. Lookup by name goes through a perfect
+     * hash built when the image is emitted, so it touches one seed, one slot and one name.
+     *
+     * Loading validates the header and section bounds only; accessors bounds-check what they
+     * return, so a corrupt file yields empty names rather than reads outside the mapping.
+     */
+    class ModuleInterface
+    {
+    public:
+        static constexpr uint32_t no_symbol = std::numeric_limits<uint32_t>::max();
+        static constexpr uint32_t no_type = std::numeric_limits<uint32_t>::max();
+
+        ModuleInterface() = default;
+
+        /**
+         * @brief Collects the exports of a parsed unit.
+         * @param unit The unit; a failed unit exports the declarations parsed before the error.
+         * @param stamp The source file the unit was read from, see stamp().
+         */
+        static ModuleInterface build(const CompilationUnit &unit, SourceStamp stamp = {});
+
+        /**
+         * @brief Maps an interface file.
+         * @return bool False if the file is missing, from another compiler version or malformed.
+         */
+        bool open(const std::string &path);
+
+        /**
+         * @brief Writes the image to a file, replacing it atomically.
+         * @return bool False if the file could not be written.
+         */
+        [[nodiscard]] bool write(const std::string &path) const;
+
+        /**
+         * @brief The interface file belonging to a source file: the same path with a `.yui` extension.
+         */
+        static std::filesystem::path interface_path(const std::filesystem::path &source);
+
+        /**
+         * @brief Size and modification time of a file; all zero if it does not exist.
+         */
+        static SourceStamp stamp(const std::filesystem::path &source);
+
+        [[nodiscard]] SourceStamp source_stamp() const;
+
+        [[nodiscard]] explicit operator bool() const
+        {
+            return size() != 0;
+        }
+
+        /**
+         * @brief Looks up an exported symbol.
+         * @return uint32_t The symbol, or no_symbol if the module exports no such name.
+         */
+        [[nodiscard]] uint32_t find(std::string_view name) const;
+
+        [[nodiscard]] uint32_t symbol_count() const;
+
+        [[nodiscard]] std::string_view symbol_name(uint32_t symbol) const;
+
+        /**
+         * @return uint32_t The symbol's type: the function type for functions, no_type if inferred.
+         */
+        [[nodiscard]] uint32_t symbol_type(uint32_t symbol) const;
+
+        [[nodiscard]] uint8_t symbol_flags(uint32_t symbol) const; // SymbolFlags
+
+        [[nodiscard]] uint32_t type_count() const;
+
+        [[nodiscard]] std::string_view type_name(uint32_t type) const;
+
+        [[nodiscard]] std::span<const uint32_t> type_generics(uint32_t type) const;
+
+        [[nodiscard]] std::span<const uint32_t> type_params(uint32_t type) const; // function types only
+
+        [[nodiscard]] uint32_t type_return(uint32_t type) const; // no_type for non-function types
+
+        /**
+         * @brief The raw image, as written by write().
+         */
+        [[nodiscard]] std::span<const std::byte> image() const
+        {
+            return { data(), size() };
+        }
+
+    private:
+        MappedFile file;
+        std::vector<std::byte> owned; // the image of a built interface; empty when mapped
+
+        [[nodiscard]] const std::byte *data() const
+        {
+            return file ? file.data() : owned.data();
+        }
+
+        [[nodiscard]] size_t size() const
+        {
+            return file ? file.size() : owned.size();
+        }
+
+        template<typename T>
+        [[nodiscard]] const T *section(uint32_t index) const;
+
+        [[nodiscard]] std::string_view string(uint32_t offset, uint32_t length) const;
+
+        [[nodiscard]] bool valid() const;
+    };
+}
@@ -0,0 +1,156 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "compilation_unit.h"
+#include "module_interface.h"
+#include "thread_pool.h"
+
+namespace yu::compiler
+{
+    /**
+     * @brief One source file of the module graph.
+     */
+    struct Module
+    {
+        std::string path; // as given for roots, as resolved for imported modules
+        CompilationUnit unit;
+        std::vector<uint32_t> imports;      // module of each row of unit.imports, no_module if unresolved
+        std::vector<uint32_t> dependencies; // distinct modules this one imports, in first-import order
+        ModuleInterface interface;          // what importers see of the module
+        bool precompiled = false;           // loaded from its interface file; unit is empty, never compiled
+    };
+
+    /**
+     * @brief Loads a set of root modules and everything they import, and compiles them in
+     * dependency order.
+     *
+     * Parsing a module reveals its imports, which are resolved and parsed in turn, so loading and
+     * compiling overlap: a module is compiled as soon as the modules it imports are, while others
+     * are still being parsed. Every file is parsed exactly once no matter how often it is imported;
+     * modules are identified by their canonical path.
+     *
+     * An import path is tried relative to the importing file, then below each search path, with
+     * the `.yu` extension added when it has none. Paths starting with `./` or `../` are only tried
+     * relative to the importing file. Unresolved imports, names a module does not export and import
+     * cycles become UNRESOLVED_IMPORT errors of the importing module; a cycle is cut at the import
+     * that closes it, so every module is still compiled exactly once.
+     *
+     * An imported module whose interface file (see ModuleInterface) is current, or that ships only
+     * an interface file, is loaded from it instead of being parsed and compiled. Roots are always
+     * compiled from source.
+     */
+    class ModuleLoader
+    {
+    public:
+        static constexpr uint32_t no_module = std::numeric_limits<uint32_t>::max();
+
+        /**
+         * @brief Produces the unit of a module that is not precompiled. Runs on a pool worker.
+         * @param module The module's index.
+         * @param path The file to read.
+         */
+        using ParseFunction = std::function<CompilationUnit(uint32_t module, const std::string &path)>;
+
+        /**
+         * @brief Called once per module compiled from source, after every module it imports was compiled
+         * and the names it imports were checked. Runs on a pool worker.
+         */
+        using CompileFunction = std::function<void(uint32_t module, Module &)>;
+
+        /**
+         * @param search_paths Directories searched for imports not found next to the importing file.
+         */
+        explicit ModuleLoader(std::vector<std::filesystem::path> search_paths = {});
+
+        /**
+         * @brief Adds a module to load. Roots are numbered from 0 in the order they are added.
+         * @return uint32_t The module's index; the existing one if the file was added before.
+         */
+        uint32_t add_root(const std::string &path);
+
+        /**
+         * @brief Parses and compiles the roots and all modules they import, then returns.
+         */
+        void run(ThreadPool &pool, const ParseFunction &parse, const CompileFunction &compile);
+
+        [[nodiscard]] uint32_t size() const
+        {
+            return static_cast<uint32_t>(modules.size());
+        }
+
+        [[nodiscard]] Module &module(const uint32_t index)
+        {
+            return *modules[index]->module;
+        }
+
+        [[nodiscard]] const Module &module(const uint32_t index) const
+        {
+            return *modules[index]->module;
+        }
+
+        /**
+         * @brief Resolves an import path.
+         * @param importer The importing file.
+         * @param path The path as written in the import.
+         * @return std::filesystem::path The file, or an empty path if none exists.
+         */
+        [[nodiscard]] std::filesystem::path resolve(const std::filesystem::path &importer, std::string_view path) const;
+
+    private:
+        struct Node
+        {
+            std::unique_ptr<Module> module;
+            std::vector<uint32_t> dependents; // modules waiting for this one to compile
+            uint32_t pending = 0;             // dependencies not compiled yet
+            bool root = false;
+            bool parsed = false;
+            bool compiled = false;
+        };
+
+        std::vector<std::filesystem::path> search_paths;
+
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Node>> modules;           // guarded by mutex while running
+        std::unordered_map<std::string, uint32_t> by_path;    // canonical path to module
+
+        /**
+         * @brief Finds or adds the module of a file; mutex must be held.
+         * @return std::pair<uint32_t, bool> The module and whether it was added.
+         */
+        std::pair<uint32_t, bool> intern(const std::string &path);
+
+        /**
+         * @brief Loads a module from its interface file if that is current.
+         * @return bool False if the module has to be parsed.
+         */
+        static bool load_interface(Module &module);
+
+        /**
+         * @brief Checks the names a module imports against the interfaces of its compiled dependencies.
+         */
+        void check_imported_names(Module &module);
+
+        void parse_module(ThreadPool &pool, uint32_t index, const ParseFunction &parse,
+                          const CompileFunction &compile);
+
+        void compile_module(ThreadPool &pool, uint32_t index, const CompileFunction &compile);
+
+        /**
+         * @brief Cuts the import cycles that keep modules from compiling. Only while the pool is idle.
+         * @return std::vector<uint32_t> Modules that became ready.
+         */
+        std::vector<uint32_t> break_cycles();
+    };
+}
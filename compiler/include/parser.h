@@ -5,7 +5,9 @@
 
 #include <limits>
 #include <vector>
+#include "interner.h"
 #include "lexer.h"
+#include "memory.h"
 #include "token.h"
 #include "../../common/arch.hpp"
 
@@ -13,39 +15,74 @@ namespace yu::compiler
 {
     struct VarDeclList
     {
-        std::vector<std::string_view> names;
-        std::vector<uint32_t> type_indices; // index into TypeList
-        std::vector<uint32_t> init_indices; // index into ExprList
-        std::vector<uint8_t> flags;         // bitflags for const, etc.
-        std::vector<uint32_t> lines;
-        std::vector<uint32_t> columns;
+        CountedVector<std::string_view> names;
+        CountedVector<uint32_t> name_atoms;   // names in the global StringInterner
+        CountedVector<uint32_t> type_indices; // index into TypeList
+        CountedVector<uint32_t> init_indices; // index into ExprList
+        CountedVector<uint8_t> flags;         // bitflags for const, etc.
+        CountedVector<uint32_t> lines;
+        CountedVector<uint32_t> columns;
     };
 
     struct TypeList
     {
-        std::vector<std::string_view> names;
-        std::vector<uint32_t> generic_starts; // start index into generic_params
-        std::vector<uint32_t> generic_counts; // number of generic params
-        std::vector<uint32_t> generic_params; // indices into TypeList
-
-        std::vector<uint32_t> function_param_starts; // start index into function_params
-        std::vector<uint32_t> function_param_counts; // number of function params
-        std::vector<uint32_t> function_params;       // parameter type indices
-        std::vector<uint32_t> function_return_types; // return type indices
+        CountedVector<std::string_view> names;
+        CountedVector<uint32_t> name_atoms;     // names in the global StringInterner
+        CountedVector<uint32_t> generic_starts; // start index into generic_params
+        CountedVector<uint32_t> generic_counts; // number of generic params
+        CountedVector<uint32_t> generic_params; // indices into TypeList
+
+        CountedVector<uint32_t> function_param_starts; // start index into function_params
+        CountedVector<uint32_t> function_param_counts; // number of function params
+        CountedVector<uint32_t> function_params;       // parameter type indices
+        CountedVector<uint32_t> function_return_types; // return type indices
     };
 
     struct alignas(8) ExprList
     {
-        std::vector<uint8_t> expr_types;      // kind of expr
-        std::vector<std::string_view> values; // for literals
+        CountedVector<uint8_t> expr_types;      // kind of expr
+        CountedVector<std::string_view> values; // for literals
+        CountedVector<uint32_t> type_indices;   // index into TypeList for function expressions
     };
 
     struct SymbolList
     {
-        std::vector<std::string_view> names; // symbol names
-        std::vector<uint32_t> type_indices;  // index into TypeList
-        std::vector<uint32_t> scopes;        // which scope does it belong to
-        std::vector<uint8_t> symbol_flags;   // something like IS_TYPE, IS_CONST, IS_FUNCTION
+        CountedVector<std::string_view> names; // symbol names
+        CountedVector<uint32_t> name_atoms;    // names in the global StringInterner
+        CountedVector<uint32_t> type_indices;  // index into TypeList
+        CountedVector<uint32_t> scopes;        // which scope does it belong to
+        CountedVector<uint8_t> symbol_flags;   // something like IS_TYPE, IS_CONST, IS_FUNCTION
+    };
+
+    /**
+     * @brief The unit's import declarations, one row each, in source order.
+     *
+     * `import { A, B } from 'path';` lists its names, `import * from 'path';` lists none and
+     * `import 'path' as M;` sets an alias. Paths are views into the source, so their position
+     * locates the import for diagnostics.
+     */
+    struct ImportList
+    {
+        CountedVector<std::string_view> paths;   // module path as written, without the quotes
+        CountedVector<std::string_view> aliases; // name after `as`, empty if none
+        CountedVector<uint32_t> name_starts;     // start index into names
+        CountedVector<uint32_t> name_counts;     // number of names, 0 for `*` and aliased imports
+        CountedVector<std::string_view> names;   // imported names
+    };
+
+    /**
+     * @brief Top-level declarations, one row per declaration.
+     *
+     * A row remembers where the declaration starts and how far every parser table column extended
+     * after it (`column_ends`, one entry per column of for_each_table_column), so the rows a
+     * declaration produced can be located without rescanning the tables.
+     */
+    struct DeclList
+    {
+        CountedVector<uint32_t> token_starts;           // first token of the declaration
+        CountedVector<uint32_t> column_ends;            // table column sizes after the declaration
+        CountedVector<uint32_t> reference_ends;         // end index into references
+        CountedVector<std::string_view> references;     // names resolved outside the declaration
     };
 
     struct TypeInferenceTask
@@ -59,7 +96,21 @@ namespace yu::compiler
         IS_TYPE = 1 << 0,
         IS_CONST = 1 << 1,
         IS_FUNCTION = 1 << 2,
-        IS_GENERIC_PARAM = 1 << 3
+        IS_GENERIC_PARAM = 1 << 3,
+        IS_IMPORTED = 1 << 4
+    };
+
+    /**
+     * @brief Attributes and modifiers written before a declaration, see decl_attributes().
+     */
+    enum class DeclAttributes : uint8_t
+    {
+        PURE = 1 << 0,       // @pure: no side effects, the result only depends on the arguments
+        TAIL_REC = 1 << 1,   // @tailrec: recursive calls must be tail calls
+        NO_DISCARD = 1 << 2, // @nodiscard: the result must be used
+        DEPRECATED = 1 << 3, // @deprecated
+        INLINE = 1 << 4,     // `inline function`
+        ASYNC = 1 << 5       // `async function`
     };
 
     enum class ParseErrorFlags : uint8_t
@@ -68,7 +119,8 @@ namespace yu::compiler
         UNEXPECTED_TOKEN = 1 << 0,
         TYPE_MISMATCH = 1 << 1,
         INVALID_SYNTAX = 1 << 2,
-        UNRESOLVED_SYMBOL = 1 << 3
+        UNRESOLVED_SYMBOL = 1 << 3,
+        UNRESOLVED_IMPORT = 1 << 4
     };
 
     enum class ErrorSeverity
@@ -114,6 +166,8 @@ namespace yu::compiler
         }
     };
 
+    struct CompilationUnit;
+
     class Parser
     {
     public:
@@ -121,16 +175,35 @@ namespace yu::compiler
                                       const std::string &message, const std::string &suggestion,
                                       uint32_t token_index) const;
 
-        Parser(lang::TokenList &tokens, const char *source, const char *file_name, const Lexer &lexer);
+        /**
+         * @brief Creates a parser that reads the unit's tokens and writes its tables in place.
+         * @param unit The lexed unit; it must outlive the parser.
+         */
+        explicit Parser(CompilationUnit &unit);
 
         ParseResult<int> parse_program();
 
+        /**
+         * @brief Parses the top-level declarations between two tokens, appending to the unit's tables.
+         *
+         * Unlike parse_program() the tables are not reset, so this can extend a unit in place.
+         * @param first_token The first token of the first declaration.
+         * @param end_token The token at which parsing must stop.
+         * @return ParseResult<int> Fails on a syntax error or if a declaration runs past `end_token`.
+         */
+        ParseResult<int> parse_declarations(uint32_t first_token, uint32_t end_token);
+
+        /**
+         * @brief Enables or disables printing of diagnostics to stderr. Errors are reported either way.
+         */
+        void set_emit_diagnostics(bool enabled);
+
         ParseResult<uint32_t> parse_function_decl();
 
         ParseResult<uint32_t> parse_variable_decl();
 
         // Debug methods
-        VarDeclList get_var_decls() const
+        const VarDeclList &get_var_decls() const
         {
             return var_declrs;
         }
@@ -145,20 +218,33 @@ namespace yu::compiler
             return warnings;
         }
 
+        /**
+         * @brief Gets the diagnostic code (e.g. "E0001") of an error kind.
+         */
+        static std::string get_error_code(ParseErrorFlags flags);
+
     private:
-        Lexer lexer;
+        static constexpr uint32_t no_symbol = std::numeric_limits<uint32_t>::max();
+
+        CompilationUnit &unit;
         const lang::TokenList &tokens;
+        const CountedVector<uint32_t> &line_starts;
         const char *source;
         const char *file_name;
         uint32_t current = 0;
         uint32_t current_scope = 0;
-
-        VarDeclList var_declrs;
-        TypeList types;
-        ExprList expressions;
-        SymbolList symbols;
+        uint32_t decl_symbol_start = 0;
+        bool emit_diagnostics = true;
+
+        VarDeclList &var_declrs;
+        TypeList &types;
+        ExprList &expressions;
+        SymbolList &symbols;
+        ImportList &imports;
+        StringInterner &interner;
         std::vector<TypeInferenceTask> inference_queue;
-        std::vector<ParseError> warnings;
+        std::vector<ParseError> &warnings;
+        std::vector<ParseError> &errors;
         lang::token_t current_token;
 
         bool is_at_end() const;
@@ -175,6 +261,24 @@ namespace yu::compiler
 
         uint32_t lookup_symbol(std::string_view name) const;
 
+        uint32_t resolve_symbol(std::string_view name);
+
+        uint32_t add_type(std::string_view name);
+
+        uint32_t add_expression(lang::token_i type, std::string_view value,
+                                uint32_t type_index = std::numeric_limits<uint32_t>::max());
+
+        ParseResult<uint32_t> parse_declaration();
+
+        /**
+         * @brief Skips the attributes and modifiers leading a declaration.
+         */
+        ParseResult<int> parse_attributes();
+
+        ParseResult<uint32_t> parse_import_decl();
+
+        void record_declaration(uint32_t first_token);
+
         ParseResult<uint32_t> parse_type();
 
         ParseResult<uint32_t> parse_statement();
@@ -185,7 +289,11 @@ namespace yu::compiler
 
         ParseResult<uint32_t> parse_return_statement();
 
-        ParseResult<uint32_t> parse_generic_params();
+        ParseResult<uint32_t> parse_while_statement();
+
+        ParseResult<uint32_t> parse_jump_statement();
+
+        ParseResult<uint32_t> parse_generic_params(uint32_t &count);
 
         ParseResult<uint32_t> parse_expression_statement();
 
@@ -198,7 +306,5 @@ namespace yu::compiler
         void synchronize();
 
         void report_error(const ParseError &error);
-
-        static std::string get_error_code(ParseErrorFlags flags);
     };
 }
@@ -0,0 +1,83 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace yu::compiler
+{
+    enum class PerfCounter : uint8_t
+    {
+        CYCLES,
+        INSTRUCTIONS,
+        BRANCH_MISSES,
+        L1D_MISSES,  // L1 data cache read misses
+        LLC_MISSES,  // last level cache misses
+        COUNT
+    };
+
+    inline constexpr uint32_t perf_counter_count = static_cast<uint32_t>(PerfCounter::COUNT);
+
+    using PerfCounterValues = std::array<uint64_t, perf_counter_count>;
+
+    /**
+     * @brief Short name of a counter, e.g. "branch-misses".
+     */
+    const char *perf_counter_name(PerfCounter counter);
+
+    /**
+     * @brief Hardware performance counters of the calling thread, read as one group.
+     *
+     * On Linux the counters come from perf_event_open and count user space only. Counters the
+     * kernel or the hardware refuses are left out and the rest still work; elsewhere, or when none
+     * can be opened (no PMU in a VM, perf_event_paranoid too strict), nothing is available and
+     * read() returns false. When the kernel multiplexes the group with other events, counts are
+     * scaled up by the time the group was enabled over the time it ran.
+     */
+    class PerfCounters
+    {
+    public:
+        PerfCounters();
+
+        PerfCounters(const PerfCounters &) = delete;
+        PerfCounters &operator=(const PerfCounters &) = delete;
+
+        ~PerfCounters();
+
+        /**
+         * @brief Bit `1 << counter` is set for each counter that could be opened.
+         */
+        [[nodiscard]] uint32_t mask() const
+        {
+            return opened_mask;
+        }
+
+        /**
+         * @brief Why no counter could be opened; empty if at least one was.
+         */
+        [[nodiscard]] const std::string &error() const
+        {
+            return open_error;
+        }
+
+        /**
+         * @brief Reads the current counts with a single system call.
+         * @param values Receives the counts; counters missing from mask() read as 0.
+         * @param multiplexed If set, receives whether the counts are estimates scaled from the
+         * part of the time the group was on the PMU.
+         * @return bool False if nothing is available or the read failed.
+         */
+        bool read(PerfCounterValues &values, bool *multiplexed = nullptr) const;
+
+    private:
+        int leader = -1;
+        std::array<int, perf_counter_count> fds {};
+        std::array<uint8_t, perf_counter_count> slots {}; // position of each counter in a group read
+        uint32_t opened_mask = 0;
+        uint32_t opened_count = 0;
+        std::string open_error;
+    };
+}
@@ -0,0 +1,70 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace yu::compiler
+{
+    struct SourceFile
+    {
+        std::string path;
+        uint64_t size; // bytes on disk, 0 if the file could not be stat'ed
+    };
+
+    /**
+     * @brief The set of source files one compiler invocation works on.
+     *
+     * Files can be named directly, found by scanning a directory for `.yu` files, or listed in a
+     * manifest. A manifest is a text file with one file or directory per line, relative to the
+     * manifest; blank lines and lines starting with `#` are ignored. A directory holding a
+     * `yu.project` manifest is read through it instead of being scanned, whether it is added
+     * directly or listed in another manifest. Every file is stat'ed once
+     * while it is collected, so scheduling never touches the file system again.
+     */
+    class Project
+    {
+    public:
+        static constexpr std::string_view manifest_name = "yu.project";
+        static constexpr std::string_view source_extension = ".yu";
+
+        /**
+         * @brief Adds a single source file. Missing files are kept so that reading them reports the error.
+         */
+        void add_file(const std::filesystem::path &path);
+
+        /**
+         * @brief Adds a directory or a manifest.
+         * @param path A directory to scan, or a manifest file.
+         * @throws std::runtime_error if the path does not exist or a manifest cannot be read.
+         */
+        void add(const std::filesystem::path &path);
+
+        [[nodiscard]] const std::vector<SourceFile> &files() const
+        {
+            return sources;
+        }
+
+        /**
+         * @brief Orders the files for a worker pool: most expensive first, so no large file starts last.
+         * @return std::vector<uint32_t> Indices into files().
+         */
+        [[nodiscard]] std::vector<uint32_t> schedule() const;
+
+    private:
+        std::vector<SourceFile> sources;
+        std::unordered_set<std::string> seen;
+        std::unordered_set<std::string> manifests; // already read
+
+        void add_directory(const std::filesystem::path &directory);
+
+        void add_manifest(const std::filesystem::path &manifest);
+
+        void add_source(const std::filesystem::path &path, uint64_t size);
+    };
+}
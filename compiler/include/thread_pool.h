@@ -0,0 +1,99 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../../common/arch.hpp"
+
+namespace yu::compiler
+{
+    /**
+     * @brief A fixed set of worker threads with two task deques each.
+     *
+     * Tasks from outside the pool are dealt round-robin and run in submission order, so work
+     * submitted largest-first starts largest-first. Tasks a worker submits itself run before those,
+     * newest first, while their data is still in cache. A worker that runs dry steals the oldest
+     * task of another worker, outside tasks before nested ones. Submission and completion only
+     * touch the target deque and two atomic counts; the shared mutex is taken to wake sleeping
+     * workers.
+     */
+    class ThreadPool
+    {
+    public:
+        /**
+         * @brief Starts the workers.
+         * @param thread_count Number of workers; 0 uses the hardware concurrency.
+         */
+        explicit ThreadPool(uint32_t thread_count = 0);
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        /**
+         * @brief Runs the remaining tasks and joins the workers.
+         */
+        ~ThreadPool();
+
+        /**
+         * @brief Queues a task. Tasks may submit further tasks; those go to the submitting worker.
+         */
+        void submit(std::function<void()> task);
+
+        /**
+         * @brief Blocks until every submitted task has finished.
+         * @throws The first exception a task threw since the last wait().
+         */
+        void wait();
+
+        [[nodiscard]] uint32_t size() const
+        {
+            return static_cast<uint32_t>(threads.size());
+        }
+
+        /**
+         * @brief Index of the pool worker running the calling thread, for per-worker scratch state.
+         * @return uint32_t The index, or UINT32_MAX when not called from a worker.
+         */
+        static uint32_t worker_index();
+
+    private:
+        struct CACHE_ALIGNED Worker
+        {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;  // submitted from outside the pool, oldest first
+            std::deque<std::function<void()>> nested; // submitted by this worker, oldest first
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::vector<std::thread> threads;
+
+        std::mutex state_mutex;
+        std::condition_variable work_available;
+        std::condition_variable all_done;
+        std::atomic<uint32_t> queued = 0;   // tasks waiting in a deque and not reserved by a worker
+        std::atomic<uint32_t> pending = 0;  // tasks submitted but not finished
+        std::atomic<uint32_t> sleeping = 0; // workers waiting on work_available
+        std::atomic<uint32_t> next_worker = 0;
+        bool stopping = false;       // guarded by state_mutex
+        std::exception_ptr failure; // guarded by state_mutex
+
+        void run(uint32_t index);
+
+        /**
+         * @brief Claims one of the queued tasks without blocking.
+         */
+        bool reserve();
+
+        bool take(uint32_t index, std::function<void()> &task);
+    };
+}
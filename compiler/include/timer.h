@@ -0,0 +1,140 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "memory.h"
+#include "perf_counters.h"
+
+namespace yu::compiler
+{
+    /**
+     * @brief Merged timings of one phase, as returned by Timer::collect().
+     *
+     * A sample is everything a phase spent inside one outermost scope of a thread, normally one
+     * file, so min/avg/max compare files even for phases entered many times per file.
+     */
+    struct PhaseStats
+    {
+        std::string name;
+        std::string path;   // names from the outermost scope down, joined by '/'
+        uint32_t depth = 0; // 0 for outermost scopes
+        uint64_t calls = 0;
+        uint64_t samples = 0;
+        uint64_t total_ns = 0;
+        uint64_t min_ns = 0;
+        uint64_t max_ns = 0;
+        uint64_t bytes = 0;
+        uint64_t tokens = 0;
+        uint64_t declarations = 0;
+        PerfCounterValues counters {}; // summed over all calls, see Timer::set_counters_enabled()
+        uint32_t counter_mask = 0;     // counters that were available, bit `1 << PerfCounter`
+        bool counters_multiplexed = false; // some counts were scaled up, see PerfCounters::read()
+
+        // see Timer::set_memory_enabled()
+        bool memory_tracked = false;
+        int64_t peak_bytes = 0;       // highest live bytes above the entry of one call
+        int64_t retained_bytes = 0;   // bytes still live when calls ended, summed over all calls
+        uint64_t allocated_bytes = 0; // bytes allocated while open, summed over all calls
+        uint64_t allocations = 0;
+
+        [[nodiscard]] uint64_t avg_ns() const
+        {
+            return samples ? total_ns / samples : 0;
+        }
+    };
+
+    /**
+     * @brief Times the scope it lives in as a phase nested under the scopes already open on the
+     * calling thread.
+     *
+     * Timings accumulate per thread without locking and are merged by collect() once the work is
+     * done. While tracing (see Tracer) each scope also becomes a span on the thread's timeline.
+     * While both are disabled (the default) a Timer costs two relaxed loads.
+     */
+    class Timer
+    {
+    public:
+        /**
+         * @param phase The phase name; must outlive the process (a string literal).
+         * @param detail Shown with the span when tracing, e.g. the file name; must outlive the Timer.
+         */
+        explicit Timer(const char *phase, std::string_view detail = {});
+
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
+
+        ~Timer();
+
+        /**
+         * @brief Counts bytes processed by this phase, for throughput.
+         */
+        void add_bytes(uint64_t count) const;
+
+        void add_tokens(uint64_t count) const;
+
+        void add_declarations(uint64_t count) const;
+
+        static void set_enabled(bool enabled);
+
+        [[nodiscard]] static bool enabled();
+
+        /**
+         * @brief Also reads the thread's hardware performance counters around each scope.
+         *
+         * Counters are opened per thread on first use. Where they are unavailable the timings are
+         * still recorded and counter_mask stays 0. A nested scope's counter reads are charged to its
+         * parents, which is noise for phases entered many times per file.
+         */
+        static void set_counters_enabled(bool enabled);
+
+        /**
+         * @brief Also records the thread's allocations (see MemoryCounters) around each scope.
+         *
+         * Only the front-end's counted columns are seen unless the build tracks the global operator
+         * new. Memory allocated in a scope and freed on another thread after it closed still counts
+         * as retained by the scope.
+         */
+        static void set_memory_enabled(bool enabled);
+
+        [[nodiscard]] static bool memory_enabled();
+
+        /**
+         * @brief Why hardware counters could not be opened, if a thread tried and none were.
+         */
+        [[nodiscard]] static std::string counters_error();
+
+        /**
+         * @brief Merges the timings of all threads into one entry per phase, parents before children.
+         *
+         * Must not run concurrently with timed work: call it after joining or waiting for the threads.
+         */
+        static std::vector<PhaseStats> collect();
+
+        /**
+         * @brief Drops everything recorded so far. Same restrictions as collect().
+         */
+        static void reset();
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        const char *phase;
+        std::string_view detail;
+        uint32_t node;
+        bool counting = false;
+        bool start_multiplexed = false;
+        bool measuring_memory = false;
+        uint64_t trace_start;
+        clock::time_point start_time;
+        PerfCounterValues start_counters;
+        MemoryCounters start_memory;
+
+        void record() const;
+    };
+}
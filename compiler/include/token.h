@@ -5,6 +5,7 @@
 
 #include <cstdint>
 #include <vector>
+#include "memory.h"
 
 namespace yu::lang
 {
@@ -246,10 +247,10 @@ namespace yu::lang
      */
     struct alignas(8) TokenList
     {
-        std::vector<uint32_t> starts;
-        std::vector<uint16_t> lengths;
-        std::vector<token_i> types;
-        std::vector<uint8_t> flags;
+        compiler::CountedVector<uint32_t> starts;
+        compiler::CountedVector<uint16_t> lengths;
+        compiler::CountedVector<token_i> types;
+        compiler::CountedVector<uint8_t> flags;
 
         void push_back(const token_t &token);
 
@@ -0,0 +1,88 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace yu::compiler
+{
+    enum class TraceEventType : uint8_t
+    {
+        SPAN,   // a completed scope: start and duration
+        COUNTER // a sampled value
+    };
+
+    struct TraceEvent
+    {
+        TraceEventType type;
+        const char *name;
+        uint64_t start_ns;    // since Tracer::set_enabled(true)
+        uint64_t duration_ns; // spans only
+        int64_t value;        // counters only
+        std::string_view detail; // e.g. the file a span worked on; valid until Tracer::reset()
+    };
+
+    /**
+     * @brief The events one thread recorded, in the order it recorded them.
+     */
+    struct TraceThread
+    {
+        uint32_t id;
+        std::string name;
+        std::vector<TraceEvent> events;
+    };
+
+    /**
+     * @brief Records a timeline of spans and counters for trace viewers.
+     *
+     * Every thread appends to its own buffer, so recording takes no lock and never waits for another
+     * thread; only a thread's first event registers its buffer. Timer scopes become spans while
+     * tracing is enabled.
+     */
+    class Tracer
+    {
+    public:
+        /**
+         * @brief Starts or stops recording. Enabling resets the timeline's origin.
+         */
+        static void set_enabled(bool enabled);
+
+        [[nodiscard]] static bool enabled();
+
+        /**
+         * @brief Current time on the trace clock.
+         */
+        [[nodiscard]] static uint64_t now_ns();
+
+        /**
+         * @brief Records a finished span on the calling thread.
+         * @param name The span name; must outlive the process (a string literal).
+         * @param start_ns When it started, from now_ns().
+         * @param detail Extra text shown with the span; copied into the thread's arena.
+         */
+        static void span(const char *name, uint64_t start_ns, std::string_view detail = {});
+
+        /**
+         * @brief Records the current value of a process-wide counter, e.g. a queue depth.
+         * @param name The counter name; must outlive the process (a string literal).
+         */
+        static void counter(const char *name, int64_t value);
+
+        /**
+         * @brief Copies out what every thread recorded.
+         *
+         * Must not run concurrently with recording: call it after joining or waiting for the threads.
+         */
+        static std::vector<TraceThread> collect();
+
+        /**
+         * @brief Drops everything recorded so far, span details included. Same restrictions as
+         * collect().
+         */
+        static void reset();
+    };
+}
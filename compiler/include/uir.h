@@ -0,0 +1,524 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * UIR, the compiler's SSA intermediate representation, as specified in docs/v1/specs/ir.md.
+ *
+ * A function is a table of instructions stored column by column (opcode, type, immediate,
+ * operand range, ...). Every SSA value is an instruction: parameters, constants and memory
+ * states included, so a value id is an instruction index and operands are plain indices. Once a
+ * function is laid out, the instructions of each block are contiguous and blocks are ranges of
+ * that table, so walking a block or a whole function is a linear scan.
+ */
+namespace yu::uir
+{
+    using TypeId = uint32_t;
+
+    inline constexpr uint32_t no_value = std::numeric_limits<uint32_t>::max();
+    inline constexpr uint32_t no_block = std::numeric_limits<uint32_t>::max();
+    inline constexpr uint32_t no_function = std::numeric_limits<uint32_t>::max();
+
+    enum class TypeKind : uint8_t
+    {
+        VOID,
+        BOOL,
+        I8,
+        U8,
+        I16,
+        U16,
+        I32,
+        U32,
+        I64,
+        U64,
+        F32,
+        F64,
+        PTR, // the generic pointer; `ptr<T>` is a compound type of this kind
+        MEM, // memory states
+        ARRAY,
+        VECTOR,
+        STRUCT
+    };
+
+    /**
+     * @brief Number of primitive kinds; their TypeId is the kind itself.
+     */
+    inline constexpr uint32_t primitive_type_count = static_cast<uint32_t>(TypeKind::ARRAY);
+
+    constexpr TypeId primitive(const TypeKind kind)
+    {
+        return static_cast<TypeId>(kind);
+    }
+
+    /**
+     * @brief The types of a module. Primitive types are predefined; compound types are interned,
+     * so structurally equal types have the same id.
+     */
+    class TypeTable
+    {
+    public:
+        TypeTable();
+
+        [[nodiscard]] TypeKind kind(TypeId type) const
+        {
+            return kinds[type];
+        }
+
+        /**
+         * @return TypeId The pointee, element or no type (VOID) for primitives.
+         */
+        [[nodiscard]] TypeId element(TypeId type) const
+        {
+            return elements[type];
+        }
+
+        [[nodiscard]] uint32_t count(TypeId type) const // elements of arrays and vectors
+        {
+            return counts[type];
+        }
+
+        [[nodiscard]] std::span<const TypeId> fields(TypeId type) const
+        {
+            return { field_list.data() + field_starts[type], field_counts[type] };
+        }
+
+        [[nodiscard]] uint32_t size() const
+        {
+            return static_cast<uint32_t>(kinds.size());
+        }
+
+        TypeId pointer_to(TypeId element);
+
+        TypeId array_of(TypeId element, uint32_t count);
+
+        TypeId vector_of(TypeId element, uint32_t count);
+
+        TypeId structure(std::span<const TypeId> fields);
+
+        [[nodiscard]] bool is_integer(TypeId type) const;
+
+        [[nodiscard]] bool is_signed(TypeId type) const;
+
+        [[nodiscard]] bool is_float(TypeId type) const;
+
+        [[nodiscard]] bool is_pointer(TypeId type) const
+        {
+            return kind(type) == TypeKind::PTR;
+        }
+
+        /**
+         * @brief Width of integer, bool and float types in bits, 0 for the others.
+         */
+        [[nodiscard]] uint32_t bits(TypeId type) const;
+
+        /**
+         * @brief The type as written in UIR text, e.g. `i32` or `array<ptr<u8>, 4>`.
+         */
+        [[nodiscard]] std::string name(TypeId type) const;
+
+    private:
+        std::vector<TypeKind> kinds;
+        std::vector<TypeId> elements;
+        std::vector<uint32_t> counts;
+        std::vector<uint32_t> field_starts;
+        std::vector<uint32_t> field_counts;
+        std::vector<TypeId> field_list;
+        std::unordered_map<std::string, TypeId> interned; // structural key to type
+
+        TypeId add(TypeKind kind, TypeId element, uint32_t count, std::span<const TypeId> fields);
+    };
+
+    enum class Opcode : uint8_t
+    {
+        NOP, // a removed instruction, dropped by the next layout
+
+        // values without operands
+        PARAM,      // immediate: parameter index
+        CONST,      // immediate: the value's bits (floats as their IEEE bits)
+        UNDEF,
+        FUNC_ENTRY, // the memory state on entry
+
+        // arithmetic, bitwise and comparisons: operands a, b (one for NEG and NOT)
+        ADD,
+        SUB,
+        MUL,
+        DIV,
+        MOD,
+        NEG,
+        FADD,
+        FSUB,
+        FMUL,
+        FDIV,
+        AND,
+        OR,
+        XOR,
+        NOT,
+        SHL,
+        SHR,
+        SAR,
+        CMP_EQ,
+        CMP_NE,
+        CMP_LT,
+        CMP_LE,
+        CMP_GT,
+        CMP_GE,
+        FCMP_EQ,
+        FCMP_NE,
+        FCMP_LT,
+        FCMP_LE,
+        FCMP_GT,
+        FCMP_GE,
+
+        // conversions: operand value, result type is the target type
+        ZEXT,
+        SEXT,
+        TRUNC,
+        BITCAST,
+        INTTOPTR,
+        PTRTOINT,
+
+        // memory; immediates hold the byte offset of the address
+        ALLOC,        // result ptr<T>, no operands
+        LOAD,         // ptr [, mem]
+        STORE,        // value, ptr [, mem]; result is the new memory state
+        BARRIER,      // mem
+        BARRIER_ACQ,  // mem
+        BARRIER_REL,  // mem
+        ATOMIC_LOAD,  // ptr; ordering in flags
+        ATOMIC_STORE, // value, ptr; ordering in flags
+        CMPXCHG,      // ptr, expected, new; orderings in flags
+        ATOMIC_ADD,   // ptr, value; ordering in flags
+        ATOMIC_SUB,
+        ATOMIC_AND,
+        ATOMIC_OR,
+        ATOMIC_XOR,
+
+        PHI, // operand k arrives from target k
+
+        CALL,          // arguments; immediate: callee function index in the module
+        CALL_INDIRECT, // callee, arguments
+        INTRINSIC,     // arguments; immediate: name atom in the global StringInterner
+
+        // terminators; successors are the instruction's targets
+        JUMP,        // targets: destination
+        BRANCH,      // operand: condition; targets: taken, not taken
+        SWITCH,      // operands: value, case constants; targets: default, one per case
+        RET,         // [value]
+        UNREACHABLE,
+
+        COUNT
+    };
+
+    enum class Ordering : uint8_t
+    {
+        UNORDERED,
+        MONOTONIC,
+        ACQUIRE,
+        RELEASE,
+        ACQ_REL,
+        SEQ_CST
+    };
+
+    enum InstructionFlags : uint8_t
+    {
+        TAIL = 1 << 0, // calls: `tail call`
+        // bits 1-3: Ordering of atomics, bits 4-6: failure Ordering of cmpxchg
+        BOUND = 1 << 7, // calls: the result is assigned to a variable, so it is used even if never read
+    };
+
+    enum FunctionAttributes : uint8_t
+    {
+        PURE = 1 << 0,       // no side effects and no reads of mutable memory: equal arguments, equal result
+        TAIL_REC = 1 << 1,   // every self call must be a tail call
+        NO_DISCARD = 1 << 2, // callers must use the result
+        INLINE = 1 << 3,     // always inlined into callers
+    };
+
+    constexpr uint8_t ordering_flags(const Ordering success, const Ordering failure = Ordering::UNORDERED)
+    {
+        return static_cast<uint8_t>(static_cast<uint8_t>(success) << 1 | static_cast<uint8_t>(failure) << 4);
+    }
+
+    constexpr Ordering success_ordering(const uint8_t flags)
+    {
+        return static_cast<Ordering>(flags >> 1 & 7);
+    }
+
+    constexpr Ordering failure_ordering(const uint8_t flags)
+    {
+        return static_cast<Ordering>(flags >> 4 & 7);
+    }
+
+    enum OpcodeTraits : uint8_t
+    {
+        TERMINATOR = 1 << 0,
+        SIDE_EFFECTS = 1 << 1, // must stay even if unused, and in order with other side effects
+        READS_MEMORY = 1 << 2,
+        COMMUTATIVE = 1 << 3,
+        NO_RESULT = 1 << 4 // produces no value (void-typed)
+    };
+
+    struct OpcodeInfo
+    {
+        std::string_view name; // mnemonic in UIR text
+        uint8_t traits;        // OpcodeTraits
+    };
+
+    /**
+     * @brief Mnemonic and traits of every opcode, indexed by Opcode.
+     */
+    extern const OpcodeInfo opcode_info[static_cast<size_t>(Opcode::COUNT)];
+
+    inline const OpcodeInfo &info(const Opcode opcode)
+    {
+        return opcode_info[static_cast<size_t>(opcode)];
+    }
+
+    inline bool is_terminator(const Opcode opcode)
+    {
+        return info(opcode).traits & TERMINATOR;
+    }
+
+    /**
+     * @brief One function's instructions, one column per field.
+     *
+     * All columns of a function, and the use and predecessor lists derived from them, live in the
+     * function's own arena and are released together with it. Laying out (see Builder::finish())
+     * copies the live instructions into a fresh arena, so edits never accumulate garbage.
+     *
+     * Use lists and predecessor lists are flat arrays indexed by value and block, computed on
+     * demand; any edit invalidates them until they are computed again.
+     */
+    class Function
+    {
+    public:
+        /**
+         * @param name Name atom in the global StringInterner.
+         * @param params Parameter types.
+         * @param return_type The return type, VOID for none.
+         */
+        Function(uint32_t name, std::vector<TypeId> params, TypeId return_type);
+
+        Function(const Function &) = delete;
+        Function &operator=(const Function &) = delete;
+
+        ~Function();
+
+        [[nodiscard]] uint32_t name() const
+        {
+            return name_atom;
+        }
+
+        [[nodiscard]] std::span<const TypeId> params() const
+        {
+            return param_types;
+        }
+
+        [[nodiscard]] TypeId return_type() const
+        {
+            return result_type;
+        }
+
+        /**
+         * @brief FunctionAttributes of the function.
+         */
+        [[nodiscard]] uint8_t attributes() const
+        {
+            return attribute_flags;
+        }
+
+        void set_attributes(const uint8_t attributes)
+        {
+            attribute_flags = attributes;
+        }
+
+        /**
+         * @brief Number of instructions, i.e. values.
+         */
+        [[nodiscard]] uint32_t size() const;
+
+        [[nodiscard]] Opcode opcode(uint32_t value) const;
+
+        [[nodiscard]] TypeId type(uint32_t value) const;
+
+        [[nodiscard]] uint64_t immediate(uint32_t value) const;
+
+        [[nodiscard]] uint8_t flags(uint32_t value) const;
+
+        /**
+         * @return uint32_t The value's name atom, StringInterner::empty_atom if unnamed.
+         */
+        [[nodiscard]] uint32_t value_name(uint32_t value) const;
+
+        [[nodiscard]] uint32_t block_of(uint32_t value) const;
+
+        [[nodiscard]] std::span<const uint32_t> operands(uint32_t value) const;
+
+        [[nodiscard]] std::span<const uint32_t> targets(uint32_t value) const;
+
+        [[nodiscard]] uint32_t block_count() const;
+
+        /**
+         * @brief First instruction of a block. Only valid while laid out.
+         */
+        [[nodiscard]] uint32_t block_begin(uint32_t block) const;
+
+        [[nodiscard]] uint32_t block_end(uint32_t block) const;
+
+        /**
+         * @return uint32_t The block's last instruction if it is a terminator, else no_value.
+         */
+        [[nodiscard]] uint32_t terminator(uint32_t block) const;
+
+        [[nodiscard]] std::span<const uint32_t> successors(uint32_t block) const;
+
+        /**
+         * @brief True once the instructions of every block are contiguous, see Builder::finish().
+         */
+        [[nodiscard]] bool laid_out() const;
+
+        /**
+         * @brief Fills the use lists: for every value, the instructions using it, one entry per use.
+         */
+        void compute_uses();
+
+        [[nodiscard]] std::span<const uint32_t> uses(uint32_t value) const;
+
+        /**
+         * @brief Fills the predecessor lists, one entry per incoming edge, in block order.
+         */
+        void compute_predecessors();
+
+        [[nodiscard]] std::span<const uint32_t> predecessors(uint32_t block) const;
+
+        void set_operand(uint32_t value, uint32_t index, uint32_t operand);
+
+        void set_target(uint32_t value, uint32_t index, uint32_t block);
+
+        void set_flags(uint32_t value, uint8_t flags);
+
+        /**
+         * @brief Drops the incoming value and block `index` of a phi, e.g. when an edge is removed.
+         */
+        void remove_incoming(uint32_t phi, uint32_t index);
+
+        /**
+         * @brief Makes every use of `from` use `to` instead.
+         */
+        void replace_all_uses(uint32_t from, uint32_t to);
+
+        /**
+         * @brief Turns an instruction into a NOP; the next layout removes it.
+         */
+        void remove(uint32_t value);
+
+        /**
+         * @brief Drops every instruction and block, leaving a laid-out declaration.
+         */
+        void clear();
+
+        /**
+         * @brief Checks the structural invariants: every block ends in its only terminator, phis
+         * lead their block and match its predecessors, operands and targets are in range and
+         * operand types agree where the opcode requires it.
+         * @return std::string Empty if the function is well-formed, else the first problem found.
+         */
+        [[nodiscard]] std::string verify(const TypeTable &types) const;
+
+    private:
+        friend class Builder;
+        friend class ModuleImage;
+        friend class TextReader; // reads UIR text straight into the columns
+
+        struct Body
+        {
+            std::pmr::monotonic_buffer_resource arena;
+
+            std::pmr::vector<Opcode> opcodes {&arena};
+            std::pmr::vector<TypeId> types {&arena};
+            std::pmr::vector<uint64_t> immediates {&arena};
+            std::pmr::vector<uint8_t> flags {&arena};
+            std::pmr::vector<uint32_t> names {&arena};
+            std::pmr::vector<uint32_t> blocks {&arena}; // block of each instruction
+
+            std::pmr::vector<uint32_t> operand_starts {&arena};
+            std::pmr::vector<uint32_t> operand_counts {&arena};
+            std::pmr::vector<uint32_t> operand_list {&arena};
+            std::pmr::vector<uint32_t> target_starts {&arena};
+            std::pmr::vector<uint32_t> target_counts {&arena};
+            std::pmr::vector<uint32_t> target_list {&arena};
+
+            uint32_t block_count = 0;
+            std::pmr::vector<uint32_t> block_starts {&arena}; // block_count + 1 entries while laid out
+
+            std::pmr::vector<uint32_t> use_starts {&arena}; // size() + 1 entries once computed
+            std::pmr::vector<uint32_t> use_list {&arena};
+            std::pmr::vector<uint32_t> predecessor_starts {&arena}; // block_count + 1 entries once computed
+            std::pmr::vector<uint32_t> predecessor_list {&arena};
+
+            explicit Body(std::pmr::memory_resource *upstream) : arena(upstream) {}
+        };
+
+        /**
+         * @brief An empty body on the counted upstream resource.
+         */
+        static std::unique_ptr<Body> make_body();
+
+        uint32_t name_atom;
+        std::vector<TypeId> param_types;
+        TypeId result_type;
+        uint8_t attribute_flags = 0;
+        std::unique_ptr<Body> body;
+    };
+
+    /**
+     * @brief A compilation's functions and the types they share.
+     */
+    class Module
+    {
+    public:
+        TypeTable types;
+
+        /**
+         * @brief Adds an empty function; build it with a Builder.
+         * @param name The function name.
+         * @return uint32_t The function's index.
+         */
+        uint32_t add_function(std::string_view name, std::vector<TypeId> params, TypeId return_type);
+
+        [[nodiscard]] uint32_t function_count() const
+        {
+            return static_cast<uint32_t>(functions.size());
+        }
+
+        [[nodiscard]] Function &function(const uint32_t index)
+        {
+            return *functions[index];
+        }
+
+        [[nodiscard]] const Function &function(const uint32_t index) const
+        {
+            return *functions[index];
+        }
+
+        /**
+         * @return uint32_t The index of the function with this name, or no_function.
+         */
+        [[nodiscard]] uint32_t find_function(std::string_view name) const;
+
+    private:
+        std::vector<std::unique_ptr<Function>> functions;
+        std::unordered_map<uint32_t, uint32_t> by_name; // name atom to function
+    };
+}
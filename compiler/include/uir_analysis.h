@@ -0,0 +1,242 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+#include "uir.h"
+
+/**
+ * Analyses over laid-out UIR functions, shared by the passes. An analysis is a snapshot: it is
+ * computed once from the function and stays valid, including its block numbering, until the
+ * function is laid out again.
+ */
+namespace yu::uir
+{
+    /**
+     * @brief The dominator tree of a function's reachable blocks (Cooper, Harvey and Kennedy).
+     *
+     * Immediate dominators are found by iterating over the reverse postorder until nothing
+     * changes, which takes two or three rounds on the control flow lowering produces. The tree is
+     * then numbered in preorder, so a dominance query is two comparisons.
+     */
+    class DominatorTree
+    {
+    public:
+        /**
+         * @brief Computes the tree; fills the function's predecessor lists on the way.
+         */
+        explicit DominatorTree(Function &function);
+
+        /**
+         * @return uint32_t The immediate dominator, no_block for the entry and unreachable blocks.
+         */
+        [[nodiscard]] uint32_t idom(const uint32_t block) const
+        {
+            return idoms[block];
+        }
+
+        [[nodiscard]] bool reachable(const uint32_t block) const
+        {
+            return enter[block] != no_block;
+        }
+
+        /**
+         * @brief True if every path from the entry to `b` passes `a`; a block dominates itself.
+         */
+        [[nodiscard]] bool dominates(const uint32_t a, const uint32_t b) const
+        {
+            return reachable(a) && reachable(b) && enter[a] <= enter[b] && enter[b] <= leave[a];
+        }
+
+        /**
+         * @brief The blocks `block` immediately dominates, in block order.
+         */
+        [[nodiscard]] std::span<const uint32_t> children(const uint32_t block) const
+        {
+            return { child_list.data() + child_starts[block], child_starts[block + 1] - child_starts[block] };
+        }
+
+        /**
+         * @brief The reachable blocks in preorder of the tree: every block after its dominators.
+         */
+        [[nodiscard]] std::span<const uint32_t> preorder() const
+        {
+            return order;
+        }
+
+        /**
+         * @brief Position of a reachable block in preorder().
+         */
+        [[nodiscard]] uint32_t preorder_index(const uint32_t block) const
+        {
+            return enter[block];
+        }
+
+        /**
+         * @brief Last preorder() position inside the subtree of a reachable block.
+         */
+        [[nodiscard]] uint32_t subtree_end(const uint32_t block) const
+        {
+            return leave[block];
+        }
+
+        /**
+         * @brief The reachable blocks in reverse postorder of the control flow graph.
+         */
+        [[nodiscard]] std::span<const uint32_t> reverse_postorder() const
+        {
+            return rpo;
+        }
+
+    private:
+        std::vector<uint32_t> idoms;
+        std::vector<uint32_t> rpo;
+        std::vector<uint32_t> child_starts; // block_count + 1 entries
+        std::vector<uint32_t> child_list;
+        std::vector<uint32_t> order;
+        std::vector<uint32_t> enter; // preorder index, no_block if unreachable
+        std::vector<uint32_t> leave;
+    };
+
+    inline constexpr uint32_t no_loop = std::numeric_limits<uint32_t>::max();
+
+    /**
+     * @brief The natural loops of a function's reachable blocks and how they nest.
+     *
+     * An edge to a block that dominates its source is a back edge. It closes a loop made of its
+     * target, the header, and every block reaching its source without passing the header. Back
+     * edges to the same header form one loop. Headers are visited in reverse dominator tree
+     * preorder, so a loop found inside the blocks of another was found first and becomes its
+     * child; loops are numbered in that order, inner loops before the loops containing them.
+     */
+    class LoopForest
+    {
+    public:
+        /**
+         * @param tree The function's dominator tree, whose predecessor lists are used.
+         */
+        LoopForest(const Function &function, const DominatorTree &tree);
+
+        [[nodiscard]] uint32_t loop_count() const
+        {
+            return static_cast<uint32_t>(headers.size());
+        }
+
+        [[nodiscard]] uint32_t header(const uint32_t loop) const
+        {
+            return headers[loop];
+        }
+
+        /**
+         * @return uint32_t The loop immediately containing a loop, no_loop for outermost loops.
+         */
+        [[nodiscard]] uint32_t parent(const uint32_t loop) const
+        {
+            return parents[loop];
+        }
+
+        /**
+         * @brief The number of loops containing a loop, itself included.
+         */
+        [[nodiscard]] uint32_t depth(const uint32_t loop) const
+        {
+            return depths[loop];
+        }
+
+        /**
+         * @return uint32_t The innermost loop of a block, no_loop if it is in none.
+         */
+        [[nodiscard]] uint32_t loop_of(const uint32_t block) const
+        {
+            return innermost[block];
+        }
+
+        /**
+         * @brief True if a block is in a loop or one nested in it.
+         */
+        [[nodiscard]] bool contains(const uint32_t loop, const uint32_t block) const
+        {
+            uint32_t inner = block < innermost.size() ? innermost[block] : no_loop;
+            while (inner != no_loop && depths[inner] > depths[loop])
+                inner = parents[inner];
+            return inner == loop;
+        }
+
+        /**
+         * @brief The blocks of a loop, nested loops included, in dominator tree preorder, so the
+         * header comes first.
+         */
+        [[nodiscard]] std::span<const uint32_t> blocks(const uint32_t loop) const
+        {
+            return { block_list.data() + block_starts[loop], block_starts[loop + 1] - block_starts[loop] };
+        }
+
+    private:
+        std::vector<uint32_t> headers;
+        std::vector<uint32_t> parents;
+        std::vector<uint32_t> depths;
+        std::vector<uint32_t> innermost;    // per block
+        std::vector<uint32_t> block_starts; // loop_count + 1 entries
+        std::vector<uint32_t> block_list;
+    };
+
+    /**
+     * @brief The direct calls between a module's functions and their strongly connected
+     * components (Tarjan), so that passes can visit callees before their callers.
+     */
+    class CallGraph
+    {
+    public:
+        explicit CallGraph(const Module &module);
+
+        /**
+         * @brief The functions a function calls directly, each once.
+         */
+        [[nodiscard]] std::span<const uint32_t> callees(const uint32_t function) const
+        {
+            return { callee_list.data() + callee_starts[function], callee_starts[function + 1] - callee_starts[function] };
+        }
+
+        /**
+         * @brief Every function, each component after the components it calls.
+         */
+        [[nodiscard]] std::span<const uint32_t> bottom_up() const
+        {
+            return order;
+        }
+
+        /**
+         * @brief The component of a function; functions calling each other share one.
+         */
+        [[nodiscard]] uint32_t component(const uint32_t function) const
+        {
+            return components[function];
+        }
+
+        /**
+         * @brief True if the function can reach a call to itself.
+         */
+        [[nodiscard]] bool recursive(const uint32_t function) const
+        {
+            return cyclic[function];
+        }
+
+    private:
+        std::vector<uint32_t> callee_starts; // function_count + 1 entries
+        std::vector<uint32_t> callee_list;
+        std::vector<uint32_t> order;
+        std::vector<uint32_t> components;
+        std::vector<bool> cyclic;
+    };
+
+    /**
+     * @brief True for the values that may write memory without giving it a new state, as stores
+     * do: calls to functions that are not `@pure`, indirect calls, intrinsics, atomics and
+     * barriers. Two loads of one memory state only read the same while none of these runs.
+     */
+    [[nodiscard]] bool writes_unversioned(const Module &module, const Function &function, uint32_t value);
+}
@@ -0,0 +1,250 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "uir.h"
+
+namespace yu::uir
+{
+    /**
+     * @brief Creates and edits the instructions of one function.
+     *
+     * New instructions are appended to the function's columns and their order is kept in a list
+     * per block, so instructions can be added to any block in any order. finish() then lays the
+     * function out: it copies the live instructions block by block into a fresh arena, dropping
+     * removed ones, and renumbers the values.
+     *
+     * Parameters, the entry memory state and constants are placed at the top of the entry block
+     * regardless of the insertion point, and equal constants are shared. Between the first edit
+     * and finish() the function is not laid out, so block ranges must not be used.
+     */
+    class Builder
+    {
+    public:
+        /**
+         * @brief Starts building an empty function, or editing a laid-out one.
+         */
+        Builder(Module &module, uint32_t function);
+
+        [[nodiscard]] Function &function() const
+        {
+            return target;
+        }
+
+        [[nodiscard]] Module &module() const
+        {
+            return owner;
+        }
+
+        /**
+         * @brief Adds an empty block; the first block created is the entry block.
+         */
+        uint32_t create_block();
+
+        /**
+         * @brief Appends the following instructions to the end of a block.
+         */
+        void set_insert_block(uint32_t block);
+
+        /**
+         * @brief Inserts the following instructions, in order, before an existing instruction.
+         */
+        void set_insert_before(uint32_t value);
+
+        [[nodiscard]] uint32_t insert_block() const
+        {
+            return current_block;
+        }
+
+        /**
+         * @brief Moves the instructions after `value` to a new block and returns it. The edges
+         * leaving the block then leave the new block, so the phis of its successors must be
+         * pointed at it.
+         */
+        uint32_t split_block(uint32_t value);
+
+        /**
+         * @brief Moves all instructions of a block to a new block and returns it, like
+         * split_block(); the parameters and constants of the entry block stay where they are.
+         */
+        uint32_t move_instructions(uint32_t block);
+
+        /**
+         * @brief Moves an instruction other than a phi from its block to the insertion point.
+         */
+        void move(uint32_t value);
+
+        /**
+         * @brief Moves the instructions of `from` to the end of `into` and drops `from` at
+         * finish(). `into` must no longer end in a terminator and `from` must have no phis left.
+         */
+        void merge_blocks(uint32_t into, uint32_t from);
+
+        /**
+         * @brief Drops a block and its instructions at finish(), which renumbers the blocks after
+         * it. No edge may lead to it any more; the entry block cannot be removed.
+         */
+        void remove_block(uint32_t block);
+
+        /**
+         * @brief True if the block already ends in a terminator.
+         */
+        [[nodiscard]] bool terminated(uint32_t block) const;
+
+        /**
+         * @brief The instructions of a block in their current order, phis first.
+         */
+        [[nodiscard]] std::span<const uint32_t> block_values(uint32_t block) const;
+
+        uint32_t param(uint32_t index);
+
+        /**
+         * @brief The memory state on entry to the function.
+         */
+        uint32_t memory_entry();
+
+        /**
+         * @param bits The value, zero-extended to 64 bits.
+         */
+        uint32_t constant(TypeId type, uint64_t bits);
+
+        uint32_t constant_float(TypeId type, double value);
+
+        uint32_t undef(TypeId type);
+
+        /**
+         * @brief Arithmetic, bitwise and comparison instructions; comparisons produce a bool.
+         */
+        uint32_t binary(Opcode opcode, uint32_t a, uint32_t b);
+
+        uint32_t unary(Opcode opcode, uint32_t value);
+
+        uint32_t convert(Opcode opcode, uint32_t value, TypeId to);
+
+        uint32_t alloc(TypeId element);
+
+        /**
+         * @param memory The memory state the load depends on, or no_value.
+         */
+        uint32_t load(TypeId type, uint32_t pointer, uint32_t offset = 0, uint32_t memory = no_value);
+
+        /**
+         * @return uint32_t The memory state after the store.
+         */
+        uint32_t store(uint32_t value, uint32_t pointer, uint32_t offset = 0, uint32_t memory = no_value);
+
+        /**
+         * @param opcode BARRIER, BARRIER_ACQ or BARRIER_REL.
+         */
+        uint32_t barrier(Opcode opcode, uint32_t memory);
+
+        uint32_t atomic_load(TypeId type, uint32_t pointer, Ordering ordering);
+
+        uint32_t atomic_store(uint32_t value, uint32_t pointer, Ordering ordering);
+
+        uint32_t cmpxchg(uint32_t pointer, uint32_t expected, uint32_t desired, Ordering success, Ordering failure);
+
+        /**
+         * @param opcode One of ATOMIC_ADD to ATOMIC_XOR.
+         */
+        uint32_t atomic_rmw(Opcode opcode, uint32_t pointer, uint32_t value, Ordering ordering);
+
+        /**
+         * @brief Adds a phi without incoming values at the top of the insertion block.
+         */
+        uint32_t phi(TypeId type);
+
+        void add_incoming(uint32_t phi, uint32_t value, uint32_t block);
+
+        /**
+         * @param callee Index of the called function in the module.
+         */
+        uint32_t call(uint32_t callee, std::span<const uint32_t> arguments, bool tail = false);
+
+        uint32_t call_indirect(TypeId return_type, uint32_t callee, std::span<const uint32_t> arguments,
+                               bool tail = false);
+
+        uint32_t intrinsic(std::string_view name, TypeId return_type, std::span<const uint32_t> arguments);
+
+        uint32_t jump(uint32_t block);
+
+        uint32_t branch(uint32_t condition, uint32_t taken, uint32_t not_taken);
+
+        /**
+         * @param cases Constant values, one per case.
+         * @param blocks The block of each case.
+         */
+        uint32_t switch_value(uint32_t value, uint32_t default_block, std::span<const uint32_t> cases,
+                              std::span<const uint32_t> blocks);
+
+        /**
+         * @param value The returned value, or no_value for void functions.
+         */
+        uint32_t ret(uint32_t value = no_value);
+
+        uint32_t unreachable();
+
+        /**
+         * @brief Adds a copy of an instruction of another function of the module, with new
+         * operands and targets, at the insertion point; phis go after the block's other phis.
+         */
+        uint32_t copy(const Function &source, uint32_t value, std::span<const uint32_t> operands,
+                      std::span<const uint32_t> targets);
+
+        void set_name(uint32_t value, std::string_view name);
+
+        /**
+         * @brief Lays the function out in block order, dropping removed instructions and blocks.
+         * @return std::vector<uint32_t> The new id of every old value, no_value for removed ones.
+         */
+        std::vector<uint32_t> finish();
+
+    private:
+        Module &owner;
+        Function &target;
+
+        std::vector<uint32_t> prefix;             // parameters, entry memory and constants
+        std::vector<std::vector<uint32_t>> order; // the other instructions of each block
+        std::vector<uint32_t> phi_counts;         // phis leading each block's order
+        std::vector<bool> removed_blocks;         // dropped by the next finish()
+        std::map<std::pair<TypeId, uint64_t>, uint32_t> constants; // (type, bits) to the shared constant
+        uint32_t entry_memory = no_value;
+
+        uint32_t current_block = no_block;
+        uint32_t current_before = no_value;
+
+        /**
+         * @brief Turns a laid-out function back into per-block lists.
+         */
+        void load();
+
+        uint32_t append(Opcode opcode, TypeId type, std::span<const uint32_t> operands,
+                        std::span<const uint32_t> targets = {}, uint64_t immediate = 0, uint8_t flags = 0);
+
+        /**
+         * @brief Appends an operand-free value to the entry prefix.
+         */
+        uint32_t append_prefix(Opcode opcode, TypeId type, uint64_t immediate);
+
+        /**
+         * @brief Moves the instructions of a block from `offset` on to a new block.
+         */
+        uint32_t split_at(uint32_t block, size_t offset);
+
+        /**
+         * @brief Puts a new instruction at the insertion point.
+         */
+        void place(uint32_t value);
+
+        /**
+         * @brief Marks the layout and the derived lists stale after an edit.
+         */
+        void invalidate() const;
+    };
+}
@@ -0,0 +1,129 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "mapped_file.h"
+#include "uir.h"
+
+namespace yu::uir
+{
+    /**
+     * @brief A UIR module as a versioned binary image, cached between builds in a `.yub` file.
+     *
+     * The image holds the module's types, a table of functions and one section per function
+     * body. The table gives each function's signature and the offset and size of its section, so
+     * a function is found without decoding the others. Bodies are varint streams: operands are
+     * stored relative to the instruction using them, which keeps most of them to one byte.
+     *
+     * Loading maps the file and checks its header; attach() then declares every function of the
+     * image in a module, and a body is only decoded when materialize() is asked for it.
+     * Everything decoded from the file is bounds-checked, so a corrupt body fails to materialize
+     * rather than producing a function with out-of-range operands.
+     */
+    class ModuleImage
+    {
+    public:
+        ModuleImage() = default;
+
+        /**
+         * @brief Encodes every function of a module; declarations stay without body.
+         * @throws std::logic_error If a function with a body is not laid out.
+         */
+        static ModuleImage build(const Module &module);
+
+        /**
+         * @brief Maps an image file.
+         * @return bool False if the file is missing, from another compiler version or malformed.
+         */
+        bool open(const std::string &path);
+
+        /**
+         * @brief Writes the image to a file, replacing it atomically.
+         * @return bool False if the file could not be written.
+         */
+        [[nodiscard]] bool write(const std::string &path) const;
+
+        [[nodiscard]] explicit operator bool() const
+        {
+            return size() != 0;
+        }
+
+        [[nodiscard]] uint32_t function_count() const;
+
+        [[nodiscard]] std::string_view function_name(uint32_t function) const;
+
+        /**
+         * @brief Adds the image's types and declares its functions in a module, in image order.
+         *
+         * The module must outlive the image, or the next attach().
+         * @return bool False if the image is empty or a function name is already in the module.
+         */
+        [[nodiscard]] bool attach(Module &module);
+
+        /**
+         * @return uint32_t The module index of an image function once attached, else no_function.
+         */
+        [[nodiscard]] uint32_t module_index(const uint32_t function) const
+        {
+            return target && function < loaded.size() ? base + function : no_function;
+        }
+
+        /**
+         * @brief Decodes one function's body into the attached module, laid out; repeated calls
+         * do nothing.
+         * @return bool False if nothing is attached or the body is malformed; the function then
+         * stays a declaration.
+         */
+        bool materialize(uint32_t function);
+
+        /**
+         * @return uint32_t The number of bodies that failed to decode.
+         */
+        uint32_t materialize_all();
+
+        /**
+         * @brief The raw image, as written by write().
+         */
+        [[nodiscard]] std::span<const std::byte> image() const
+        {
+            return { data(), size() };
+        }
+
+    private:
+        compiler::MappedFile file;
+        std::vector<std::byte> owned; // the image of a built module; empty when mapped
+
+        // state of the attached module
+        Module *target = nullptr;
+        uint32_t base = 0;               // module index of the image's first function
+        std::vector<TypeId> types;       // image type to module type
+        std::vector<uint32_t> atoms;     // image name to atom, filled as names are first used
+        std::vector<uint8_t> loaded;     // per function: body decoded
+
+        [[nodiscard]] const std::byte *data() const
+        {
+            return file ? file.data() : owned.data();
+        }
+
+        [[nodiscard]] size_t size() const
+        {
+            return file ? file.size() : owned.size();
+        }
+
+        template<typename T>
+        [[nodiscard]] const T *section(uint32_t index) const;
+
+        [[nodiscard]] std::string_view name(uint32_t index) const;
+
+        [[nodiscard]] uint32_t atom(uint32_t index);
+
+        [[nodiscard]] bool valid() const;
+    };
+}
@@ -0,0 +1,124 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "uir.h"
+#include "uir_analysis.h"
+
+/**
+ * Optimization passes over UIR. Each pass takes a laid-out function, edits it through a Builder
+ * and lays it out again, so passes can run in any order and repeatedly. Passes return true if
+ * they changed the function.
+ */
+namespace yu::uir
+{
+    /**
+     * @brief Sparse conditional constant propagation (Wegman and Zadeck).
+     *
+     * Values start unknown and blocks unreachable; a worklist of blocks and one of values, both
+     * dense arrays of indices, propagate constants along SSA uses and reachability along CFG
+     * edges, so a phi only merges values from edges that can be taken. Constant values are
+     * replaced by shared constants, branches and switches on constants become jumps, and blocks
+     * that are never reached are reduced to a single `unreachable`.
+     *
+     * Integer arithmetic folds with wraparound in the value's width; division by zero and
+     * out-of-range shifts are left to run time.
+     */
+    bool propagate_constants(Module &module, uint32_t function);
+
+    /**
+     * @brief Global value numbering over the dominator tree, eliminating redundant computations.
+     *
+     * Blocks are visited in dominator tree preorder with a scoped hash table of the values of
+     * the dominating blocks, keyed by opcode, type, immediate, flags and operand value numbers,
+     * commutative operands in either order. A value equal to one in the table is replaced by it.
+     * Pure operations are numbered, and so are loads that name their memory state and calls to
+     * functions with the PURE attribute, so `@pure` calls with the same arguments run once.
+     * Loads are left alone in functions with calls, intrinsics or atomics that write memory
+     * without a new state. Phis, allocations and other side effects keep their own numbers.
+     */
+    bool number_values(Module &module, uint32_t function);
+
+    /**
+     * @brief A call whose result is unused although the callee has the NO_DISCARD attribute.
+     */
+    struct DiscardedResult
+    {
+        uint32_t caller;
+        uint32_t callee;
+    };
+
+    /**
+     * @brief Aggressive dead code elimination.
+     *
+     * Every value starts dead. Terminators, parameters and the side effects of reachable blocks
+     * are live, and a worklist marks the operands of live values live, so dead cycles through
+     * phis go as well. Calls to PURE functions have no side effects here. One pass over the
+     * instruction columns marks the roots and one removes the dead values.
+     * @param discarded If set, receives the NO_DISCARD calls whose result is neither read, even by
+     * a dead value, nor BOUND to a variable.
+     */
+    bool eliminate_dead_code(Module &module, uint32_t function, std::vector<DiscardedResult> *discarded = nullptr);
+
+    /**
+     * @brief Control flow cleanup: points edges past blocks that only jump on, folds branches
+     * and switches whose targets are then all the same block into jumps, removes the blocks the
+     * entry no longer reaches and merges a block into the one before it when that is its only
+     * predecessor and ends in a jump to it.
+     *
+     * Each step is one pass over the blocks; the unused conditions it leaves behind are for
+     * eliminate_dead_code().
+     */
+    bool simplify_cfg(Module &module, uint32_t function);
+
+    /**
+     * @brief Inlines the direct calls of one function.
+     *
+     * Calls to functions with the INLINE attribute are always inlined. Other calls are inlined
+     * if the callee's size, less the cost of the call and of moving its arguments and less a
+     * bonus for every constant argument and each use of its parameter, stays under a small
+     * threshold, and only while the caller has grown by less than its own size. Calls to recursive
+     * functions stay, so recursion is never unrolled, and so do calls to functions that read
+     * their entry memory state. Run it on callees before their callers, see
+     * CallGraph::bottom_up(), so callees are inlined and simplified first.
+     */
+    bool inline_calls(Module &module, uint32_t function, const CallGraph &graph);
+
+    /**
+     * @brief Tail call elimination.
+     *
+     * A call directly followed by the return of its result is a tail call. Self tail calls become
+     * jumps back to a loop header after the entry block, with one phi per parameter carrying the
+     * call's arguments, so tail recursion runs in constant stack. Other tail calls are marked
+     * `tail call`, for code generation to turn into jumps that reuse the caller's frame. Functions
+     * with stack allocations are left alone, and functions reading their entry memory state keep
+     * their self calls as tail calls.
+     */
+    bool eliminate_tail_calls(Module &module, uint32_t function);
+
+    /**
+     * @brief Loop-invariant code motion.
+     *
+     * Loops come from a LoopForest and are visited inner loops first. A loop entered from more
+     * than one block, or from a block that may go elsewhere, first gets a preheader: a block
+     * entered from all of those that only jumps to the header. Values computing the same on every
+     * iteration then move to the end of the preheader, in dominator order so that chains of them
+     * move together, and from there on into the preheaders of the loops around. These are pure
+     * operations, `@pure` calls and loads naming a memory state, whose operands are all defined
+     * outside the loop. A store in the loop would give it a memory state of its own, so a load
+     * from a state defined outside is one the loop's stores do not clobber. Calls that are not
+     * `@pure`, intrinsics and atomics write without a new state, so no load leaves a loop holding
+     * one. Loads, calls and divisions that may trap only move from blocks that run on every
+     * iteration leaving the loop.
+     */
+    bool hoist_loop_invariants(Module &module, uint32_t function);
+
+    /**
+     * @brief Runs the passes in pipeline order over every function with a body.
+     * @param discarded If set, receives the discarded NO_DISCARD results, see eliminate_dead_code().
+     */
+    void optimize_module(Module &module, std::vector<DiscardedResult> *discarded = nullptr);
+}
@@ -0,0 +1,56 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "uir.h"
+
+/**
+ * The line-based UIR text format of docs/v1/specs/ir.md, used to exchange functions with tests and
+ * tools:
+ *
+ *     func max(%a: i32, %b: i32) -> i32:
+ *         bb0:
+ *             %2 = cmp.gt i32 %a, %b
+ *             branch %2, bb1, bb2
+ *         bb1:
+ *             ret i32 %a
+ *         ...
+ *
+ * Parameters are named in the header, every other value is defined by one line, constants
+ * included (`%3 = const i32 7`). Values print as `%name` or, if unnamed, `%index`; a name used
+ * twice is printed as `%name.index` the second time. Labels are `bb` and the block index. Function
+ * attributes follow the return type (`-> i32 pure inline`). A header without the trailing colon
+ * declares a function without body. `#` starts a comment.
+ *
+ * Printing a laid-out module and reading it back gives the same functions, so printing that again
+ * gives the same text.
+ */
+namespace yu::uir
+{
+    /**
+     * @brief Appends one laid-out function as UIR text.
+     * @param out The buffer to append to; it is grown once up front for the whole function.
+     */
+    void print_function(const Module &module, uint32_t function, std::string &out);
+
+    /**
+     * @brief Prints every function of a module, separated by blank lines.
+     */
+    std::string print_module(const Module &module);
+
+    /**
+     * @brief Reads UIR text, adding its functions to a module and laying them out.
+     *
+     * All headers are read before any body, so calls may refer to functions further down. Values
+     * may be used before the line defining them, as phis and loops need. Equal constants are shared
+     * like the Builder shares them. Only the syntax is checked; use Function::verify() for the rest.
+     * @param text The UIR text.
+     * @param module The module receiving the functions; names must not clash with its functions.
+     * @return std::string Empty on success, else the first error as `line L, column C: message`.
+     */
+    [[nodiscard]] std::string read_text(std::string_view text, Module &module);
+}
@@ -0,0 +1,50 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include "compilation_unit.h"
+
+namespace yu::compiler
+{
+    /**
+     * @brief On-disk, content-addressed cache of lexed and parsed units.
+     *
+     * Entries are keyed by a hash of the source bytes and the compiler version, so a stale entry is
+     * never looked up rather than invalidated. An entry is a flat image of every column of the unit;
+     * string views are stored as offsets into the source and fixed up against the caller's buffer on
+     * load. Only units that parsed cleanly are cached, so diagnostics are always produced fresh.
+     */
+    class UnitCache
+    {
+    public:
+        /**
+         * @brief Opens (and creates if needed) a cache directory.
+         * @param directory The directory holding the entries.
+         * @throws std::filesystem::filesystem_error if the directory cannot be created.
+         */
+        explicit UnitCache(std::filesystem::path directory);
+
+        /**
+         * @brief Looks up the unit for a source buffer.
+         * @param source The source; moved into `unit` on a hit and left untouched on a miss.
+         * @param unit Receives the cached unit.
+         * @return bool True on a hit.
+         */
+        bool load(SourceBuffer &source, CompilationUnit &unit) const;
+
+        /**
+         * @brief Writes a unit to the cache. Failed units and units with warnings are skipped.
+         * @param unit The unit to store.
+         * @return bool True if an entry was written.
+         */
+        bool store(const CompilationUnit &unit) const;
+
+    private:
+        std::filesystem::path directory;
+
+        [[nodiscard]] std::filesystem::path entry_path(std::string_view source) const;
+    };
+}
@@ -0,0 +1,14 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#pragma once
+
+#include <string_view>
+
+namespace yu::compiler
+{
+    /**
+     * @brief Version of the compiler. Anything persisted between runs is keyed by it.
+     */
+    constexpr std::string_view compiler_version = "0.1.0";
+}
@@ -0,0 +1,174 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/compilation_unit.h"
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include "../include/lexer.h"
+#include "../include/timer.h"
+
+namespace yu::compiler
+{
+    SourceBuffer::SourceBuffer(const std::string_view name, const uint32_t size) : length(size)
+                                                                                 , name_offset(size + padding)
+    {
+        // [source][zeroed padding][name\0]
+        storage = std::make_unique<char[]>(static_cast<size_t>(size) + padding + name.size() + 1);
+        std::memset(storage.get() + size, 0, padding);
+        std::memcpy(storage.get() + name_offset, name.data(), name.size());
+        storage[name_offset + name.size()] = '\0';
+    }
+
+    SourceBuffer::SourceBuffer(const std::string_view name, const std::string_view contents)
+    {
+        if (contents.size() > std::numeric_limits<uint32_t>::max() - padding)
+            throw std::runtime_error("Source file too large: " + std::string(name));
+
+        *this = SourceBuffer(name, static_cast<uint32_t>(contents.size()));
+        std::memcpy(storage.get(), contents.data(), contents.size());
+    }
+
+    SourceBuffer SourceBuffer::from_file(const std::string &path)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Could not open file: " + path);
+        }
+
+        const std::streamoff size = file.tellg();
+        if (size < 0 || static_cast<uint64_t>(size) > std::numeric_limits<uint32_t>::max() - padding)
+        {
+            throw std::runtime_error("Source file too large: " + path);
+        }
+
+        SourceBuffer buffer(path, static_cast<uint32_t>(size));
+        file.seekg(0);
+        if (!file.read(buffer.storage.get(), size))
+        {
+            throw std::runtime_error("Could not read file: " + path);
+        }
+        return buffer;
+    }
+
+    uint32_t table_column_index(const CompilationUnit &unit, const void *column)
+    {
+        uint32_t index = 0, found = std::numeric_limits<uint32_t>::max();
+        for_each_table_column(unit, [&](const auto &candidate, ColumnRef)
+        {
+            if (static_cast<const void *>(&candidate) == column)
+                found = index;
+            ++index;
+        });
+        return found;
+    }
+
+    namespace
+    {
+        /**
+         * @brief Walks the attributes and modifiers of a declaration, as parse_attributes() accepted them.
+         * @return uint32_t The keyword token after them.
+         */
+        uint32_t scan_attributes(const CompilationUnit &unit, const uint32_t decl, uint8_t &attributes)
+        {
+            using lang::token_i;
+            attributes = 0;
+            uint32_t token = unit.decls.token_starts[decl];
+            for (;; ++token)
+            {
+                switch (unit.tokens.types[token])
+                {
+                    case token_i::PURE_ANNOT:
+                        attributes |= static_cast<uint8_t>(DeclAttributes::PURE);
+                        continue;
+                    case token_i::TAIL_REC_ANNOT:
+                        attributes |= static_cast<uint8_t>(DeclAttributes::TAIL_REC);
+                        continue;
+                    case token_i::NO_DISCARD_ANNOT:
+                        attributes |= static_cast<uint8_t>(DeclAttributes::NO_DISCARD);
+                        continue;
+                    case token_i::DEPRECATED_ANNOT:
+                        attributes |= static_cast<uint8_t>(DeclAttributes::DEPRECATED);
+                        continue;
+                    case token_i::INLINE:
+                        attributes |= static_cast<uint8_t>(DeclAttributes::INLINE);
+                        continue;
+                    case token_i::ASYNC:
+                        attributes |= static_cast<uint8_t>(DeclAttributes::ASYNC);
+                        continue;
+                    case token_i::PACKED_ANNOT:
+                    case token_i::VOLATILE_ANNOT:
+                    case token_i::LAZY_ANNOT:
+                        continue;
+                    case token_i::ALIGN_ANNOT:
+                    {
+                        // `@align(...)`; the parser checked that the parentheses follow and close
+                        uint32_t depth = 0;
+                        do
+                        {
+                            ++token;
+                            depth += unit.tokens.types[token] == token_i::LEFT_PAREN;
+                            depth -= unit.tokens.types[token] == token_i::RIGHT_PAREN;
+                        } while (depth);
+                        continue;
+                    }
+                    default:
+                        return token;
+                }
+            }
+        }
+    }
+
+    uint32_t decl_keyword(const CompilationUnit &unit, const uint32_t decl)
+    {
+        uint8_t attributes;
+        return scan_attributes(unit, decl, attributes);
+    }
+
+    uint8_t decl_attributes(const CompilationUnit &unit, const uint32_t decl)
+    {
+        uint8_t attributes;
+        scan_attributes(unit, decl, attributes);
+        return attributes;
+    }
+
+    CompilationUnit parse_unit(SourceBuffer source, const bool emit_diagnostics)
+    {
+        CompilationUnit unit;
+        unit.source = std::move(source);
+
+        try
+        {
+            {
+                const Timer timer("lex");
+                Lexer lexer(unit.source.view());
+                lexer.tokenize();
+                unit.tokens = lexer.take_tokens();
+                unit.line_starts = std::move(lexer.line_starts);
+                timer.add_bytes(unit.source.size());
+                timer.add_tokens(unit.tokens.size());
+            }
+
+            const Timer timer("parse");
+            timer.add_bytes(unit.source.size());
+            timer.add_tokens(unit.tokens.size());
+            Parser parser(unit);
+            parser.set_emit_diagnostics(emit_diagnostics);
+            const auto parsed = parser.parse_program();
+            timer.add_declarations(unit.decls.token_starts.size());
+            if (!parsed)
+            {
+                unit.error_message = "Failed to parse program";
+                return unit;
+            }
+            unit.success = true;
+        }
+        catch (const std::exception &e)
+        {
+            unit.error_message = e.what();
+        }
+        return unit;
+    }
+}
@@ -0,0 +1,480 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/file_reader.h"
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include "../../common/arch.hpp"
+
+#if !defined(YUMINA_OS_WINDOWS)
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#if defined(YUMINA_OS_LINUX)
+    #include <atomic>
+    #include <cstring>
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <sys/uio.h>
+#endif
+
+namespace yu::compiler
+{
+    namespace
+    {
+        // the pread backend needs only a few threads to keep the device queue busy
+        constexpr uint32_t max_io_threads = 4;
+        constexpr uint32_t ring_entries = 64;
+    }
+
+#if defined(YUMINA_OS_LINUX)
+    /**
+     * @brief A minimal io_uring: one submission and one completion queue, mapped once.
+     */
+    struct FileReader::Ring
+    {
+        int fd = -1;
+        uint32_t entries = 0; // submission queue slots, also the reads in flight at most
+
+        void *sq_memory = MAP_FAILED;
+        size_t sq_size = 0;
+        void *cq_memory = MAP_FAILED;
+        size_t cq_size = 0;
+        io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+        size_t sqes_size = 0;
+
+        unsigned *sq_tail = nullptr;
+        unsigned *sq_mask = nullptr;
+        unsigned *sq_array = nullptr;
+        unsigned *cq_head = nullptr;
+        unsigned *cq_tail = nullptr;
+        unsigned *cq_mask = nullptr;
+        io_uring_cqe *cqes = nullptr;
+
+        Ring() = default;
+
+        Ring(const Ring &) = delete;
+        Ring &operator=(const Ring &) = delete;
+
+        ~Ring()
+        {
+            if (sqes != MAP_FAILED)
+                munmap(sqes, sqes_size);
+            if (cq_memory != MAP_FAILED && cq_memory != sq_memory)
+                munmap(cq_memory, cq_size);
+            if (sq_memory != MAP_FAILED)
+                munmap(sq_memory, sq_size);
+            if (fd >= 0)
+                close(fd);
+        }
+
+        /**
+         * @return bool False where io_uring is missing or forbidden (old kernel, seccomp, sysctl).
+         */
+        bool open(const uint32_t requested)
+        {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            fd = static_cast<int>(syscall(__NR_io_uring_setup, requested, &params));
+            if (fd < 0)
+                return false;
+
+            entries = params.sq_entries;
+            sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single_mmap)
+                sq_size = cq_size = std::max(sq_size, cq_size);
+
+            sq_memory = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                             IORING_OFF_SQ_RING);
+            if (sq_memory == MAP_FAILED)
+                return false;
+            cq_memory = single_mmap
+                            ? sq_memory
+                            : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                   IORING_OFF_CQ_RING);
+            if (cq_memory == MAP_FAILED)
+                return false;
+            sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            sqes = static_cast<io_uring_sqe *>(mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                                                    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+            if (sqes == MAP_FAILED)
+                return false;
+
+            auto *sq = static_cast<char *>(sq_memory);
+            auto *cq = static_cast<char *>(cq_memory);
+            sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+            sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+            sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+            cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+            cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+            cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+            return true;
+        }
+
+        /**
+         * @brief Queues a submission; the caller keeps fewer than `entries` reads in flight.
+         */
+        void push(const io_uring_sqe &sqe)
+        {
+            const unsigned tail = *sq_tail;
+            const unsigned slot = tail & *sq_mask;
+            sqes[slot] = sqe;
+            sq_array[slot] = slot;
+            std::atomic_ref(*sq_tail).store(tail + 1, std::memory_order_release);
+        }
+
+        /**
+         * @return int Submissions the kernel took, or -1 with errno set.
+         */
+        int enter(const uint32_t submit, const uint32_t wait) const
+        {
+            return static_cast<int>(syscall(__NR_io_uring_enter, fd, submit, wait,
+                                            wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+        }
+
+        template<typename Handler>
+        void reap(Handler &&handle)
+        {
+            unsigned head = *cq_head;
+            const unsigned tail = std::atomic_ref(*cq_tail).load(std::memory_order_acquire);
+            for (; head != tail; ++head)
+            {
+                const io_uring_cqe cqe = cqes[head & *cq_mask];
+                std::atomic_ref(*cq_head).store(head + 1, std::memory_order_release);
+                handle(cqe);
+            }
+        }
+    };
+#else
+    struct FileReader::Ring
+    {
+        bool open(uint32_t)
+        {
+            return false;
+        }
+    };
+#endif
+
+    FileReader::FileReader(std::vector<std::string> paths, const uint32_t depth,
+                           const ReadBackend backend) : paths(std::move(paths))
+                                                      , depth(depth)
+    {
+        slots.resize(this->paths.size());
+        if (slots.empty())
+            return;
+
+        if (backend == ReadBackend::AUTO)
+        {
+            if (auto ring = std::make_unique<Ring>(); ring->open(ring_entries))
+            {
+                backend_name = "io_uring";
+                threads.emplace_back([this, ring = std::move(ring)] { run_ring(*ring); });
+                return;
+            }
+        }
+
+        const uint32_t thread_count = std::clamp<uint64_t>(depth, 1, std::min<uint64_t>(max_io_threads, slots.size()));
+        for (uint32_t i = 0; i < thread_count; ++i)
+            threads.emplace_back([this] { run_threads(); });
+    }
+
+    FileReader::~FileReader()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+
+        for (auto &thread: threads)
+            thread.join();
+    }
+
+    SourceBuffer FileReader::take(const uint32_t index)
+    {
+        std::unique_lock lock(mutex);
+        Slot &slot = slots.at(index);
+        if (slot.state == SlotState::TAKEN)
+            throw std::logic_error("File already taken: " + paths[index]);
+        if (slot.state == SlotState::WAITING)
+        {
+            requests.push_back(index);
+            changed.notify_all();
+        }
+        changed.wait(lock, [&] { return slot.state == SlotState::READY; });
+
+        slot.state = SlotState::TAKEN;
+        --ahead;
+        SourceBuffer buffer = std::move(slot.buffer);
+        const std::string error = std::move(slot.error);
+        lock.unlock();
+        changed.notify_all(); // room for another read-ahead
+
+        if (!error.empty())
+            throw std::runtime_error(error);
+        return buffer;
+    }
+
+    bool FileReader::next_read(uint32_t &index, const bool block)
+    {
+        std::unique_lock lock(mutex);
+        while (!stopping)
+        {
+            while (!requests.empty())
+            {
+                index = requests.back();
+                requests.pop_back();
+                if (slots[index].state == SlotState::WAITING)
+                {
+                    slots[index].state = SlotState::READING;
+                    ++ahead;
+                    return true;
+                }
+            }
+
+            while (next < slots.size() && slots[next].state != SlotState::WAITING)
+                ++next;
+            if (next == slots.size())
+                return false;
+            if (ahead < depth)
+            {
+                index = next++;
+                slots[index].state = SlotState::READING;
+                ++ahead;
+                return true;
+            }
+
+            if (!block)
+                return false;
+            changed.wait(lock);
+        }
+        return false;
+    }
+
+    void FileReader::finish(const uint32_t index, SourceBuffer buffer, std::string error)
+    {
+        {
+            std::lock_guard lock(mutex);
+            Slot &slot = slots[index];
+            slot.state = SlotState::READY;
+            slot.buffer = std::move(buffer);
+            slot.error = std::move(error);
+        }
+        changed.notify_all();
+    }
+
+    void FileReader::retry(const uint32_t index)
+    {
+        {
+            std::lock_guard lock(mutex);
+            slots[index].state = SlotState::WAITING;
+            --ahead;
+            requests.push_back(index);
+        }
+        changed.notify_all();
+    }
+
+    bool FileReader::open_file(const std::string &path, int &fd, SourceBuffer &buffer, std::string &error)
+    {
+#if defined(YUMINA_OS_WINDOWS)
+        try
+        {
+            fd = -1;
+            buffer = SourceBuffer::from_file(path);
+            return true;
+        }
+        catch (const std::exception &e)
+        {
+            error = e.what();
+            return false;
+        }
+#else
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            error = "Could not open file: " + path;
+            return false;
+        }
+
+        struct stat info {};
+        if (fstat(fd, &info) != 0
+            || static_cast<uint64_t>(info.st_size) > std::numeric_limits<uint32_t>::max() - SourceBuffer::padding)
+        {
+            ::close(fd);
+            error = "Source file too large: " + path;
+            return false;
+        }
+        buffer = SourceBuffer(path, static_cast<uint32_t>(info.st_size));
+        return true;
+#endif
+    }
+
+    void FileReader::run_threads()
+    {
+        uint32_t index;
+        while (next_read(index, true))
+        {
+            int fd;
+            SourceBuffer buffer;
+            std::string error;
+            if (!open_file(paths[index], fd, buffer, error))
+            {
+                finish(index, {}, std::move(error));
+                continue;
+            }
+
+#if !defined(YUMINA_OS_WINDOWS)
+            char *data = buffer_data(buffer);
+            for (uint32_t done = 0; done < buffer.size();)
+            {
+                const ssize_t count = pread(fd, data + done, buffer.size() - done, done);
+                if (count < 0 && errno == EINTR)
+                    continue;
+                if (count <= 0)
+                {
+                    error = "Could not read file: " + paths[index];
+                    break;
+                }
+                done += static_cast<uint32_t>(count);
+            }
+            ::close(fd);
+#endif
+            finish(index, error.empty() ? std::move(buffer) : SourceBuffer {}, std::move(error));
+        }
+    }
+
+    void FileReader::run_ring(Ring &ring)
+    {
+#if defined(YUMINA_OS_LINUX)
+        struct Read
+        {
+            uint32_t index = 0;
+            int fd = -1;
+            uint32_t done = 0;
+            SourceBuffer buffer;
+            iovec vector {};
+        };
+
+        // the kernel keeps pointers into these until the completion, so they never move
+        std::vector<Read> reads(ring.entries);
+        std::vector<uint32_t> free_reads;
+        for (uint32_t i = ring.entries; i-- > 0;)
+            free_reads.push_back(i);
+        uint32_t in_flight = 0, unsubmitted = 0;
+
+        const auto queue = [&](const uint32_t slot)
+        {
+            Read &read = reads[slot];
+            read.vector = { buffer_data(read.buffer) + read.done, read.buffer.size() - read.done };
+
+            io_uring_sqe sqe;
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_READV;
+            sqe.fd = read.fd;
+            sqe.addr = reinterpret_cast<uint64_t>(&read.vector);
+            sqe.len = 1;
+            sqe.off = read.done;
+            sqe.user_data = slot;
+            ring.push(sqe);
+            ++unsubmitted;
+        };
+
+        const auto complete = [&](const uint32_t slot, std::string error)
+        {
+            Read &read = reads[slot];
+            ::close(read.fd);
+            finish(read.index, error.empty() ? std::move(read.buffer) : SourceBuffer {}, std::move(error));
+            read = {};
+            free_reads.push_back(slot);
+            --in_flight;
+        };
+
+        while (true)
+        {
+            uint32_t index;
+            while (!free_reads.empty() && next_read(index, in_flight == 0))
+            {
+                int fd;
+                SourceBuffer buffer;
+                std::string error;
+                if (!open_file(paths[index], fd, buffer, error))
+                {
+                    finish(index, {}, std::move(error));
+                    continue;
+                }
+                if (buffer.size() == 0)
+                {
+                    ::close(fd);
+                    finish(index, std::move(buffer), {});
+                    continue;
+                }
+
+                const uint32_t slot = free_reads.back();
+                free_reads.pop_back();
+                reads[slot].index = index;
+                reads[slot].fd = fd;
+                reads[slot].buffer = std::move(buffer);
+                queue(slot);
+                ++in_flight;
+            }
+            if (in_flight == 0)
+                return;
+
+            if (const int submitted = ring.enter(unsubmitted, 1); submitted >= 0)
+                unsubmitted -= static_cast<uint32_t>(submitted);
+            else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            {
+                // the ring is unusable; wait out what the kernel took, since it reads into `reads`
+                // until it completes, then start the lot over on the pread path
+                uint32_t pending = in_flight - unsubmitted;
+                while (pending > 0)
+                {
+                    if (ring.enter(0, pending) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                        break;
+                    ring.reap([&](const io_uring_cqe &) { --pending; });
+                }
+                for (Read &read: reads)
+                {
+                    if (read.fd < 0)
+                        continue;
+                    ::close(read.fd);
+                    read.fd = -1;
+                    retry(read.index);
+                }
+                // cannot even wait: never free memory the kernel may still write to
+                if (pending > 0)
+                    static_cast<void>(new std::vector<Read>(std::move(reads)));
+                run_threads();
+                return;
+            }
+
+            ring.reap([&](const io_uring_cqe &cqe)
+            {
+                const auto slot = static_cast<uint32_t>(cqe.user_data);
+                Read &read = reads[slot];
+                if (cqe.res == -EINTR || cqe.res == -EAGAIN)
+                    queue(slot);
+                else if (cqe.res <= 0)
+                    complete(slot, "Could not read file: " + paths[read.index]);
+                else if ((read.done += static_cast<uint32_t>(cqe.res)) < read.buffer.size())
+                    queue(slot); // short read
+                else
+                    complete(slot, {});
+            });
+        }
+#else
+        (void) ring;
+        run_threads();
+#endif
+    }
+}
@@ -0,0 +1,350 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/incremental.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+#include "../include/lexer.h"
+
+namespace yu::compiler
+{
+    namespace
+    {
+        constexpr uint32_t no_index = std::numeric_limits<uint32_t>::max();
+
+        uint32_t references_before(const DeclList &decls, const uint32_t decl)
+        {
+            return decl == 0 ? 0 : decls.reference_ends[decl - 1];
+        }
+
+        /**
+         * @brief First source byte owned by a declaration. A declaration owns the text from its first
+         * token up to the first token of the next one; the first declaration also owns the file head.
+         */
+        uint32_t span_start(const CompilationUnit &unit, const uint32_t decl)
+        {
+            return decl == 0 ? 0 : unit.tokens.starts[unit.decls.token_starts[decl]];
+        }
+
+        uint32_t decl_containing(const CompilationUnit &unit, const uint32_t offset)
+        {
+            const auto &token_starts = unit.decls.token_starts;
+            const auto it = std::ranges::upper_bound(token_starts, offset, {}, [&unit](const uint32_t token)
+            {
+                return unit.tokens.starts[token];
+            });
+            return it == token_starts.begin() ? 0 : static_cast<uint32_t>(it - token_starts.begin() - 1);
+        }
+
+        uint32_t anchor_column(const CompilationUnit &unit, const ColumnRef ref)
+        {
+            switch (ref)
+            {
+                case ColumnRef::TYPES:
+                    return table_column_index(unit, &unit.types.names);
+                case ColumnRef::GENERIC_PARAMS:
+                    return table_column_index(unit, &unit.types.generic_params);
+                case ColumnRef::FUNCTION_PARAMS:
+                    return table_column_index(unit, &unit.types.function_params);
+                case ColumnRef::EXPRESSIONS:
+                    return table_column_index(unit, &unit.expressions.expr_types);
+                case ColumnRef::IMPORT_NAMES:
+                    return table_column_index(unit, &unit.imports.names);
+                default:
+                    return no_index;
+            }
+        }
+
+        /**
+         * @brief Checks that lexing the region on its own gives the same tokens as lexing the whole file,
+         * i.e. that nothing at its end would have continued into the next declaration.
+         */
+        bool region_is_closed(const std::string_view region, const lang::TokenList &tokens)
+        {
+            if (std::ranges::any_of(tokens.flags, [](const uint8_t flags)
+            {
+                return flags & static_cast<uint8_t>(lang::token_flags::UNTERMINATED_STRING);
+            }))
+                return false;
+
+            if (region.empty())
+                return true;
+
+            const char last = region.back();
+            if (std::isalnum(static_cast<unsigned char>(last)) || last == '_')
+                return false;
+
+            // the gap after the last token may hold comments, which must end inside the region
+            const size_t token_count = tokens.size() - 1;
+            size_t pos = token_count == 0 ? 0 : tokens.starts[token_count - 1] + tokens.lengths[token_count - 1];
+            while ((pos = region.find('/', pos)) != std::string_view::npos && pos + 1 < region.size())
+            {
+                if (region[pos + 1] == '/')
+                    pos = region.find('\n', pos + 2);
+                else if (region[pos + 1] == '*')
+                    pos = region.find("*/", pos + 2);
+                else
+                {
+                    ++pos;
+                    continue;
+                }
+
+                if (pos == std::string_view::npos)
+                    return false;
+                pos += 1;
+            }
+            return true;
+        }
+
+        template<typename T>
+        void splice(CountedVector<T> &column, const size_t begin, const size_t end, const CountedVector<T> &rows,
+                    const size_t row_count)
+        {
+            column.insert(column.erase(column.begin() + begin, column.begin() + end),
+                          rows.begin(), rows.begin() + row_count);
+        }
+
+        ReparseStats reparse_fully(CompilationUnit &unit, SourceBuffer source, const bool emit_diagnostics)
+        {
+            unit = parse_unit(std::move(source), emit_diagnostics);
+            return {};
+        }
+    }
+
+    ReparseStats reparse(CompilationUnit &unit, const TextEdit &edit, const bool emit_diagnostics)
+    {
+        const uint32_t old_size = unit.source.size();
+        if (edit.offset > old_size || edit.removed > old_size - edit.offset)
+            throw std::out_of_range("Edit outside of source: " + std::string(unit.file_name()));
+
+        std::string text;
+        text.reserve(static_cast<size_t>(old_size) - edit.removed + edit.inserted.size());
+        text.append(unit.source.view().substr(0, edit.offset));
+        text.append(edit.inserted);
+        text.append(unit.source.view().substr(edit.offset + edit.removed));
+        SourceBuffer source(unit.file_name(), text);
+
+        const uint32_t decl_count = unit.decls.token_starts.size();
+        if (!unit.success || !unit.warnings.empty() || decl_count == 0)
+            return reparse_fully(unit, std::move(source), emit_diagnostics);
+
+        // declarations touched by the edit, widened by one byte on each side so edits at a boundary
+        // reparse both neighbours
+        const uint32_t first = decl_containing(unit, edit.offset == 0 ? 0 : edit.offset - 1);
+        uint32_t last = decl_containing(unit, edit.offset + edit.removed);
+
+        // later declarations that resolved a name defined in the reparsed ones depend on their rows
+        const uint32_t symbol_column = table_column_index(unit, &unit.symbols.names);
+        std::unordered_set<std::string_view> defined;
+        const auto define = [&](const uint32_t decl)
+        {
+            for (uint32_t i = decl_rows_begin(unit.decls, decl, symbol_column);
+                 i < decl_rows_begin(unit.decls, decl + 1, symbol_column); ++i)
+                defined.insert(unit.symbols.names[i]);
+        };
+        for (uint32_t decl = first; decl <= last; ++decl)
+            define(decl);
+        for (uint32_t decl = last + 1; decl < decl_count; ++decl)
+        {
+            const auto references = unit.decls.references.begin();
+            if (std::any_of(references + references_before(unit.decls, decl),
+                            references + unit.decls.reference_ends[decl],
+                            [&defined](const std::string_view name) { return defined.contains(name); }))
+            {
+                while (last < decl)
+                    define(++last);
+            }
+        }
+
+        const bool reaches_end = last + 1 == decl_count;
+        const int64_t byte_delta = static_cast<int64_t>(edit.inserted.size()) - edit.removed;
+        const uint32_t region_start = span_start(unit, first);
+        const uint32_t old_region_end = reaches_end ? old_size : span_start(unit, last + 1);
+        const uint32_t new_region_end = old_region_end + byte_delta;
+
+        Lexer lexer(source.view().substr(region_start, new_region_end - region_start));
+        lexer.tokenize();
+        lang::TokenList region_tokens = lexer.take_tokens();
+        if (!reaches_end && !region_is_closed(source.view().substr(region_start, new_region_end - region_start),
+                                              region_tokens))
+            return reparse_fully(unit, std::move(source), emit_diagnostics);
+
+        // tokens: the region is relexed, later tokens only move
+        const uint32_t first_token = unit.decls.token_starts[first];
+        const uint32_t old_end_token = reaches_end
+                                           ? static_cast<uint32_t>(unit.tokens.size() - 1)
+                                           : unit.decls.token_starts[last + 1];
+        const uint32_t region_token_count = region_tokens.size() - 1;
+        const uint32_t new_end_token = first_token + region_token_count;
+        const int64_t token_delta = static_cast<int64_t>(new_end_token) - old_end_token;
+
+        for (auto &start : region_tokens.starts)
+            start += region_start;
+        for (uint32_t i = old_end_token; i < unit.tokens.size(); ++i)
+            unit.tokens.starts[i] += byte_delta;
+        splice(unit.tokens.starts, first_token, old_end_token, region_tokens.starts, region_token_count);
+        splice(unit.tokens.lengths, first_token, old_end_token, region_tokens.lengths, region_token_count);
+        splice(unit.tokens.types, first_token, old_end_token, region_tokens.types, region_token_count);
+        splice(unit.tokens.flags, first_token, old_end_token, region_tokens.flags, region_token_count);
+
+        // line index: the sub-lexer's first entry is the region start itself
+        const auto [old_end_line, old_end_column] = Lexer::get_line_col(unit.line_starts, old_region_end);
+        const auto old_line_count = static_cast<int64_t>(unit.line_starts.size());
+        auto &line_starts = unit.line_starts;
+        const auto line_begin = std::ranges::upper_bound(line_starts, region_start) - line_starts.begin();
+        const auto line_end = std::ranges::upper_bound(line_starts, old_region_end) - line_starts.begin();
+        for (auto i = static_cast<size_t>(line_end); i < line_starts.size(); ++i)
+            line_starts[i] += byte_delta;
+        for (auto &line_start : lexer.line_starts)
+            line_start += region_start;
+        line_starts.erase(line_starts.begin() + line_begin, line_starts.begin() + line_end);
+        line_starts.insert(line_starts.begin() + line_begin, lexer.line_starts.begin() + 1, lexer.line_starts.end());
+        const auto [new_end_line, new_end_column] = Lexer::get_line_col(line_starts, new_region_end);
+        const int64_t line_delta = static_cast<int64_t>(line_starts.size()) - old_line_count;
+
+        // tables: keep the rows of later declarations aside, drop the region's rows and parse it again
+        std::array<uint32_t, table_column_count> old_ends {};
+        std::array<void *, table_column_count> tail_columns {};
+        CompilationUnit tail;
+        {
+            uint32_t column_index = 0;
+            for_each_table_column(tail, [&](auto &column, ColumnRef)
+            {
+                tail_columns[column_index++] = &column;
+            });
+        }
+
+        uint32_t column_index = 0;
+        for_each_table_column(unit, [&](auto &column, ColumnRef)
+        {
+            auto &tail_column = *static_cast<std::remove_reference_t<decltype(column)> *>(tail_columns[column_index]);
+            const uint32_t old_end = decl_rows_begin(unit.decls, last + 1, column_index);
+            tail_column.assign(column.begin() + old_end, column.end());
+            column.resize(decl_rows_begin(unit.decls, first, column_index));
+            old_ends[column_index++] = old_end;
+        });
+
+        DeclList &decls = unit.decls;
+        const uint32_t old_reference_end = references_before(decls, last + 1);
+        DeclList tail_decls;
+        tail_decls.token_starts.assign(decls.token_starts.begin() + last + 1, decls.token_starts.end());
+        tail_decls.column_ends.assign(decls.column_ends.begin() + (last + 1) * table_column_count,
+                                      decls.column_ends.end());
+        tail_decls.reference_ends.assign(decls.reference_ends.begin() + last + 1, decls.reference_ends.end());
+        tail_decls.references.assign(decls.references.begin() + old_reference_end, decls.references.end());
+        decls.references.resize(references_before(decls, first));
+        decls.token_starts.resize(first);
+        decls.column_ends.resize(first * table_column_count);
+        decls.reference_ends.resize(first);
+
+        SourceBuffer old_source = std::move(unit.source);
+        unit.source = std::move(source);
+        try
+        {
+            Parser parser(unit);
+            parser.set_emit_diagnostics(false);
+            if (!parser.parse_declarations(first_token, new_end_token) || !unit.warnings.empty())
+                return reparse_fully(unit, std::move(unit.source), emit_diagnostics);
+        }
+        catch (const std::exception &)
+        {
+            return reparse_fully(unit, std::move(unit.source), emit_diagnostics);
+        }
+
+        // a later declaration referring to a name the region defines now would resolve differently
+        std::unordered_set<std::string_view> redefined(unit.symbols.names.begin() +
+                                                       decl_rows_begin(decls, first, symbol_column),
+                                                       unit.symbols.names.end());
+        if (std::ranges::any_of(tail_decls.references,
+                                [&redefined](const std::string_view name) { return redefined.contains(name); }))
+            return reparse_fully(unit, std::move(unit.source), emit_diagnostics);
+
+        // views into the old source move to the new one; views into string literals stay
+        const auto old_begin = reinterpret_cast<uintptr_t>(old_source.data());
+        const char *new_data = unit.source.data();
+        const auto rebase = [&](std::string_view &view)
+        {
+            const auto address = reinterpret_cast<uintptr_t>(view.data());
+            if (view.data() == nullptr || address < old_begin || address > old_begin + old_size)
+                return;
+            const auto offset = static_cast<uint32_t>(address - old_begin);
+            view = { new_data + (offset >= old_region_end ? offset + byte_delta : offset), view.size() };
+        };
+
+        std::array<int64_t, table_column_count> deltas {};
+        column_index = 0;
+        for_each_table_column(unit, [&](auto &column, ColumnRef)
+        {
+            deltas[column_index] = static_cast<int64_t>(column.size()) - old_ends[column_index];
+            ++column_index;
+        });
+
+        column_index = 0;
+        for_each_table_column(unit, [&](auto &column, const ColumnRef ref)
+        {
+            using Column = std::remove_reference_t<decltype(column)>;
+            auto &tail_column = *static_cast<Column *>(tail_columns[column_index]);
+            const uint32_t prefix_end = decl_rows_begin(decls, first, column_index);
+
+            if constexpr (std::is_same_v<typename Column::value_type, std::string_view>)
+            {
+                for (uint32_t i = 0; i < prefix_end; ++i)
+                    rebase(column[i]);
+                for (auto &view : tail_column)
+                    rebase(view);
+            }
+            else if constexpr (std::is_same_v<typename Column::value_type, uint32_t>)
+            {
+                if (const uint32_t anchor = anchor_column(unit, ref); anchor != no_index)
+                {
+                    for (auto &value : tail_column)
+                    {
+                        if (value != no_index && value >= old_ends[anchor])
+                            value += deltas[anchor];
+                    }
+                }
+            }
+
+            column.insert(column.end(), tail_column.begin(), tail_column.end());
+            ++column_index;
+        });
+
+        // source positions of later variables: rows on the region's last line also change column
+        const uint32_t var_tail = old_ends[0] + deltas[0];
+        for (uint32_t i = var_tail; i < unit.var_decls.lines.size(); ++i)
+        {
+            uint32_t &line = unit.var_decls.lines[i];
+            uint32_t &column = unit.var_decls.columns[i];
+            if (line == old_end_line)
+            {
+                line = new_end_line;
+                column = new_end_column + (column - old_end_column);
+            }
+            else
+                line += line_delta;
+        }
+
+        for (uint32_t i = 0; i < decls.references.size(); ++i)
+            rebase(decls.references[i]);
+        const int64_t reference_delta = static_cast<int64_t>(decls.references.size()) - old_reference_end;
+        for (auto &view : tail_decls.references)
+            rebase(view);
+        for (uint32_t i = 0; i < tail_decls.token_starts.size(); ++i)
+        {
+            decls.token_starts.emplace_back(tail_decls.token_starts[i] + token_delta);
+            for (uint32_t column = 0; column < table_column_count; ++column)
+                decls.column_ends.emplace_back(tail_decls.column_ends[i * table_column_count + column] + deltas[column]);
+            decls.reference_ends.emplace_back(tail_decls.reference_ends[i] + reference_delta);
+        }
+        decls.references.insert(decls.references.end(), tail_decls.references.begin(), tail_decls.references.end());
+
+        unit.success = true;
+        return { true, first, last - first + 1 };
+    }
+}
@@ -0,0 +1,168 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/interner.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include "../include/hash.h"
+
+namespace yu::compiler
+{
+    StringInterner::StringInterner() : shards(std::make_unique<Shard[]>(shard_count))
+    {
+        // local entry 0 of shard 0 is the empty string; it is never looked up through the index
+        Shard &shard = shards[0];
+        shard.blocks[0] = std::make_unique<Entry[]>(first_block_size);
+        shard.blocks[0][0] = { "", 0, 0 };
+        shard.count = 1;
+    }
+
+    StringInterner &StringInterner::global()
+    {
+        static StringInterner interner;
+        return interner;
+    }
+
+    const StringInterner::Entry &StringInterner::entry(const Shard &shard, const uint32_t local)
+    {
+        const uint32_t block = std::bit_width(local / first_block_size + 1) - 1;
+        return shard.blocks[block][local - first_block_size * ((1u << block) - 1)];
+    }
+
+    uint32_t StringInterner::probe(const Shard &shard, const std::string_view text, const uint32_t hash)
+    {
+        const auto mask = static_cast<uint32_t>(shard.index.size() - 1);
+        for (uint32_t slot = hash & mask;; slot = (slot + 1) & mask)
+        {
+            if (!shard.index[slot])
+                return slot;
+
+            const Entry &candidate = entry(shard, shard.index[slot] - 1);
+            if (candidate.hash == hash && candidate.length == text.size() &&
+                std::memcmp(candidate.data, text.data(), text.size()) == 0)
+                return slot;
+        }
+    }
+
+    const char *StringInterner::store(Shard &shard, const std::string_view text)
+    {
+        shard.bytes += text.size();
+        // long strings get a chunk of their own instead of wasting the rest of the current one
+        if (text.size() > chunk_size / 4)
+        {
+            auto &chunk = shard.chunks.emplace_back(std::make_unique<char[]>(text.size()));
+            std::memcpy(chunk.get(), text.data(), text.size());
+            return chunk.get();
+        }
+
+        if (shard.remaining < text.size())
+        {
+            shard.cursor = shard.chunks.emplace_back(std::make_unique<char[]>(chunk_size)).get();
+            shard.remaining = chunk_size;
+        }
+        char *data = shard.cursor;
+        std::memcpy(data, text.data(), text.size());
+        shard.cursor += text.size();
+        shard.remaining -= text.size();
+        return data;
+    }
+
+    void StringInterner::grow(Shard &shard)
+    {
+        const std::vector<uint32_t> previous = std::move(shard.index);
+        shard.index.assign(std::max<size_t>(64, previous.size() * 2), 0);
+
+        const auto mask = static_cast<uint32_t>(shard.index.size() - 1);
+        for (const uint32_t value: previous)
+        {
+            if (!value)
+                continue;
+            uint32_t slot = entry(shard, value - 1).hash & mask;
+            while (shard.index[slot])
+                slot = (slot + 1) & mask;
+            shard.index[slot] = value;
+        }
+    }
+
+    uint32_t StringInterner::intern(const std::string_view text)
+    {
+        if (text.empty())
+            return empty_atom;
+
+        const uint64_t hash = hash_bytes(text);
+        const auto shard_index = static_cast<uint32_t>(hash >> (64 - shard_bits));
+        Shard &shard = shards[shard_index];
+
+        std::lock_guard lock(shard.mutex);
+        if ((shard.count + 1) * 2 > shard.index.size())
+            grow(shard);
+
+        const uint32_t slot = probe(shard, text, static_cast<uint32_t>(hash));
+        if (shard.index[slot])
+            return (shard.index[slot] - 1) << shard_bits | shard_index;
+
+        const uint32_t local = shard.count;
+        if (local >> (32 - shard_bits))
+            throw std::length_error("String interner is full");
+
+        const uint32_t block = std::bit_width(local / first_block_size + 1) - 1;
+        if (!shard.blocks[block])
+            shard.blocks[block] = std::make_unique<Entry[]>(static_cast<size_t>(first_block_size) << block);
+        shard.blocks[block][local - first_block_size * ((1u << block) - 1)] = {
+            store(shard, text),
+            static_cast<uint32_t>(text.size()),
+            static_cast<uint32_t>(hash)
+        };
+        shard.index[slot] = local + 1;
+        ++shard.count;
+        return local << shard_bits | shard_index;
+    }
+
+    uint32_t StringInterner::find(const std::string_view text)
+    {
+        if (text.empty())
+            return empty_atom;
+
+        const uint64_t hash = hash_bytes(text);
+        const auto shard_index = static_cast<uint32_t>(hash >> (64 - shard_bits));
+        Shard &shard = shards[shard_index];
+
+        std::lock_guard lock(shard.mutex);
+        if (shard.index.empty())
+            return no_atom;
+        const uint32_t slot = probe(shard, text, static_cast<uint32_t>(hash));
+        return shard.index[slot] ? (shard.index[slot] - 1) << shard_bits | shard_index : no_atom;
+    }
+
+    std::string_view StringInterner::view(const uint32_t atom) const
+    {
+        if (atom == no_atom)
+            return {};
+        const Entry &found = entry(shards[atom & (shard_count - 1)], atom >> shard_bits);
+        return { found.data, found.length };
+    }
+
+    uint32_t StringInterner::size()
+    {
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < shard_count; ++i)
+        {
+            std::lock_guard lock(shards[i].mutex);
+            count += shards[i].count;
+        }
+        return count;
+    }
+
+    uint64_t StringInterner::bytes()
+    {
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < shard_count; ++i)
+        {
+            std::lock_guard lock(shards[i].mutex);
+            total += shards[i].bytes;
+        }
+        return total;
+    }
+}
@@ -0,0 +1,271 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/language_service.h"
+#include <algorithm>
+#include <limits>
+#include "../include/unit_cache.h"
+
+namespace yu::compiler
+{
+    namespace
+    {
+        /**
+         * @brief UTF-16 code units taken by the character a UTF-8 byte starts; 0 for continuation bytes.
+         */
+        uint32_t utf16_width(const uint8_t byte)
+        {
+            if (byte < 0x80)
+                return 1;
+            if (byte < 0xC0)
+                return 0;
+            return byte < 0xF0 ? 1 : 2;
+        }
+
+        uint32_t line_start(const CompilationUnit &unit, const uint32_t line)
+        {
+            if (line == 0 || unit.line_starts.empty())
+                return 0;
+            return line < unit.line_starts.size() ? unit.line_starts[line] : unit.source.size();
+        }
+
+        bool in_source(const CompilationUnit &unit, const std::string_view view)
+        {
+            const auto address = reinterpret_cast<uintptr_t>(view.data());
+            const auto begin = reinterpret_cast<uintptr_t>(unit.source.data());
+            return view.data() != nullptr && address >= begin && address + view.size() <= begin + unit.source.size();
+        }
+
+        Range name_range(const CompilationUnit &unit, const std::string_view name)
+        {
+            const auto offset = static_cast<uint32_t>(name.data() - unit.source.data());
+            return { LanguageService::position_at(unit, offset),
+                     LanguageService::position_at(unit, offset + name.size()) };
+        }
+
+        uint32_t token_at(const CompilationUnit &unit, const uint32_t offset)
+        {
+            const auto &starts = unit.tokens.starts;
+            return static_cast<uint32_t>(std::ranges::upper_bound(starts, offset) - starts.begin()) - 1;
+        }
+
+        /**
+         * @brief True if the block a symbol was declared in is still open at a later token. The
+         * parser records the block depth of each symbol in `symbols.scopes`; a name declared in
+         * parentheses, such as a parameter, belongs to the block after them.
+         */
+        bool in_scope(const CompilationUnit &unit, const uint32_t symbol, const uint32_t declared, const uint32_t use)
+        {
+            int64_t depth = unit.symbols.scopes[symbol];
+            int64_t scope = depth;
+            int64_t parens = 0;
+            for (uint32_t token = declared + 1; token < use; ++token)
+            {
+                switch (unit.tokens.types[token])
+                {
+                    case lang::token_i::LEFT_PAREN:
+                        ++parens;
+                        break;
+                    case lang::token_i::RIGHT_PAREN:
+                        if (--parens < 0)
+                        {
+                            parens = 0;
+                            scope = depth + 1;
+                        }
+                        break;
+                    case lang::token_i::LEFT_BRACE:
+                        ++depth;
+                        break;
+                    case lang::token_i::RIGHT_BRACE:
+                        if (--depth < scope)
+                            return false;
+                        break;
+                    default:
+                        break;
+                }
+            }
+            return true;
+        }
+    }
+
+    LanguageService::LanguageService(const UnitCache *cache) : cache(cache)
+    {
+    }
+
+    const CompilationUnit &LanguageService::open(const std::string &id, const std::string_view name,
+                                                 const std::string_view text)
+    {
+        SourceBuffer source(name, text);
+        CompilationUnit unit;
+        if (!cache || !cache->load(source, unit))
+        {
+            unit = parse_unit(std::move(source), false);
+            if (cache)
+                cache->store(unit);
+        }
+        return documents.insert_or_assign(id, std::move(unit)).first->second;
+    }
+
+    const CompilationUnit *LanguageService::change(const std::string &id, const std::optional<Range> &range,
+                                                   const std::string_view text)
+    {
+        const auto it = documents.find(id);
+        if (it == documents.end())
+            return nullptr;
+
+        CompilationUnit &unit = it->second;
+        if (!range)
+        {
+            SourceBuffer source(unit.file_name(), text);
+            unit = parse_unit(std::move(source), false);
+            return &unit;
+        }
+
+        const uint32_t start = offset_at(unit, range->start);
+        const uint32_t end = std::max(start, offset_at(unit, range->end));
+        reparse(unit, { start, end - start, text }, false);
+        return &unit;
+    }
+
+    void LanguageService::close(const std::string &id)
+    {
+        documents.erase(id);
+    }
+
+    const CompilationUnit *LanguageService::find(const std::string &id) const
+    {
+        const auto it = documents.find(id);
+        return it == documents.end() ? nullptr : &it->second;
+    }
+
+    uint32_t LanguageService::offset_at(const CompilationUnit &unit, const Position position)
+    {
+        const char *source = unit.source.data();
+        const uint32_t size = unit.source.size();
+
+        uint32_t offset = line_start(unit, position.line);
+        uint32_t units = 0;
+        while (offset < size && source[offset] != '\n' && units < position.character)
+        {
+            units += utf16_width(static_cast<uint8_t>(source[offset++]));
+            while (offset < size && utf16_width(static_cast<uint8_t>(source[offset])) == 0)
+                ++offset;
+        }
+        return offset;
+    }
+
+    Position LanguageService::position_at(const CompilationUnit &unit, const uint32_t offset)
+    {
+        const auto &line_starts = unit.line_starts;
+        const auto line = static_cast<uint32_t>(
+            std::max<ptrdiff_t>(std::ranges::upper_bound(line_starts, offset) - line_starts.begin() - 1, 0));
+
+        uint32_t character = 0;
+        for (uint32_t i = line_start(unit, line); i < offset && i < unit.source.size(); ++i)
+            character += utf16_width(static_cast<uint8_t>(unit.source.data()[i]));
+        return { line, character };
+    }
+
+    std::vector<DocumentSymbol> LanguageService::document_symbols(const CompilationUnit &unit)
+    {
+        std::vector<DocumentSymbol> result;
+        const DeclList &decls = unit.decls;
+        const uint32_t symbol_column = table_column_index(unit, &unit.symbols.names);
+        const uint32_t decl_count = decls.token_starts.size();
+
+        for (uint32_t decl = 0; decl < decl_count; ++decl)
+        {
+            const uint32_t begin = decl_rows_begin(decls, decl, symbol_column);
+            const uint32_t end = decl_rows_begin(decls, decl + 1, symbol_column);
+            if (begin == end)
+                continue;
+
+            // a function binds its name before its parameters, a variable after its initializer
+            const uint32_t first_token = decls.token_starts[decl];
+            const lang::token_i keyword = unit.tokens.types[decl_keyword(unit, decl)];
+            uint32_t symbol = end - 1;
+            if (keyword == lang::token_i::FUNCTION)
+            {
+                symbol = begin;
+                while (symbol < end &&
+                       !(unit.symbols.symbol_flags[symbol] & static_cast<uint8_t>(SymbolFlags::IS_FUNCTION)))
+                    ++symbol;
+                if (symbol == end)
+                    continue;
+            }
+
+            const std::string_view name = unit.symbols.names[symbol];
+            if (!in_source(unit, name))
+                continue;
+
+            const uint32_t end_token = (decl + 1 < decl_count
+                                            ? decls.token_starts[decl + 1]
+                                            : static_cast<uint32_t>(unit.tokens.size() - 1)) - 1;
+            result.push_back({
+                name,
+                keyword == lang::token_i::FUNCTION
+                    ? SymbolKind::FUNCTION
+                    : keyword == lang::token_i::CONST ? SymbolKind::CONSTANT : SymbolKind::VARIABLE,
+                {
+                    position_at(unit, unit.tokens.starts[first_token]),
+                    position_at(unit, unit.tokens.starts[end_token] + unit.tokens.lengths[end_token])
+                },
+                name_range(unit, name)
+            });
+        }
+        return result;
+    }
+
+    std::optional<Range> LanguageService::definition(const CompilationUnit &unit, const Position position)
+    {
+        const uint32_t offset = offset_at(unit, position);
+        const auto &starts = unit.tokens.starts;
+        const auto it = std::ranges::upper_bound(starts, offset);
+        if (it == starts.begin())
+            return std::nullopt;
+
+        const auto token = static_cast<uint32_t>(it - starts.begin() - 1);
+        if (unit.tokens.types[token] != lang::token_i::IDENTIFIER ||
+            offset > starts[token] + unit.tokens.lengths[token])
+            return std::nullopt;
+
+        // the latest declaration whose block is still open is the innermost one
+        const std::string_view name(unit.source.data() + starts[token], unit.tokens.lengths[token]);
+        for (uint32_t symbol = unit.symbols.names.size(); symbol-- > 0;)
+        {
+            const std::string_view candidate = unit.symbols.names[symbol];
+            if (candidate != name || !in_source(unit, candidate) || candidate.data() > name.data())
+                continue;
+            const uint32_t declared = token_at(unit, static_cast<uint32_t>(candidate.data() - unit.source.data()));
+            if (declared == token || in_scope(unit, symbol, declared, token))
+                return name_range(unit, candidate);
+        }
+        return std::nullopt;
+    }
+
+    std::vector<Diagnostic> LanguageService::diagnostics(const CompilationUnit &unit)
+    {
+        std::vector<Diagnostic> result;
+        const auto add = [&](const ParseError &error)
+        {
+            const uint32_t line = error.line == 0 ? 0 : error.line - 1;
+            const uint32_t column = error.column == 0 ? 0 : error.column - 1;
+            const Position start = position_at(unit, std::min(line_start(unit, line) + column, unit.source.size()));
+            result.push_back({
+                { start, { start.line, start.character + 1 } },
+                error.severity,
+                error.message,
+                Parser::get_error_code(error.flags)
+            });
+        };
+
+        for (const auto &error: unit.errors)
+            add(error);
+        for (const auto &warning: unit.warnings)
+            add(warning);
+
+        if (!unit.success && unit.errors.empty())
+            result.push_back({ {}, ErrorSeverity::ERROR, unit.error_message, {} });
+        return result;
+    }
+}
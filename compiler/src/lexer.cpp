@@ -21,7 +21,7 @@ namespace yu::compiler
                        (i == '*') * 3 +
                        (std::isalpha(i) || i == '_' || i == '@') * 4 +
                        std::isdigit(i) * 5 +
-                       (i == '"') * 6;
+                       (i == '"' || i == '\'') * 6;
         }
         return types;
     }();
@@ -92,7 +92,7 @@ namespace yu::compiler
     {
         std::array<uint8_t, 256> table {};
         table['n'] = table['t'] = table['r'] = table['\\'] =
-                                               table['"'] = table['0'] = table['x'] = 1;
+                                               table['"'] = table['\''] = table['0'] = table['x'] = 1;
         return table;
     }();
 
@@ -145,11 +145,9 @@ namespace yu::compiler
             const uint8_t type = char_type[static_cast<uint8_t>(current_char)];
             const uint32_t is_newline = current_char == '\n';
 
-            // Branchless line start tracking
-            const size_t curr_size = line_starts.size();
-            line_starts.resize(curr_size + is_newline);
-            line_starts[curr_size] *= !is_newline;
-            line_starts[curr_size] += (current_pos + 1) * is_newline;
+            // Line start tracking
+            if (is_newline)
+                line_starts.emplace_back(current_pos + 1);
 
             const bool has_next = current_pos + 1 < src_length;
             const char next_char = has_next ? src[current_pos + 1] : '\0';
@@ -170,10 +168,8 @@ namespace yu::compiler
 
                 // Handle newlines in multi-line comments
                 const uint32_t comment_newline = src[current_pos] == '\n';
-                const size_t comment_size = line_starts.size();
-                line_starts.resize(comment_size + comment_newline);
-                line_starts[comment_size] *= !comment_newline;
-                line_starts[comment_size] += (current_pos + 1) * comment_newline;
+                if (comment_newline)
+                    line_starts.emplace_back(current_pos + 1);
 
                 current_pos += 1 + end_of_comment;
                 in_comment &= !end_of_comment;
@@ -329,6 +325,7 @@ namespace yu::compiler
     HOT_FUNCTION lang::token_t Lexer::lex_string() const
     {
         const char *start = src + current_pos;
+        const char quote = *start; // '"' or '\''
         const char *current = start + 1;
         const char *end = src + src_length;
         uint8_t flags = 0;
@@ -340,7 +337,7 @@ namespace yu::compiler
             const uint32_t has_next = current + 1 < end;
             const char next = current[has_next];
 
-            const uint32_t is_quote = c == '"';
+            const uint32_t is_quote = c == quote;
             const uint32_t is_valid_escape = valid_escapes[static_cast<uint8_t>(next)];
             const uint32_t escape_advance = is_escape * (1 + (next == 'x') * 2);
 
@@ -352,7 +349,7 @@ namespace yu::compiler
                 break;
         }
 
-        flags |= make_flag(current >= end || *(current - 1) != '"',
+        flags |= make_flag(current >= end || *(current - 1) != quote,
                            lang::token_flags::UNTERMINATED_STRING);
         return {
             current_pos,
@@ -380,8 +377,19 @@ namespace yu::compiler
 
     HOT_FUNCTION std::pair<uint32_t, uint32_t> Lexer::get_line_col(const lang::token_t &token) const
     {
-        const auto it = std::ranges::upper_bound(line_starts, token.start);
-        return { std::distance(line_starts.begin(), it), token.start - *(it - 1) + 1 };
+        return get_line_col(line_starts, token.start);
+    }
+
+    HOT_FUNCTION std::pair<uint32_t, uint32_t> Lexer::get_line_col(const CountedVector<uint32_t> &line_starts,
+                                                                   const uint32_t offset)
+    {
+        const auto it = std::ranges::upper_bound(line_starts, offset);
+        return { std::distance(line_starts.begin(), it), offset - *(it - 1) + 1 };
+    }
+
+    lang::TokenList Lexer::take_tokens()
+    {
+        return std::move(tokens);
     }
 
     HOT_FUNCTION lang::token_i Lexer::get_token_type(const char c)
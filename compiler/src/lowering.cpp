@@ -0,0 +1,1345 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/lowering.h"
+#include <algorithm>
+#include <charconv>
+#include <string>
+#include <unordered_map>
+#include "../include/interner.h"
+#include "../include/uir_builder.h"
+
+namespace yu::compiler
+{
+    namespace
+    {
+        using lang::token_i;
+        using uir::no_block;
+        using uir::no_value;
+        using uir::Opcode;
+        using uir::primitive;
+        using uir::TypeId;
+        using uir::TypeKind;
+
+        constexpr uint32_t no_variable = std::numeric_limits<uint32_t>::max();
+        constexpr TypeId no_hint = primitive(TypeKind::VOID);
+
+        /**
+         * @brief The UIR type of a front-end type name.
+         * @return TypeId The type, or no_value if the lowering does not handle it yet.
+         */
+        TypeId lower_type(const std::string_view name)
+        {
+            static const std::unordered_map<std::string_view, TypeKind> kinds = {
+                { "i8", TypeKind::I8 }, { "u8", TypeKind::U8 }, { "i16", TypeKind::I16 }, { "u16", TypeKind::U16 },
+                { "i32", TypeKind::I32 }, { "u32", TypeKind::U32 }, { "i64", TypeKind::I64 },
+                { "u64", TypeKind::U64 }, { "f32", TypeKind::F32 }, { "f64", TypeKind::F64 },
+                { "boolean", TypeKind::BOOL }, { "void", TypeKind::VOID }
+            };
+            const auto it = kinds.find(name);
+            return it == kinds.end() ? no_value : primitive(it->second);
+        }
+
+        /**
+         * @brief The uir::FunctionAttributes of a declaration's DeclAttributes.
+         */
+        uint8_t function_attributes(const uint8_t decl)
+        {
+            uint8_t attributes = 0;
+            if (decl & static_cast<uint8_t>(DeclAttributes::PURE))
+                attributes |= uir::PURE;
+            if (decl & static_cast<uint8_t>(DeclAttributes::TAIL_REC))
+                attributes |= uir::TAIL_REC;
+            if (decl & static_cast<uint8_t>(DeclAttributes::NO_DISCARD))
+                attributes |= uir::NO_DISCARD;
+            if (decl & static_cast<uint8_t>(DeclAttributes::INLINE))
+                attributes |= uir::INLINE;
+            return attributes;
+        }
+
+        void report(CompilationUnit &unit, const ParseErrorFlags flags, const ErrorSeverity severity,
+                    std::string message, std::string suggestion, const std::string_view at)
+        {
+            const auto offset = static_cast<uint32_t>(at.data() - unit.source.data());
+            const auto [line, column] = Lexer::get_line_col(unit.line_starts, offset);
+            const std::string_view source = unit.source.view();
+            const uint32_t line_start = unit.line_starts[line - 1];
+            const size_t line_end = std::min(source.find('\n', line_start), source.size());
+
+            ParseError error {
+                flags,
+                severity,
+                std::move(message),
+                std::move(suggestion),
+                unit.file_name(),
+                line,
+                column,
+                std::string(source.substr(line_start, line_end - line_start)),
+                std::string(column - 1, ' ') + "^" + std::string(at.size(), '~')
+            };
+            if (severity == ErrorSeverity::WARNING)
+            {
+                unit.warnings.push_back(std::move(error));
+                return;
+            }
+            if (unit.error_message.empty())
+                unit.error_message = error.message;
+            unit.success = false;
+            unit.errors.push_back(std::move(error));
+        }
+
+        enum class BinaryOperator : uint8_t
+        {
+            NONE,
+            LOGICAL_OR,
+            LOGICAL_AND,
+            EQ,
+            NE,
+            LT,
+            LE,
+            GT,
+            GE,
+            ADD,
+            SUB,
+            BIT_OR,
+            BIT_XOR,
+            MUL,
+            DIV,
+            MOD,
+            BIT_AND
+        };
+
+        struct OperatorToken
+        {
+            BinaryOperator op;
+            uint8_t precedence; // higher binds tighter
+            uint8_t width;      // tokens, as == is lexed as two
+        };
+
+        /**
+         * @brief Translates one function body into SSA form.
+         */
+        class FunctionLowering
+        {
+        public:
+            FunctionLowering(CompilationUnit &unit, uir::Module &module, const uint32_t function) :
+                unit(unit), module(module), builder(module, function), function(module.function(function)),
+                tokens(unit.tokens) {}
+
+            /**
+             * @param body The opening brace of the body.
+             * @param first_param The symbol of the first parameter.
+             * @return bool False if the function could not be lowered; a diagnostic was reported.
+             */
+            bool run(const uint32_t body, const uint32_t first_param)
+            {
+                const uint32_t entry = new_block();
+                seal(entry);
+                start(entry);
+                for (uint32_t i = 0; i < function.params().size(); ++i)
+                {
+                    const uint32_t value = builder.param(i);
+                    builder.set_name(value, unit.symbols.names[first_param + i]);
+                    write_variable(declare(unit.symbols.name_atoms[first_param + i], function.params()[i], false),
+                                   entry, value);
+                }
+
+                current = body;
+                if (!block_statement())
+                    return false;
+
+                if (!builder.terminated(block))
+                {
+                    if (function.return_type() == primitive(TypeKind::VOID))
+                        builder.ret();
+                    else if (block == entry || !predecessors[block].empty())
+                    {
+                        error(ParseErrorFlags::TYPE_MISMATCH, "Function may end without returning a value",
+                              "Return a value on every path", current - 1);
+                        return false;
+                    }
+                    else
+                        builder.unreachable();
+                }
+                if (!check_self_calls())
+                    return false;
+
+                // uses of phis found trivial after they were used
+                for (uint32_t value = 0; value < function.size(); ++value)
+                {
+                    if (function.opcode(value) == Opcode::NOP)
+                        continue;
+                    for (uint32_t i = 0; i < function.operands(value).size(); ++i)
+                        function.set_operand(value, i, resolve(function.operands(value)[i]));
+                }
+                builder.finish();
+                return true;
+            }
+
+        private:
+            struct Loop
+            {
+                uint32_t header;
+                uint32_t exit;
+            };
+
+            CompilationUnit &unit;
+            uir::Module &module;
+            uir::Builder builder;
+            uir::Function &function;
+            const lang::TokenList &tokens;
+            uint32_t current = 0; // token
+            uint32_t block = no_block;
+
+            // SSA construction state, per block
+            std::vector<std::unordered_map<uint32_t, uint32_t>> definitions; // variable to current value
+            std::vector<std::vector<std::pair<uint32_t, uint32_t>>> incomplete_phis; // (variable, phi)
+            std::vector<std::vector<uint32_t>> predecessors;
+            std::vector<uint8_t> sealed;
+            std::unordered_map<uint32_t, uint32_t> replaced;                // removed trivial phi to its value
+            std::unordered_map<uint32_t, std::vector<uint32_t>> phi_users;  // phis using a phi
+
+            // variables and their scopes
+            std::vector<TypeId> variable_types;
+            std::vector<uint8_t> variable_const;
+            std::vector<std::pair<uint32_t, uint32_t>> scope; // (name atom, variable), innermost last
+            std::vector<Loop> loops;
+            std::vector<std::pair<uint32_t, uint32_t>> self_calls; // (call, token) of `@tailrec` functions
+
+            [[nodiscard]] token_i peek(const uint32_t ahead = 0) const
+            {
+                const uint32_t index = std::min<uint32_t>(current + ahead, tokens.size() - 1);
+                return tokens.types[index];
+            }
+
+            [[nodiscard]] std::string_view text(const uint32_t token) const
+            {
+                return { unit.source.data() + tokens.starts[token], tokens.lengths[token] };
+            }
+
+            bool accept(const token_i type)
+            {
+                if (peek() != type)
+                    return false;
+                ++current;
+                return true;
+            }
+
+            void error(const ParseErrorFlags flags, std::string message, std::string suggestion, const uint32_t token)
+            {
+                report(unit, flags, ErrorSeverity::ERROR, std::move(message), std::move(suggestion), text(token));
+            }
+
+            void unsupported(const std::string &what, const uint32_t token)
+            {
+                report(unit, ParseErrorFlags::NONE, ErrorSeverity::WARNING,
+                       what + " not supported by the UIR lowering yet; the function is left as a declaration", "",
+                       text(token));
+            }
+
+            bool expect(const token_i type, const std::string_view spelling)
+            {
+                if (accept(type))
+                    return true;
+                error(ParseErrorFlags::UNEXPECTED_TOKEN, "Expected '" + std::string(spelling) + "'", "", current);
+                return false;
+            }
+
+            [[nodiscard]] std::string type_name(const TypeId type) const
+            {
+                return type == primitive(TypeKind::BOOL) ? "boolean" : module.types.name(type);
+            }
+
+            // blocks and edges
+
+            uint32_t new_block()
+            {
+                definitions.emplace_back();
+                incomplete_phis.emplace_back();
+                predecessors.emplace_back();
+                sealed.push_back(false);
+                return builder.create_block();
+            }
+
+            void start(const uint32_t next)
+            {
+                block = next;
+                builder.set_insert_block(next);
+            }
+
+            /**
+             * @brief Starts a fresh unreachable block if the current one is already terminated.
+             */
+            void ensure_open()
+            {
+                if (!builder.terminated(block))
+                    return;
+                const uint32_t dead = new_block();
+                seal(dead);
+                start(dead);
+            }
+
+            void jump_to(const uint32_t target)
+            {
+                builder.jump(target);
+                predecessors[target].push_back(block);
+            }
+
+            void branch_to(const uint32_t condition, const uint32_t taken, const uint32_t not_taken)
+            {
+                builder.branch(condition, taken, not_taken);
+                predecessors[taken].push_back(block);
+                predecessors[not_taken].push_back(block);
+            }
+
+            // SSA construction
+
+            uint32_t declare(const uint32_t atom, const TypeId type, const bool is_const)
+            {
+                const auto variable = static_cast<uint32_t>(variable_types.size());
+                variable_types.push_back(type);
+                variable_const.push_back(is_const);
+                scope.emplace_back(atom, variable);
+                return variable;
+            }
+
+            [[nodiscard]] uint32_t lookup(const std::string_view name) const
+            {
+                const uint32_t atom = StringInterner::global().find(name);
+                for (auto it = scope.rbegin(); atom != StringInterner::no_atom && it != scope.rend(); ++it)
+                {
+                    if (it->first == atom)
+                        return it->second;
+                }
+                return no_variable;
+            }
+
+            uint32_t resolve(uint32_t value)
+            {
+                auto it = replaced.find(value);
+                if (it == replaced.end())
+                    return value;
+                const uint32_t target = resolve(it->second);
+                replaced[value] = target;
+                return target;
+            }
+
+            void write_variable(const uint32_t variable, const uint32_t in, const uint32_t value)
+            {
+                definitions[in][variable] = value;
+            }
+
+            uint32_t read_variable(const uint32_t variable, const uint32_t in)
+            {
+                if (const auto it = definitions[in].find(variable); it != definitions[in].end())
+                    return resolve(it->second);
+
+                uint32_t value;
+                if (!sealed[in])
+                {
+                    // not all predecessors are known: complete the phi when the block is sealed
+                    value = new_phi(variable, in);
+                    incomplete_phis[in].emplace_back(variable, value);
+                }
+                else if (predecessors[in].size() == 1)
+                    value = read_variable(variable, predecessors[in][0]);
+                else
+                {
+                    // defined before the operands are read, to break cycles through loops
+                    const uint32_t phi = new_phi(variable, in);
+                    write_variable(variable, in, phi);
+                    value = add_phi_operands(variable, phi, in);
+                }
+                write_variable(variable, in, value);
+                return value;
+            }
+
+            uint32_t new_phi(const uint32_t variable, const uint32_t in)
+            {
+                builder.set_insert_block(in);
+                const uint32_t phi = builder.phi(variable_types[variable]);
+                builder.set_insert_block(block);
+                return phi;
+            }
+
+            uint32_t add_phi_operands(const uint32_t variable, const uint32_t phi, const uint32_t in)
+            {
+                for (const uint32_t predecessor: predecessors[in])
+                {
+                    const uint32_t value = read_variable(variable, predecessor);
+                    builder.add_incoming(phi, value, predecessor);
+                    if (function.opcode(value) == Opcode::PHI)
+                        phi_users[value].push_back(phi);
+                }
+                return remove_trivial_phi(phi);
+            }
+
+            /**
+             * @brief Replaces a phi merging one value (besides itself) with that value.
+             * @return uint32_t The phi, or the value replacing it.
+             */
+            uint32_t remove_trivial_phi(const uint32_t phi)
+            {
+                uint32_t same = no_value;
+                for (uint32_t i = 0; i < function.operands(phi).size(); ++i)
+                {
+                    const uint32_t operand = resolve(function.operands(phi)[i]);
+                    if (operand == same || operand == phi)
+                        continue;
+                    if (same != no_value)
+                        return phi;
+                    same = operand;
+                }
+                if (same == no_value)
+                    same = builder.undef(function.type(phi)); // unreachable or read before any definition
+
+                replaced[phi] = same;
+                function.remove(phi);
+
+                // phis using this one may have become trivial in turn
+                std::vector<uint32_t> users;
+                if (const auto it = phi_users.find(phi); it != phi_users.end())
+                {
+                    users = std::move(it->second);
+                    phi_users.erase(it);
+                }
+                if (function.opcode(same) == Opcode::PHI)
+                {
+                    auto &inherited = phi_users[same];
+                    inherited.insert(inherited.end(), users.begin(), users.end());
+                }
+                for (const uint32_t user: users)
+                {
+                    if (user != phi && function.opcode(user) == Opcode::PHI && !replaced.contains(user))
+                        remove_trivial_phi(user);
+                }
+                return same;
+            }
+
+            void seal(const uint32_t target)
+            {
+                // adding operands may create more incomplete phis in other blocks, never in this one
+                const auto pending = std::move(incomplete_phis[target]);
+                incomplete_phis[target].clear();
+                for (const auto &[variable, phi]: pending)
+                    add_phi_operands(variable, phi, target);
+                sealed[target] = true;
+            }
+
+            // values
+
+            /**
+             * @brief Converts a constant to another numeric type if it is representable there.
+             * @return uint32_t The value of type `to`, or no_value.
+             */
+            uint32_t coerce(const uint32_t value, const TypeId to)
+            {
+                const TypeId from = function.type(value);
+                if (from == to)
+                    return value;
+                if (function.opcode(value) != Opcode::CONST)
+                    return no_value;
+
+                const uir::TypeTable &types = module.types;
+                const uint64_t bits = function.immediate(value);
+                if (types.is_integer(from))
+                {
+                    const uint32_t width = types.bits(from);
+                    const bool negative = types.is_signed(from) && (bits >> (width - 1) & 1);
+                    const uint64_t extended = negative && width < 64 ? bits | ~0ULL << width : bits;
+                    if (types.is_float(to))
+                    {
+                        return builder.constant_float(to, negative ? static_cast<double>(static_cast<int64_t>(extended))
+                                                                   : static_cast<double>(extended));
+                    }
+                    if (types.is_integer(to))
+                        return integer_constant(to, negative ? 0 - extended : extended, negative);
+                    return no_value;
+                }
+                if (types.is_float(from) && types.is_float(to))
+                {
+                    const double number = from == primitive(TypeKind::F32)
+                                              ? std::bit_cast<float>(static_cast<uint32_t>(bits))
+                                              : std::bit_cast<double>(bits);
+                    return builder.constant_float(to, number);
+                }
+                return no_value;
+            }
+
+            /**
+             * @brief A constant from its magnitude and sign, if it fits the type.
+             */
+            uint32_t integer_constant(const TypeId type, const uint64_t magnitude, const bool negative)
+            {
+                const uir::TypeTable &types = module.types;
+                const uint32_t width = types.bits(type);
+                const uint64_t mask = width == 64 ? ~0ULL : (1ULL << width) - 1;
+                if (negative)
+                {
+                    if (!types.is_signed(type) || magnitude > 1ULL << (width - 1))
+                        return no_value;
+                    return builder.constant(type, (0 - magnitude) & mask);
+                }
+                const uint64_t max = types.is_signed(type) ? mask >> 1 : mask;
+                return magnitude > max ? no_value : builder.constant(type, magnitude);
+            }
+
+            uint32_t literal(const TypeId hint, const bool negative)
+            {
+                const uint32_t token = current++;
+                const std::string_view digits = text(token);
+                const bool hex = digits.size() > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X');
+                const bool is_float = !hex && digits.find_first_of(".eE") != std::string_view::npos;
+
+                if (is_float || module.types.is_float(hint))
+                {
+                    const double number = std::strtod(std::string(digits).c_str(), nullptr);
+                    const TypeId type = module.types.is_float(hint) ? hint : primitive(TypeKind::F64);
+                    return builder.constant_float(type, negative ? -number : number);
+                }
+
+                int base = 10;
+                std::string_view body = digits;
+                if (hex || (digits.size() > 2 && digits[0] == '0' && (digits[1] == 'b' || digits[1] == 'B')))
+                {
+                    base = hex ? 16 : 2;
+                    body.remove_prefix(2);
+                }
+                uint64_t magnitude = 0;
+                const auto [end, status] = std::from_chars(body.data(), body.data() + body.size(), magnitude, base);
+                const TypeId type = module.types.is_integer(hint) ? hint : primitive(TypeKind::I32);
+                const uint32_t value = status == std::errc() && end == body.data() + body.size()
+                                           ? integer_constant(type, magnitude, negative)
+                                           : no_value;
+                if (value == no_value)
+                {
+                    error(ParseErrorFlags::TYPE_MISMATCH,
+                          "Literal does not fit in '" + type_name(type) + "'", "Use a wider type", token);
+                }
+                return value;
+            }
+
+            uint32_t expression(const TypeId hint)
+            {
+                return binary(1, hint);
+            }
+
+            [[nodiscard]] OperatorToken peek_operator() const
+            {
+                const bool assigns = peek(1) == token_i::EQUAL; // `a += b` is not an operator here
+                switch (peek())
+                {
+                    case token_i::OR:
+                        if (peek(1) == token_i::OR)
+                            return { BinaryOperator::LOGICAL_OR, 1, 2 };
+                        return { assigns ? BinaryOperator::NONE : BinaryOperator::BIT_OR, 4, 1 };
+                    case token_i::AND:
+                        if (peek(1) == token_i::AND)
+                            return { BinaryOperator::LOGICAL_AND, 2, 2 };
+                        return { assigns ? BinaryOperator::NONE : BinaryOperator::BIT_AND, 5, 1 };
+                    case token_i::EQUAL:
+                        return { assigns ? BinaryOperator::EQ : BinaryOperator::NONE, 3, 2 };
+                    case token_i::BANG:
+                        return { assigns ? BinaryOperator::NE : BinaryOperator::NONE, 3, 2 };
+                    case token_i::LESS:
+                        return assigns ? OperatorToken { BinaryOperator::LE, 3, 2 } : OperatorToken { BinaryOperator::LT, 3, 1 };
+                    case token_i::GREATER:
+                        return assigns ? OperatorToken { BinaryOperator::GE, 3, 2 } : OperatorToken { BinaryOperator::GT, 3, 1 };
+                    case token_i::PLUS:
+                        return { assigns ? BinaryOperator::NONE : BinaryOperator::ADD, 4, 1 };
+                    case token_i::MINUS:
+                        return { assigns ? BinaryOperator::NONE : BinaryOperator::SUB, 4, 1 };
+                    case token_i::XOR:
+                        return { assigns ? BinaryOperator::NONE : BinaryOperator::BIT_XOR, 4, 1 };
+                    case token_i::STAR:
+                        return { assigns ? BinaryOperator::NONE : BinaryOperator::MUL, 5, 1 };
+                    case token_i::SLASH:
+                        return { assigns ? BinaryOperator::NONE : BinaryOperator::DIV, 5, 1 };
+                    case token_i::PERCENT:
+                        return { assigns ? BinaryOperator::NONE : BinaryOperator::MOD, 5, 1 };
+                    default:
+                        return { BinaryOperator::NONE, 0, 0 };
+                }
+            }
+
+            /**
+             * @brief The operator of a compound assignment such as `+=`, by its first token.
+             */
+            static BinaryOperator compound_operator(const token_i type)
+            {
+                switch (type)
+                {
+                    case token_i::PLUS:
+                        return BinaryOperator::ADD;
+                    case token_i::MINUS:
+                        return BinaryOperator::SUB;
+                    case token_i::STAR:
+                        return BinaryOperator::MUL;
+                    case token_i::SLASH:
+                        return BinaryOperator::DIV;
+                    case token_i::PERCENT:
+                        return BinaryOperator::MOD;
+                    case token_i::AND:
+                        return BinaryOperator::BIT_AND;
+                    case token_i::OR:
+                        return BinaryOperator::BIT_OR;
+                    case token_i::XOR:
+                        return BinaryOperator::BIT_XOR;
+                    default:
+                        return BinaryOperator::NONE;
+                }
+            }
+
+            /**
+             * @brief Precedence climbing over the binary operators binding at least `min_precedence`.
+             */
+            uint32_t binary(const uint8_t min_precedence, const TypeId hint)
+            {
+                uint32_t left = unary(hint);
+                while (left != no_value)
+                {
+                    const auto [op, precedence, width] = peek_operator();
+                    if (op == BinaryOperator::NONE || precedence < min_precedence)
+                        break;
+                    const uint32_t token = current;
+                    current += width;
+
+                    if (op == BinaryOperator::LOGICAL_OR || op == BinaryOperator::LOGICAL_AND)
+                        left = logical(op, left, precedence, token);
+                    else
+                    {
+                        const uint32_t right = binary(precedence + 1, function.type(left));
+                        left = right == no_value ? no_value : arithmetic(op, left, right, token);
+                    }
+                }
+                return left;
+            }
+
+            /**
+             * @brief Emits a binary operator, matching the operand types first.
+             */
+            uint32_t arithmetic(const BinaryOperator op, uint32_t left, uint32_t right, const uint32_t token)
+            {
+                if (function.type(left) != function.type(right))
+                {
+                    if (const uint32_t converted = coerce(right, function.type(left)); converted != no_value)
+                        right = converted;
+                    else if (const uint32_t widened = coerce(left, function.type(right)); widened != no_value)
+                        left = widened;
+                    else
+                    {
+                        error(ParseErrorFlags::TYPE_MISMATCH,
+                              "Mismatched types '" + type_name(function.type(left)) + "' and '" +
+                              type_name(function.type(right)) + "'", "Convert one operand explicitly", token);
+                        return no_value;
+                    }
+                }
+
+                const uir::TypeTable &types = module.types;
+                const TypeId type = function.type(left);
+                const bool is_float = types.is_float(type);
+                const bool is_integer = types.is_integer(type);
+                const bool is_bool = type == primitive(TypeKind::BOOL);
+
+                Opcode opcode = Opcode::NOP;
+                switch (op)
+                {
+                    case BinaryOperator::EQ:
+                    case BinaryOperator::NE:
+                        if (is_float || is_integer || is_bool)
+                            opcode = op == BinaryOperator::EQ ? Opcode::CMP_EQ : Opcode::CMP_NE;
+                        break;
+                    case BinaryOperator::LT:
+                    case BinaryOperator::LE:
+                    case BinaryOperator::GT:
+                    case BinaryOperator::GE:
+                        if (is_float || is_integer)
+                        {
+                            opcode = static_cast<Opcode>(static_cast<uint8_t>(Opcode::CMP_LT) +
+                                                         static_cast<uint8_t>(op) -
+                                                         static_cast<uint8_t>(BinaryOperator::LT));
+                        }
+                        break;
+                    case BinaryOperator::ADD:
+                        opcode = is_integer ? Opcode::ADD : is_float ? Opcode::FADD : Opcode::NOP;
+                        break;
+                    case BinaryOperator::SUB:
+                        opcode = is_integer ? Opcode::SUB : is_float ? Opcode::FSUB : Opcode::NOP;
+                        break;
+                    case BinaryOperator::MUL:
+                        opcode = is_integer ? Opcode::MUL : is_float ? Opcode::FMUL : Opcode::NOP;
+                        break;
+                    case BinaryOperator::DIV:
+                        opcode = is_integer ? Opcode::DIV : is_float ? Opcode::FDIV : Opcode::NOP;
+                        break;
+                    case BinaryOperator::MOD:
+                        opcode = is_integer ? Opcode::MOD : Opcode::NOP;
+                        break;
+                    case BinaryOperator::BIT_AND:
+                        opcode = is_integer || is_bool ? Opcode::AND : Opcode::NOP;
+                        break;
+                    case BinaryOperator::BIT_OR:
+                        opcode = is_integer || is_bool ? Opcode::OR : Opcode::NOP;
+                        break;
+                    case BinaryOperator::BIT_XOR:
+                        opcode = is_integer || is_bool ? Opcode::XOR : Opcode::NOP;
+                        break;
+                    default:
+                        break;
+                }
+
+                // float comparisons share the integer order: CMP_EQ..CMP_GE, FCMP_EQ..FCMP_GE
+                if (is_float && opcode >= Opcode::CMP_EQ && opcode <= Opcode::CMP_GE)
+                {
+                    opcode = static_cast<Opcode>(static_cast<uint8_t>(opcode) - static_cast<uint8_t>(Opcode::CMP_EQ) +
+                                                 static_cast<uint8_t>(Opcode::FCMP_EQ));
+                }
+                if (opcode == Opcode::NOP)
+                {
+                    error(ParseErrorFlags::TYPE_MISMATCH,
+                          "Operator '" + std::string(text(token)) + "' cannot be applied to '" + type_name(type) + "'",
+                          "", token);
+                    return no_value;
+                }
+                return builder.binary(opcode, left, right);
+            }
+
+            /**
+             * @brief `a && b` and `a || b`, evaluating `b` only when needed.
+             */
+            uint32_t logical(const BinaryOperator op, const uint32_t left, const uint8_t precedence, const uint32_t token)
+            {
+                constexpr TypeId boolean = primitive(TypeKind::BOOL);
+                if (function.type(left) != boolean)
+                {
+                    error(ParseErrorFlags::TYPE_MISMATCH, "Operands of '" + std::string(text(token)) +
+                          "' must be boolean, found '" + type_name(function.type(left)) + "'", "", token);
+                    return no_value;
+                }
+
+                const uint32_t from = block;
+                const uint32_t rest = new_block();
+                const uint32_t merge = new_block();
+                if (op == BinaryOperator::LOGICAL_AND)
+                    branch_to(left, rest, merge);
+                else
+                    branch_to(left, merge, rest);
+
+                seal(rest);
+                start(rest);
+                const uint32_t right = binary(precedence + 1, boolean);
+                if (right == no_value)
+                    return no_value;
+                if (function.type(right) != boolean)
+                {
+                    error(ParseErrorFlags::TYPE_MISMATCH, "Operands of '" + std::string(text(token)) +
+                          "' must be boolean, found '" + type_name(function.type(right)) + "'", "", token);
+                    return no_value;
+                }
+                const uint32_t rest_end = block;
+                jump_to(merge);
+
+                seal(merge);
+                start(merge);
+                const uint32_t result = builder.phi(boolean);
+                builder.add_incoming(result, builder.constant(boolean, op == BinaryOperator::LOGICAL_OR), from);
+                builder.add_incoming(result, right, rest_end);
+                return result;
+            }
+
+            uint32_t unary(const TypeId hint)
+            {
+                const uint32_t token = current;
+                switch (peek())
+                {
+                    case token_i::MINUS:
+                    {
+                        ++current;
+                        if (peek() == token_i::NUM_LITERAL)
+                            return literal(hint, true);
+                        const uint32_t value = unary(hint);
+                        if (value == no_value)
+                            return no_value;
+                        if (!module.types.is_integer(function.type(value)) && !module.types.is_float(function.type(value)))
+                            break;
+                        return builder.unary(Opcode::NEG, value);
+                    }
+                    case token_i::PLUS:
+                        ++current;
+                        return unary(hint);
+                    case token_i::TILDE:
+                    {
+                        ++current;
+                        const uint32_t value = unary(hint);
+                        if (value == no_value)
+                            return no_value;
+                        if (!module.types.is_integer(function.type(value)))
+                            break;
+                        return builder.unary(Opcode::NOT, value);
+                    }
+                    case token_i::BANG:
+                    {
+                        ++current;
+                        const uint32_t value = unary(primitive(TypeKind::BOOL));
+                        if (value == no_value)
+                            return no_value;
+                        if (function.type(value) != primitive(TypeKind::BOOL))
+                            break;
+                        return builder.unary(Opcode::NOT, value);
+                    }
+                    case token_i::AND:
+                        unsupported("Taking addresses is", token);
+                        return no_value;
+                    default:
+                        return primary(hint);
+                }
+
+                error(ParseErrorFlags::TYPE_MISMATCH, "Operator '" + std::string(text(token)) +
+                      "' cannot be applied to this operand", "", token);
+                return no_value;
+            }
+
+            uint32_t primary(const TypeId hint)
+            {
+                const uint32_t token = current;
+                switch (peek())
+                {
+                    case token_i::NUM_LITERAL:
+                        return literal(hint, false);
+                    case token_i::TRUE:
+                    case token_i::FALSE:
+                        ++current;
+                        return builder.constant(primitive(TypeKind::BOOL), tokens.types[token] == token_i::TRUE);
+                    case token_i::LEFT_PAREN:
+                    {
+                        ++current;
+                        const uint32_t value = expression(hint);
+                        return value != no_value && expect(token_i::RIGHT_PAREN, ")") ? value : no_value;
+                    }
+                    case token_i::IDENTIFIER:
+                    {
+                        if (peek(1) == token_i::LEFT_PAREN)
+                            return call();
+                        ++current;
+                        const uint32_t variable = lookup(text(token));
+                        if (variable == no_variable)
+                        {
+                            unknown_name(token);
+                            return no_value;
+                        }
+                        return read_variable(variable, block);
+                    }
+                    case token_i::STR_LITERAL:
+                        unsupported("String literals are", token);
+                        return no_value;
+                    case token_i::NIL:
+                        unsupported("null is", token);
+                        return no_value;
+                    case token_i::FUNCTION:
+                        unsupported("Function expressions are", token);
+                        return no_value;
+                    default:
+                        error(ParseErrorFlags::INVALID_SYNTAX, "Expected an expression", "", token);
+                        return no_value;
+                }
+            }
+
+            /**
+             * @brief Reports a name that is not a local: unsupported if it names a declaration, else unknown.
+             */
+            void unknown_name(const uint32_t token)
+            {
+                const uint32_t atom = StringInterner::global().find(text(token));
+                for (uint32_t symbol = 0; atom != StringInterner::no_atom && symbol < unit.symbols.names.size(); ++symbol)
+                {
+                    if (unit.symbols.name_atoms[symbol] == atom && unit.symbols.scopes[symbol] == 0)
+                    {
+                        unsupported(unit.symbols.symbol_flags[symbol] & static_cast<uint8_t>(SymbolFlags::IS_FUNCTION)
+                                        ? "Generic and imported functions are"
+                                        : "Global variables are", token);
+                        return;
+                    }
+                }
+                error(ParseErrorFlags::UNRESOLVED_SYMBOL, "Unknown name '" + std::string(text(token)) + "'",
+                      "Declare it before use", token);
+            }
+
+            uint32_t call()
+            {
+                const uint32_t token = current;
+                const uint32_t callee = module.find_function(text(token));
+                if (callee == uir::no_function)
+                {
+                    unknown_name(token);
+                    return no_value;
+                }
+                current += 2;
+
+                const std::span<const TypeId> params = module.function(callee).params();
+                std::vector<uint32_t> arguments;
+                while (peek() != token_i::RIGHT_PAREN)
+                {
+                    const uint32_t argument_token = current;
+                    const TypeId hint = arguments.size() < params.size() ? params[arguments.size()] : no_hint;
+                    uint32_t value = expression(hint);
+                    if (value == no_value)
+                        return no_value;
+                    if (arguments.size() < params.size())
+                    {
+                        value = coerce(value, hint);
+                        if (value == no_value)
+                        {
+                            error(ParseErrorFlags::TYPE_MISMATCH, "Argument does not match parameter type '" +
+                                  type_name(hint) + "'", "", argument_token);
+                            return no_value;
+                        }
+                    }
+                    arguments.push_back(value);
+                    if (!accept(token_i::COMMA))
+                        break;
+                }
+                if (!expect(token_i::RIGHT_PAREN, ")"))
+                    return no_value;
+                if (arguments.size() != params.size())
+                {
+                    error(ParseErrorFlags::TYPE_MISMATCH, "'" + std::string(text(token)) + "' takes " +
+                          std::to_string(params.size()) + " arguments but " + std::to_string(arguments.size()) +
+                          " were given", "", token);
+                    return no_value;
+                }
+                const uint32_t value = builder.call(callee, arguments);
+                if (&module.function(callee) == &function && function.attributes() & uir::TAIL_REC)
+                    self_calls.emplace_back(value, token);
+                return value;
+            }
+
+            /**
+             * @brief Reports the self calls of a `@tailrec` function that are not in tail
+             * position, i.e. not directly followed by the return of their result.
+             */
+            bool check_self_calls()
+            {
+                for (const auto &[call, token]: self_calls)
+                {
+                    const uint32_t next = call + 1;
+                    const bool tail = next < function.size() && function.opcode(next) == Opcode::RET &&
+                                      (function.operands(next).empty()
+                                           ? function.type(call) == primitive(TypeKind::VOID)
+                                           : function.operands(next)[0] == call);
+                    if (!tail)
+                    {
+                        error(ParseErrorFlags::INVALID_SYNTAX, "Recursive call of a @tailrec function is not a tail call",
+                              "Return the call's result directly, carrying pending work in a parameter", token);
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            uint32_t condition()
+            {
+                const uint32_t token = current;
+                const uint32_t value = expression(primitive(TypeKind::BOOL));
+                if (value != no_value && function.type(value) != primitive(TypeKind::BOOL))
+                {
+                    error(ParseErrorFlags::TYPE_MISMATCH, "Condition must be boolean, found '" +
+                          type_name(function.type(value)) + "'", "Compare the value explicitly", token);
+                    return no_value;
+                }
+                return value;
+            }
+
+            // statements
+
+            /**
+             * @brief The token after a statement, without lowering it.
+             */
+            [[nodiscard]] uint32_t statement_end(uint32_t token) const
+            {
+                const auto skip_group = [this](uint32_t at)
+                {
+                    for (uint32_t depth = 0; at < tokens.size(); ++at)
+                    {
+                        const token_i type = tokens.types[at];
+                        depth += type == token_i::LEFT_PAREN || type == token_i::LEFT_BRACE;
+                        depth -= type == token_i::RIGHT_PAREN || type == token_i::RIGHT_BRACE;
+                        if (depth == 0)
+                            return at + 1;
+                    }
+                    return at;
+                };
+
+                switch (tokens.types[token])
+                {
+                    case token_i::LEFT_BRACE:
+                        return skip_group(token);
+                    case token_i::IF:
+                    {
+                        token = statement_end(skip_group(token + 1));
+                        return tokens.types[token] == token_i::ELSE ? statement_end(token + 1) : token;
+                    }
+                    case token_i::WHILE:
+                        return statement_end(skip_group(token + 1));
+                    default:
+                        while (token < tokens.size() && tokens.types[token] != token_i::SEMICOLON &&
+                               tokens.types[token] != token_i::END_OF_FILE)
+                        {
+                            const token_i type = tokens.types[token];
+                            token = type == token_i::LEFT_PAREN || type == token_i::LEFT_BRACE ? skip_group(token) : token + 1;
+                        }
+                        return token + 1;
+                }
+            }
+
+            bool statement()
+            {
+                ensure_open();
+                switch (peek())
+                {
+                    case token_i::LEFT_BRACE:
+                        return block_statement();
+                    case token_i::VAR:
+                    case token_i::CONST:
+                        return declaration();
+                    case token_i::IF:
+                        return if_statement();
+                    case token_i::WHILE:
+                        return while_statement();
+                    case token_i::RETURN:
+                        return return_statement();
+                    case token_i::BREAK:
+                    case token_i::CONTINUE:
+                        return jump_statement();
+                    case token_i::SEMICOLON:
+                        ++current;
+                        return true;
+                    case token_i::IDENTIFIER:
+                        if ((peek(1) == token_i::EQUAL && peek(2) != token_i::EQUAL) ||
+                            (compound_operator(peek(1)) != BinaryOperator::NONE && peek(2) == token_i::EQUAL))
+                            return assignment();
+                        [[fallthrough]];
+                    default:
+                        return expression(no_hint) != no_value && expect(token_i::SEMICOLON, ";");
+                }
+            }
+
+            bool block_statement()
+            {
+                ++current;
+                const size_t depth = scope.size();
+                while (peek() != token_i::RIGHT_BRACE && peek() != token_i::END_OF_FILE)
+                {
+                    if (!statement())
+                        return false;
+                }
+                scope.resize(depth);
+                return expect(token_i::RIGHT_BRACE, "}");
+            }
+
+            /**
+             * @brief Names a value after the variable it is assigned to, unless it is shared or named,
+             * and marks an assigned call result as used.
+             */
+            void name_value(const uint32_t value, const uint32_t token)
+            {
+                const Opcode opcode = function.opcode(value);
+                if (opcode == Opcode::CALL)
+                    function.set_flags(value, function.flags(value) | uir::BOUND);
+                if (opcode != Opcode::CONST && opcode != Opcode::UNDEF && opcode != Opcode::PARAM &&
+                    function.value_name(value) == StringInterner::empty_atom)
+                    builder.set_name(value, text(token));
+            }
+
+            bool declaration()
+            {
+                const bool is_const = peek() == token_i::CONST;
+                const uint32_t name = ++current;
+                ++current;
+
+                TypeId type = no_value;
+                if (accept(token_i::COLON))
+                {
+                    const uint32_t type_token = current++;
+                    type = tokens.types[type_token] == token_i::IDENTIFIER || peek() == token_i::LESS
+                               ? no_value
+                               : lower_type(text(type_token));
+                    if (type == no_value || type == primitive(TypeKind::VOID))
+                    {
+                        unsupported("The type '" + std::string(text(type_token)) + "' is", type_token);
+                        return false;
+                    }
+                }
+                if (!expect(token_i::EQUAL, "="))
+                    return false;
+
+                const uint32_t init_token = current;
+                uint32_t value = expression(type == no_value ? no_hint : type);
+                if (value == no_value)
+                    return false;
+                if (type == no_value)
+                    type = function.type(value);
+                else
+                    value = coerce(value, type);
+                if (value == no_value || type == primitive(TypeKind::VOID))
+                {
+                    error(ParseErrorFlags::TYPE_MISMATCH, "Initializer does not match the type of '" +
+                          std::string(text(name)) + "'", "", init_token);
+                    return false;
+                }
+
+                name_value(value, name);
+                write_variable(declare(StringInterner::global().intern(text(name)), type, is_const), block, value);
+                return expect(token_i::SEMICOLON, ";");
+            }
+
+            bool assignment()
+            {
+                const uint32_t name = current;
+                const uint32_t variable = lookup(text(name));
+                if (variable == no_variable)
+                {
+                    unknown_name(name);
+                    return false;
+                }
+                if (variable_const[variable])
+                {
+                    error(ParseErrorFlags::TYPE_MISMATCH, "Cannot assign to constant '" + std::string(text(name)) + "'",
+                          "Declare it with 'var'", name);
+                    return false;
+                }
+
+                const uint32_t op_token = ++current;
+                const BinaryOperator op = peek() == token_i::EQUAL ? BinaryOperator::NONE : compound_operator(peek());
+                current += op == BinaryOperator::NONE ? 1 : 2;
+
+                const TypeId type = variable_types[variable];
+                uint32_t value = expression(type);
+                if (value == no_value)
+                    return false;
+                if (op != BinaryOperator::NONE)
+                {
+                    value = arithmetic(op, read_variable(variable, block), value, op_token);
+                    if (value == no_value)
+                        return false;
+                }
+                value = coerce(value, type);
+                if (value == no_value)
+                {
+                    error(ParseErrorFlags::TYPE_MISMATCH, "Value does not match the type of '" +
+                          std::string(text(name)) + "'", "", op_token);
+                    return false;
+                }
+
+                name_value(value, name);
+                write_variable(variable, block, value);
+                return expect(token_i::SEMICOLON, ";");
+            }
+
+            bool if_statement()
+            {
+                ++current;
+                if (!expect(token_i::LEFT_PAREN, "("))
+                    return false;
+                const uint32_t test = condition();
+                if (test == no_value || !expect(token_i::RIGHT_PAREN, ")"))
+                    return false;
+
+                const bool has_else = tokens.types[statement_end(current)] == token_i::ELSE;
+                const uint32_t then_block = new_block();
+                const uint32_t else_block = has_else ? new_block() : no_block;
+                const uint32_t merge = new_block();
+                branch_to(test, then_block, has_else ? else_block : merge);
+
+                seal(then_block);
+                start(then_block);
+                if (!statement())
+                    return false;
+                if (!builder.terminated(block))
+                    jump_to(merge);
+
+                if (accept(token_i::ELSE))
+                {
+                    seal(else_block);
+                    start(else_block);
+                    if (!statement())
+                        return false;
+                    if (!builder.terminated(block))
+                        jump_to(merge);
+                }
+
+                seal(merge);
+                start(merge);
+                return true;
+            }
+
+            bool while_statement()
+            {
+                ++current;
+                const uint32_t header = new_block();
+                jump_to(header);
+                start(header); // sealed once the back edges are known
+
+                if (!expect(token_i::LEFT_PAREN, "("))
+                    return false;
+                const uint32_t test = condition();
+                if (test == no_value || !expect(token_i::RIGHT_PAREN, ")"))
+                    return false;
+
+                const uint32_t body = new_block();
+                const uint32_t exit = new_block();
+                branch_to(test, body, exit);
+
+                seal(body);
+                start(body);
+                loops.push_back({ header, exit });
+                const bool lowered = statement();
+                loops.pop_back();
+                if (!lowered)
+                    return false;
+                if (!builder.terminated(block))
+                    jump_to(header);
+
+                seal(header);
+                seal(exit);
+                start(exit);
+                return true;
+            }
+
+            bool return_statement()
+            {
+                const uint32_t token = current++;
+                const TypeId type = function.return_type();
+                if (accept(token_i::SEMICOLON))
+                {
+                    if (type != primitive(TypeKind::VOID))
+                    {
+                        error(ParseErrorFlags::TYPE_MISMATCH, "Missing return value", "Return a value of type '" +
+                              type_name(type) + "'", token);
+                        return false;
+                    }
+                    builder.ret();
+                    return true;
+                }
+
+                const uint32_t value_token = current;
+                uint32_t value = expression(type == primitive(TypeKind::VOID) ? no_hint : type);
+                if (value == no_value)
+                    return false;
+                if (type == primitive(TypeKind::VOID) && function.type(value) == type)
+                    value = no_value; // returning the result of a void call
+                else if ((value = coerce(value, type)) == no_value || type == primitive(TypeKind::VOID))
+                {
+                    error(ParseErrorFlags::TYPE_MISMATCH, "Returned value does not match the return type '" +
+                          type_name(type) + "'", "", value_token);
+                    return false;
+                }
+                builder.ret(value);
+                return expect(token_i::SEMICOLON, ";");
+            }
+
+            bool jump_statement()
+            {
+                const uint32_t token = current++;
+                if (loops.empty())
+                {
+                    error(ParseErrorFlags::INVALID_SYNTAX, "'" + std::string(text(token)) + "' outside of a loop", "",
+                          token);
+                    return false;
+                }
+                jump_to(tokens.types[token] == token_i::BREAK ? loops.back().exit : loops.back().header);
+                return expect(token_i::SEMICOLON, ";");
+            }
+        };
+    }
+
+    bool lower_unit(CompilationUnit &unit, uir::Module &module)
+    {
+        const size_t errors_before = unit.errors.size();
+        const DeclList &decls = unit.decls;
+        const uint32_t symbol_column = table_column_index(unit, &unit.symbols.names);
+        const uint32_t type_column = table_column_index(unit, &unit.types.names);
+
+        struct Pending
+        {
+            uint32_t function;
+            uint32_t body;        // opening brace
+            uint32_t first_param; // symbol
+        };
+        std::vector<Pending> pending;
+
+        // declare every function first, so bodies can call functions defined after them
+        for (uint32_t decl = 0; decl < decls.token_starts.size(); ++decl)
+        {
+            const uint32_t first_token = decl_keyword(unit, decl);
+            if (unit.tokens.types[first_token] != token_i::FUNCTION)
+                continue;
+
+            uint32_t symbol = no_value, type = no_value;
+            for (uint32_t i = decl_rows_begin(decls, decl, symbol_column);
+                 i < decl_rows_begin(decls, decl + 1, symbol_column) && symbol == no_value; ++i)
+            {
+                if (unit.symbols.symbol_flags[i] & static_cast<uint8_t>(SymbolFlags::IS_FUNCTION))
+                    symbol = i;
+            }
+            if (symbol == no_value)
+                continue;
+            for (uint32_t t = decl_rows_begin(decls, decl, type_column);
+                 t < decl_rows_begin(decls, decl + 1, type_column) && type == no_value; ++t)
+            {
+                if (unit.types.names[t] == "function" &&
+                    unit.types.function_return_types[t] == unit.symbols.type_indices[symbol])
+                    type = t;
+            }
+            if (type == no_value || unit.types.generic_counts[type] > 0)
+                continue;
+
+            const TypeList &types = unit.types;
+            std::vector<TypeId> params;
+            bool supported = true;
+            for (uint32_t i = 0; i < types.function_param_counts[type]; ++i)
+            {
+                params.push_back(lower_type(types.names[types.function_params[types.function_param_starts[type] + i]]));
+                supported &= params.back() != no_value && params.back() != primitive(TypeKind::VOID);
+            }
+            const TypeId return_type = lower_type(types.names[types.function_return_types[type]]);
+            if (!supported || return_type == no_value)
+            {
+                report(unit, ParseErrorFlags::NONE, ErrorSeverity::WARNING,
+                       "The signature of '" + std::string(unit.symbols.names[symbol]) +
+                       "' uses types not supported by the UIR lowering yet; it is not lowered", "",
+                       unit.symbols.names[symbol]);
+                continue;
+            }
+
+            // the body is the first brace after the parameter list
+            uint32_t token = first_token;
+            while (unit.tokens.types[token] != token_i::LEFT_PAREN)
+                ++token;
+            for (uint32_t depth = 0;; ++token)
+            {
+                depth += unit.tokens.types[token] == token_i::LEFT_PAREN;
+                depth -= unit.tokens.types[token] == token_i::RIGHT_PAREN;
+                if (depth == 0)
+                    break;
+            }
+            while (unit.tokens.types[token] != token_i::LEFT_BRACE)
+                ++token;
+
+            const uint32_t function = module.add_function(unit.symbols.names[symbol], std::move(params), return_type);
+            module.function(function).set_attributes(function_attributes(decl_attributes(unit, decl)));
+            pending.push_back({ function, token, symbol + 1 });
+        }
+
+        for (const auto &[function, body, first_param]: pending)
+        {
+            bool lowered;
+            {
+                FunctionLowering lowering(unit, module, function);
+                lowered = lowering.run(body, first_param);
+            }
+            if (!lowered)
+                module.function(function).clear();
+        }
+        return unit.errors.size() == errors_before;
+    }
+}
@@ -0,0 +1,131 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/mapped_file.h"
+#include <atomic>
+#include <fstream>
+#include <thread>
+#include <utility>
+#include "../../common/arch.hpp"
+
+#if defined(YUMINA_OS_WINDOWS)
+    #include <process.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace yu::compiler
+{
+    MappedFile::MappedFile(MappedFile &&other) noexcept : bytes(std::exchange(other.bytes, nullptr))
+                                                        , length(std::exchange(other.length, 0))
+                                                        , fallback(std::move(other.fallback)) {}
+
+    MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            bytes = std::exchange(other.bytes, nullptr);
+            length = std::exchange(other.length, 0);
+            fallback = std::move(other.fallback);
+        }
+        return *this;
+    }
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    bool MappedFile::open(const std::string &path)
+    {
+        close();
+
+#if defined(YUMINA_OS_WINDOWS)
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+            return false;
+
+        length = static_cast<size_t>(file.tellg());
+        fallback = std::make_unique<std::byte[]>(length);
+        file.seekg(0);
+        if (!file.read(reinterpret_cast<char *>(fallback.get()), static_cast<std::streamsize>(length)))
+        {
+            fallback.reset();
+            length = 0;
+            return false;
+        }
+        bytes = fallback.get();
+        return true;
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat info {};
+        if (fstat(fd, &info) != 0 || info.st_size <= 0)
+        {
+            ::close(fd);
+            return false;
+        }
+
+        void *mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+            return false;
+
+        bytes = static_cast<const std::byte *>(mapping);
+        length = static_cast<size_t>(info.st_size);
+        return true;
+#endif
+    }
+
+    void MappedFile::close()
+    {
+#if !defined(YUMINA_OS_WINDOWS)
+        if (bytes && !fallback)
+            munmap(const_cast<std::byte *>(bytes), length);
+#endif
+        fallback.reset();
+        bytes = nullptr;
+        length = 0;
+    }
+
+    bool write_file_atomically(const std::filesystem::path &path, const std::span<const std::byte> bytes)
+    {
+        // unique per process, thread and call: other compilers may share the directory
+        static std::atomic<uint32_t> sequence = 0;
+#if defined(YUMINA_OS_WINDOWS)
+        const auto process = _getpid();
+#else
+        const auto process = getpid();
+#endif
+        auto temp = path;
+        temp += "." + std::to_string(process) + "." +
+                std::to_string(std::hash<std::thread::id> {}(std::this_thread::get_id())) + "." +
+                std::to_string(sequence++) + ".tmp";
+
+        std::error_code error;
+        {
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            out.close();
+            if (!out)
+            {
+                std::filesystem::remove(temp, error);
+                return false;
+            }
+        }
+
+        std::filesystem::rename(temp, path, error);
+        if (error)
+        {
+            std::filesystem::remove(temp, error);
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,146 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/memory.h"
+#include <cstdlib>
+#include <new>
+#include "../../common/arch.hpp"
+
+#if defined(YUMINA_OS_LINUX) || defined(YUMINA_OS_MACOS)
+    #include <fcntl.h>
+    #include <sys/resource.h>
+    #include <unistd.h>
+#endif
+
+namespace yu::compiler
+{
+    bool tracks_global_new()
+    {
+        return global_new_tracked;
+    }
+
+    uint64_t resident_memory_bytes()
+    {
+#if defined(YUMINA_OS_LINUX)
+        // /proc/self/statm: total and resident size in pages
+        const int fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return 0;
+        char buffer[128];
+        const ssize_t size = read(fd, buffer, sizeof(buffer) - 1);
+        close(fd);
+        if (size <= 0)
+            return 0;
+        buffer[size] = '\0';
+
+        char *end = nullptr;
+        std::strtoull(buffer, &end, 10);
+        const uint64_t pages = std::strtoull(end, nullptr, 10);
+        return pages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#else
+        return 0;
+#endif
+    }
+
+    uint64_t peak_resident_memory_bytes()
+    {
+#if defined(YUMINA_OS_LINUX) || defined(YUMINA_OS_MACOS)
+        rusage usage {};
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+    #if defined(YUMINA_OS_MACOS)
+        return static_cast<uint64_t>(usage.ru_maxrss); // bytes
+    #else
+        return static_cast<uint64_t>(usage.ru_maxrss) * 1024; // kilobytes
+    #endif
+#else
+        return 0;
+#endif
+    }
+}
+
+#if defined(YU_TRACK_GLOBAL_NEW)
+namespace
+{
+    // the size is kept in front of the block so unsized deletes can be counted too; 16 bytes keep
+    // the alignment malloc guarantees
+    constexpr size_t header_size = 16;
+
+    void *counted_new(const size_t size) noexcept
+    {
+        auto *block = static_cast<char *>(std::malloc(size + header_size));
+        if (!block)
+            return nullptr;
+        *reinterpret_cast<size_t *>(block) = size;
+        yu::compiler::count_allocation(size);
+        return block + header_size;
+    }
+
+    void counted_delete(void *pointer) noexcept
+    {
+        if (!pointer)
+            return;
+        char *block = static_cast<char *>(pointer) - header_size;
+        yu::compiler::count_deallocation(*reinterpret_cast<size_t *>(block));
+        std::free(block);
+    }
+
+    void *counted_new_or_throw(const size_t size)
+    {
+        void *pointer = counted_new(size);
+        if (!pointer)
+            throw std::bad_alloc();
+        return pointer;
+    }
+}
+
+void *operator new(const size_t size)
+{
+    return counted_new_or_throw(size);
+}
+
+void *operator new[](const size_t size)
+{
+    return counted_new_or_throw(size);
+}
+
+void *operator new(const size_t size, const std::nothrow_t &) noexcept
+{
+    return counted_new(size);
+}
+
+void *operator new[](const size_t size, const std::nothrow_t &) noexcept
+{
+    return counted_new(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    counted_delete(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    counted_delete(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    counted_delete(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+    counted_delete(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept
+{
+    counted_delete(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept
+{
+    counted_delete(pointer);
+}
+#endif
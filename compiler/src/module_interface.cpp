@@ -0,0 +1,484 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/module_interface.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include "../include/hash.h"
+#include "../include/version.h"
+
+namespace yu::compiler
+{
+    namespace
+    {
+        constexpr uint32_t interface_magic = 0x31495559; // "YUI1"
+        constexpr uint32_t interface_endian = 0x01020304;
+
+        enum Section : uint32_t
+        {
+            SYMBOLS,
+            TYPES,
+            TYPE_REFS,
+            SEEDS,
+            SLOTS,
+            STRINGS,
+            SECTION_COUNT
+        };
+
+        struct InterfaceHeader
+        {
+            uint32_t magic;
+            uint32_t endian;
+            uint64_t version_hash;
+            uint64_t source_size;
+            int64_t source_modified;
+
+            uint32_t symbol_count;
+            uint32_t type_count;
+            uint32_t type_ref_count;
+            uint32_t bucket_count; // entries of the seed section
+            uint32_t slot_count;   // entries of the slot section, >= symbol_count
+            uint32_t string_size;
+
+            uint64_t sections[SECTION_COUNT]; // byte offset of each section, 8-aligned
+        };
+
+        struct InterfaceSymbol
+        {
+            uint32_t name_offset;
+            uint32_t name_length;
+            uint32_t type;
+            uint32_t flags;
+        };
+
+        struct InterfaceType
+        {
+            uint32_t name_offset;
+            uint32_t name_length;
+            uint32_t generic_start; // index into the type references
+            uint32_t generic_count;
+            uint32_t param_start; // index into the type references
+            uint32_t param_count;
+            uint32_t return_type;
+            uint32_t reserved;
+        };
+
+        uint64_t version_hash()
+        {
+            static const uint64_t hash = hash_bytes(compiler_version, sizeof(InterfaceHeader));
+            return hash;
+        }
+
+        size_t align8(const size_t n)
+        {
+            return (n + 7) & ~static_cast<size_t>(7);
+        }
+
+        uint32_t bucket_of(const std::string_view name, const uint32_t bucket_count)
+        {
+            return static_cast<uint32_t>(hash_bytes(name) % bucket_count);
+        }
+
+        uint32_t slot_of(const std::string_view name, const uint32_t seed, const uint32_t slot_count)
+        {
+            return static_cast<uint32_t>(hash_bytes(name, seed) % slot_count);
+        }
+
+        /**
+         * @brief Builds a perfect hash over distinct names by hash and displace: names are split into
+         * buckets of about four, and each bucket, largest first, gets the first seed that moves all its
+         * names into free slots.
+         */
+        void build_perfect_hash(const std::vector<std::string_view> &names, std::vector<uint32_t> &seeds,
+                                std::vector<uint32_t> &slots)
+        {
+            const auto count = static_cast<uint32_t>(names.size());
+            const uint32_t bucket_count = std::max<uint32_t>(1, (count + 3) / 4);
+            std::vector<std::vector<uint32_t>> buckets(bucket_count);
+            for (uint32_t i = 0; i < count; ++i)
+                buckets[bucket_of(names[i], bucket_count)].push_back(i);
+
+            std::vector<uint32_t> order(bucket_count);
+            for (uint32_t i = 0; i < bucket_count; ++i)
+                order[i] = i;
+            std::ranges::stable_sort(order, [&buckets](const uint32_t a, const uint32_t b)
+            {
+                return buckets[a].size() > buckets[b].size();
+            });
+
+            // a fifth of the slots spare keeps the seed search short; grow if a bucket still gets stuck
+            for (uint32_t slot_count = std::max<uint32_t>(1, count + count / 4);; slot_count *= 2)
+            {
+                seeds.assign(bucket_count, 0);
+                slots.assign(slot_count, ModuleInterface::no_symbol);
+                std::vector<uint32_t> taken;
+                bool placed = true;
+                for (const uint32_t bucket: order)
+                {
+                    if (buckets[bucket].empty())
+                        break;
+
+                    uint32_t seed = 1;
+                    for (; seed < 1u << 16; ++seed)
+                    {
+                        taken.clear();
+                        for (const uint32_t name: buckets[bucket])
+                        {
+                            const uint32_t slot = slot_of(names[name], seed, slot_count);
+                            if (slots[slot] != ModuleInterface::no_symbol || std::ranges::find(taken, slot) != taken.end())
+                                break;
+                            taken.push_back(slot);
+                        }
+                        if (taken.size() == buckets[bucket].size())
+                            break;
+                    }
+                    if (taken.size() != buckets[bucket].size())
+                    {
+                        placed = false;
+                        break;
+                    }
+
+                    seeds[bucket] = seed;
+                    for (size_t i = 0; i < taken.size(); ++i)
+                        slots[taken[i]] = buckets[bucket][i];
+                }
+                if (placed)
+                    return;
+            }
+        }
+
+        /**
+         * @brief Interns the unit's types reachable from the exports, children before their users.
+         */
+        class TypeInterner
+        {
+        public:
+            std::vector<InterfaceType> types;
+            std::vector<uint32_t> refs;
+
+            TypeInterner(const CompilationUnit &unit, std::string &strings) : unit(unit), strings(strings),
+                                                                               interned(unit.types.names.size(), unvisited) {}
+
+            uint32_t intern(const uint32_t type)
+            {
+                if (type >= interned.size())
+                    return ModuleInterface::no_type;
+                if (interned[type] != unvisited)
+                    return interned[type];
+                interned[type] = ModuleInterface::no_type; // a malformed self-reference ends here
+
+                const TypeList &list = unit.types;
+                std::vector<uint32_t> generics, params;
+                for (uint32_t i = 0; i < list.generic_counts[type]; ++i)
+                    generics.push_back(intern(list.generic_params[list.generic_starts[type] + i]));
+                for (uint32_t i = 0; i < list.function_param_counts[type]; ++i)
+                    params.push_back(intern(list.function_params[list.function_param_starts[type] + i]));
+                const uint32_t return_type = intern(list.function_return_types[type]);
+
+                std::string key(list.names[type]);
+                key += '\0';
+                for (const auto *children: { &generics, &params })
+                {
+                    key.append(reinterpret_cast<const char *>(children->data()), children->size() * sizeof(uint32_t));
+                    key += '\0';
+                }
+                key.append(reinterpret_cast<const char *>(&return_type), sizeof(return_type));
+
+                const auto [it, added] = keys.try_emplace(std::move(key), static_cast<uint32_t>(types.size()));
+                if (added)
+                {
+                    const auto [name_offset, name_length] = add_string(list.names[type]);
+                    const auto generic_start = static_cast<uint32_t>(refs.size());
+                    refs.insert(refs.end(), generics.begin(), generics.end());
+                    const auto param_start = static_cast<uint32_t>(refs.size());
+                    refs.insert(refs.end(), params.begin(), params.end());
+                    types.push_back({
+                        name_offset, name_length,
+                        generic_start, static_cast<uint32_t>(generics.size()),
+                        param_start, static_cast<uint32_t>(params.size()),
+                        return_type, 0
+                    });
+                }
+                return interned[type] = it->second;
+            }
+
+            std::pair<uint32_t, uint32_t> add_string(const std::string_view text)
+            {
+                const auto [it, added] = string_offsets.try_emplace(text, static_cast<uint32_t>(strings.size()));
+                if (added)
+                    strings.append(text);
+                return { it->second, static_cast<uint32_t>(text.size()) };
+            }
+
+        private:
+            static constexpr uint32_t unvisited = ModuleInterface::no_type - 1;
+
+            const CompilationUnit &unit;
+            std::string &strings;
+            std::vector<uint32_t> interned; // unit type row to interned type
+            std::unordered_map<std::string, uint32_t> keys;
+            std::unordered_map<std::string_view, uint32_t> string_offsets;
+        };
+    }
+
+    ModuleInterface ModuleInterface::build(const CompilationUnit &unit, const SourceStamp stamp)
+    {
+        std::string strings;
+        TypeInterner interner(unit, strings);
+        std::vector<InterfaceSymbol> symbols;
+        std::vector<std::string_view> names;
+
+        // every top-level declaration is exported; its name is the symbol the declaration is about
+        const DeclList &decls = unit.decls;
+        const uint32_t symbol_column = table_column_index(unit, &unit.symbols.names);
+        const uint32_t type_column = table_column_index(unit, &unit.types.names);
+        for (uint32_t decl = 0; decl < decls.token_starts.size(); ++decl)
+        {
+            const uint32_t begin = decl_rows_begin(decls, decl, symbol_column);
+            const uint32_t end = decl_rows_begin(decls, decl + 1, symbol_column);
+            uint32_t symbol = no_symbol, type = no_type;
+            switch (unit.tokens.types[decl_keyword(unit, decl)])
+            {
+                case lang::token_i::VAR:
+                case lang::token_i::CONST:
+                {
+                    // added after the initializer, so the declaration's last symbol
+                    if (begin != end)
+                    {
+                        symbol = end - 1;
+                        type = unit.symbols.type_indices[symbol];
+                    }
+                    break;
+                }
+                case lang::token_i::FUNCTION:
+                {
+                    for (uint32_t i = begin; i < end && symbol == no_symbol; ++i)
+                    {
+                        if (unit.symbols.symbol_flags[i] & static_cast<uint8_t>(SymbolFlags::IS_FUNCTION))
+                            symbol = i;
+                    }
+                    if (symbol == no_symbol)
+                        break;
+
+                    // the function type directly follows its return type
+                    for (uint32_t t = decl_rows_begin(decls, decl, type_column);
+                         t < decl_rows_begin(decls, decl + 1, type_column) && type == no_type; ++t)
+                    {
+                        if (unit.types.names[t] == "function" &&
+                            unit.types.function_return_types[t] == unit.symbols.type_indices[symbol])
+                            type = t;
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+
+            if (symbol == no_symbol || std::ranges::find(names, unit.symbols.names[symbol]) != names.end())
+                continue;
+            const auto [name_offset, name_length] = interner.add_string(unit.symbols.names[symbol]);
+            names.push_back(unit.symbols.names[symbol]);
+            symbols.push_back({ name_offset, name_length, interner.intern(type), unit.symbols.symbol_flags[symbol] });
+        }
+
+        std::vector<uint32_t> seeds, slots;
+        build_perfect_hash(names, seeds, slots);
+
+        InterfaceHeader header {
+            interface_magic,
+            interface_endian,
+            version_hash(),
+            stamp.size,
+            stamp.modified,
+            static_cast<uint32_t>(symbols.size()),
+            static_cast<uint32_t>(interner.types.size()),
+            static_cast<uint32_t>(interner.refs.size()),
+            static_cast<uint32_t>(seeds.size()),
+            static_cast<uint32_t>(slots.size()),
+            static_cast<uint32_t>(strings.size()),
+            {}
+        };
+
+        const std::pair<const void *, size_t> contents[SECTION_COUNT] = {
+            { symbols.data(), symbols.size() * sizeof(InterfaceSymbol) },
+            { interner.types.data(), interner.types.size() * sizeof(InterfaceType) },
+            { interner.refs.data(), interner.refs.size() * sizeof(uint32_t) },
+            { seeds.data(), seeds.size() * sizeof(uint32_t) },
+            { slots.data(), slots.size() * sizeof(uint32_t) },
+            { strings.data(), strings.size() },
+        };
+        size_t offset = align8(sizeof(InterfaceHeader));
+        for (uint32_t section = 0; section < SECTION_COUNT; ++section)
+        {
+            header.sections[section] = offset;
+            offset = align8(offset + contents[section].second);
+        }
+
+        ModuleInterface result;
+        result.owned.resize(offset);
+        std::memcpy(result.owned.data(), &header, sizeof(header));
+        for (uint32_t section = 0; section < SECTION_COUNT; ++section)
+        {
+            if (contents[section].second)
+                std::memcpy(result.owned.data() + header.sections[section], contents[section].first, contents[section].second);
+        }
+        return result;
+    }
+
+    bool ModuleInterface::open(const std::string &path)
+    {
+        owned.clear();
+        if (!file.open(path))
+            return false;
+        if (valid())
+            return true;
+
+        file = MappedFile {};
+        return false;
+    }
+
+    bool ModuleInterface::valid() const
+    {
+        if (size() < sizeof(InterfaceHeader))
+            return false;
+
+        const auto &header = *reinterpret_cast<const InterfaceHeader *>(data());
+        if (header.magic != interface_magic || header.endian != interface_endian ||
+            header.version_hash != version_hash() || header.slot_count < header.symbol_count ||
+            (header.symbol_count && !header.bucket_count))
+            return false;
+
+        const uint64_t sizes[SECTION_COUNT] = {
+            static_cast<uint64_t>(header.symbol_count) * sizeof(InterfaceSymbol),
+            static_cast<uint64_t>(header.type_count) * sizeof(InterfaceType),
+            static_cast<uint64_t>(header.type_ref_count) * sizeof(uint32_t),
+            static_cast<uint64_t>(header.bucket_count) * sizeof(uint32_t),
+            static_cast<uint64_t>(header.slot_count) * sizeof(uint32_t),
+            header.string_size
+        };
+        for (uint32_t section = 0; section < SECTION_COUNT; ++section)
+        {
+            if (header.sections[section] % 8 || header.sections[section] < sizeof(InterfaceHeader) ||
+                header.sections[section] > size() || sizes[section] > size() - header.sections[section])
+                return false;
+        }
+        return true;
+    }
+
+    bool ModuleInterface::write(const std::string &path) const
+    {
+        if (!*this)
+            return false;
+
+        return write_file_atomically(path, image());
+    }
+
+    std::filesystem::path ModuleInterface::interface_path(const std::filesystem::path &source)
+    {
+        auto path = source;
+        return path.replace_extension(".yui");
+    }
+
+    SourceStamp ModuleInterface::stamp(const std::filesystem::path &source)
+    {
+        std::error_code error;
+        const auto size = std::filesystem::file_size(source, error);
+        if (error)
+            return {};
+        const auto modified = std::filesystem::last_write_time(source, error);
+        if (error)
+            return {};
+        return { size, static_cast<int64_t>(modified.time_since_epoch().count()) };
+    }
+
+    SourceStamp ModuleInterface::source_stamp() const
+    {
+        if (!*this)
+            return {};
+        const auto &header = *reinterpret_cast<const InterfaceHeader *>(data());
+        return { header.source_size, header.source_modified };
+    }
+
+    template<typename T>
+    const T *ModuleInterface::section(const uint32_t index) const
+    {
+        return reinterpret_cast<const T *>(data() + reinterpret_cast<const InterfaceHeader *>(data())->sections[index]);
+    }
+
+    std::string_view ModuleInterface::string(const uint32_t offset, const uint32_t length) const
+    {
+        if (static_cast<uint64_t>(offset) + length > reinterpret_cast<const InterfaceHeader *>(data())->string_size)
+            return {};
+        return { section<char>(STRINGS) + offset, length };
+    }
+
+    uint32_t ModuleInterface::find(const std::string_view name) const
+    {
+        if (!symbol_count())
+            return no_symbol;
+
+        const auto &header = *reinterpret_cast<const InterfaceHeader *>(data());
+        const uint32_t seed = section<uint32_t>(SEEDS)[bucket_of(name, header.bucket_count)];
+        const uint32_t symbol = section<uint32_t>(SLOTS)[slot_of(name, seed, header.slot_count)];
+        return symbol < header.symbol_count && symbol_name(symbol) == name ? symbol : no_symbol;
+    }
+
+    uint32_t ModuleInterface::symbol_count() const
+    {
+        return *this ? reinterpret_cast<const InterfaceHeader *>(data())->symbol_count : 0;
+    }
+
+    std::string_view ModuleInterface::symbol_name(const uint32_t symbol) const
+    {
+        const InterfaceSymbol &entry = section<InterfaceSymbol>(SYMBOLS)[symbol];
+        return string(entry.name_offset, entry.name_length);
+    }
+
+    uint32_t ModuleInterface::symbol_type(const uint32_t symbol) const
+    {
+        const uint32_t type = section<InterfaceSymbol>(SYMBOLS)[symbol].type;
+        return type < type_count() ? type : no_type;
+    }
+
+    uint8_t ModuleInterface::symbol_flags(const uint32_t symbol) const
+    {
+        return static_cast<uint8_t>(section<InterfaceSymbol>(SYMBOLS)[symbol].flags);
+    }
+
+    uint32_t ModuleInterface::type_count() const
+    {
+        return *this ? reinterpret_cast<const InterfaceHeader *>(data())->type_count : 0;
+    }
+
+    std::string_view ModuleInterface::type_name(const uint32_t type) const
+    {
+        const InterfaceType &entry = section<InterfaceType>(TYPES)[type];
+        return string(entry.name_offset, entry.name_length);
+    }
+
+    std::span<const uint32_t> ModuleInterface::type_generics(const uint32_t type) const
+    {
+        const InterfaceType &entry = section<InterfaceType>(TYPES)[type];
+        if (static_cast<uint64_t>(entry.generic_start) + entry.generic_count >
+            reinterpret_cast<const InterfaceHeader *>(data())->type_ref_count)
+            return {};
+        return { section<uint32_t>(TYPE_REFS) + entry.generic_start, entry.generic_count };
+    }
+
+    std::span<const uint32_t> ModuleInterface::type_params(const uint32_t type) const
+    {
+        const InterfaceType &entry = section<InterfaceType>(TYPES)[type];
+        if (static_cast<uint64_t>(entry.param_start) + entry.param_count >
+            reinterpret_cast<const InterfaceHeader *>(data())->type_ref_count)
+            return {};
+        return { section<uint32_t>(TYPE_REFS) + entry.param_start, entry.param_count };
+    }
+
+    uint32_t ModuleInterface::type_return(const uint32_t type) const
+    {
+        const uint32_t result = section<InterfaceType>(TYPES)[type].return_type;
+        return result < type_count() ? result : no_type;
+    }
+}
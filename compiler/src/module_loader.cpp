@@ -0,0 +1,343 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/module_loader.h"
+#include <algorithm>
+#include <system_error>
+#include <utility>
+#include "../include/lexer.h"
+
+namespace yu::compiler
+{
+    namespace
+    {
+        std::string canonical_path(const std::filesystem::path &path)
+        {
+            std::error_code error;
+            const auto canonical = std::filesystem::weakly_canonical(path, error);
+            return (error ? path.lexically_normal() : canonical).string();
+        }
+
+        bool is_file(const std::filesystem::path &path)
+        {
+            std::error_code error;
+            return std::filesystem::is_regular_file(path, error);
+        }
+
+        /**
+         * @brief Records an import error at the import's path, the way the parser records its errors.
+         */
+        void add_import_error(CompilationUnit &unit, const std::string_view path, std::string message,
+                              std::string suggestion)
+        {
+            const auto offset = static_cast<uint32_t>(path.data() - unit.source.data());
+            const auto [line, column] = Lexer::get_line_col(unit.line_starts, offset);
+            const std::string_view source = unit.source.view();
+            const uint32_t line_start = unit.line_starts[line - 1];
+            const size_t line_end = std::min(source.find('\n', line_start), source.size());
+
+            if (unit.error_message.empty())
+                unit.error_message = message;
+            unit.success = false;
+            unit.errors.push_back({
+                ParseErrorFlags::UNRESOLVED_IMPORT,
+                ErrorSeverity::ERROR,
+                std::move(message),
+                std::move(suggestion),
+                unit.file_name(),
+                line,
+                column,
+                std::string(source.substr(line_start, line_end - line_start)),
+                std::string(column - 1, ' ') + "^" + std::string(path.size(), '~')
+            });
+        }
+    }
+
+    ModuleLoader::ModuleLoader(std::vector<std::filesystem::path> search_paths) : search_paths(std::move(search_paths)) {}
+
+    uint32_t ModuleLoader::add_root(const std::string &path)
+    {
+        std::lock_guard lock(mutex);
+        const auto [index, added] = intern(path);
+        modules[index]->root = true;
+        return index;
+    }
+
+    std::pair<uint32_t, bool> ModuleLoader::intern(const std::string &path)
+    {
+        const auto [it, added] = by_path.try_emplace(canonical_path(path), static_cast<uint32_t>(modules.size()));
+        if (added)
+        {
+            auto &node = modules.emplace_back(std::make_unique<Node>());
+            node->module = std::make_unique<Module>();
+            node->module->path = path;
+        }
+        return { it->second, added };
+    }
+
+    std::filesystem::path ModuleLoader::resolve(const std::filesystem::path &importer, const std::string_view path) const
+    {
+        std::filesystem::path relative(path);
+        if (!relative.has_extension())
+            relative += ".yu";
+
+        // a library may ship only the interface files of its modules
+        const auto exists = [](const std::filesystem::path &candidate)
+        {
+            return is_file(candidate) || is_file(ModuleInterface::interface_path(candidate));
+        };
+        if (relative.empty() || relative.is_absolute())
+            return exists(relative) ? relative : std::filesystem::path {};
+
+        if (const auto candidate = importer.parent_path() / relative; exists(candidate))
+            return candidate.lexically_normal();
+        if (path.starts_with("./") || path.starts_with("../"))
+            return {};
+
+        for (const auto &directory: search_paths)
+        {
+            if (const auto candidate = directory / relative; exists(candidate))
+                return candidate.lexically_normal();
+        }
+        return {};
+    }
+
+    void ModuleLoader::run(ThreadPool &pool, const ParseFunction &parse, const CompileFunction &compile)
+    {
+        uint32_t roots;
+        {
+            std::lock_guard lock(mutex);
+            roots = static_cast<uint32_t>(modules.size());
+        }
+        for (uint32_t index = 0; index < roots; ++index)
+            pool.submit([this, &pool, &parse, &compile, index] { parse_module(pool, index, parse, compile); });
+        pool.wait();
+
+        // whatever did not compile waits on an import cycle
+        for (auto ready = break_cycles(); !ready.empty(); ready = break_cycles())
+        {
+            for (const uint32_t index: ready)
+                pool.submit([this, &pool, &compile, index] { compile_module(pool, index, compile); });
+            pool.wait();
+        }
+    }
+
+    void ModuleLoader::parse_module(ThreadPool &pool, const uint32_t index, const ParseFunction &parse,
+                                    const CompileFunction &compile)
+    {
+        Module *module;
+        bool root;
+        {
+            std::lock_guard lock(mutex);
+            module = modules[index]->module.get();
+            root = modules[index]->root;
+        }
+
+        if (!root && load_interface(*module))
+        {
+            {
+                std::lock_guard lock(mutex);
+                modules[index]->parsed = true;
+            }
+            compile_module(pool, index, compile);
+            return;
+        }
+
+        const SourceStamp stamp = ModuleInterface::stamp(module->path);
+        module->unit = parse(index, module->path);
+        module->interface = ModuleInterface::build(module->unit, stamp);
+
+        // file system lookups happen before taking the lock
+        const ImportList &imports = module->unit.imports;
+        std::vector<std::string> resolved(imports.paths.size());
+        for (uint32_t row = 0; row < imports.paths.size(); ++row)
+        {
+            if (const auto file = resolve(module->path, imports.paths[row]); !file.empty())
+                resolved[row] = file.string();
+            else
+            {
+                add_import_error(module->unit, imports.paths[row],
+                                 "Cannot resolve import '" + std::string(imports.paths[row]) + "'",
+                                 "Check the module path and the module search paths");
+            }
+        }
+
+        std::vector<uint32_t> discovered;
+        bool ready;
+        {
+            std::lock_guard lock(mutex);
+            module->imports.assign(resolved.size(), no_module);
+            for (uint32_t row = 0; row < resolved.size(); ++row)
+            {
+                if (resolved[row].empty())
+                    continue;
+
+                const auto [dependency, added] = intern(resolved[row]);
+                module->imports[row] = dependency;
+                if (added)
+                    discovered.push_back(dependency);
+                if (std::ranges::find(module->dependencies, dependency) != module->dependencies.end())
+                    continue;
+
+                module->dependencies.push_back(dependency);
+                if (Node &node = *modules[dependency]; !node.compiled)
+                {
+                    node.dependents.push_back(index);
+                    ++modules[index]->pending;
+                }
+            }
+            modules[index]->parsed = true;
+            ready = modules[index]->pending == 0;
+        }
+
+        for (const uint32_t dependency: discovered)
+            pool.submit([this, &pool, &parse, &compile, dependency] { parse_module(pool, dependency, parse, compile); });
+        if (ready)
+            compile_module(pool, index, compile);
+    }
+
+    void ModuleLoader::compile_module(ThreadPool &pool, const uint32_t index, const CompileFunction &compile)
+    {
+        Module *module;
+        {
+            std::lock_guard lock(mutex);
+            module = modules[index]->module.get();
+        }
+        if (!module->precompiled)
+        {
+            check_imported_names(*module);
+            compile(index, *module);
+        }
+
+        std::vector<uint32_t> ready;
+        {
+            std::lock_guard lock(mutex);
+            Node &node = *modules[index];
+            node.compiled = true;
+            for (const uint32_t dependent: node.dependents)
+            {
+                if (--modules[dependent]->pending == 0 && modules[dependent]->parsed)
+                    ready.push_back(dependent);
+            }
+            node.dependents.clear();
+        }
+
+        for (const uint32_t dependent: ready)
+            pool.submit([this, &pool, &compile, dependent] { compile_module(pool, dependent, compile); });
+    }
+
+    bool ModuleLoader::load_interface(Module &module)
+    {
+        // a missing source stamps as zero, then the interface is all there is
+        const SourceStamp stamp = ModuleInterface::stamp(module.path);
+        if (!module.interface.open(ModuleInterface::interface_path(module.path).string()))
+            return false;
+        if (stamp.modified != 0 && module.interface.source_stamp() != stamp)
+        {
+            module.interface = ModuleInterface {};
+            return false;
+        }
+
+        module.precompiled = true;
+        module.unit.source = SourceBuffer(module.path, std::string_view {});
+        module.unit.success = true;
+        return true;
+    }
+
+    void ModuleLoader::check_imported_names(Module &module)
+    {
+        // only dependencies that compiled cleanly; a cut cycle or a broken module proves nothing
+        std::vector<const Module *> dependencies(module.imports.size(), nullptr);
+        {
+            std::lock_guard lock(mutex);
+            for (uint32_t row = 0; row < module.imports.size(); ++row)
+            {
+                const uint32_t dependency = module.imports[row];
+                if (dependency != no_module && modules[dependency]->compiled &&
+                    modules[dependency]->module->unit.success)
+                    dependencies[row] = modules[dependency]->module.get();
+            }
+        }
+
+        const ImportList &imports = module.unit.imports;
+        for (uint32_t row = 0; row < dependencies.size(); ++row)
+        {
+            if (!dependencies[row])
+                continue;
+            for (uint32_t i = imports.name_starts[row]; i < imports.name_starts[row] + imports.name_counts[row]; ++i)
+            {
+                if (dependencies[row]->interface.find(imports.names[i]) == ModuleInterface::no_symbol)
+                {
+                    add_import_error(module.unit, imports.names[i],
+                                     "Module '" + std::string(imports.paths[row]) + "' has no export '" +
+                                     std::string(imports.names[i]) + "'",
+                                     "Check the name against the module's top-level declarations");
+                }
+            }
+        }
+    }
+
+    std::vector<uint32_t> ModuleLoader::break_cycles()
+    {
+        std::lock_guard lock(mutex);
+
+        // depth-first over the modules still waiting; an import of a module on the stack closes a cycle
+        enum : uint8_t { UNVISITED, ON_STACK, DONE };
+        std::vector<uint8_t> state(modules.size(), UNVISITED);
+        std::vector<std::pair<uint32_t, uint32_t>> stack; // module, next row of its imports
+        std::vector<uint32_t> ready;
+
+        for (uint32_t root = 0; root < modules.size(); ++root)
+        {
+            if (modules[root]->compiled || state[root] != UNVISITED)
+                continue;
+
+            stack.emplace_back(root, 0);
+            state[root] = ON_STACK;
+            while (!stack.empty())
+            {
+                auto &[index, row] = stack.back();
+                Module &module = *modules[index]->module;
+                if (row == module.imports.size())
+                {
+                    state[index] = DONE;
+                    stack.pop_back();
+                    continue;
+                }
+
+                const uint32_t dependency = module.imports[row++];
+                if (dependency == no_module || modules[dependency]->compiled)
+                    continue;
+                if (state[dependency] == UNVISITED)
+                {
+                    state[dependency] = ON_STACK;
+                    stack.emplace_back(dependency, 0);
+                    continue;
+                }
+                if (state[dependency] == DONE)
+                    continue;
+
+                auto &dependents = modules[dependency]->dependents;
+                if (const auto it = std::ranges::find(dependents, index); it == dependents.end())
+                    continue; // a repeated import of the same module, already cut
+                else
+                    dependents.erase(it);
+
+                std::string cycle;
+                const auto first = std::ranges::find_if(stack, [dependency](const auto &entry)
+                {
+                    return entry.first == dependency;
+                });
+                for (auto it = first; it != stack.end(); ++it)
+                    cycle.append(modules[it->first]->module->path).append(" -> ");
+                cycle.append(modules[dependency]->module->path);
+                add_import_error(module.unit, module.unit.imports.paths[row - 1], "Import cycle: " + cycle,
+                                 "Move the shared declarations into a module both can import");
+
+                if (--modules[index]->pending == 0)
+                    ready.push_back(index);
+            }
+        }
+        return ready;
+    }
+}
@@ -2,6 +2,8 @@
 // See LICENSE.txt for details
 
 #include "../include/parser.h"
+#include "../include/compilation_unit.h"
+#include "../include/timer.h"
 #include <iomanip>
 #include <iostream>
 #include "../../common/styles.h"
@@ -12,7 +14,7 @@ namespace yu::compiler
                                           const std::string &message, const std::string &suggestion,
                                           const uint32_t token_index) const
     {
-        const auto [line, col] = lexer.get_line_col(current_token);
+        const auto [line, col] = Lexer::get_line_col(line_starts, current_token.start);
         return {
             flags,
             severity,
@@ -26,10 +28,12 @@ namespace yu::compiler
         };
     }
 
-    Parser::Parser(lang::TokenList &tokens, const char *source, const char *file_name,
-                   const Lexer &lexer): lexer(lexer),
-                                        tokens(tokens), source(source),
-                                        file_name(file_name)
+    Parser::Parser(CompilationUnit &unit): unit(unit), tokens(unit.tokens), line_starts(unit.line_starts),
+                                           source(unit.source.data()), file_name(unit.file_name()),
+                                           var_declrs(unit.var_decls), types(unit.types),
+                                           expressions(unit.expressions), symbols(unit.symbols),
+                                           imports(unit.imports), interner(StringInterner::global()),
+                                           warnings(unit.warnings), errors(unit.errors)
     {
         update_current_token();
     }
@@ -40,64 +44,309 @@ namespace yu::compiler
         symbols = SymbolList {};
         types = TypeList {};
         expressions = ExprList {};
+        imports = ImportList {};
+        unit.decls = DeclList {};
         current_scope = 0;
         current = 0;
         update_current_token();
 
         while (!is_at_end())
+        {
+            if (const auto declaration = parse_declaration();
+                !declaration)
+            {
+                return ParseResult<int>::failure();
+            }
+        }
+
+        return ParseResult(1);
+    }
+
+    ParseResult<int> Parser::parse_declarations(const uint32_t first_token, const uint32_t end_token)
+    {
+        current_scope = 0;
+        current = first_token;
+        update_current_token();
+
+        while (current < end_token && !is_at_end())
+        {
+            if (const auto declaration = parse_declaration();
+                !declaration)
+            {
+                return ParseResult<int>::failure();
+            }
+        }
+
+        if (current != end_token)
+            return ParseResult<int>::failure();
+
+        return ParseResult(0);
+    }
+
+    void Parser::set_emit_diagnostics(const bool enabled)
+    {
+        emit_diagnostics = enabled;
+    }
+
+    ParseResult<uint32_t> Parser::parse_declaration()
+    {
+        const uint32_t first_token = current;
+        decl_symbol_start = symbols.names.size();
+
+        // attributes only qualify the declaration; decl_attributes() reads them back from the tokens
+        if (!parse_attributes())
+            return ParseResult<uint32_t>::failure();
+
+        switch (current_token.type)
+        {
+            case lang::token_i::VAR:
+            case lang::token_i::CONST:
+            {
+                if (const auto var_decl = parse_variable_decl();
+                    !var_decl)
+                {
+                    return ParseResult<uint32_t>::failure();
+                }
+                break;
+            }
+            case lang::token_i::FUNCTION:
+            {
+                if (const auto func_decl = parse_function_decl();
+                    !func_decl)
+                {
+                    return ParseResult<uint32_t>::failure();
+                }
+                break;
+            }
+            case lang::token_i::IMPORT:
+            {
+                if (const auto import_decl = parse_import_decl();
+                    !import_decl)
+                {
+                    return ParseResult<uint32_t>::failure();
+                }
+                break;
+            }
+            default:
+            {
+                report_error(create_parse_error(
+                    ParseErrorFlags::UNEXPECTED_TOKEN,
+                    ErrorSeverity::ERROR,
+                    "Unexpected token in program",
+                    "Remove or replace this token",
+                    current
+                ));
+                return ParseResult<uint32_t>::failure();
+            }
+        }
+
+        record_declaration(first_token);
+        return ParseResult(static_cast<uint32_t>(unit.decls.token_starts.size() - 1));
+    }
+
+    ParseResult<int> Parser::parse_attributes()
+    {
+        while (true)
         {
             switch (current_token.type)
             {
-                case lang::token_i::VAR:
-                case lang::token_i::CONST:
+                case lang::token_i::PURE_ANNOT:
+                case lang::token_i::TAIL_REC_ANNOT:
+                case lang::token_i::NO_DISCARD_ANNOT:
+                case lang::token_i::DEPRECATED_ANNOT:
+                case lang::token_i::PACKED_ANNOT:
+                case lang::token_i::VOLATILE_ANNOT:
+                case lang::token_i::LAZY_ANNOT:
+                    advance();
+                    continue;
+                case lang::token_i::ALIGN_ANNOT:
                 {
-                    auto var_decl = parse_variable_decl();
-                    if (!var_decl)
+                    advance();
+                    if (current_token.type != lang::token_i::LEFT_PAREN)
                     {
+                        report_error(create_parse_error(
+                            ParseErrorFlags::UNEXPECTED_TOKEN,
+                            ErrorSeverity::ERROR,
+                            "Expected '(' after @align",
+                            "Write the alignment as @align(N)",
+                            current
+                        ));
                         return ParseResult<int>::failure();
                     }
-                    break;
-                }
-                case lang::token_i::FUNCTION:
-                {
-                    if (const auto func_decl = parse_function_decl();
-                        !func_decl)
+                    uint32_t depth = 0;
+                    do
+                    {
+                        depth += current_token.type == lang::token_i::LEFT_PAREN;
+                        depth -= current_token.type == lang::token_i::RIGHT_PAREN;
+                        advance();
+                    } while (depth && !is_at_end());
+                    if (depth)
                     {
+                        report_error(create_parse_error(
+                            ParseErrorFlags::INVALID_SYNTAX,
+                            ErrorSeverity::ERROR,
+                            "Unterminated @align",
+                            "Close the alignment with ')'",
+                            current
+                        ));
                         return ParseResult<int>::failure();
                     }
-                    break;
+                    continue;
                 }
-                case lang::token_i::END_OF_FILE:
-                    return ParseResult(0);
-
+                case lang::token_i::INLINE:
+                case lang::token_i::ASYNC:
+                    advance();
+                    if (current_token.type != lang::token_i::FUNCTION)
+                    {
+                        report_error(create_parse_error(
+                            ParseErrorFlags::UNEXPECTED_TOKEN,
+                            ErrorSeverity::ERROR,
+                            "Expected 'function' after a function modifier",
+                            "Only functions can be inline or async",
+                            current
+                        ));
+                        return ParseResult<int>::failure();
+                    }
+                    return ParseResult(1);
                 default:
+                    return ParseResult(1);
+            }
+        }
+    }
+
+    void Parser::record_declaration(const uint32_t first_token)
+    {
+        DeclList &decls = unit.decls;
+        decls.token_starts.emplace_back(first_token);
+        for_each_table_column(unit, [&decls](const auto &column, ColumnRef)
+        {
+            decls.column_ends.emplace_back(static_cast<uint32_t>(column.size()));
+        });
+        decls.reference_ends.emplace_back(decls.references.size());
+    }
+
+    ParseResult<uint32_t> Parser::parse_import_decl()
+    {
+        advance();
+
+        const uint32_t name_start = imports.names.size();
+        const bool has_from = current_token.type == lang::token_i::LEFT_BRACE
+                              || current_token.type == lang::token_i::STAR;
+        if (match(lang::token_i::LEFT_BRACE))
+        {
+            do
+            {
+                if (current_token.type != lang::token_i::IDENTIFIER)
                 {
                     report_error(create_parse_error(
                         ParseErrorFlags::UNEXPECTED_TOKEN,
                         ErrorSeverity::ERROR,
-                        "Unexpected token in program",
-                        "Remove or replace this token",
+                        "Expected name to import",
+                        "List the imported names, e.g. import { A, B } from 'path';",
                         current
                     ));
-                    return ParseResult<int>::failure();
+                    return ParseResult<uint32_t>::failure();
                 }
+
+                const std::string_view name(source + tokens.starts[current], tokens.lengths[current]);
+                imports.names.emplace_back(name);
+                add_symbol(name, std::numeric_limits<uint32_t>::max(), static_cast<uint8_t>(SymbolFlags::IS_IMPORTED));
+                advance();
+            }
+            while (match(lang::token_i::COMMA));
+
+            if (!match(lang::token_i::RIGHT_BRACE))
+            {
+                report_error(create_parse_error(
+                    ParseErrorFlags::UNEXPECTED_TOKEN,
+                    ErrorSeverity::ERROR,
+                    "Expected '}' to close import list",
+                    "Close the import list with '}'",
+                    current
+                ));
+                return ParseResult<uint32_t>::failure();
             }
         }
+        else
+            match(lang::token_i::STAR);
 
-        return ParseResult(1);
+        if (has_from && !match(lang::token_i::FROM))
+        {
+            report_error(create_parse_error(
+                ParseErrorFlags::UNEXPECTED_TOKEN,
+                ErrorSeverity::ERROR,
+                "Expected 'from' after imported names",
+                "Name the module with from 'path'",
+                current
+            ));
+            return ParseResult<uint32_t>::failure();
+        }
+
+        if (current_token.type != lang::token_i::STR_LITERAL || tokens.lengths[current] < 2)
+        {
+            report_error(create_parse_error(
+                ParseErrorFlags::UNEXPECTED_TOKEN,
+                ErrorSeverity::ERROR,
+                "Expected module path",
+                "Give the module path as a string, e.g. 'math/linear'",
+                current
+            ));
+            return ParseResult<uint32_t>::failure();
+        }
+        const std::string_view path(source + tokens.starts[current] + 1, tokens.lengths[current] - 2);
+        advance();
+
+        std::string_view alias;
+        if (!has_from && match(lang::token_i::AS))
+        {
+            if (current_token.type != lang::token_i::IDENTIFIER)
+            {
+                report_error(create_parse_error(
+                    ParseErrorFlags::UNEXPECTED_TOKEN,
+                    ErrorSeverity::ERROR,
+                    "Expected module alias after 'as'",
+                    "Name the module, e.g. import 'collections/hashmap' as HashMap;",
+                    current
+                ));
+                return ParseResult<uint32_t>::failure();
+            }
+            alias = { source + tokens.starts[current], tokens.lengths[current] };
+            add_symbol(alias, std::numeric_limits<uint32_t>::max(), static_cast<uint8_t>(SymbolFlags::IS_IMPORTED));
+            advance();
+        }
+
+        if (!match(lang::token_i::SEMICOLON))
+        {
+            report_error(create_parse_error(
+                ParseErrorFlags::UNEXPECTED_TOKEN,
+                ErrorSeverity::ERROR,
+                "Expected ';' after import",
+                "End the import with ';'",
+                current
+            ));
+            return ParseResult<uint32_t>::failure();
+        }
+
+        const uint32_t import_index = imports.paths.size();
+        imports.paths.emplace_back(path);
+        imports.aliases.emplace_back(alias);
+        imports.name_starts.emplace_back(name_start);
+        imports.name_counts.emplace_back(imports.names.size() - name_start);
+        return ParseResult(import_index);
     }
 
     ParseResult<uint32_t> Parser::parse_function_decl()
     {
-        //const uint32_t func_index = types.names.size();
         advance();
 
-        // TODO: Make actually generics
+        uint32_t generic_start = types.generic_params.size();
+        uint32_t generic_count = 0;
         if (current_token.type == lang::token_i::LESS)
         {
-            auto generic_result = parse_generic_params();
+            const auto generic_result = parse_generic_params(generic_count);
             if (!generic_result)
                 return ParseResult<uint32_t>::failure();
+            generic_start = generic_result.value;
         }
 
         // fn name
@@ -258,14 +507,12 @@ namespace yu::compiler
 
         symbols.type_indices[func_symbol_index] = return_type_result.value;
 
-        const uint32_t function_type_index = types.names.size();
-        types.names.emplace_back("function");
-        types.function_param_starts.emplace_back(param_start);
-        types.function_param_counts.emplace_back(param_count);
-        types.function_return_types.emplace_back(return_type_result.value);
-
-        types.generic_starts.emplace_back(0);
-        types.generic_counts.emplace_back(0);
+        const uint32_t function_type_index = add_type("function");
+        types.function_param_starts[function_type_index] = param_start;
+        types.function_param_counts[function_type_index] = param_count;
+        types.function_return_types[function_type_index] = return_type_result.value;
+        types.generic_starts[function_type_index] = generic_start;
+        types.generic_counts[function_type_index] = generic_count;
 
         if (current_token.type != lang::token_i::LEFT_BRACE)
         {
@@ -328,6 +575,8 @@ namespace yu::compiler
             source + tokens.starts[current],
             tokens.lengths[current]
         });
+        var_declrs.name_atoms.emplace_back(interner.intern(var_declrs.names.back()));
+        const auto [name_line, name_column] = Lexer::get_line_col(line_starts, current_token.start);
         advance();
 
         uint32_t type_idx = std::numeric_limits<uint32_t>::max();
@@ -375,7 +624,10 @@ namespace yu::compiler
 
         if (type_idx == std::numeric_limits<uint32_t>::max())
         {
-            type_idx = infer_type(init_result.value);
+            {
+                const Timer timer("infer");
+                type_idx = infer_type(init_result.value);
+            }
             if (type_idx == std::numeric_limits<uint32_t>::max())
             {
                 report_error(create_parse_error(
@@ -392,9 +644,10 @@ namespace yu::compiler
         var_declrs.type_indices.emplace_back(type_idx);
         var_declrs.init_indices.emplace_back(init_result.value);
         var_declrs.flags.emplace_back(is_const);
+        add_symbol(var_declrs.names.back(), type_idx, is_const ? static_cast<uint8_t>(SymbolFlags::IS_CONST) : 0);
 
-        var_declrs.lines.emplace_back(current_token.start);
-        var_declrs.columns.emplace_back(current_token.length);
+        var_declrs.lines.emplace_back(name_line);
+        var_declrs.columns.emplace_back(name_column);
 
         if (!match(lang::token_i::SEMICOLON))
         {
@@ -447,27 +700,25 @@ namespace yu::compiler
         if (expr_index >= expressions.expr_types.size())
             return std::numeric_limits<uint32_t>::max();
 
-        if (expressions.expr_types[expr_index] < types.names.size())
-        {
-            return expressions.expr_types[expr_index];
-        }
-
         switch (static_cast<lang::token_i>(expressions.expr_types[expr_index]))
         {
+            case lang::token_i::FUNCTION:
+                return expressions.type_indices[expr_index];
+
             case lang::token_i::NUM_LITERAL:
             {
                 const std::string_view value = expressions.values[expr_index];
-                return value.find('.') != std::string_view::npos
-                           ? static_cast<uint32_t>(lang::token_i::F64)
-                           : static_cast<uint32_t>(lang::token_i::I32);
+                return add_type(lang::token_type_to_string(value.find('.') != std::string_view::npos
+                                                               ? lang::token_i::F64
+                                                               : lang::token_i::I32));
             }
 
             case lang::token_i::TRUE:
             case lang::token_i::FALSE:
-                return static_cast<uint32_t>(lang::token_i::BOOLEAN);
+                return add_type(lang::token_type_to_string(lang::token_i::BOOLEAN));
 
             case lang::token_i::STR_LITERAL:
-                return static_cast<uint32_t>(lang::token_i::STRING);
+                return add_type(lang::token_type_to_string(lang::token_i::STRING));
 
             case lang::token_i::NIL:
                 return std::numeric_limits<uint32_t>::max();
@@ -476,8 +727,8 @@ namespace yu::compiler
             {
                 const std::string_view identifier = expressions.values[expr_index];
 
-                if (const uint32_t symbol_index = lookup_symbol(identifier);
-                    symbol_index != -1)
+                if (const uint32_t symbol_index = resolve_symbol(identifier);
+                    symbol_index != no_symbol)
                     return symbols.type_indices[symbol_index];
                 return std::numeric_limits<uint32_t>::max();
             }
@@ -492,6 +743,7 @@ namespace yu::compiler
         const uint32_t symbol_index = symbols.names.size();
 
         symbols.names.emplace_back(name);
+        symbols.name_atoms.emplace_back(interner.intern(name));
         symbols.type_indices.emplace_back(type_index);
         symbols.scopes.emplace_back(current_scope);
         symbols.symbol_flags.emplace_back(flags);
@@ -501,18 +753,44 @@ namespace yu::compiler
 
     uint32_t Parser::lookup_symbol(const std::string_view name) const
     {
-        for (int32_t i = symbols.names.size() - 1; i >= 0; --i)
+        // a name nobody interned cannot name a symbol; otherwise compare atoms, not strings
+        const uint32_t atom = interner.find(name);
+        if (atom == StringInterner::no_atom)
+            return no_symbol;
+        for (uint32_t i = symbols.name_atoms.size(); i-- > 0;)
         {
-            if (symbols.names[i] == name)
+            if (symbols.name_atoms[i] == atom)
                 return i;
         }
-        return -1;
+        return no_symbol;
     }
 
-    ParseResult<uint32_t> Parser::parse_type()
+    uint32_t Parser::resolve_symbol(const std::string_view name)
+    {
+        // remember names bound by earlier declarations, so edits to those can invalidate this one
+        const uint32_t symbol_index = lookup_symbol(name);
+        if (symbol_index != no_symbol && symbol_index < decl_symbol_start)
+            unit.decls.references.emplace_back(name);
+        return symbol_index;
+    }
+
+    uint32_t Parser::add_type(const std::string_view name)
     {
         const uint32_t type_index = types.names.size();
 
+        types.names.emplace_back(name);
+        types.name_atoms.emplace_back(interner.intern(name));
+        types.generic_starts.emplace_back(types.generic_params.size());
+        types.generic_counts.emplace_back(0);
+        types.function_param_starts.emplace_back(types.function_params.size());
+        types.function_param_counts.emplace_back(0);
+        types.function_return_types.emplace_back(std::numeric_limits<uint32_t>::max());
+
+        return type_index;
+    }
+
+    ParseResult<uint32_t> Parser::parse_type()
+    {
         switch (current_token.type)
         {
             case lang::token_i::U8:
@@ -529,30 +807,26 @@ namespace yu::compiler
             case lang::token_i::BOOLEAN:
             case lang::token_i::VOID:
             {
-                std::string_view name {
+                const uint32_t type_index = add_type(std::string_view {
                     source + tokens.starts[current],
                     tokens.lengths[current]
-                };
-                types.names.emplace_back(name);
-                types.generic_starts.emplace_back(0);
-                types.generic_counts.emplace_back(0);
+                });
                 advance();
                 return ParseResult(type_index);
             }
 
             case lang::token_i::PTR:
             {
-                std::string_view name {
+                const uint32_t type_index = add_type(std::string_view {
                     source + tokens.starts[current],
                     tokens.lengths[current]
-                };
-                types.names.emplace_back(name);
+                });
                 advance();
 
                 if (match(lang::token_i::LESS))
                 {
-                    const uint32_t generic_start = types.generic_params.size();
-                    uint32_t generic_count = 0;
+                    // nested arguments append their own parameters, so collect ours first
+                    std::vector<uint32_t> generic_args;
 
                     do
                     {
@@ -569,8 +843,7 @@ namespace yu::compiler
                             return ParseResult<uint32_t>::failure();
                         }
 
-                        types.generic_params.emplace_back(param_type_result.value);
-                        generic_count++;
+                        generic_args.emplace_back(param_type_result.value);
                     }
                     while (match(lang::token_i::COMMA));
 
@@ -586,13 +859,9 @@ namespace yu::compiler
                         return ParseResult<uint32_t>::failure();
                     }
 
-                    types.generic_starts.emplace_back(generic_start);
-                    types.generic_counts.emplace_back(generic_count);
-                }
-                else
-                {
-                    types.generic_starts.emplace_back(0);
-                    types.generic_counts.emplace_back(0);
+                    types.generic_starts[type_index] = types.generic_params.size();
+                    types.generic_counts[type_index] = generic_args.size();
+                    types.generic_params.insert(types.generic_params.end(), generic_args.begin(), generic_args.end());
                 }
 
                 return ParseResult(type_index);
@@ -605,15 +874,12 @@ namespace yu::compiler
                     tokens.lengths[current]
                 };
 
-                uint32_t symbol_index = lookup_symbol(name);
-                if (symbol_index != -1 &&
+                const uint32_t symbol_index = resolve_symbol(name);
+                if (symbol_index != no_symbol &&
                     (symbols.symbol_flags[symbol_index] & static_cast<uint8_t>(SymbolFlags::IS_GENERIC_PARAM)))
                 {
-                    types.names.emplace_back(name);
-                    types.generic_starts.emplace_back(0);
-                    types.generic_counts.emplace_back(0);
                     advance();
-                    return ParseResult(type_index);
+                    return ParseResult(symbols.type_indices[symbol_index]);
                 }
 
                 report_error(create_parse_error(
@@ -656,6 +922,13 @@ namespace yu::compiler
             case lang::token_i::RETURN:
                 return parse_return_statement();
 
+            case lang::token_i::WHILE:
+                return parse_while_statement();
+
+            case lang::token_i::BREAK:
+            case lang::token_i::CONTINUE:
+                return parse_jump_statement();
+
             default:
                 return parse_expression_statement();
         }
@@ -736,6 +1009,86 @@ namespace yu::compiler
         return ParseResult(if_index);
     }
 
+    ParseResult<uint32_t> Parser::parse_while_statement()
+    {
+        constexpr uint32_t while_index = std::numeric_limits<uint32_t>::max(); // TODO: track while statement
+
+        advance();
+        if (current_token.type != lang::token_i::LEFT_PAREN)
+        {
+            report_error(create_parse_error(
+                ParseErrorFlags::UNEXPECTED_TOKEN,
+                ErrorSeverity::ERROR,
+                "Expected '(' after 'while'",
+                "Open condition with '('",
+                current
+            ));
+            return ParseResult<uint32_t>::failure();
+        }
+        advance();
+
+        if (const auto condition_result = parse_expression();
+            !condition_result)
+        {
+            report_error(create_parse_error(
+                ParseErrorFlags::INVALID_SYNTAX,
+                ErrorSeverity::ERROR,
+                "Invalid condition expression",
+                "Provide a valid condition",
+                current
+            ));
+            return ParseResult<uint32_t>::failure();
+        }
+
+        if (current_token.type != lang::token_i::RIGHT_PAREN)
+        {
+            report_error(create_parse_error(
+                ParseErrorFlags::UNEXPECTED_TOKEN,
+                ErrorSeverity::ERROR,
+                "Expected ')' after condition",
+                "Close condition with ')'",
+                current
+            ));
+            return ParseResult<uint32_t>::failure();
+        }
+        advance();
+
+        if (const auto body = parse_statement();
+            !body)
+        {
+            report_error(create_parse_error(
+                ParseErrorFlags::INVALID_SYNTAX,
+                ErrorSeverity::ERROR,
+                "Invalid statement in 'while' body",
+                "Provide a valid statement",
+                current
+            ));
+            return ParseResult<uint32_t>::failure();
+        }
+
+        return ParseResult(while_index);
+    }
+
+    ParseResult<uint32_t> Parser::parse_jump_statement()
+    {
+        constexpr uint32_t jump_index = std::numeric_limits<uint32_t>::max(); // TODO: track break and continue
+
+        advance();
+        if (!match(lang::token_i::SEMICOLON))
+        {
+            report_error(create_parse_error(
+                ParseErrorFlags::UNEXPECTED_TOKEN,
+                ErrorSeverity::WARNING,
+                "Expected ';' after 'break' or 'continue'",
+                "End the statement with ';'",
+                current
+            ));
+            return ParseResult<uint32_t>::failure();
+        }
+
+        return ParseResult(jump_index);
+    }
+
     ParseResult<uint32_t> Parser::parse_block_statement()
     {
         constexpr uint32_t block_index = std::numeric_limits<uint32_t>::max(); // TODO: track block
@@ -794,10 +1147,10 @@ namespace yu::compiler
     }
 
 
-    ParseResult<uint32_t> Parser::parse_generic_params()
+    ParseResult<uint32_t> Parser::parse_generic_params(uint32_t &count)
     {
-        const uint32_t generic_start = types.generic_params.size();
-        uint32_t generic_count = 0;
+        // nested parameter lists append their own parameters, so collect ours first
+        std::vector<uint32_t> generic_params;
         auto has_variadic = false;
 
         if (current_token.type != lang::token_i::LESS)
@@ -848,23 +1201,27 @@ namespace yu::compiler
                 return ParseResult<uint32_t>::failure();
             }
 
-            uint32_t param_index = add_symbol(
-                std::string_view(source + tokens.starts[current], tokens.lengths[current]),
-                std::numeric_limits<uint32_t>::max(),
+            const std::string_view param_name(source + tokens.starts[current], tokens.lengths[current]);
+            const uint32_t param_type = add_type(param_name);
+            add_symbol(
+                param_name,
+                param_type,
                 static_cast<uint8_t>(SymbolFlags::IS_GENERIC_PARAM)
             );
 
-            types.generic_params.emplace_back(param_index);
-            generic_count++;
+            generic_params.emplace_back(param_type);
             advance();
 
             if (current_token.type == lang::token_i::LESS)
             {
-                if (const auto nested_result = parse_generic_params();
-                    !nested_result)
+                uint32_t nested_count = 0;
+                const auto nested_result = parse_generic_params(nested_count);
+                if (!nested_result)
                 {
                     return ParseResult<uint32_t>::failure();
                 }
+                types.generic_starts[param_type] = nested_result.value;
+                types.generic_counts[param_type] = nested_count;
             }
 
             if (current_token.type == lang::token_i::COMMA)
@@ -885,8 +1242,9 @@ namespace yu::compiler
         }
 
         advance();
-        types.generic_starts.emplace_back(generic_start);
-        types.generic_counts.emplace_back(generic_count);
+        const uint32_t generic_start = types.generic_params.size();
+        types.generic_params.insert(types.generic_params.end(), generic_params.begin(), generic_params.end());
+        count = generic_params.size();
 
         return ParseResult(generic_start);
     }
@@ -931,10 +1289,10 @@ namespace yu::compiler
         if (current_token.type == lang::token_i::MINUS ||
             current_token.type == lang::token_i::PLUS ||
             current_token.type == lang::token_i::AND ||
-            current_token.type == lang::token_i::TILDE)
+            current_token.type == lang::token_i::TILDE ||
+            current_token.type == lang::token_i::BANG)
         {
-            expressions.expr_types.emplace_back(static_cast<uint8_t>(current_token.type));
-            expressions.values.emplace_back(std::string_view {
+            add_expression(current_token.type, std::string_view {
                 source + tokens.starts[current],
                 tokens.lengths[current]
             });
@@ -945,18 +1303,17 @@ namespace yu::compiler
         {
             const uint32_t param_start = types.function_params.size();
             uint32_t param_count = 0;
-            uint32_t generic_start = std::numeric_limits<uint32_t>::max();
+            uint32_t generic_start = types.generic_params.size();
             uint32_t generic_count = 0;
 
             advance();
             if (current_token.type == lang::token_i::LESS)
             {
-                auto generic_result = parse_generic_params();
+                const auto generic_result = parse_generic_params(generic_count);
                 if (!generic_result)
                     return ParseResult<uint32_t>::failure();
 
                 generic_start = generic_result.value;
-                generic_count = types.generic_counts.back();
             }
 
             // parse param list
@@ -1111,22 +1468,12 @@ namespace yu::compiler
                 return ParseResult<uint32_t>::failure();
             }
 
-            const uint32_t function_type_index = types.names.size();
-            types.names.emplace_back("function");
-            types.function_param_starts.emplace_back(param_start);
-            types.function_param_counts.emplace_back(param_count);
-            types.function_return_types.emplace_back(return_type_result.value);
-
-            if (generic_start != std::numeric_limits<uint32_t>::max())
-            {
-                types.generic_starts.emplace_back(generic_start);
-                types.generic_counts.emplace_back(generic_count);
-            }
-            else
-            {
-                types.generic_starts.emplace_back(0);
-                types.generic_counts.emplace_back(0);
-            }
+            const uint32_t function_type_index = add_type("function");
+            types.function_param_starts[function_type_index] = param_start;
+            types.function_param_counts[function_type_index] = param_count;
+            types.function_return_types[function_type_index] = return_type_result.value;
+            types.generic_starts[function_type_index] = generic_start;
+            types.generic_counts[function_type_index] = generic_count;
 
             if (current_token.type != lang::token_i::LEFT_BRACE)
             {
@@ -1155,9 +1502,7 @@ namespace yu::compiler
             }
             advance();
 
-            expressions.expr_types.emplace_back(static_cast<uint8_t>(function_type_index));
-            expressions.values.emplace_back(std::string_view {});
-            return ParseResult(expr_index);
+            return ParseResult(add_expression(lang::token_i::FUNCTION, std::string_view {}, function_type_index));
         }
         if (current_token.type == lang::token_i::LEFT_PAREN)
         {
@@ -1199,8 +1544,7 @@ namespace yu::compiler
                 case lang::token_i::NIL:
                 case lang::token_i::STR_LITERAL:
                 {
-                    expressions.expr_types.emplace_back(static_cast<uint8_t>(current_token.type));
-                    expressions.values.emplace_back(std::string_view {
+                    add_expression(current_token.type, std::string_view {
                         source + tokens.starts[current],
                         tokens.lengths[current]
                     });
@@ -1209,12 +1553,43 @@ namespace yu::compiler
                 }
                 case lang::token_i::IDENTIFIER:
                 {
-                    expressions.expr_types.emplace_back(static_cast<uint8_t>(current_token.type));
-                    expressions.values.emplace_back(std::string_view {
+                    add_expression(current_token.type, std::string_view {
                         source + tokens.starts[current],
                         tokens.lengths[current]
                     });
                     advance();
+                    if (match(lang::token_i::LEFT_PAREN))
+                    {
+                        while (current_token.type != lang::token_i::RIGHT_PAREN)
+                        {
+                            if (const auto argument = parse_expression();
+                                !argument)
+                            {
+                                report_error(create_parse_error(
+                                    ParseErrorFlags::INVALID_SYNTAX,
+                                    ErrorSeverity::ERROR,
+                                    "Invalid call argument",
+                                    "Provide a valid expression as argument",
+                                    current
+                                ));
+                                return ParseResult<uint32_t>::failure();
+                            }
+                            if (!match(lang::token_i::COMMA))
+                                break;
+                        }
+
+                        if (!match(lang::token_i::RIGHT_PAREN))
+                        {
+                            report_error(create_parse_error(
+                                ParseErrorFlags::UNEXPECTED_TOKEN,
+                                ErrorSeverity::ERROR,
+                                "Expected ')' to close the argument list",
+                                "Close the argument list with ')'",
+                                current
+                            ));
+                            return ParseResult<uint32_t>::failure();
+                        }
+                    }
                     break;
                 }
                 default:
@@ -1239,15 +1614,24 @@ namespace yu::compiler
                current_token.type == lang::token_i::MINUS ||
                current_token.type == lang::token_i::AND || // bitwise
                current_token.type == lang::token_i::OR ||
-               current_token.type == lang::token_i::XOR)
+               current_token.type == lang::token_i::XOR ||
+               current_token.type == lang::token_i::LESS || // comparison and assignment
+               current_token.type == lang::token_i::GREATER ||
+               current_token.type == lang::token_i::EQUAL ||
+               (current_token.type == lang::token_i::BANG && tokens.types[current + 1] == lang::token_i::EQUAL))
         {
-            expressions.expr_types.emplace_back(static_cast<uint8_t>(current_token.type));
-            expressions.values.emplace_back(std::string_view {
+            add_expression(current_token.type, std::string_view {
                 source + tokens.starts[current],
                 tokens.lengths[current]
             });
+            const lang::token_i first = current_token.type;
             advance();
 
+            // two-character operators are lexed as two tokens: == != <= >= && || and compound assignments
+            if (current_token.type == lang::token_i::EQUAL ||
+                ((first == lang::token_i::AND || first == lang::token_i::OR) && current_token.type == first))
+                advance();
+
             if (const auto right_operand_result = parse_expression();
                 !right_operand_result)
             {
@@ -1265,6 +1649,17 @@ namespace yu::compiler
         return ParseResult(expr_index);
     }
 
+    uint32_t Parser::add_expression(const lang::token_i type, const std::string_view value, const uint32_t type_index)
+    {
+        const uint32_t expr_index = expressions.expr_types.size();
+
+        expressions.expr_types.emplace_back(static_cast<uint8_t>(type));
+        expressions.values.emplace_back(value);
+        expressions.type_indices.emplace_back(type_index);
+
+        return expr_index;
+    }
+
     std::string Parser::get_source_line(const uint32_t line_number) const
     {
         uint32_t current_line = 1;
@@ -1321,7 +1716,7 @@ namespace yu::compiler
 
     void Parser::report_error(const ParseError &error)
     {
-        if (error.severity >= ErrorSeverity::WARNING)
+        if (emit_diagnostics && error.severity >= ErrorSeverity::WARNING)
         {
             const auto &color = error.severity == ErrorSeverity::WARNING
                                     ? styles::color::YELLOW
@@ -1365,6 +1760,7 @@ namespace yu::compiler
                 break;
 
             case ErrorSeverity::ERROR:
+                errors.emplace_back(error);
                 synchronize();
                 break;
 
@@ -1385,6 +1781,8 @@ namespace yu::compiler
                 return "E0002";
             case ParseErrorFlags::UNRESOLVED_SYMBOL:
                 return "E0433";
+            case ParseErrorFlags::UNRESOLVED_IMPORT:
+                return "E0432";
             default:
                 return "E0000";
         }
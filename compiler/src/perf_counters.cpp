@@ -0,0 +1,167 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/perf_counters.h"
+#include "../../common/arch.hpp"
+
+#if defined(YUMINA_OS_LINUX)
+    #include <cerrno>
+    #include <cstring>
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace yu::compiler
+{
+    const char *perf_counter_name(const PerfCounter counter)
+    {
+        switch (counter)
+        {
+            case PerfCounter::CYCLES:
+                return "cycles";
+            case PerfCounter::INSTRUCTIONS:
+                return "instructions";
+            case PerfCounter::BRANCH_MISSES:
+                return "branch-misses";
+            case PerfCounter::L1D_MISSES:
+                return "l1d-misses";
+            case PerfCounter::LLC_MISSES:
+                return "llc-misses";
+            default:
+                return "unknown";
+        }
+    }
+
+#if defined(YUMINA_OS_LINUX)
+    namespace
+    {
+        perf_event_attr counter_attributes(const PerfCounter counter)
+        {
+            perf_event_attr attributes;
+            std::memset(&attributes, 0, sizeof(attributes));
+            attributes.size = sizeof(attributes);
+            attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+
+            constexpr uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D
+                                               | PERF_COUNT_HW_CACHE_OP_READ << 8
+                                               | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+            switch (counter)
+            {
+                case PerfCounter::CYCLES:
+                    attributes.type = PERF_TYPE_HARDWARE;
+                    attributes.config = PERF_COUNT_HW_CPU_CYCLES;
+                    break;
+                case PerfCounter::INSTRUCTIONS:
+                    attributes.type = PERF_TYPE_HARDWARE;
+                    attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+                    break;
+                case PerfCounter::BRANCH_MISSES:
+                    attributes.type = PERF_TYPE_HARDWARE;
+                    attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+                    break;
+                case PerfCounter::L1D_MISSES:
+                    attributes.type = PERF_TYPE_HW_CACHE;
+                    attributes.config = l1d_read_miss;
+                    break;
+                default:
+                    attributes.type = PERF_TYPE_HARDWARE;
+                    attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+                    break;
+            }
+            return attributes;
+        }
+    }
+
+    PerfCounters::PerfCounters()
+    {
+        fds.fill(-1);
+        for (uint32_t i = 0; i < perf_counter_count; ++i)
+        {
+            perf_event_attr attributes = counter_attributes(static_cast<PerfCounter>(i));
+            // the group starts disabled and is switched on at once, so all members count the same code
+            attributes.disabled = leader < 0;
+            const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, leader, 0));
+            if (fd < 0)
+            {
+                if (open_error.empty())
+                    open_error = std::string("perf_event_open: ") + std::strerror(errno);
+                continue;
+            }
+
+            if (leader < 0)
+                leader = fd;
+            fds[i] = fd;
+            slots[i] = static_cast<uint8_t>(opened_count++);
+            opened_mask |= 1u << i;
+        }
+
+        if (leader >= 0)
+        {
+            open_error.clear();
+            ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    PerfCounters::~PerfCounters()
+    {
+        // members first, the leader last
+        for (uint32_t i = perf_counter_count; i-- > 0;)
+        {
+            if (fds[i] >= 0 && fds[i] != leader)
+                close(fds[i]);
+        }
+        if (leader >= 0)
+            close(leader);
+    }
+
+    bool PerfCounters::read(PerfCounterValues &values, bool *multiplexed) const
+    {
+        values.fill(0);
+        if (multiplexed)
+            *multiplexed = false;
+        if (leader < 0)
+            return false;
+
+        // PERF_FORMAT_GROUP with both times: the member count, the time the group was enabled and
+        // the time it was counting, then one value per member in opening order
+        uint64_t buffer[3 + perf_counter_count];
+        const auto size = static_cast<ssize_t>(sizeof(uint64_t) * (3 + opened_count));
+        if (::read(leader, buffer, static_cast<size_t>(size)) != size)
+            return false;
+
+        const uint64_t enabled = buffer[1], running = buffer[2];
+        const bool scaled = running < enabled;
+        const double scale = running ? static_cast<double>(enabled) / static_cast<double>(running) : 0;
+        for (uint32_t i = 0; i < perf_counter_count; ++i)
+        {
+            if (!(opened_mask & 1u << i))
+                continue;
+            const uint64_t count = buffer[3 + slots[i]];
+            values[i] = scaled ? static_cast<uint64_t>(static_cast<double>(count) * scale) : count;
+        }
+        if (multiplexed)
+            *multiplexed = scaled;
+        return true;
+    }
+#else
+    PerfCounters::PerfCounters() : open_error("Hardware counters are only supported on Linux")
+    {
+        fds.fill(-1);
+    }
+
+    PerfCounters::~PerfCounters() = default;
+
+    bool PerfCounters::read(PerfCounterValues &values, bool *multiplexed) const
+    {
+        values.fill(0);
+        if (multiplexed)
+            *multiplexed = false;
+        return false;
+    }
+#endif
+}
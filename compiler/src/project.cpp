@@ -0,0 +1,112 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/project.h"
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+namespace yu::compiler
+{
+    namespace
+    {
+        std::string_view trim(std::string_view line)
+        {
+            constexpr std::string_view whitespace = " \t\r";
+            const size_t begin = line.find_first_not_of(whitespace);
+            if (begin == std::string_view::npos)
+                return {};
+            return line.substr(begin, line.find_last_not_of(whitespace) - begin + 1);
+        }
+    }
+
+    void Project::add_file(const std::filesystem::path &path)
+    {
+        std::error_code error;
+        const uint64_t size = std::filesystem::file_size(path, error);
+        add_source(path, error ? 0 : size);
+    }
+
+    void Project::add(const std::filesystem::path &path)
+    {
+        std::error_code error;
+        const auto status = std::filesystem::status(path, error);
+        if (error || !std::filesystem::exists(status))
+            throw std::runtime_error("Project not found: " + path.string());
+
+        if (!std::filesystem::is_directory(status))
+            add_manifest(path);
+        else if (const auto manifest = path / manifest_name; std::filesystem::is_regular_file(manifest, error))
+            add_manifest(manifest);
+        else
+            add_directory(path);
+    }
+
+    std::vector<uint32_t> Project::schedule() const
+    {
+        std::vector<uint32_t> order(sources.size());
+        std::iota(order.begin(), order.end(), 0);
+        // lexing and parsing are linear in the input, so the size is the cost estimate
+        std::ranges::stable_sort(order, [this](const uint32_t a, const uint32_t b)
+        {
+            return sources[a].size > sources[b].size;
+        });
+        return order;
+    }
+
+    void Project::add_directory(const std::filesystem::path &directory)
+    {
+        // the extension is checked first, so only source files cost a stat for their size
+        std::vector<std::pair<std::filesystem::path, uint64_t>> found;
+        for (const auto &entry: std::filesystem::recursive_directory_iterator(
+                 directory, std::filesystem::directory_options::skip_permission_denied))
+        {
+            std::error_code error;
+            if (entry.path().extension() != source_extension || !entry.is_regular_file(error))
+                continue;
+            const uint64_t size = entry.file_size(error);
+            found.emplace_back(entry.path(), error ? 0 : size);
+        }
+
+        // directory order is unspecified; keep reports stable across runs and machines
+        std::ranges::sort(found);
+        for (const auto &[path, size]: found)
+            add_source(path, size);
+    }
+
+    void Project::add_manifest(const std::filesystem::path &manifest)
+    {
+        // manifests naming each other's directories are read once each
+        if (!manifests.insert(manifest.lexically_normal().string()).second)
+            return;
+        std::ifstream file(manifest);
+        if (!file.is_open())
+            throw std::runtime_error("Could not open manifest: " + manifest.string());
+
+        const auto base = manifest.parent_path();
+        std::string line;
+        while (std::getline(file, line))
+        {
+            const std::string_view entry = trim(line);
+            if (entry.empty() || entry.front() == '#')
+                continue;
+
+            const auto path = base / std::filesystem::path(entry);
+            std::error_code error;
+            if (!std::filesystem::is_directory(path, error))
+                add_file(path);
+            else if (const auto nested = path / manifest_name; std::filesystem::is_regular_file(nested, error))
+                add_manifest(nested);
+            else
+                add_directory(path);
+        }
+    }
+
+    void Project::add_source(const std::filesystem::path &path, const uint64_t size)
+    {
+        if (!seen.insert(path.lexically_normal().string()).second)
+            return;
+        sources.push_back({ path.lexically_normal().string(), size });
+    }
+}
@@ -0,0 +1,171 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/thread_pool.h"
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include "../include/trace.h"
+
+namespace yu::compiler
+{
+    namespace
+    {
+        thread_local const ThreadPool *current_pool = nullptr;
+        thread_local uint32_t current_worker = std::numeric_limits<uint32_t>::max();
+    }
+
+    ThreadPool::ThreadPool(uint32_t thread_count)
+    {
+        if (thread_count == 0)
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+        workers.reserve(thread_count);
+        for (uint32_t i = 0; i < thread_count; ++i)
+            workers.emplace_back(std::make_unique<Worker>());
+
+        threads.reserve(thread_count);
+        for (uint32_t i = 0; i < thread_count; ++i)
+            threads.emplace_back([this, i] { run(i); });
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard lock(state_mutex);
+            stopping = true;
+        }
+        work_available.notify_all();
+
+        for (auto &thread: threads)
+            thread.join();
+    }
+
+    uint32_t ThreadPool::worker_index()
+    {
+        return current_worker;
+    }
+
+    void ThreadPool::submit(std::function<void()> task)
+    {
+        const bool nested = current_pool == this;
+        const uint32_t target = nested ? current_worker
+                                       : next_worker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+        {
+            std::lock_guard lock(workers[target]->mutex);
+            (nested ? workers[target]->nested : workers[target]->tasks).emplace_back(std::move(task));
+        }
+
+        // counted only once it is in a deque, so a worker that reserves it always finds it
+        pending.fetch_add(1);
+        const uint32_t depth = queued.fetch_add(1) + 1;
+        if (sleeping.load() > 0)
+        {
+            // a worker that saw nothing queued is now waiting, or sees this task before it waits
+            std::lock_guard lock(state_mutex);
+            work_available.notify_one();
+        }
+
+        if (Tracer::enabled())
+            Tracer::counter("queue depth", depth);
+    }
+
+    void ThreadPool::wait()
+    {
+        std::unique_lock lock(state_mutex);
+        all_done.wait(lock, [this] { return pending.load() == 0; });
+
+        if (failure)
+            std::rethrow_exception(std::exchange(failure, nullptr));
+    }
+
+    bool ThreadPool::reserve()
+    {
+        uint32_t count = queued.load();
+        while (count > 0 && !queued.compare_exchange_weak(count, count - 1))
+        {
+        }
+        return count > 0;
+    }
+
+    bool ThreadPool::take(const uint32_t index, std::function<void()> &task)
+    {
+        {
+            Worker &own = *workers[index];
+            std::lock_guard lock(own.mutex);
+            if (!own.nested.empty())
+            {
+                task = std::move(own.nested.back());
+                own.nested.pop_back();
+                return true;
+            }
+            if (!own.tasks.empty())
+            {
+                task = std::move(own.tasks.front());
+                own.tasks.pop_front();
+                return true;
+            }
+        }
+
+        for (uint32_t i = 1; i < workers.size(); ++i)
+        {
+            Worker &victim = *workers[(index + i) % workers.size()];
+            std::lock_guard lock(victim.mutex);
+            for (auto *const deque: { &victim.tasks, &victim.nested })
+            {
+                if (!deque->empty())
+                {
+                    task = std::move(deque->front());
+                    deque->pop_front();
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void ThreadPool::run(const uint32_t index)
+    {
+        current_pool = this;
+        current_worker = index;
+
+        while (true)
+        {
+            if (!reserve())
+            {
+                std::unique_lock lock(state_mutex);
+                sleeping.fetch_add(1);
+                work_available.wait(lock, [this] { return queued.load() > 0 || stopping; });
+                sleeping.fetch_sub(1);
+                if (queued.load() == 0)
+                    return;
+                continue;
+            }
+
+            if (Tracer::enabled())
+                Tracer::counter("queue depth", queued.load(std::memory_order_relaxed));
+
+            // the reservation above guarantees a task is sitting in some deque
+            std::function<void()> task;
+            while (!take(index, task))
+                std::this_thread::yield();
+
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                std::lock_guard lock(state_mutex);
+                if (!failure)
+                    failure = std::current_exception();
+            }
+
+            if (pending.fetch_sub(1) == 1)
+            {
+                std::lock_guard lock(state_mutex);
+                all_done.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,373 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/timer.h"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include "../include/trace.h"
+
+namespace yu::compiler
+{
+    namespace
+    {
+        constexpr uint32_t no_node = std::numeric_limits<uint32_t>::max();
+        constexpr uint64_t no_trace = std::numeric_limits<uint64_t>::max();
+
+        struct Node
+        {
+            uint32_t parent;
+            const char *name;
+        };
+
+        struct NodeStats
+        {
+            uint64_t calls = 0;
+            uint64_t samples = 0;
+            uint64_t total_ns = 0;
+            uint64_t min_ns = std::numeric_limits<uint64_t>::max();
+            uint64_t max_ns = 0;
+            uint64_t bytes = 0;
+            uint64_t tokens = 0;
+            uint64_t declarations = 0;
+            PerfCounterValues counters {};
+            uint32_t counter_mask = 0;
+            bool counters_multiplexed = false;
+            bool memory_tracked = false;
+            int64_t peak_bytes = 0;
+            int64_t retained_bytes = 0;
+            uint64_t allocated_bytes = 0;
+            uint64_t allocations = 0;
+
+            // what the current outermost scope has spent so far
+            uint64_t pending_ns = 0;
+            bool touched = false;
+        };
+
+        struct ChildLink
+        {
+            uint32_t parent;
+            const char *name;
+            uint32_t node;
+        };
+
+        /**
+         * @brief Timings of one thread; only that thread writes them.
+         */
+        struct ThreadTimings
+        {
+            std::vector<NodeStats> stats;
+            std::vector<uint32_t> open;    // stack of open scopes
+            std::vector<uint32_t> touched; // nodes with pending time
+            std::vector<ChildLink> links;  // node lookups already resolved by this thread
+            std::unique_ptr<PerfCounters> counters;
+        };
+
+        struct Registry
+        {
+            std::atomic<bool> enabled = false;
+            std::atomic<bool> counters_enabled = false;
+            std::atomic<bool> memory_enabled = false;
+            std::mutex mutex;
+            std::vector<Node> nodes;
+            std::vector<std::unique_ptr<ThreadTimings>> threads; // kept after their thread exits
+            std::string counters_error;
+        };
+
+        Registry &registry()
+        {
+            static Registry instance;
+            return instance;
+        }
+
+        ThreadTimings &thread_timings()
+        {
+            thread_local ThreadTimings *timings = nullptr;
+            if (!timings)
+            {
+                auto &reg = registry();
+                std::lock_guard lock(reg.mutex);
+                timings = reg.threads.emplace_back(std::make_unique<ThreadTimings>()).get();
+            }
+            return *timings;
+        }
+
+        uint32_t find_node(ThreadTimings &timings, const uint32_t parent, const char *name)
+        {
+            for (const auto &link: timings.links)
+            {
+                if (link.parent == parent && link.name == name)
+                    return link.node;
+            }
+
+            // names are compared by content here, so the same phase from two translation units
+            // still ends up in one node
+            auto &reg = registry();
+            uint32_t node = no_node;
+            {
+                std::lock_guard lock(reg.mutex);
+                for (uint32_t i = 0; i < reg.nodes.size(); ++i)
+                {
+                    if (reg.nodes[i].parent == parent && std::string_view(reg.nodes[i].name) == name)
+                    {
+                        node = i;
+                        break;
+                    }
+                }
+                if (node == no_node)
+                {
+                    node = static_cast<uint32_t>(reg.nodes.size());
+                    reg.nodes.push_back({ parent, name });
+                }
+            }
+
+            timings.links.push_back({ parent, name, node });
+            if (timings.stats.size() <= node)
+                timings.stats.resize(node + 1);
+            return node;
+        }
+
+        const PerfCounters &thread_counters(ThreadTimings &timings)
+        {
+            if (!timings.counters)
+            {
+                timings.counters = std::make_unique<PerfCounters>();
+                if (!timings.counters->mask())
+                {
+                    auto &reg = registry();
+                    std::lock_guard lock(reg.mutex);
+                    if (reg.counters_error.empty())
+                        reg.counters_error = timings.counters->error();
+                }
+            }
+            return *timings.counters;
+        }
+
+        NodeStats &touch(ThreadTimings &timings, const uint32_t node)
+        {
+            NodeStats &stats = timings.stats[node];
+            if (!stats.touched)
+            {
+                stats.touched = true;
+                timings.touched.push_back(node);
+            }
+            return stats;
+        }
+
+        void close_sample(ThreadTimings &timings)
+        {
+            for (const uint32_t node: timings.touched)
+            {
+                NodeStats &stats = timings.stats[node];
+                ++stats.samples;
+                stats.total_ns += stats.pending_ns;
+                stats.min_ns = std::min(stats.min_ns, stats.pending_ns);
+                stats.max_ns = std::max(stats.max_ns, stats.pending_ns);
+                stats.pending_ns = 0;
+                stats.touched = false;
+            }
+            timings.touched.clear();
+        }
+    }
+
+    Timer::Timer(const char *phase, const std::string_view detail) : phase(phase)
+                                                                    , detail(detail)
+                                                                    , node(no_node)
+                                                                    , trace_start(no_trace)
+    {
+        if (Tracer::enabled())
+            trace_start = Tracer::now_ns();
+        if (!registry().enabled.load(std::memory_order_relaxed))
+            return;
+
+        ThreadTimings &timings = thread_timings();
+        node = find_node(timings, timings.open.empty() ? no_node : timings.open.back(), phase);
+        timings.open.push_back(node);
+        if (registry().counters_enabled.load(std::memory_order_relaxed))
+            counting = thread_counters(timings).read(start_counters, &start_multiplexed);
+        if (registry().memory_enabled.load(std::memory_order_relaxed))
+        {
+            // the scope's peak is measured from its entry; record() hands the outer peak back
+            MemoryCounters &memory = thread_memory();
+            start_memory = memory;
+            memory.peak = memory.live;
+            measuring_memory = true;
+        }
+        start_time = clock::now();
+    }
+
+    Timer::~Timer()
+    {
+        if (node != no_node)
+            record();
+        if (trace_start != no_trace)
+            Tracer::span(phase, trace_start, detail);
+    }
+
+    void Timer::record() const
+    {
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start_time);
+        ThreadTimings &timings = thread_timings();
+        NodeStats &stats = touch(timings, node);
+        ++stats.calls;
+        stats.pending_ns += static_cast<uint64_t>(elapsed.count());
+
+        PerfCounterValues end_counters;
+        if (bool multiplexed; counting && timings.counters->read(end_counters, &multiplexed))
+        {
+            // scaled counts are estimates and may even run backwards
+            for (uint32_t i = 0; i < perf_counter_count; ++i)
+                stats.counters[i] += std::max(end_counters[i], start_counters[i]) - start_counters[i];
+            stats.counter_mask |= timings.counters->mask();
+            stats.counters_multiplexed |= multiplexed || start_multiplexed;
+        }
+
+        if (measuring_memory)
+        {
+            MemoryCounters &memory = thread_memory();
+            stats.memory_tracked = true;
+            stats.peak_bytes = std::max(stats.peak_bytes, memory.peak - start_memory.live);
+            stats.retained_bytes += memory.live - start_memory.live;
+            stats.allocated_bytes += memory.allocated - start_memory.allocated;
+            stats.allocations += memory.allocations - start_memory.allocations;
+            memory.peak = std::max(memory.peak, start_memory.peak);
+        }
+
+        timings.open.pop_back();
+        if (timings.open.empty())
+            close_sample(timings);
+    }
+
+    void Timer::add_bytes(const uint64_t count) const
+    {
+        if (node != no_node)
+            thread_timings().stats[node].bytes += count;
+    }
+
+    void Timer::add_tokens(const uint64_t count) const
+    {
+        if (node != no_node)
+            thread_timings().stats[node].tokens += count;
+    }
+
+    void Timer::add_declarations(const uint64_t count) const
+    {
+        if (node != no_node)
+            thread_timings().stats[node].declarations += count;
+    }
+
+    void Timer::set_enabled(const bool enabled)
+    {
+        registry().enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool Timer::enabled()
+    {
+        return registry().enabled.load(std::memory_order_relaxed);
+    }
+
+    void Timer::set_counters_enabled(const bool enabled)
+    {
+        registry().counters_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void Timer::set_memory_enabled(const bool enabled)
+    {
+        registry().memory_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool Timer::memory_enabled()
+    {
+        return registry().memory_enabled.load(std::memory_order_relaxed);
+    }
+
+    std::string Timer::counters_error()
+    {
+        auto &reg = registry();
+        std::lock_guard lock(reg.mutex);
+        return reg.counters_error;
+    }
+
+    std::vector<PhaseStats> Timer::collect()
+    {
+        auto &reg = registry();
+        std::lock_guard lock(reg.mutex);
+
+        std::vector<PhaseStats> merged(reg.nodes.size());
+        for (const auto &timings: reg.threads)
+        {
+            for (uint32_t i = 0; i < timings->stats.size(); ++i)
+            {
+                const NodeStats &stats = timings->stats[i];
+                if (!stats.samples)
+                    continue;
+
+                PhaseStats &phase = merged[i];
+                phase.min_ns = phase.samples ? std::min(phase.min_ns, stats.min_ns) : stats.min_ns;
+                phase.max_ns = std::max(phase.max_ns, stats.max_ns);
+                phase.calls += stats.calls;
+                phase.samples += stats.samples;
+                phase.total_ns += stats.total_ns;
+                phase.bytes += stats.bytes;
+                phase.tokens += stats.tokens;
+                for (uint32_t counter = 0; counter < perf_counter_count; ++counter)
+                    phase.counters[counter] += stats.counters[counter];
+                phase.counter_mask |= stats.counter_mask;
+                phase.counters_multiplexed |= stats.counters_multiplexed;
+                phase.declarations += stats.declarations;
+                phase.memory_tracked |= stats.memory_tracked;
+                phase.peak_bytes = std::max(phase.peak_bytes, stats.peak_bytes);
+                phase.retained_bytes += stats.retained_bytes;
+                phase.allocated_bytes += stats.allocated_bytes;
+                phase.allocations += stats.allocations;
+            }
+        }
+
+        // depth-first, siblings in the order they were first entered
+        std::vector<PhaseStats> result;
+        std::vector<std::pair<uint32_t, uint32_t>> stack; // node, depth
+        for (uint32_t i = static_cast<uint32_t>(reg.nodes.size()); i-- > 0;)
+        {
+            if (reg.nodes[i].parent == no_node)
+                stack.emplace_back(i, 0);
+        }
+
+        std::vector<std::string> paths(reg.nodes.size());
+        while (!stack.empty())
+        {
+            const auto [node, depth] = stack.back();
+            stack.pop_back();
+
+            const uint32_t parent = reg.nodes[node].parent;
+            paths[node] = parent == no_node ? reg.nodes[node].name : paths[parent] + '/' + reg.nodes[node].name;
+            if (merged[node].samples)
+            {
+                PhaseStats &phase = result.emplace_back(std::move(merged[node]));
+                phase.name = reg.nodes[node].name;
+                phase.path = paths[node];
+                phase.depth = depth;
+            }
+
+            for (uint32_t i = static_cast<uint32_t>(reg.nodes.size()); i-- > node + 1;)
+            {
+                if (reg.nodes[i].parent == node)
+                    stack.emplace_back(i, depth + 1);
+            }
+        }
+        return result;
+    }
+
+    void Timer::reset()
+    {
+        auto &reg = registry();
+        std::lock_guard lock(reg.mutex);
+        for (const auto &timings: reg.threads)
+        {
+            std::ranges::fill(timings->stats, NodeStats {});
+            timings->touched.clear();
+        }
+    }
+}
@@ -0,0 +1,123 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/trace.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include "../include/thread_pool.h"
+
+namespace yu::compiler
+{
+    namespace
+    {
+        using clock = std::chrono::steady_clock;
+
+        struct ThreadTrace
+        {
+            uint32_t id;
+            std::string name;
+            std::deque<TraceEvent> events; // grows in blocks, never moves what was recorded
+            std::pmr::monotonic_buffer_resource details; // the events' detail text
+        };
+
+        struct Registry
+        {
+            std::atomic<bool> enabled = false;
+            std::atomic<clock::rep> origin = 0;
+            std::mutex mutex;
+            std::vector<std::unique_ptr<ThreadTrace>> threads; // kept after their thread exits
+        };
+
+        Registry &registry()
+        {
+            static Registry instance;
+            return instance;
+        }
+
+        ThreadTrace &thread_trace()
+        {
+            thread_local ThreadTrace *trace = nullptr;
+            if (!trace)
+            {
+                auto &reg = registry();
+                std::lock_guard lock(reg.mutex);
+                auto &created = reg.threads.emplace_back(std::make_unique<ThreadTrace>());
+                created->id = static_cast<uint32_t>(reg.threads.size());
+                const uint32_t worker = ThreadPool::worker_index();
+                created->name = worker == std::numeric_limits<uint32_t>::max()
+                                    ? "thread " + std::to_string(created->id)
+                                    : "worker " + std::to_string(worker);
+                trace = created.get();
+            }
+            return *trace;
+        }
+    }
+
+    void Tracer::set_enabled(const bool enabled)
+    {
+        auto &reg = registry();
+        if (enabled)
+            reg.origin.store(clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        reg.enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool Tracer::enabled()
+    {
+        return registry().enabled.load(std::memory_order_relaxed);
+    }
+
+    uint64_t Tracer::now_ns()
+    {
+        const clock::duration since_origin(clock::now().time_since_epoch().count()
+                                           - registry().origin.load(std::memory_order_relaxed));
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(since_origin).count());
+    }
+
+    void Tracer::span(const char *name, const uint64_t start_ns, const std::string_view detail)
+    {
+        const uint64_t end_ns = now_ns();
+        ThreadTrace &trace = thread_trace();
+        std::string_view copy;
+        if (!detail.empty())
+        {
+            auto *text = static_cast<char *>(trace.details.allocate(detail.size(), 1));
+            std::memcpy(text, detail.data(), detail.size());
+            copy = { text, detail.size() };
+        }
+        trace.events.push_back({ TraceEventType::SPAN, name, start_ns, end_ns - start_ns, 0, copy });
+    }
+
+    void Tracer::counter(const char *name, const int64_t value)
+    {
+        thread_trace().events.push_back({ TraceEventType::COUNTER, name, now_ns(), 0, value, {} });
+    }
+
+    std::vector<TraceThread> Tracer::collect()
+    {
+        auto &reg = registry();
+        std::lock_guard lock(reg.mutex);
+
+        std::vector<TraceThread> result;
+        result.reserve(reg.threads.size());
+        for (const auto &trace: reg.threads)
+            result.push_back({ trace->id, trace->name, { trace->events.begin(), trace->events.end() } });
+        return result;
+    }
+
+    void Tracer::reset()
+    {
+        auto &reg = registry();
+        std::lock_guard lock(reg.mutex);
+        for (const auto &trace: reg.threads)
+        {
+            trace->events.clear();
+            trace->details.release();
+        }
+    }
+}
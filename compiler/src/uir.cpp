@@ -0,0 +1,590 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/uir.h"
+#include <algorithm>
+#include "../include/interner.h"
+#include "../include/memory.h"
+
+namespace yu::uir
+{
+    namespace
+    {
+        /**
+         * @brief Upstream of the function arenas, counted like the front-end's columns.
+         */
+        class CountingResource final : public std::pmr::memory_resource
+        {
+            void *do_allocate(const size_t bytes, const size_t alignment) override
+            {
+                if constexpr (!compiler::global_new_tracked)
+                    compiler::count_allocation(bytes);
+                return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+            }
+
+            void do_deallocate(void *pointer, const size_t bytes, const size_t alignment) override
+            {
+                if constexpr (!compiler::global_new_tracked)
+                    compiler::count_deallocation(bytes);
+                std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+            }
+
+            [[nodiscard]] bool do_is_equal(const memory_resource &other) const noexcept override
+            {
+                return this == &other;
+            }
+        };
+
+        std::pmr::memory_resource *arena_upstream()
+        {
+            static CountingResource resource;
+            return &resource;
+        }
+
+        constexpr std::string_view primitive_names[primitive_type_count] = {
+            "void", "bool", "i8", "u8", "i16", "u16", "i32", "u32", "i64", "u64", "f32", "f64", "ptr", "mem"
+        };
+
+        constexpr uint8_t ARITHMETIC = 0;
+        constexpr uint8_t COMMUTATIVE_ARITHMETIC = COMMUTATIVE;
+        constexpr uint8_t STORE_LIKE = SIDE_EFFECTS | READS_MEMORY;
+    }
+
+    const OpcodeInfo opcode_info[static_cast<size_t>(Opcode::COUNT)] = {
+        { "nop", NO_RESULT },
+        { "param", 0 },
+        { "const", 0 },
+        { "undef", 0 },
+        { "func_entry", 0 },
+        { "add", COMMUTATIVE_ARITHMETIC },
+        { "sub", ARITHMETIC },
+        { "mul", COMMUTATIVE_ARITHMETIC },
+        { "div", ARITHMETIC },
+        { "mod", ARITHMETIC },
+        { "neg", ARITHMETIC },
+        { "fadd", COMMUTATIVE_ARITHMETIC },
+        { "fsub", ARITHMETIC },
+        { "fmul", COMMUTATIVE_ARITHMETIC },
+        { "fdiv", ARITHMETIC },
+        { "and", COMMUTATIVE_ARITHMETIC },
+        { "or", COMMUTATIVE_ARITHMETIC },
+        { "xor", COMMUTATIVE_ARITHMETIC },
+        { "not", ARITHMETIC },
+        { "shl", ARITHMETIC },
+        { "shr", ARITHMETIC },
+        { "sar", ARITHMETIC },
+        { "cmp.eq", COMMUTATIVE_ARITHMETIC },
+        { "cmp.ne", COMMUTATIVE_ARITHMETIC },
+        { "cmp.lt", ARITHMETIC },
+        { "cmp.le", ARITHMETIC },
+        { "cmp.gt", ARITHMETIC },
+        { "cmp.ge", ARITHMETIC },
+        { "fcmp.eq", COMMUTATIVE_ARITHMETIC },
+        { "fcmp.ne", COMMUTATIVE_ARITHMETIC },
+        { "fcmp.lt", ARITHMETIC },
+        { "fcmp.le", ARITHMETIC },
+        { "fcmp.gt", ARITHMETIC },
+        { "fcmp.ge", ARITHMETIC },
+        { "zext", ARITHMETIC },
+        { "sext", ARITHMETIC },
+        { "trunc", ARITHMETIC },
+        { "bitcast", ARITHMETIC },
+        { "inttoptr", ARITHMETIC },
+        { "ptrtoint", ARITHMETIC },
+        { "alloc", SIDE_EFFECTS },
+        { "load", READS_MEMORY },
+        { "store", STORE_LIKE },
+        { "barrier", STORE_LIKE },
+        { "barrier.acq", STORE_LIKE },
+        { "barrier.rel", STORE_LIKE },
+        { "atomic.load", STORE_LIKE },
+        { "atomic.store", STORE_LIKE | NO_RESULT },
+        { "cmpxchg", STORE_LIKE },
+        { "atomic.add", STORE_LIKE },
+        { "atomic.sub", STORE_LIKE },
+        { "atomic.and", STORE_LIKE },
+        { "atomic.or", STORE_LIKE },
+        { "atomic.xor", STORE_LIKE },
+        { "phi", 0 },
+        { "call", STORE_LIKE },
+        { "call", STORE_LIKE },
+        { "intrinsic", STORE_LIKE },
+        { "jump", TERMINATOR | SIDE_EFFECTS | NO_RESULT },
+        { "branch", TERMINATOR | SIDE_EFFECTS | NO_RESULT },
+        { "switch", TERMINATOR | SIDE_EFFECTS | NO_RESULT },
+        { "ret", TERMINATOR | SIDE_EFFECTS | NO_RESULT },
+        { "unreachable", TERMINATOR | SIDE_EFFECTS | NO_RESULT },
+    };
+
+    TypeTable::TypeTable()
+    {
+        for (uint32_t kind = 0; kind < primitive_type_count; ++kind)
+            add(static_cast<TypeKind>(kind), primitive(TypeKind::VOID), 0, {});
+    }
+
+    TypeId TypeTable::add(const TypeKind kind, const TypeId element, const uint32_t count,
+                          const std::span<const TypeId> fields)
+    {
+        std::string key;
+        key += static_cast<char>(kind);
+        for (const uint32_t part: { element, count })
+            key.append(reinterpret_cast<const char *>(&part), sizeof(part));
+        key.append(reinterpret_cast<const char *>(fields.data()), fields.size_bytes());
+
+        const auto [it, added] = interned.try_emplace(std::move(key), size());
+        if (added)
+        {
+            kinds.push_back(kind);
+            elements.push_back(element);
+            counts.push_back(count);
+            field_starts.push_back(static_cast<uint32_t>(field_list.size()));
+            field_counts.push_back(static_cast<uint32_t>(fields.size()));
+            field_list.insert(field_list.end(), fields.begin(), fields.end());
+        }
+        return it->second;
+    }
+
+    TypeId TypeTable::pointer_to(const TypeId element)
+    {
+        return add(TypeKind::PTR, element, 0, {});
+    }
+
+    TypeId TypeTable::array_of(const TypeId element, const uint32_t count)
+    {
+        return add(TypeKind::ARRAY, element, count, {});
+    }
+
+    TypeId TypeTable::vector_of(const TypeId element, const uint32_t count)
+    {
+        return add(TypeKind::VECTOR, element, count, {});
+    }
+
+    TypeId TypeTable::structure(const std::span<const TypeId> fields)
+    {
+        return add(TypeKind::STRUCT, primitive(TypeKind::VOID), 0, fields);
+    }
+
+    bool TypeTable::is_integer(const TypeId type) const
+    {
+        return kind(type) >= TypeKind::I8 && kind(type) <= TypeKind::U64;
+    }
+
+    bool TypeTable::is_signed(const TypeId type) const
+    {
+        // the signed kinds come first in each pair
+        return is_integer(type) && (static_cast<uint8_t>(kind(type)) - static_cast<uint8_t>(TypeKind::I8)) % 2 == 0;
+    }
+
+    bool TypeTable::is_float(const TypeId type) const
+    {
+        return kind(type) == TypeKind::F32 || kind(type) == TypeKind::F64;
+    }
+
+    uint32_t TypeTable::bits(const TypeId type) const
+    {
+        switch (kind(type))
+        {
+            case TypeKind::BOOL:
+                return 1;
+            case TypeKind::I8:
+            case TypeKind::U8:
+                return 8;
+            case TypeKind::I16:
+            case TypeKind::U16:
+                return 16;
+            case TypeKind::I32:
+            case TypeKind::U32:
+            case TypeKind::F32:
+                return 32;
+            case TypeKind::I64:
+            case TypeKind::U64:
+            case TypeKind::F64:
+                return 64;
+            default:
+                return 0;
+        }
+    }
+
+    std::string TypeTable::name(const TypeId type) const
+    {
+        if (type < primitive_type_count)
+            return std::string(primitive_names[type]);
+
+        switch (kind(type))
+        {
+            case TypeKind::PTR:
+                return "ptr<" + name(element(type)) + ">";
+            case TypeKind::ARRAY:
+                return "array<" + name(element(type)) + ", " + std::to_string(count(type)) + ">";
+            case TypeKind::VECTOR:
+                return "vector<" + name(element(type)) + ", " + std::to_string(count(type)) + ">";
+            case TypeKind::STRUCT:
+            {
+                std::string result = "struct<{";
+                for (const TypeId field: fields(type))
+                {
+                    if (result.size() > 8)
+                        result += ", ";
+                    result += name(field);
+                }
+                return result + "}>";
+            }
+            default:
+                return "?";
+        }
+    }
+
+    Function::Function(const uint32_t name, std::vector<TypeId> params, const TypeId return_type) :
+        name_atom(name), param_types(std::move(params)), result_type(return_type),
+        body(make_body()) {}
+
+    Function::~Function() = default;
+
+    std::unique_ptr<Function::Body> Function::make_body()
+    {
+        return std::make_unique<Body>(arena_upstream());
+    }
+
+    uint32_t Function::size() const
+    {
+        return static_cast<uint32_t>(body->opcodes.size());
+    }
+
+    Opcode Function::opcode(const uint32_t value) const
+    {
+        return body->opcodes[value];
+    }
+
+    TypeId Function::type(const uint32_t value) const
+    {
+        return body->types[value];
+    }
+
+    uint64_t Function::immediate(const uint32_t value) const
+    {
+        return body->immediates[value];
+    }
+
+    uint8_t Function::flags(const uint32_t value) const
+    {
+        return body->flags[value];
+    }
+
+    uint32_t Function::value_name(const uint32_t value) const
+    {
+        return body->names[value];
+    }
+
+    uint32_t Function::block_of(const uint32_t value) const
+    {
+        return body->blocks[value];
+    }
+
+    std::span<const uint32_t> Function::operands(const uint32_t value) const
+    {
+        return { body->operand_list.data() + body->operand_starts[value], body->operand_counts[value] };
+    }
+
+    std::span<const uint32_t> Function::targets(const uint32_t value) const
+    {
+        return { body->target_list.data() + body->target_starts[value], body->target_counts[value] };
+    }
+
+    uint32_t Function::block_count() const
+    {
+        return body->block_count;
+    }
+
+    uint32_t Function::block_begin(const uint32_t block) const
+    {
+        return body->block_starts[block];
+    }
+
+    uint32_t Function::block_end(const uint32_t block) const
+    {
+        return body->block_starts[block + 1];
+    }
+
+    uint32_t Function::terminator(const uint32_t block) const
+    {
+        if (block_begin(block) == block_end(block))
+            return no_value;
+        const uint32_t last = block_end(block) - 1;
+        return is_terminator(opcode(last)) ? last : no_value;
+    }
+
+    std::span<const uint32_t> Function::successors(const uint32_t block) const
+    {
+        const uint32_t last = terminator(block);
+        return last == no_value ? std::span<const uint32_t> {} : targets(last);
+    }
+
+    bool Function::laid_out() const
+    {
+        return body->block_starts.size() == body->block_count + 1;
+    }
+
+    void Function::compute_uses()
+    {
+        // counting sort of (operand, user) pairs by operand; removed instructions use nothing
+        auto &starts = body->use_starts;
+        starts.assign(size() + 1, 0);
+        for (uint32_t user = 0; user < size(); ++user)
+        {
+            for (const uint32_t operand: operands(user))
+                ++starts[operand + 1];
+        }
+        for (uint32_t value = 0; value < size(); ++value)
+            starts[value + 1] += starts[value];
+
+        body->use_list.assign(starts.back(), 0);
+        std::pmr::vector<uint32_t> cursor(starts.begin(), starts.end() - 1, &body->arena);
+        for (uint32_t user = 0; user < size(); ++user)
+        {
+            for (const uint32_t operand: operands(user))
+                body->use_list[cursor[operand]++] = user;
+        }
+    }
+
+    std::span<const uint32_t> Function::uses(const uint32_t value) const
+    {
+        const auto &starts = body->use_starts;
+        return { body->use_list.data() + starts[value], starts[value + 1] - starts[value] };
+    }
+
+    void Function::compute_predecessors()
+    {
+        auto &starts = body->predecessor_starts;
+        starts.assign(block_count() + 1, 0);
+        for (uint32_t block = 0; block < block_count(); ++block)
+        {
+            for (const uint32_t successor: successors(block))
+                ++starts[successor + 1];
+        }
+        for (uint32_t block = 0; block < block_count(); ++block)
+            starts[block + 1] += starts[block];
+
+        body->predecessor_list.assign(starts.back(), 0);
+        std::pmr::vector<uint32_t> cursor(starts.begin(), starts.end() - 1, &body->arena);
+        for (uint32_t block = 0; block < block_count(); ++block)
+        {
+            for (const uint32_t successor: successors(block))
+                body->predecessor_list[cursor[successor]++] = block;
+        }
+    }
+
+    std::span<const uint32_t> Function::predecessors(const uint32_t block) const
+    {
+        const auto &starts = body->predecessor_starts;
+        return { body->predecessor_list.data() + starts[block], starts[block + 1] - starts[block] };
+    }
+
+    void Function::set_operand(const uint32_t value, const uint32_t index, const uint32_t operand)
+    {
+        body->operand_list[body->operand_starts[value] + index] = operand;
+    }
+
+    void Function::set_target(const uint32_t value, const uint32_t index, const uint32_t block)
+    {
+        body->target_list[body->target_starts[value] + index] = block;
+    }
+
+    void Function::set_flags(const uint32_t value, const uint8_t flags)
+    {
+        body->flags[value] = flags;
+    }
+
+    void Function::remove_incoming(const uint32_t phi, const uint32_t index)
+    {
+        // a phi owns its ranges, so they shrink in place
+        const auto drop = [index](auto &list, const uint32_t start, const uint32_t count)
+        {
+            std::copy(list.begin() + start + index + 1, list.begin() + start + count, list.begin() + start + index);
+        };
+        drop(body->operand_list, body->operand_starts[phi], body->operand_counts[phi]);
+        drop(body->target_list, body->target_starts[phi], body->target_counts[phi]);
+        --body->operand_counts[phi];
+        --body->target_counts[phi];
+    }
+
+    void Function::replace_all_uses(const uint32_t from, const uint32_t to)
+    {
+        for (uint32_t user = 0; user < size(); ++user)
+        {
+            if (opcode(user) == Opcode::NOP)
+                continue;
+            for (uint32_t i = 0; i < body->operand_counts[user]; ++i)
+            {
+                if (operands(user)[i] == from)
+                    set_operand(user, i, to);
+            }
+        }
+    }
+
+    void Function::remove(const uint32_t value)
+    {
+        body->opcodes[value] = Opcode::NOP;
+        body->operand_counts[value] = 0;
+        body->target_counts[value] = 0;
+    }
+
+    void Function::clear()
+    {
+        body = make_body();
+        body->block_starts.push_back(0);
+    }
+
+    std::string Function::verify(const TypeTable &types) const
+    {
+        if (!laid_out())
+            return "function is not laid out";
+
+        const auto where = [this](const uint32_t value)
+        {
+            return " (%" + std::to_string(value) + " in bb" + std::to_string(block_of(value)) + ")";
+        };
+
+        std::vector<uint32_t> predecessors_of(block_count());
+        std::vector<std::vector<uint32_t>> predecessor_lists(block_count());
+        for (uint32_t block = 0; block < block_count(); ++block)
+        {
+            if (terminator(block) == no_value)
+                return "bb" + std::to_string(block) + " does not end in a terminator";
+            for (const uint32_t successor: successors(block))
+            {
+                if (successor >= block_count())
+                    return "branch to a block that does not exist" + where(terminator(block));
+                predecessor_lists[successor].push_back(block);
+            }
+        }
+
+        for (uint32_t block = 0; block < block_count(); ++block)
+        {
+            bool leading = true;
+            for (uint32_t value = block_begin(block); value < block_end(block); ++value)
+            {
+                const Opcode op = opcode(value);
+                if (op == Opcode::NOP)
+                    return "removed instruction left in the layout" + where(value);
+                if (block_of(value) != block)
+                    return "instruction outside its block's range" + where(value);
+                if (is_terminator(op) && value + 1 != block_end(block))
+                    return "terminator in the middle of a block" + where(value);
+                if (op == Opcode::PHI && !leading)
+                    return "phi after other instructions" + where(value);
+                leading = leading && op == Opcode::PHI;
+
+                for (const uint32_t operand: operands(value))
+                {
+                    if (operand >= size())
+                        return "operand out of range" + where(value);
+                    if (info(opcode(operand)).traits & NO_RESULT || type(operand) == primitive(TypeKind::VOID))
+                        return "operand without a value" + where(value);
+                }
+
+                const auto ops = operands(value);
+                switch (op)
+                {
+                    case Opcode::PHI:
+                    {
+                        auto incoming = std::vector(targets(value).begin(), targets(value).end());
+                        auto expected = predecessor_lists[block];
+                        std::ranges::sort(incoming);
+                        std::ranges::sort(expected);
+                        if (ops.size() != targets(value).size() || incoming != expected)
+                            return "phi does not match the block's predecessors" + where(value);
+                        for (const uint32_t operand: ops)
+                        {
+                            if (type(operand) != type(value))
+                                return "phi operand of another type" + where(value);
+                        }
+                        break;
+                    }
+                    case Opcode::ADD:
+                    case Opcode::SUB:
+                    case Opcode::MUL:
+                    case Opcode::DIV:
+                    case Opcode::MOD:
+                    case Opcode::FADD:
+                    case Opcode::FSUB:
+                    case Opcode::FMUL:
+                    case Opcode::FDIV:
+                    case Opcode::AND:
+                    case Opcode::OR:
+                    case Opcode::XOR:
+                    case Opcode::SHL:
+                    case Opcode::SHR:
+                    case Opcode::SAR:
+                        if (ops.size() != 2 || type(ops[0]) != type(value) || type(ops[1]) != type(value))
+                            return "operands do not match the result type" + where(value);
+                        break;
+                    case Opcode::NEG:
+                    case Opcode::NOT:
+                        if (ops.size() != 1 || type(ops[0]) != type(value))
+                            return "operand does not match the result type" + where(value);
+                        break;
+                    case Opcode::BRANCH:
+                        if (ops.size() != 1 || type(ops[0]) != primitive(TypeKind::BOOL) || targets(value).size() != 2)
+                            return "branch needs a bool condition and two targets" + where(value);
+                        break;
+                    case Opcode::JUMP:
+                        if (!ops.empty() || targets(value).size() != 1)
+                            return "jump needs exactly one target" + where(value);
+                        break;
+                    case Opcode::SWITCH:
+                        if (ops.empty() || targets(value).size() != ops.size())
+                            return "switch needs a default and one target per case" + where(value);
+                        break;
+                    case Opcode::RET:
+                        if (return_type() == primitive(TypeKind::VOID) ? !ops.empty()
+                                                                        : ops.size() != 1 || type(ops[0]) != return_type())
+                            return "return value does not match the function" + where(value);
+                        break;
+                    case Opcode::CALL:
+                    case Opcode::CALL_INDIRECT:
+                    {
+                        const uint32_t next = value + 1;
+                        const bool tail = next + 1 == block_end(block) && opcode(next) == Opcode::RET &&
+                                          (operands(next).empty() ? type(value) == primitive(TypeKind::VOID)
+                                                                  : operands(next)[0] == value);
+                        if (flags(value) & TAIL && !tail)
+                            return "tail call not followed by the return of its result" + where(value);
+                        break;
+                    }
+                    case Opcode::LOAD:
+                    case Opcode::STORE:
+                    {
+                        const uint32_t pointer = op == Opcode::LOAD ? 0 : 1;
+                        if (ops.size() <= pointer || !types.is_pointer(type(ops[pointer])))
+                            return "memory access without a pointer" + where(value);
+                        if (ops.size() == pointer + 2 && type(ops[pointer + 1]) != primitive(TypeKind::MEM))
+                            return "memory operand is not a memory state" + where(value);
+                        break;
+                    }
+                    default:
+                        if (op >= Opcode::CMP_EQ && op <= Opcode::FCMP_GE &&
+                            (ops.size() != 2 || type(ops[0]) != type(ops[1]) || type(value) != primitive(TypeKind::BOOL)))
+                            return "comparison of different types" + where(value);
+                        break;
+                }
+            }
+        }
+        return {};
+    }
+
+    uint32_t Module::add_function(const std::string_view name, std::vector<TypeId> params, const TypeId return_type)
+    {
+        const uint32_t atom = compiler::StringInterner::global().intern(name);
+        const auto index = static_cast<uint32_t>(functions.size());
+        functions.push_back(std::make_unique<Function>(atom, std::move(params), return_type));
+        by_name.try_emplace(atom, index);
+        return index;
+    }
+
+    uint32_t Module::find_function(const std::string_view name) const
+    {
+        const uint32_t atom = compiler::StringInterner::global().find(name);
+        const auto it = by_name.find(atom);
+        return it == by_name.end() ? no_function : it->second;
+    }
+}
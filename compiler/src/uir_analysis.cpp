@@ -0,0 +1,277 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/uir_analysis.h"
+#include <algorithm>
+#include <utility>
+
+namespace yu::uir
+{
+    DominatorTree::DominatorTree(Function &function)
+    {
+        const uint32_t block_count = function.block_count();
+        idoms.assign(block_count, no_block);
+        enter.assign(block_count, no_block);
+        leave.assign(block_count, no_block);
+        child_starts.assign(block_count + 1, 0);
+        if (block_count == 0)
+            return;
+
+        // postorder by an explicit stack of (block, next successor)
+        std::vector<uint32_t> postorder_index(block_count, no_block);
+        std::vector<bool> visited(block_count, false);
+        std::vector<std::pair<uint32_t, uint32_t>> stack { { 0, 0 } };
+        visited[0] = true;
+        while (!stack.empty())
+        {
+            auto &[block, next] = stack.back();
+            const auto successors = function.successors(block);
+            if (next < successors.size())
+            {
+                const uint32_t successor = successors[next++];
+                if (!visited[successor])
+                {
+                    visited[successor] = true;
+                    stack.emplace_back(successor, 0);
+                }
+                continue;
+            }
+            postorder_index[block] = static_cast<uint32_t>(rpo.size());
+            rpo.push_back(block);
+            stack.pop_back();
+        }
+        std::ranges::reverse(rpo);
+
+        function.compute_predecessors();
+        const auto intersect = [this, &postorder_index](uint32_t a, uint32_t b)
+        {
+            while (a != b)
+            {
+                while (postorder_index[a] < postorder_index[b])
+                    a = idoms[a];
+                while (postorder_index[b] < postorder_index[a])
+                    b = idoms[b];
+            }
+            return a;
+        };
+
+        // the entry is its own idom while iterating, so intersect() stops there
+        idoms[0] = 0;
+        for (bool changed = true; changed;)
+        {
+            changed = false;
+            for (const uint32_t block: std::span(rpo).subspan(1))
+            {
+                uint32_t dominator = no_block;
+                for (const uint32_t predecessor: function.predecessors(block))
+                {
+                    if (idoms[predecessor] == no_block)
+                        continue;
+                    dominator = dominator == no_block ? predecessor : intersect(predecessor, dominator);
+                }
+                if (idoms[block] != dominator)
+                {
+                    idoms[block] = dominator;
+                    changed = true;
+                }
+            }
+        }
+        idoms[0] = no_block;
+
+        for (const uint32_t block: rpo)
+        {
+            if (idoms[block] != no_block)
+                ++child_starts[idoms[block] + 1];
+        }
+        for (uint32_t block = 0; block < block_count; ++block)
+            child_starts[block + 1] += child_starts[block];
+        child_list.assign(child_starts.back(), 0);
+        std::vector cursor(child_starts.begin(), child_starts.end() - 1);
+        for (uint32_t block = 0; block < block_count; ++block)
+        {
+            if (idoms[block] != no_block)
+                child_list[cursor[idoms[block]]++] = block;
+        }
+
+        // preorder numbering; a block's subtree ends where the last block pushed after it ends
+        std::vector<uint32_t> pending { 0 };
+        while (!pending.empty())
+        {
+            const uint32_t block = pending.back();
+            pending.pop_back();
+            enter[block] = static_cast<uint32_t>(order.size());
+            order.push_back(block);
+            const auto children = this->children(block);
+            for (auto child = children.rbegin(); child != children.rend(); ++child)
+                pending.push_back(*child);
+        }
+        for (auto block = order.rbegin(); block != order.rend(); ++block)
+        {
+            const auto children = this->children(*block);
+            leave[*block] = children.empty() ? enter[*block] : leave[children.back()];
+        }
+    }
+
+    LoopForest::LoopForest(const Function &function, const DominatorTree &tree)
+    {
+        innermost.assign(function.block_count(), no_loop);
+        const auto order = tree.preorder();
+        std::vector<uint32_t> worklist;
+        for (auto it = order.rbegin(); it != order.rend(); ++it)
+        {
+            const uint32_t header = *it;
+            for (const uint32_t predecessor: function.predecessors(header))
+            {
+                if (tree.dominates(header, predecessor))
+                    worklist.push_back(predecessor);
+            }
+            if (worklist.empty())
+                continue;
+
+            // walk back from the back edges; a block of a loop found earlier stands for the
+            // outermost loop around it, which is entered through its header
+            const auto loop = static_cast<uint32_t>(headers.size());
+            headers.push_back(header);
+            parents.push_back(no_loop);
+            innermost[header] = loop;
+            while (!worklist.empty())
+            {
+                const uint32_t block = worklist.back();
+                worklist.pop_back();
+                uint32_t entered = block;
+                if (innermost[block] == no_loop)
+                    innermost[block] = loop;
+                else
+                {
+                    uint32_t outer = innermost[block];
+                    while (parents[outer] != no_loop)
+                        outer = parents[outer];
+                    if (outer == loop)
+                        continue;
+                    parents[outer] = loop;
+                    entered = headers[outer];
+                }
+                for (const uint32_t predecessor: function.predecessors(entered))
+                {
+                    if (tree.reachable(predecessor))
+                        worklist.push_back(predecessor);
+                }
+            }
+        }
+
+        // parents are numbered after their children
+        const uint32_t loop_count = this->loop_count();
+        depths.assign(loop_count, 1);
+        for (uint32_t loop = loop_count; loop-- > 0;)
+        {
+            if (parents[loop] != no_loop)
+                depths[loop] = depths[parents[loop]] + 1;
+        }
+
+        block_starts.assign(loop_count + 1, 0);
+        for (const uint32_t block: order)
+        {
+            for (uint32_t loop = innermost[block]; loop != no_loop; loop = parents[loop])
+                ++block_starts[loop + 1];
+        }
+        for (uint32_t loop = 0; loop < loop_count; ++loop)
+            block_starts[loop + 1] += block_starts[loop];
+        block_list.assign(block_starts.back(), 0);
+        std::vector cursor(block_starts.begin(), block_starts.end() - 1);
+        for (const uint32_t block: order)
+        {
+            for (uint32_t loop = innermost[block]; loop != no_loop; loop = parents[loop])
+                block_list[cursor[loop]++] = block;
+        }
+    }
+
+    CallGraph::CallGraph(const Module &module)
+    {
+        const uint32_t function_count = module.function_count();
+        callee_starts.assign(function_count + 1, 0);
+        components.assign(function_count, no_function);
+        cyclic.assign(function_count, false);
+
+        std::vector<uint32_t> seen(function_count, no_function); // last caller that listed a callee
+        for (uint32_t caller = 0; caller < function_count; ++caller)
+        {
+            const Function &function = module.function(caller);
+            for (uint32_t value = 0; value < function.size(); ++value)
+            {
+                if (function.opcode(value) != Opcode::CALL)
+                    continue;
+                const auto callee = static_cast<uint32_t>(function.immediate(value));
+                if (callee >= function_count || seen[callee] == caller)
+                    continue;
+                seen[callee] = caller;
+                callee_list.push_back(callee);
+                cyclic[caller] = cyclic[caller] || callee == caller;
+            }
+            callee_starts[caller + 1] = static_cast<uint32_t>(callee_list.size());
+        }
+
+        // Tarjan's algorithm with an explicit stack of (function, next callee); components are
+        // completed callees first, which is the bottom-up order
+        std::vector<uint32_t> index(function_count, no_function), low(function_count, 0);
+        std::vector<uint32_t> path;
+        std::vector<bool> on_path(function_count, false);
+        std::vector<std::pair<uint32_t, uint32_t>> stack;
+        uint32_t next_index = 0, next_component = 0;
+        for (uint32_t root = 0; root < function_count; ++root)
+        {
+            if (index[root] != no_function)
+                continue;
+            stack.emplace_back(root, 0);
+            while (!stack.empty())
+            {
+                auto &[function, next] = stack.back();
+                if (next == 0 && index[function] == no_function)
+                {
+                    index[function] = low[function] = next_index++;
+                    path.push_back(function);
+                    on_path[function] = true;
+                }
+                const auto calls = callees(function);
+                if (next < calls.size())
+                {
+                    const uint32_t callee = calls[next++];
+                    if (index[callee] == no_function)
+                        stack.emplace_back(callee, 0);
+                    else if (on_path[callee])
+                        low[function] = std::min(low[function], index[callee]);
+                    continue;
+                }
+
+                const uint32_t finished = function;
+                stack.pop_back();
+                if (!stack.empty())
+                    low[stack.back().first] = std::min(low[stack.back().first], low[finished]);
+                if (low[finished] != index[finished])
+                    continue;
+                size_t first = path.size() - 1;
+                while (path[first] != finished)
+                    --first;
+                for (size_t i = first; i < path.size(); ++i)
+                {
+                    components[path[i]] = next_component;
+                    on_path[path[i]] = false;
+                    cyclic[path[i]] = cyclic[path[i]] || path.size() - first > 1;
+                    order.push_back(path[i]);
+                }
+                path.resize(first);
+                ++next_component;
+            }
+        }
+    }
+
+    bool writes_unversioned(const Module &module, const Function &function, const uint32_t value)
+    {
+        const Opcode opcode = function.opcode(value);
+        if (opcode == Opcode::STORE)
+            return false;
+        if (opcode == Opcode::CALL)
+            return !(module.function(static_cast<uint32_t>(function.immediate(value))).attributes() & PURE);
+        const uint8_t traits = info(opcode).traits;
+        return (traits & SIDE_EFFECTS) && (traits & READS_MEMORY);
+    }
+}
@@ -0,0 +1,562 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/uir_builder.h"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include "../include/interner.h"
+
+namespace yu::uir
+{
+    namespace
+    {
+        bool in_prefix(const Opcode opcode)
+        {
+            return opcode == Opcode::PARAM || opcode == Opcode::CONST || opcode == Opcode::UNDEF ||
+                   opcode == Opcode::FUNC_ENTRY;
+        }
+    }
+
+    Builder::Builder(Module &module, const uint32_t function) : owner(module), target(module.function(function))
+    {
+        if (target.laid_out())
+            load();
+    }
+
+    void Builder::load()
+    {
+        prefix.clear();
+        constants.clear();
+        entry_memory = no_value;
+        order.assign(target.block_count(), {});
+        phi_counts.assign(target.block_count(), 0);
+        removed_blocks.assign(target.block_count(), false);
+
+        for (uint32_t block = 0; block < target.block_count(); ++block)
+        {
+            uint32_t value = target.block_begin(block);
+            for (; block == 0 && value < target.block_end(block) && in_prefix(target.opcode(value)); ++value)
+            {
+                prefix.push_back(value);
+                if (target.opcode(value) == Opcode::CONST)
+                    constants.try_emplace({ target.type(value), target.immediate(value) }, value);
+                else if (target.opcode(value) == Opcode::FUNC_ENTRY)
+                    entry_memory = value;
+            }
+            for (; value < target.block_end(block); ++value)
+            {
+                order[block].push_back(value);
+                if (target.opcode(value) == Opcode::PHI && phi_counts[block] + 1 == order[block].size())
+                    ++phi_counts[block];
+            }
+        }
+    }
+
+    void Builder::invalidate() const
+    {
+        Function::Body &body = *target.body;
+        body.block_starts.clear();
+        body.use_starts.clear();
+        body.predecessor_starts.clear();
+    }
+
+    uint32_t Builder::create_block()
+    {
+        invalidate();
+        order.emplace_back();
+        phi_counts.push_back(0);
+        removed_blocks.push_back(false);
+        return target.body->block_count++;
+    }
+
+    uint32_t Builder::split_block(const uint32_t value)
+    {
+        const uint32_t block = target.block_of(value);
+        const auto position = std::ranges::find(order[block], value);
+        if (position == order[block].end())
+            throw std::logic_error("UIR split point is not in its block");
+        return split_at(block, position - order[block].begin() + 1);
+    }
+
+    uint32_t Builder::move_instructions(const uint32_t block)
+    {
+        return split_at(block, 0);
+    }
+
+    uint32_t Builder::split_at(const uint32_t block, const size_t offset)
+    {
+        const uint32_t tail = create_block();
+        order[tail].assign(order[block].begin() + static_cast<std::ptrdiff_t>(offset), order[block].end());
+        order[block].resize(offset);
+        const auto kept = static_cast<uint32_t>(offset);
+        phi_counts[tail] = phi_counts[block] > kept ? phi_counts[block] - kept : 0;
+        phi_counts[block] = std::min(phi_counts[block], kept);
+        for (const uint32_t moved: order[tail])
+            target.body->blocks[moved] = tail;
+        return tail;
+    }
+
+    void Builder::move(const uint32_t value)
+    {
+        const Opcode opcode = target.opcode(value);
+        if (opcode == Opcode::PHI || in_prefix(opcode))
+            throw std::logic_error("UIR instruction cannot be moved");
+        auto &values = order[target.block_of(value)];
+        const auto position = std::ranges::find(values, value);
+        if (position == values.end())
+            throw std::logic_error("UIR instruction to move is not in its block");
+        invalidate();
+        values.erase(position);
+        target.body->blocks[value] = current_block;
+        place(value);
+    }
+
+    void Builder::merge_blocks(const uint32_t into, const uint32_t from)
+    {
+        if (from == 0 || into == from)
+            throw std::logic_error("UIR block cannot be merged");
+        invalidate();
+        for (const uint32_t value: order[from])
+            target.body->blocks[value] = into;
+        order[into].insert(order[into].end(), order[from].begin(), order[from].end());
+        order[from].clear();
+        phi_counts[from] = 0;
+        removed_blocks[from] = true;
+    }
+
+    void Builder::remove_block(const uint32_t block)
+    {
+        if (block == 0)
+            throw std::logic_error("UIR entry block cannot be removed");
+        invalidate();
+        for (const uint32_t value: order[block])
+            target.remove(value);
+        order[block].clear();
+        phi_counts[block] = 0;
+        removed_blocks[block] = true;
+    }
+
+    void Builder::set_insert_block(const uint32_t block)
+    {
+        current_block = block;
+        current_before = no_value;
+    }
+
+    void Builder::set_insert_before(const uint32_t value)
+    {
+        current_block = target.block_of(value);
+        current_before = value;
+    }
+
+    bool Builder::terminated(const uint32_t block) const
+    {
+        return !order[block].empty() && is_terminator(target.opcode(order[block].back()));
+    }
+
+    std::span<const uint32_t> Builder::block_values(const uint32_t block) const
+    {
+        return order[block];
+    }
+
+    uint32_t Builder::append(const Opcode opcode, const TypeId type, const std::span<const uint32_t> operands,
+                             const std::span<const uint32_t> targets, const uint64_t immediate, const uint8_t flags)
+    {
+        invalidate();
+        Function::Body &body = *target.body;
+        const auto value = static_cast<uint32_t>(body.opcodes.size());
+        body.opcodes.push_back(opcode);
+        body.types.push_back(type);
+        body.immediates.push_back(immediate);
+        body.flags.push_back(flags);
+        body.names.push_back(compiler::StringInterner::empty_atom);
+        body.blocks.push_back(in_prefix(opcode) ? 0 : current_block);
+
+        body.operand_starts.push_back(static_cast<uint32_t>(body.operand_list.size()));
+        body.operand_counts.push_back(static_cast<uint32_t>(operands.size()));
+        body.operand_list.insert(body.operand_list.end(), operands.begin(), operands.end());
+        body.target_starts.push_back(static_cast<uint32_t>(body.target_list.size()));
+        body.target_counts.push_back(static_cast<uint32_t>(targets.size()));
+        body.target_list.insert(body.target_list.end(), targets.begin(), targets.end());
+        return value;
+    }
+
+    uint32_t Builder::append_prefix(const Opcode opcode, const TypeId type, const uint64_t immediate)
+    {
+        if (order.empty())
+            throw std::logic_error("UIR function has no entry block");
+        const uint32_t value = append(opcode, type, {}, {}, immediate);
+        prefix.push_back(value);
+        return value;
+    }
+
+    void Builder::place(const uint32_t value)
+    {
+        if (current_block == no_block)
+            throw std::logic_error("UIR builder has no insertion point");
+
+        auto &values = order[current_block];
+        if (current_before != no_value)
+        {
+            const auto position = std::ranges::find(values, current_before);
+            if (position == values.end())
+                throw std::logic_error("UIR insertion point is not in its block");
+            values.insert(position, value);
+            return;
+        }
+        if (terminated(current_block))
+            throw std::logic_error("UIR block already ends in a terminator");
+        values.push_back(value);
+    }
+
+    uint32_t Builder::param(const uint32_t index)
+    {
+        for (const uint32_t value: prefix)
+        {
+            if (target.opcode(value) == Opcode::PARAM && target.immediate(value) == index)
+                return value;
+        }
+        return append_prefix(Opcode::PARAM, target.params()[index], index);
+    }
+
+    uint32_t Builder::memory_entry()
+    {
+        if (entry_memory == no_value)
+            entry_memory = append_prefix(Opcode::FUNC_ENTRY, primitive(TypeKind::MEM), 0);
+        return entry_memory;
+    }
+
+    uint32_t Builder::constant(const TypeId type, const uint64_t bits)
+    {
+        if (const auto it = constants.find({ type, bits }); it != constants.end())
+            return it->second;
+        const uint32_t value = append_prefix(Opcode::CONST, type, bits);
+        constants.try_emplace({ type, bits }, value);
+        return value;
+    }
+
+    uint32_t Builder::constant_float(const TypeId type, const double value)
+    {
+        if (type == primitive(TypeKind::F32))
+            return constant(type, std::bit_cast<uint32_t>(static_cast<float>(value)));
+        return constant(type, std::bit_cast<uint64_t>(value));
+    }
+
+    uint32_t Builder::undef(const TypeId type)
+    {
+        return append_prefix(Opcode::UNDEF, type, 0);
+    }
+
+    uint32_t Builder::binary(const Opcode opcode, const uint32_t a, const uint32_t b)
+    {
+        const bool compare = opcode >= Opcode::CMP_EQ && opcode <= Opcode::FCMP_GE;
+        const uint32_t operands[] = { a, b };
+        const uint32_t value = append(opcode, compare ? primitive(TypeKind::BOOL) : target.type(a), operands);
+        place(value);
+        return value;
+    }
+
+    uint32_t Builder::unary(const Opcode opcode, const uint32_t value)
+    {
+        const uint32_t operands[] = { value };
+        const uint32_t result = append(opcode, target.type(value), operands);
+        place(result);
+        return result;
+    }
+
+    uint32_t Builder::convert(const Opcode opcode, const uint32_t value, const TypeId to)
+    {
+        const uint32_t operands[] = { value };
+        const uint32_t result = append(opcode, to, operands);
+        place(result);
+        return result;
+    }
+
+    uint32_t Builder::alloc(const TypeId element)
+    {
+        const uint32_t value = append(Opcode::ALLOC, owner.types.pointer_to(element), {});
+        place(value);
+        return value;
+    }
+
+    uint32_t Builder::load(const TypeId type, const uint32_t pointer, const uint32_t offset, const uint32_t memory)
+    {
+        const uint32_t operands[] = { pointer, memory };
+        const uint32_t value = append(Opcode::LOAD, type, std::span(operands, memory == no_value ? 1 : 2), {}, offset);
+        place(value);
+        return value;
+    }
+
+    uint32_t Builder::store(const uint32_t value, const uint32_t pointer, const uint32_t offset, const uint32_t memory)
+    {
+        const uint32_t operands[] = { value, pointer, memory };
+        const uint32_t result = append(Opcode::STORE, primitive(TypeKind::MEM),
+                                       std::span(operands, memory == no_value ? 2 : 3), {}, offset);
+        place(result);
+        return result;
+    }
+
+    uint32_t Builder::barrier(const Opcode opcode, const uint32_t memory)
+    {
+        const uint32_t operands[] = { memory };
+        const uint32_t value = append(opcode, primitive(TypeKind::MEM), operands);
+        place(value);
+        return value;
+    }
+
+    uint32_t Builder::atomic_load(const TypeId type, const uint32_t pointer, const Ordering ordering)
+    {
+        const uint32_t operands[] = { pointer };
+        const uint32_t value = append(Opcode::ATOMIC_LOAD, type, operands, {}, 0, ordering_flags(ordering));
+        place(value);
+        return value;
+    }
+
+    uint32_t Builder::atomic_store(const uint32_t value, const uint32_t pointer, const Ordering ordering)
+    {
+        const uint32_t operands[] = { value, pointer };
+        const uint32_t result = append(Opcode::ATOMIC_STORE, primitive(TypeKind::VOID), operands, {}, 0,
+                                       ordering_flags(ordering));
+        place(result);
+        return result;
+    }
+
+    uint32_t Builder::cmpxchg(const uint32_t pointer, const uint32_t expected, const uint32_t desired,
+                              const Ordering success, const Ordering failure)
+    {
+        const uint32_t operands[] = { pointer, expected, desired };
+        const uint32_t value = append(Opcode::CMPXCHG, target.type(expected), operands, {}, 0,
+                                      ordering_flags(success, failure));
+        place(value);
+        return value;
+    }
+
+    uint32_t Builder::atomic_rmw(const Opcode opcode, const uint32_t pointer, const uint32_t value,
+                                 const Ordering ordering)
+    {
+        const uint32_t operands[] = { pointer, value };
+        const uint32_t result = append(opcode, target.type(value), operands, {}, 0, ordering_flags(ordering));
+        place(result);
+        return result;
+    }
+
+    uint32_t Builder::phi(const TypeId type)
+    {
+        if (current_block == no_block)
+            throw std::logic_error("UIR builder has no insertion point");
+        const uint32_t value = append(Opcode::PHI, type, {});
+        auto &values = order[current_block];
+        values.insert(values.begin() + phi_counts[current_block]++, value);
+        return value;
+    }
+
+    void Builder::add_incoming(const uint32_t phi, const uint32_t value, const uint32_t block)
+    {
+        invalidate();
+        Function::Body &body = *target.body;
+
+        // a phi's ranges grow in place while they are the last ones, else they move to the end first
+        const auto extend = [phi](auto &starts, const auto &counts, auto &list, const uint32_t item)
+        {
+            if (starts[phi] + counts[phi] != list.size())
+            {
+                const uint32_t start = starts[phi];
+                starts[phi] = static_cast<uint32_t>(list.size());
+                for (uint32_t i = 0; i < counts[phi]; ++i)
+                    list.push_back(list[start + i]);
+            }
+            list.push_back(item);
+        };
+        extend(body.operand_starts, body.operand_counts, body.operand_list, value);
+        ++body.operand_counts[phi];
+        extend(body.target_starts, body.target_counts, body.target_list, block);
+        ++body.target_counts[phi];
+    }
+
+    uint32_t Builder::copy(const Function &source, const uint32_t value, const std::span<const uint32_t> operands,
+                           const std::span<const uint32_t> targets)
+    {
+        const Opcode opcode = source.opcode(value);
+        if (in_prefix(opcode) || opcode == Opcode::NOP)
+            throw std::logic_error("UIR prefix values are not copied");
+        if (opcode == Opcode::PHI && current_block == no_block)
+            throw std::logic_error("UIR builder has no insertion point");
+
+        const uint32_t copied = append(opcode, source.type(value), operands, targets, source.immediate(value),
+                                       source.flags(value));
+        target.body->names[copied] = source.value_name(value);
+        if (opcode != Opcode::PHI)
+            place(copied);
+        else
+            order[current_block].insert(order[current_block].begin() + phi_counts[current_block]++, copied);
+        return copied;
+    }
+
+    uint32_t Builder::call(const uint32_t callee, const std::span<const uint32_t> arguments, const bool tail)
+    {
+        const uint32_t value = append(Opcode::CALL, owner.function(callee).return_type(), arguments, {}, callee,
+                                      tail ? TAIL : 0);
+        place(value);
+        return value;
+    }
+
+    uint32_t Builder::call_indirect(const TypeId return_type, const uint32_t callee,
+                                    const std::span<const uint32_t> arguments, const bool tail)
+    {
+        std::vector<uint32_t> operands { callee };
+        operands.insert(operands.end(), arguments.begin(), arguments.end());
+        const uint32_t value = append(Opcode::CALL_INDIRECT, return_type, operands, {}, 0, tail ? TAIL : 0);
+        place(value);
+        return value;
+    }
+
+    uint32_t Builder::intrinsic(const std::string_view name, const TypeId return_type,
+                                const std::span<const uint32_t> arguments)
+    {
+        const uint32_t value = append(Opcode::INTRINSIC, return_type, arguments, {},
+                                      compiler::StringInterner::global().intern(name));
+        place(value);
+        return value;
+    }
+
+    uint32_t Builder::jump(const uint32_t block)
+    {
+        const uint32_t targets[] = { block };
+        const uint32_t value = append(Opcode::JUMP, primitive(TypeKind::VOID), {}, targets);
+        place(value);
+        return value;
+    }
+
+    uint32_t Builder::branch(const uint32_t condition, const uint32_t taken, const uint32_t not_taken)
+    {
+        const uint32_t operands[] = { condition };
+        const uint32_t targets[] = { taken, not_taken };
+        const uint32_t value = append(Opcode::BRANCH, primitive(TypeKind::VOID), operands, targets);
+        place(value);
+        return value;
+    }
+
+    uint32_t Builder::switch_value(const uint32_t value, const uint32_t default_block,
+                                   const std::span<const uint32_t> cases, const std::span<const uint32_t> blocks)
+    {
+        std::vector<uint32_t> operands { value };
+        operands.insert(operands.end(), cases.begin(), cases.end());
+        std::vector<uint32_t> targets { default_block };
+        targets.insert(targets.end(), blocks.begin(), blocks.end());
+        const uint32_t result = append(Opcode::SWITCH, primitive(TypeKind::VOID), operands, targets);
+        place(result);
+        return result;
+    }
+
+    uint32_t Builder::ret(const uint32_t value)
+    {
+        const uint32_t operands[] = { value };
+        const uint32_t result = append(Opcode::RET, primitive(TypeKind::VOID),
+                                       std::span(operands, value == no_value ? 0 : 1));
+        place(result);
+        return result;
+    }
+
+    uint32_t Builder::unreachable()
+    {
+        const uint32_t value = append(Opcode::UNREACHABLE, primitive(TypeKind::VOID), {});
+        place(value);
+        return value;
+    }
+
+    void Builder::set_name(const uint32_t value, const std::string_view name)
+    {
+        target.body->names[value] = compiler::StringInterner::global().intern(name);
+    }
+
+    std::vector<uint32_t> Builder::finish()
+    {
+        const Function::Body &old = *target.body;
+        std::vector<uint32_t> layout;
+        layout.reserve(old.opcodes.size());
+
+        std::vector block_remap(old.block_count, no_block);
+        uint32_t kept = 0;
+        for (uint32_t block = 0; block < old.block_count; ++block)
+        {
+            if (!removed_blocks[block])
+                block_remap[block] = kept++;
+        }
+
+        auto fresh = Function::make_body();
+        fresh->block_count = kept;
+        for (uint32_t block = 0; block < old.block_count; ++block)
+        {
+            if (removed_blocks[block])
+                continue;
+            fresh->block_starts.push_back(static_cast<uint32_t>(layout.size()));
+            // removed instructions are dropped here; the prefix and the lists may still hold them
+            const auto keep = [&old, &layout](const std::span<const uint32_t> values)
+            {
+                for (const uint32_t value: values)
+                {
+                    if (old.opcodes[value] != Opcode::NOP)
+                        layout.push_back(value);
+                }
+            };
+            if (block == 0)
+                keep(prefix);
+            keep(order[block]);
+        }
+        fresh->block_starts.push_back(static_cast<uint32_t>(layout.size()));
+
+        std::vector remap(old.opcodes.size(), no_value);
+        for (uint32_t i = 0; i < layout.size(); ++i)
+            remap[layout[i]] = i;
+
+        const size_t count = layout.size();
+        fresh->opcodes.reserve(count);
+        fresh->types.reserve(count);
+        fresh->immediates.reserve(count);
+        fresh->flags.reserve(count);
+        fresh->names.reserve(count);
+        fresh->blocks.reserve(count);
+        fresh->operand_starts.reserve(count);
+        fresh->operand_counts.reserve(count);
+        fresh->target_starts.reserve(count);
+        fresh->target_counts.reserve(count);
+
+        for (uint32_t block = 0; block < kept; ++block)
+        {
+            for (uint32_t i = fresh->block_starts[block]; i < fresh->block_starts[block + 1]; ++i)
+            {
+                const uint32_t value = layout[i];
+                fresh->opcodes.push_back(old.opcodes[value]);
+                fresh->types.push_back(old.types[value]);
+                fresh->immediates.push_back(old.immediates[value]);
+                fresh->flags.push_back(old.flags[value]);
+                fresh->names.push_back(old.names[value]);
+                fresh->blocks.push_back(block);
+
+                fresh->operand_starts.push_back(static_cast<uint32_t>(fresh->operand_list.size()));
+                fresh->operand_counts.push_back(old.operand_counts[value]);
+                for (uint32_t k = 0; k < old.operand_counts[value]; ++k)
+                {
+                    const uint32_t operand = old.operand_list[old.operand_starts[value] + k];
+                    fresh->operand_list.push_back(operand < remap.size() ? remap[operand] : no_value);
+                }
+
+                fresh->target_starts.push_back(static_cast<uint32_t>(fresh->target_list.size()));
+                fresh->target_counts.push_back(old.target_counts[value]);
+                for (uint32_t k = 0; k < old.target_counts[value]; ++k)
+                {
+                    const uint32_t target_block = old.target_list[old.target_starts[value] + k];
+                    fresh->target_list.push_back(target_block < block_remap.size() ? block_remap[target_block] : no_block);
+                }
+            }
+        }
+
+        target.body = std::move(fresh);
+        load();
+        if (current_block != no_block)
+            current_block = current_block < block_remap.size() ? block_remap[current_block] : no_block;
+        if (current_before != no_value)
+            current_before = remap[current_before];
+        return remap;
+    }
+}
@@ -0,0 +1,314 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <algorithm>
+#include <vector>
+#include "../include/uir_builder.h"
+#include "../include/uir_passes.h"
+
+namespace yu::uir
+{
+    namespace
+    {
+        class CfgSimplification
+        {
+        public:
+            CfgSimplification(Module &module, const uint32_t index) : function(module.function(index)),
+                                                                      builder(module, index)
+            {
+            }
+
+            bool run()
+            {
+                // block ranges are gone after the first edit; terminators are tracked as they change
+                const uint32_t block_count = function.block_count();
+                starts.resize(block_count + 1);
+                terminators.resize(block_count);
+                phi_ends.resize(block_count);
+                for (uint32_t block = 0; block < block_count; ++block)
+                {
+                    starts[block] = function.block_begin(block);
+                    terminators[block] = function.terminator(block);
+                    uint32_t value = starts[block];
+                    while (value < function.block_end(block) && function.opcode(value) == Opcode::PHI)
+                        ++value;
+                    phi_ends[block] = value;
+                }
+                starts[block_count] = function.size();
+                function.compute_predecessors();
+                edge_counts.resize(block_count);
+                for (uint32_t block = 0; block < block_count; ++block)
+                    edge_counts[block] = static_cast<uint32_t>(function.predecessors(block).size());
+                replacement.assign(function.size(), no_value);
+                bypassed.assign(block_count, false);
+
+                for (uint32_t block = 0; block < block_count; ++block)
+                    skip_empty_successors(block);
+                for (uint32_t block = 0; block < block_count; ++block)
+                    fold_branch(block);
+                remove_unreachable();
+                for (uint32_t block = 0; block < block_count; ++block)
+                    merge_successors(block);
+
+                if (!changed)
+                    return false;
+                for (uint32_t user = 0; user < function.size(); ++user)
+                {
+                    const auto operands = function.operands(user);
+                    for (uint32_t k = 0; k < operands.size(); ++k)
+                    {
+                        if (operands[k] < replacement.size() && replacement[operands[k]] != no_value)
+                            function.set_operand(user, k, resolve(operands[k]));
+                    }
+                }
+                builder.finish();
+                return true;
+            }
+
+        private:
+            Function &function;
+            Builder builder;
+            bool changed = false;
+
+            std::vector<uint32_t> starts;
+            std::vector<uint32_t> terminators;
+            std::vector<uint32_t> phi_ends;    // first non-phi of each block
+            std::vector<uint32_t> edge_counts; // incoming edges, kept up to date
+            std::vector<bool> bypassed;        // empty blocks every edge now skips
+            std::vector<bool> removed;
+            std::vector<uint32_t> replacement; // phis of merged blocks to their only incoming value
+
+            [[nodiscard]] uint32_t resolve(uint32_t value) const
+            {
+                while (replacement[value] != no_value)
+                    value = replacement[value];
+                return value;
+            }
+
+            /**
+             * @brief Calls `visit(phi, k)` for every incoming entry of `to` from `from`.
+             */
+            template<typename Visit>
+            void incoming(const uint32_t to, const uint32_t from, Visit visit)
+            {
+                for (uint32_t phi = starts[to]; phi < phi_ends[to]; ++phi)
+                {
+                    if (function.opcode(phi) != Opcode::PHI)
+                        continue;
+                    const auto blocks = function.targets(phi);
+                    for (uint32_t k = static_cast<uint32_t>(blocks.size()); k-- > 0;)
+                    {
+                        if (blocks[k] == from)
+                            visit(phi, k);
+                    }
+                }
+            }
+
+            /**
+             * @brief Turns a branch or switch whose targets are all the same block into a jump,
+             * if the phis there get the same value over every one of its edges.
+             */
+            void fold_branch(const uint32_t block)
+            {
+                const uint32_t terminator = terminators[block];
+                if (terminator == no_value)
+                    return;
+                const Opcode opcode = function.opcode(terminator);
+                if (opcode != Opcode::BRANCH && opcode != Opcode::SWITCH)
+                    return;
+                const auto targets = function.targets(terminator);
+                const uint32_t destination = targets[0];
+                if (!std::ranges::all_of(targets, [destination](const uint32_t t) { return t == destination; }))
+                    return;
+
+                bool agree = true;
+                for (uint32_t phi = starts[destination]; phi < phi_ends[destination] && agree; ++phi)
+                {
+                    uint32_t value = no_value;
+                    const auto blocks = function.targets(phi);
+                    for (uint32_t k = 0; k < blocks.size(); ++k)
+                    {
+                        if (blocks[k] != block)
+                            continue;
+                        if (value != no_value && value != function.operands(phi)[k])
+                            agree = false;
+                        value = function.operands(phi)[k];
+                    }
+                }
+                if (!agree)
+                    return;
+
+                // keep the last entry of every phi; incoming() visits it first
+                uint32_t current = no_value;
+                incoming(destination, block, [this, &current](const uint32_t phi, const uint32_t k)
+                {
+                    if (phi == current)
+                        function.remove_incoming(phi, k);
+                    current = phi;
+                });
+                edge_counts[destination] -= static_cast<uint32_t>(targets.size()) - 1;
+                function.remove(terminator);
+                builder.set_insert_block(block);
+                terminators[block] = builder.jump(destination);
+                changed = true;
+            }
+
+            /**
+             * @return uint32_t The block a block does nothing but jump to, or no_block.
+             */
+            [[nodiscard]] uint32_t forwards_to(const uint32_t block) const
+            {
+                if (block == 0 || starts[block + 1] - starts[block] != 1 || terminators[block] == no_value ||
+                    function.opcode(terminators[block]) != Opcode::JUMP)
+                    return no_block;
+                const uint32_t destination = function.targets(terminators[block])[0];
+                return destination == block ? no_block : destination;
+            }
+
+            /**
+             * @brief Points the edges of a block past the empty blocks they lead to. Blocks with
+             * phis are only reached that way along chains of single-predecessor blocks, whose
+             * phi entries then come from this block instead, and only if it has no other edge there.
+             */
+            void skip_empty_successors(const uint32_t block)
+            {
+                const uint32_t terminator = terminators[block];
+                if (terminator == no_value || bypassed[block])
+                    return;
+                const uint32_t target_count = static_cast<uint32_t>(function.targets(terminator).size());
+                for (uint32_t slot = 0; slot < target_count; ++slot)
+                {
+                    uint32_t target = function.targets(terminator)[slot];
+                    bool single = true;
+                    for (uint32_t hops = 0; hops < starts.size(); ++hops)
+                    {
+                        const uint32_t next = forwards_to(target);
+                        if (next == no_block)
+                            break;
+                        single &= edge_counts[target] == 1;
+                        if (phi_ends[next] != starts[next])
+                        {
+                            const auto targets = function.targets(terminator);
+                            const bool other_edge = std::ranges::any_of(targets, [next](const uint32_t t) { return t == next; });
+                            if (!single || other_edge)
+                                break;
+                            incoming(next, target, [this, block](const uint32_t phi, const uint32_t k)
+                            {
+                                function.set_target(phi, k, block);
+                            });
+                        }
+                        target = next;
+                    }
+                    const uint32_t skipped = function.targets(terminator)[slot];
+                    if (target == skipped)
+                        continue;
+                    function.set_target(terminator, slot, target);
+                    ++edge_counts[target];
+                    // the empty blocks nothing leads to any more no longer count as predecessors
+                    for (uint32_t dropped = skipped; --edge_counts[dropped] == 0 && dropped != target;)
+                    {
+                        bypassed[dropped] = true;
+                        dropped = forwards_to(dropped);
+                    }
+                    changed = true;
+                }
+            }
+
+            /**
+             * @brief Removes the blocks the entry no longer reaches, with their phi entries.
+             */
+            void remove_unreachable()
+            {
+                const uint32_t block_count = static_cast<uint32_t>(terminators.size());
+                removed.assign(block_count, true);
+                std::vector<uint32_t> blocks { 0 };
+                removed[0] = false;
+                while (!blocks.empty())
+                {
+                    const uint32_t block = blocks.back();
+                    blocks.pop_back();
+                    if (terminators[block] == no_value)
+                        continue;
+                    for (const uint32_t successor: function.targets(terminators[block]))
+                    {
+                        if (removed[successor])
+                        {
+                            removed[successor] = false;
+                            blocks.push_back(successor);
+                        }
+                    }
+                }
+
+                // the edge counts become exact again for the merge below
+                std::ranges::fill(edge_counts, 0);
+                for (uint32_t block = 0; block < block_count; ++block)
+                {
+                    if (removed[block])
+                    {
+                        builder.remove_block(block);
+                        changed = true;
+                        continue;
+                    }
+                    if (terminators[block] == no_value)
+                        continue;
+                    for (const uint32_t successor: function.targets(terminators[block]))
+                        ++edge_counts[successor];
+                }
+                for (uint32_t block = 0; block < block_count; ++block)
+                {
+                    for (uint32_t phi = starts[block]; phi < phi_ends[block] && !removed[block]; ++phi)
+                    {
+                        const auto blocks = function.targets(phi);
+                        for (uint32_t k = static_cast<uint32_t>(blocks.size()); k-- > 0;)
+                        {
+                            if (removed[blocks[k]])
+                                function.remove_incoming(phi, k);
+                        }
+                    }
+                }
+            }
+
+            /**
+             * @brief Appends the successors a block jumps to to it while it is their only predecessor.
+             */
+            void merge_successors(const uint32_t block)
+            {
+                while (!removed[block] && terminators[block] != no_value &&
+                       function.opcode(terminators[block]) == Opcode::JUMP)
+                {
+                    const uint32_t next = function.targets(terminators[block])[0];
+                    if (next == 0 || next == block || edge_counts[next] != 1)
+                        return;
+
+                    for (uint32_t phi = starts[next]; phi < phi_ends[next]; ++phi)
+                    {
+                        replacement[phi] = function.operands(phi)[0];
+                        function.remove(phi);
+                    }
+                    if (terminators[next] != no_value)
+                    {
+                        for (const uint32_t successor: function.targets(terminators[next]))
+                        {
+                            incoming(successor, next, [this, block](const uint32_t phi, const uint32_t k)
+                            {
+                                function.set_target(phi, k, block);
+                            });
+                        }
+                    }
+                    function.remove(terminators[block]);
+                    builder.merge_blocks(block, next);
+                    terminators[block] = terminators[next];
+                    removed[next] = true;
+                    changed = true;
+                }
+            }
+        };
+    }
+
+    bool simplify_cfg(Module &module, const uint32_t function)
+    {
+        if (!module.function(function).block_count())
+            return false;
+        return CfgSimplification(module, function).run();
+    }
+}
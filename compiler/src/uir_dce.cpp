@@ -0,0 +1,111 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <vector>
+#include "../include/uir_builder.h"
+#include "../include/uir_passes.h"
+
+namespace yu::uir
+{
+    bool eliminate_dead_code(Module &module, const uint32_t index, std::vector<DiscardedResult> *discarded)
+    {
+        Function &function = module.function(index);
+        const uint32_t block_count = function.block_count();
+        if (!block_count)
+            return false;
+
+        std::vector<bool> reachable(block_count, false);
+        std::vector<uint32_t> blocks { 0 };
+        reachable[0] = true;
+        while (!blocks.empty())
+        {
+            const uint32_t block = blocks.back();
+            blocks.pop_back();
+            for (const uint32_t successor: function.successors(block))
+            {
+                if (!reachable[successor])
+                {
+                    reachable[successor] = true;
+                    blocks.push_back(successor);
+                }
+            }
+        }
+
+        const auto is_pure_call = [&module, &function](const uint32_t value)
+        {
+            return function.opcode(value) == Opcode::CALL &&
+                   module.function(static_cast<uint32_t>(function.immediate(value))).attributes() & PURE;
+        };
+
+        // everything is dead until an effect, a terminator or a live user needs it
+        const uint32_t size = function.size();
+        std::vector<bool> live(size, false);
+        std::vector<uint32_t> worklist;
+        for (uint32_t value = 0; value < size; ++value)
+        {
+            const Opcode opcode = function.opcode(value);
+            const bool root = is_terminator(opcode) || opcode == Opcode::PARAM || opcode == Opcode::FUNC_ENTRY ||
+                              (reachable[function.block_of(value)] && info(opcode).traits & SIDE_EFFECTS &&
+                               !is_pure_call(value));
+            if (root)
+            {
+                live[value] = true;
+                worklist.push_back(value);
+            }
+        }
+        while (!worklist.empty())
+        {
+            const uint32_t value = worklist.back();
+            worklist.pop_back();
+            for (const uint32_t operand: function.operands(value))
+            {
+                if (operand >= size)
+                    continue;
+                if (!live[operand])
+                {
+                    live[operand] = true;
+                    worklist.push_back(operand);
+                }
+            }
+        }
+
+        if (discarded)
+        {
+            // any reachable user counts, dead or not: the source did not throw the result away
+            std::vector<bool> used(size, false);
+            for (uint32_t value = 0; value < size; ++value)
+            {
+                if (!reachable[function.block_of(value)] || function.opcode(value) == Opcode::NOP)
+                    continue;
+                for (const uint32_t operand: function.operands(value))
+                {
+                    if (operand < size)
+                        used[operand] = true;
+                }
+            }
+            for (uint32_t value = 0; value < size; ++value)
+            {
+                if (function.opcode(value) != Opcode::CALL || used[value] || function.flags(value) & BOUND ||
+                    !reachable[function.block_of(value)] || function.type(value) == primitive(TypeKind::VOID))
+                    continue;
+                const auto callee = static_cast<uint32_t>(function.immediate(value));
+                if (module.function(callee).attributes() & NO_DISCARD)
+                    discarded->push_back({ index, callee });
+            }
+        }
+
+        Builder builder(module, index);
+        bool changed = false;
+        for (uint32_t value = 0; value < size; ++value)
+        {
+            if (!live[value] && function.opcode(value) != Opcode::NOP)
+            {
+                function.remove(value);
+                changed = true;
+            }
+        }
+        if (changed)
+            builder.finish();
+        return changed;
+    }
+}
@@ -0,0 +1,189 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <algorithm>
+#include <unordered_set>
+#include <vector>
+#include "../include/hash.h"
+#include "../include/uir_analysis.h"
+#include "../include/uir_builder.h"
+#include "../include/uir_passes.h"
+
+namespace yu::uir
+{
+    namespace
+    {
+        class ValueNumbering
+        {
+        public:
+            ValueNumbering(Module &module, const uint32_t index) : module(module), index(index),
+                                                                   function(module.function(index)),
+                                                                   leader(function.size())
+            {
+                for (uint32_t value = 0; value < leader.size(); ++value)
+                {
+                    leader[value] = value;
+                    versioned = versioned && !writes_unversioned(module, function, value);
+                }
+            }
+
+            bool run()
+            {
+                const DominatorTree tree(function);
+                const auto order = tree.preorder();
+
+                // the table holds the values of the blocks dominating the current one; `scopes`
+                // are those blocks, each with the mark of `inserted` at its start
+                struct Scope
+                {
+                    uint32_t block;
+                    size_t inserted;
+                };
+                std::vector<Scope> scopes;
+                std::vector<uint32_t> inserted;
+                Table table(0, Hash { this }, Equal { this });
+
+                bool changed = false;
+                for (const uint32_t block: order)
+                {
+                    while (!scopes.empty() && tree.subtree_end(scopes.back().block) < tree.preorder_index(block))
+                    {
+                        for (size_t i = scopes.back().inserted; i < inserted.size(); ++i)
+                            table.erase(inserted[i]);
+                        inserted.resize(scopes.back().inserted);
+                        scopes.pop_back();
+                    }
+                    scopes.push_back({ block, inserted.size() });
+
+                    for (uint32_t value = function.block_begin(block); value < function.block_end(block); ++value)
+                    {
+                        if (!numbered(value))
+                            continue;
+                        const auto [existing, added] = table.insert(value);
+                        if (added)
+                            inserted.push_back(value);
+                        else
+                        {
+                            leader[value] = *existing;
+                            changed = true;
+                        }
+                    }
+                }
+                if (!changed)
+                    return false;
+
+                // every use now dominated by its leader, phis and unreachable code included
+                Builder builder(module, index);
+                for (uint32_t user = 0; user < function.size(); ++user)
+                {
+                    const auto operands = function.operands(user);
+                    for (uint32_t k = 0; k < operands.size(); ++k)
+                    {
+                        if (operands[k] < leader.size() && leader[operands[k]] != operands[k])
+                            function.set_operand(user, k, leader[operands[k]]);
+                    }
+                }
+                for (uint32_t value = 0; value < leader.size(); ++value)
+                {
+                    if (leader[value] != value)
+                        function.remove(value);
+                }
+                builder.finish();
+                return true;
+            }
+
+        private:
+            /**
+             * @brief Hashes a value by what it computes: opcode, type, immediate, flags and the
+             * leaders of its operands, the two operands of a commutative opcode in either order.
+             */
+            struct Hash
+            {
+                const ValueNumbering *numbering;
+
+                size_t operator()(const uint32_t value) const
+                {
+                    const Function &function = numbering->function;
+                    uint64_t h = compiler::hash_mix(static_cast<uint64_t>(function.opcode(value)) << 40 ^
+                                                    static_cast<uint64_t>(function.flags(value)) << 32 ^
+                                                    function.type(value));
+                    h = compiler::hash_mix(h ^ function.immediate(value));
+                    const auto operands = function.operands(value);
+                    if (info(function.opcode(value)).traits & COMMUTATIVE)
+                    {
+                        const uint32_t a = numbering->leader[operands[0]], b = numbering->leader[operands[1]];
+                        return compiler::hash_mix(h ^ (static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b)));
+                    }
+                    for (const uint32_t operand: operands)
+                        h = compiler::hash_mix(h ^ numbering->leader[operand]);
+                    return h;
+                }
+            };
+
+            struct Equal
+            {
+                const ValueNumbering *numbering;
+
+                bool operator()(const uint32_t a, const uint32_t b) const
+                {
+                    const Function &function = numbering->function;
+                    if (function.opcode(a) != function.opcode(b) || function.type(a) != function.type(b) ||
+                        function.immediate(a) != function.immediate(b) || function.flags(a) != function.flags(b))
+                        return false;
+                    const auto left = function.operands(a), right = function.operands(b);
+                    if (left.size() != right.size())
+                        return false;
+                    const std::vector<uint32_t> &leader = numbering->leader;
+                    bool same = true;
+                    for (uint32_t k = 0; k < left.size() && same; ++k)
+                        same = leader[left[k]] == leader[right[k]];
+                    if (!same && info(function.opcode(a)).traits & COMMUTATIVE)
+                        same = leader[left[0]] == leader[right[1]] && leader[left[1]] == leader[right[0]];
+                    return same;
+                }
+            };
+
+            using Table = std::unordered_set<uint32_t, Hash, Equal>;
+
+            /**
+             * @brief True for the values that equal any other value computing the same: pure
+             * operations, loads from a given memory state and calls to `@pure` functions. Phis
+             * merge values of other blocks and keep their own number. Loads are only numbered in
+             * functions where every write to memory versions it.
+             */
+            [[nodiscard]] bool numbered(const uint32_t value) const
+            {
+                const Opcode opcode = function.opcode(value);
+                switch (opcode)
+                {
+                    case Opcode::NOP:
+                    case Opcode::PHI:
+                    case Opcode::UNDEF:
+                    case Opcode::FUNC_ENTRY:
+                        return false;
+                    case Opcode::LOAD:
+                        // without a memory state a load may see any earlier store
+                        return versioned && function.operands(value).size() == 2;
+                    case Opcode::CALL:
+                        return function.type(value) != primitive(TypeKind::VOID) &&
+                               module.function(static_cast<uint32_t>(function.immediate(value))).attributes() & PURE;
+                    default:
+                        return !(info(opcode).traits & (SIDE_EFFECTS | READS_MEMORY | NO_RESULT));
+                }
+            }
+
+            Module &module;
+            uint32_t index;
+            Function &function;
+            std::vector<uint32_t> leader; // the value each value is replaced by, itself if none
+            bool versioned = true;        // no write to memory but stores, see writes_unversioned()
+        };
+    }
+
+    bool number_values(Module &module, const uint32_t function)
+    {
+        if (!module.function(function).block_count())
+            return false;
+        return ValueNumbering(module, function).run();
+    }
+}
@@ -0,0 +1,592 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/uir_image.h"
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include "../include/hash.h"
+#include "../include/interner.h"
+#include "../include/version.h"
+
+namespace yu::uir
+{
+    namespace
+    {
+        constexpr uint32_t image_magic = 0x31525559; // "YUR1"
+        constexpr uint32_t image_endian = 0x01020304;
+
+        enum Section : uint32_t
+        {
+            TYPES,
+            TYPE_REFS,
+            FUNCTIONS,
+            NAMES,
+            STRINGS,
+            BODIES,
+            SECTION_COUNT
+        };
+
+        struct ImageHeader
+        {
+            uint32_t magic;
+            uint32_t endian;
+            uint64_t version_hash;
+
+            uint32_t type_count; // compound types; the primitives are implied
+            uint32_t type_ref_count;
+            uint32_t function_count;
+            uint32_t name_count;
+            uint64_t string_size;
+            uint64_t body_size;
+
+            uint64_t sections[SECTION_COUNT]; // byte offset of each section, 8-aligned
+        };
+
+        struct ImageType
+        {
+            uint32_t kind;
+            uint32_t element;
+            uint32_t count;
+            uint32_t field_start; // index into the type references
+            uint32_t field_count;
+            uint32_t reserved;
+        };
+
+        struct ImageFunction
+        {
+            uint32_t name; // index into the names
+            uint32_t param_start; // index into the type references
+            uint32_t param_count;
+            uint32_t return_type;
+            uint32_t attributes; // FunctionAttributes
+            uint32_t reserved;
+            uint64_t body_offset; // into the body section
+            uint64_t body_size;   // 0 for declarations
+        };
+
+        struct ImageName
+        {
+            uint32_t offset;
+            uint32_t length;
+        };
+
+        uint64_t version_hash()
+        {
+            // the opcode numbering is part of the format
+            static const uint64_t hash = compiler::hash_bytes(compiler::compiler_version,
+                                                              sizeof(ImageHeader) << 8 | static_cast<size_t>(Opcode::COUNT));
+            return hash;
+        }
+
+        size_t align8(const size_t n)
+        {
+            return (n + 7) & ~static_cast<size_t>(7);
+        }
+
+        void put_varint(std::vector<uint8_t> &out, uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                out.push_back(static_cast<uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<uint8_t>(value));
+        }
+
+        /**
+         * @brief Reads varints from a body section; reading past its end yields zeros and clears ok.
+         */
+        struct VarintReader
+        {
+            const uint8_t *at;
+            const uint8_t *end;
+            bool ok = true;
+
+            uint64_t next()
+            {
+                uint64_t value = 0;
+                for (uint32_t shift = 0; shift < 64; shift += 7)
+                {
+                    if (at == end)
+                        break;
+                    const uint8_t byte = *at++;
+                    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                    if (!(byte & 0x80))
+                        return value;
+                }
+                ok = false;
+                return 0;
+            }
+
+            uint8_t byte()
+            {
+                if (at == end)
+                {
+                    ok = false;
+                    return 0;
+                }
+                return *at++;
+            }
+        };
+
+        /**
+         * @brief Operands are stored relative to their user, zigzagged, with 0 for a missing one.
+         */
+        uint64_t encode_operand(const uint32_t user, const uint32_t operand)
+        {
+            if (operand == no_value)
+                return 0;
+            const int64_t delta = static_cast<int64_t>(user) - operand;
+            return (static_cast<uint64_t>(delta) << 1 ^ static_cast<uint64_t>(delta >> 63)) + 1;
+        }
+
+        uint32_t decode_operand(const uint32_t user, const uint64_t encoded)
+        {
+            if (!encoded)
+                return no_value;
+            const uint64_t zigzag = encoded - 1;
+            const auto delta = static_cast<int64_t>(zigzag >> 1 ^ (0 - (zigzag & 1)));
+            const int64_t operand = static_cast<int64_t>(user) - delta;
+            return operand >= 0 && operand < no_value ? static_cast<uint32_t>(operand) : no_value;
+        }
+
+        class ImageWriter
+        {
+        public:
+            std::vector<ImageType> types;
+            std::vector<uint32_t> refs;
+            std::vector<ImageFunction> functions;
+            std::vector<ImageName> names;
+            std::string strings;
+            std::vector<uint8_t> bodies;
+
+            explicit ImageWriter(const Module &module) : module(module) {}
+
+            void write_types()
+            {
+                const TypeTable &table = module.types;
+                for (TypeId type = primitive_type_count; type < table.size(); ++type)
+                {
+                    const auto fields = table.fields(type);
+                    types.push_back({
+                        static_cast<uint32_t>(table.kind(type)), table.element(type), table.count(type),
+                        static_cast<uint32_t>(refs.size()), static_cast<uint32_t>(fields.size()), 0
+                    });
+                    refs.insert(refs.end(), fields.begin(), fields.end());
+                }
+            }
+
+            void write_function(const Function &function)
+            {
+                const auto params = function.params();
+                ImageFunction entry {
+                    name(function.name()), static_cast<uint32_t>(refs.size()), static_cast<uint32_t>(params.size()),
+                    function.return_type(), function.attributes(), 0, bodies.size(), 0
+                };
+                refs.insert(refs.end(), params.begin(), params.end());
+
+                if (function.block_count())
+                {
+                    if (!function.laid_out())
+                        throw std::logic_error("Cannot encode a function that is not laid out");
+                    write_body(function);
+                    entry.body_size = bodies.size() - entry.body_offset;
+                }
+                functions.push_back(entry);
+            }
+
+        private:
+            const Module &module;
+            std::unordered_map<uint32_t, uint32_t> name_indices; // atom to name
+
+            uint32_t name(const uint32_t atom)
+            {
+                const auto [it, added] = name_indices.try_emplace(atom, static_cast<uint32_t>(names.size()));
+                if (added)
+                {
+                    const std::string_view text = compiler::StringInterner::global().view(atom);
+                    names.push_back({ static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(text.size()) });
+                    strings.append(text);
+                }
+                return it->second;
+            }
+
+            void write_body(const Function &function)
+            {
+                put_varint(bodies, function.size());
+                put_varint(bodies, function.block_count());
+                for (uint32_t block = 0; block < function.block_count(); ++block)
+                    put_varint(bodies, function.block_end(block) - function.block_begin(block));
+
+                for (uint32_t value = 0; value < function.size(); ++value)
+                {
+                    const Opcode opcode = function.opcode(value);
+                    bodies.push_back(static_cast<uint8_t>(opcode));
+                    put_varint(bodies, function.type(value));
+                    bodies.push_back(function.flags(value));
+
+                    const uint32_t value_name = function.value_name(value);
+                    put_varint(bodies, value_name == compiler::StringInterner::empty_atom ? 0 : name(value_name) + 1);
+                    const uint64_t immediate = function.immediate(value);
+                    put_varint(bodies, opcode == Opcode::INTRINSIC ? name(static_cast<uint32_t>(immediate)) : immediate);
+
+                    const auto operands = function.operands(value);
+                    put_varint(bodies, operands.size());
+                    for (const uint32_t operand: operands)
+                        put_varint(bodies, encode_operand(value, operand));
+
+                    const auto targets = function.targets(value);
+                    put_varint(bodies, targets.size());
+                    for (const uint32_t target: targets)
+                        put_varint(bodies, target);
+                }
+            }
+        };
+    }
+
+    ModuleImage ModuleImage::build(const Module &module)
+    {
+        ImageWriter writer(module);
+        writer.write_types();
+        for (uint32_t function = 0; function < module.function_count(); ++function)
+            writer.write_function(module.function(function));
+
+        ImageHeader header {
+            image_magic,
+            image_endian,
+            version_hash(),
+            static_cast<uint32_t>(writer.types.size()),
+            static_cast<uint32_t>(writer.refs.size()),
+            static_cast<uint32_t>(writer.functions.size()),
+            static_cast<uint32_t>(writer.names.size()),
+            writer.strings.size(),
+            writer.bodies.size(),
+            {}
+        };
+
+        const std::pair<const void *, size_t> contents[SECTION_COUNT] = {
+            { writer.types.data(), writer.types.size() * sizeof(ImageType) },
+            { writer.refs.data(), writer.refs.size() * sizeof(uint32_t) },
+            { writer.functions.data(), writer.functions.size() * sizeof(ImageFunction) },
+            { writer.names.data(), writer.names.size() * sizeof(ImageName) },
+            { writer.strings.data(), writer.strings.size() },
+            { writer.bodies.data(), writer.bodies.size() },
+        };
+        size_t offset = align8(sizeof(ImageHeader));
+        for (uint32_t section = 0; section < SECTION_COUNT; ++section)
+        {
+            header.sections[section] = offset;
+            offset = align8(offset + contents[section].second);
+        }
+
+        ModuleImage result;
+        result.owned.resize(offset);
+        std::memcpy(result.owned.data(), &header, sizeof(header));
+        for (uint32_t section = 0; section < SECTION_COUNT; ++section)
+        {
+            if (contents[section].second)
+                std::memcpy(result.owned.data() + header.sections[section], contents[section].first, contents[section].second);
+        }
+        return result;
+    }
+
+    bool ModuleImage::open(const std::string &path)
+    {
+        owned.clear();
+        target = nullptr;
+        if (!file.open(path))
+            return false;
+        if (valid())
+            return true;
+
+        file = compiler::MappedFile {};
+        return false;
+    }
+
+    bool ModuleImage::valid() const
+    {
+        if (size() < sizeof(ImageHeader))
+            return false;
+
+        const auto &header = *reinterpret_cast<const ImageHeader *>(data());
+        if (header.magic != image_magic || header.endian != image_endian || header.version_hash != version_hash())
+            return false;
+
+        const uint64_t sizes[SECTION_COUNT] = {
+            static_cast<uint64_t>(header.type_count) * sizeof(ImageType),
+            static_cast<uint64_t>(header.type_ref_count) * sizeof(uint32_t),
+            static_cast<uint64_t>(header.function_count) * sizeof(ImageFunction),
+            static_cast<uint64_t>(header.name_count) * sizeof(ImageName),
+            header.string_size,
+            header.body_size
+        };
+        for (uint32_t section = 0; section < SECTION_COUNT; ++section)
+        {
+            if (header.sections[section] % 8 || header.sections[section] < sizeof(ImageHeader) ||
+                header.sections[section] > size() || sizes[section] > size() - header.sections[section])
+                return false;
+        }
+        return true;
+    }
+
+    bool ModuleImage::write(const std::string &path) const
+    {
+        if (!*this)
+            return false;
+
+        return compiler::write_file_atomically(path, image());
+    }
+
+    template<typename T>
+    const T *ModuleImage::section(const uint32_t index) const
+    {
+        return reinterpret_cast<const T *>(data() + reinterpret_cast<const ImageHeader *>(data())->sections[index]);
+    }
+
+    uint32_t ModuleImage::function_count() const
+    {
+        return *this ? reinterpret_cast<const ImageHeader *>(data())->function_count : 0;
+    }
+
+    std::string_view ModuleImage::name(const uint32_t index) const
+    {
+        const auto &header = *reinterpret_cast<const ImageHeader *>(data());
+        if (index >= header.name_count)
+            return {};
+        const ImageName &entry = section<ImageName>(NAMES)[index];
+        if (static_cast<uint64_t>(entry.offset) + entry.length > header.string_size)
+            return {};
+        return { section<char>(STRINGS) + entry.offset, entry.length };
+    }
+
+    std::string_view ModuleImage::function_name(const uint32_t function) const
+    {
+        return name(section<ImageFunction>(FUNCTIONS)[function].name);
+    }
+
+    uint32_t ModuleImage::atom(const uint32_t index)
+    {
+        if (atoms[index] == compiler::StringInterner::no_atom)
+            atoms[index] = compiler::StringInterner::global().intern(name(index));
+        return atoms[index];
+    }
+
+    bool ModuleImage::attach(Module &module)
+    {
+        if (!*this)
+            return false;
+        const auto &header = *reinterpret_cast<const ImageHeader *>(data());
+        const auto *image_types = section<ImageType>(TYPES);
+        const auto *image_functions = section<ImageFunction>(FUNCTIONS);
+        const uint32_t *refs = section<uint32_t>(TYPE_REFS);
+        const uint64_t type_count = static_cast<uint64_t>(primitive_type_count) + header.type_count;
+        const auto refs_in_range = [&header](const uint32_t start, const uint32_t count)
+        {
+            return static_cast<uint64_t>(start) + count <= header.type_ref_count;
+        };
+
+        // check everything first, so a malformed image leaves the module untouched; types only
+        // refer to types before them
+        for (uint32_t i = 0; i < header.type_count; ++i)
+        {
+            const ImageType &type = image_types[i];
+            const uint32_t self = primitive_type_count + i;
+            if (type.element >= self || !refs_in_range(type.field_start, type.field_count))
+                return false;
+            for (uint32_t k = 0; k < type.field_count; ++k)
+            {
+                if (refs[type.field_start + k] >= self)
+                    return false;
+            }
+            if (type.kind != static_cast<uint32_t>(TypeKind::PTR) && type.kind != static_cast<uint32_t>(TypeKind::ARRAY) &&
+                type.kind != static_cast<uint32_t>(TypeKind::VECTOR) && type.kind != static_cast<uint32_t>(TypeKind::STRUCT))
+                return false;
+        }
+        for (uint32_t function = 0; function < header.function_count; ++function)
+        {
+            const ImageFunction &entry = image_functions[function];
+            if (entry.name >= header.name_count || entry.return_type >= type_count ||
+                !refs_in_range(entry.param_start, entry.param_count) ||
+                module.find_function(name(entry.name)) != no_function)
+                return false;
+            for (uint32_t k = 0; k < entry.param_count; ++k)
+            {
+                if (refs[entry.param_start + k] >= type_count)
+                    return false;
+            }
+        }
+
+        target = &module;
+        base = module.function_count();
+        types.resize(type_count);
+        for (TypeId type = 0; type < primitive_type_count; ++type)
+            types[type] = type;
+        std::vector<TypeId> fields;
+        for (uint32_t i = 0; i < header.type_count; ++i)
+        {
+            const ImageType &type = image_types[i];
+            TypeId &mapped = types[primitive_type_count + i];
+            switch (static_cast<TypeKind>(type.kind))
+            {
+                case TypeKind::PTR:
+                    mapped = module.types.pointer_to(types[type.element]);
+                    break;
+                case TypeKind::ARRAY:
+                    mapped = module.types.array_of(types[type.element], type.count);
+                    break;
+                case TypeKind::VECTOR:
+                    mapped = module.types.vector_of(types[type.element], type.count);
+                    break;
+                default:
+                    fields.clear();
+                    for (uint32_t k = 0; k < type.field_count; ++k)
+                        fields.push_back(types[refs[type.field_start + k]]);
+                    mapped = module.types.structure(fields);
+                    break;
+            }
+        }
+
+        atoms.assign(header.name_count, compiler::StringInterner::no_atom);
+        loaded.assign(header.function_count, 0);
+        for (uint32_t function = 0; function < header.function_count; ++function)
+        {
+            const ImageFunction &entry = image_functions[function];
+            std::vector<TypeId> params(entry.param_count);
+            for (uint32_t k = 0; k < entry.param_count; ++k)
+                params[k] = types[refs[entry.param_start + k]];
+            const uint32_t index = module.add_function(name(entry.name), std::move(params), types[entry.return_type]);
+            module.function(index).set_attributes(static_cast<uint8_t>(entry.attributes));
+        }
+        return true;
+    }
+
+    bool ModuleImage::materialize(const uint32_t function)
+    {
+        if (!target || function >= loaded.size())
+            return false;
+        if (loaded[function])
+            return true;
+
+        const auto &header = *reinterpret_cast<const ImageHeader *>(data());
+        const ImageFunction &entry = section<ImageFunction>(FUNCTIONS)[function];
+        if (entry.body_offset > header.body_size || entry.body_size > header.body_size - entry.body_offset)
+            return false;
+        if (!entry.body_size)
+        {
+            loaded[function] = 1;
+            return true;
+        }
+
+        const auto *bytes = section<uint8_t>(BODIES) + entry.body_offset;
+        VarintReader in { bytes, bytes + entry.body_size };
+
+        // every instruction takes at least seven bytes and every block at least one, which bounds
+        // the reservations below by the section size
+        const uint64_t count = in.next();
+        const uint64_t block_count = in.next();
+        if (count > entry.body_size / 7 || block_count > entry.body_size)
+            return false;
+
+        auto body = Function::make_body();
+        body->block_count = static_cast<uint32_t>(block_count);
+        body->block_starts.reserve(block_count + 1);
+        body->block_starts.push_back(0);
+        uint64_t end = 0;
+        for (uint64_t block = 0; block < block_count; ++block)
+        {
+            end += in.next();
+            if (end > count)
+                return false;
+            body->block_starts.push_back(static_cast<uint32_t>(end));
+        }
+        if (end != count)
+            return false;
+
+        body->opcodes.reserve(count);
+        body->types.reserve(count);
+        body->immediates.reserve(count);
+        body->flags.reserve(count);
+        body->names.reserve(count);
+        body->blocks.reserve(count);
+        body->operand_starts.reserve(count);
+        body->operand_counts.reserve(count);
+        body->target_starts.reserve(count);
+        body->target_counts.reserve(count);
+
+        const uint32_t function_count = static_cast<uint32_t>(loaded.size());
+        uint32_t block = 0;
+        for (uint32_t value = 0; value < count && in.ok; ++value)
+        {
+            while (body->block_starts[block + 1] == value)
+                ++block;
+
+            const uint8_t opcode = in.byte();
+            const uint64_t type = in.next();
+            const uint8_t flags = in.byte();
+            const uint64_t value_name = in.next();
+            uint64_t immediate = in.next();
+            if (opcode >= static_cast<uint8_t>(Opcode::COUNT) || type >= types.size() || value_name > atoms.size())
+                return false;
+            if (opcode == static_cast<uint8_t>(Opcode::INTRINSIC))
+            {
+                if (immediate >= atoms.size())
+                    return false;
+                immediate = atom(static_cast<uint32_t>(immediate));
+            }
+            else if (opcode == static_cast<uint8_t>(Opcode::CALL))
+            {
+                if (immediate >= function_count)
+                    return false;
+                immediate += base;
+            }
+
+            body->opcodes.push_back(static_cast<Opcode>(opcode));
+            body->types.push_back(types[type]);
+            body->immediates.push_back(immediate);
+            body->flags.push_back(flags);
+            body->names.push_back(value_name ? atom(static_cast<uint32_t>(value_name - 1)) : compiler::StringInterner::empty_atom);
+            body->blocks.push_back(block);
+
+            const uint64_t operand_count = in.next();
+            if (operand_count > entry.body_size)
+                return false;
+            body->operand_starts.push_back(static_cast<uint32_t>(body->operand_list.size()));
+            body->operand_counts.push_back(static_cast<uint32_t>(operand_count));
+            for (uint64_t k = 0; k < operand_count; ++k)
+            {
+                const uint32_t operand = decode_operand(value, in.next());
+                if (operand >= count)
+                    return false;
+                body->operand_list.push_back(operand);
+            }
+
+            const uint64_t target_count = in.next();
+            if (target_count > entry.body_size)
+                return false;
+            body->target_starts.push_back(static_cast<uint32_t>(body->target_list.size()));
+            body->target_counts.push_back(static_cast<uint32_t>(target_count));
+            for (uint64_t k = 0; k < target_count; ++k)
+            {
+                const uint64_t successor = in.next();
+                if (successor >= block_count)
+                    return false;
+                body->target_list.push_back(static_cast<uint32_t>(successor));
+            }
+        }
+        if (!in.ok)
+            return false;
+
+        target->function(base + function).body = std::move(body);
+        loaded[function] = 1;
+        return true;
+    }
+
+    uint32_t ModuleImage::materialize_all()
+    {
+        uint32_t failed = 0;
+        for (uint32_t function = 0; function < loaded.size(); ++function)
+            failed += !materialize(function);
+        return failed;
+    }
+}
@@ -0,0 +1,256 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <algorithm>
+#include <vector>
+#include "../include/uir_analysis.h"
+#include "../include/uir_builder.h"
+#include "../include/uir_passes.h"
+
+namespace yu::uir
+{
+    namespace
+    {
+        // a call site is inlined if the callee's size, less what the call itself costs and what
+        // its constant arguments let fold, is at most this many instructions
+        constexpr int32_t inline_threshold = 12;
+        // a caller may grow by its own size, and by at least this many instructions
+        constexpr uint32_t minimum_budget = 64;
+
+        class Inliner
+        {
+        public:
+            Inliner(Module &module, const uint32_t index, const CallGraph &graph) : module(module), index(index),
+                                                                                 graph(graph), caller(module.function(index))
+            {
+            }
+
+            bool run()
+            {
+                std::vector<uint32_t> sites;
+                uint32_t size = 0;
+                for (uint32_t value = 0; value < caller.size(); ++value)
+                {
+                    size += !is_prefix(caller.opcode(value));
+                    if (caller.opcode(value) == Opcode::CALL && inlinable(static_cast<uint32_t>(caller.immediate(value))))
+                        sites.push_back(value);
+                }
+                if (sites.empty())
+                    return false;
+
+                int64_t budget = std::max(size, minimum_budget);
+                Builder builder(module, index);
+                replacement.assign(caller.size(), no_value);
+                bool changed = false;
+                for (const uint32_t site: sites)
+                {
+                    const auto callee = static_cast<uint32_t>(caller.immediate(site));
+                    const Function &body = module.function(callee);
+                    const uint32_t cost = callee_size(body);
+                    if (!(body.attributes() & INLINE) && (!profitable(site, body) || cost > budget))
+                        continue;
+                    budget -= cost;
+                    expand(builder, site, body);
+                    changed = true;
+                }
+                if (!changed)
+                    return false;
+
+                replacement.resize(caller.size(), no_value);
+                for (uint32_t user = 0; user < caller.size(); ++user)
+                {
+                    const auto operands = caller.operands(user);
+                    for (uint32_t k = 0; k < operands.size(); ++k)
+                    {
+                        if (operands[k] < replacement.size() && replacement[operands[k]] != no_value)
+                            caller.set_operand(user, k, resolve(operands[k]));
+                    }
+                }
+                builder.finish();
+                return true;
+            }
+
+        private:
+            Module &module;
+            uint32_t index;
+            const CallGraph &graph;
+            Function &caller;
+            std::vector<uint32_t> replacement; // inlined calls to their result
+
+            static bool is_prefix(const Opcode opcode)
+            {
+                return opcode == Opcode::PARAM || opcode == Opcode::CONST || opcode == Opcode::UNDEF ||
+                       opcode == Opcode::FUNC_ENTRY || opcode == Opcode::NOP;
+            }
+
+            [[nodiscard]] uint32_t resolve(uint32_t value) const
+            {
+                while (value < replacement.size() && replacement[value] != no_value)
+                    value = replacement[value];
+                return value;
+            }
+
+            /**
+             * @brief Callees with a body that are not recursive; inlining those would only unroll
+             * them once. Bodies reading their entry memory state stay calls: at a call site that
+             * state is whatever the caller's stores made it, which UIR calls do not name.
+             */
+            [[nodiscard]] bool inlinable(const uint32_t callee) const
+            {
+                if (callee >= module.function_count() || graph.recursive(callee) ||
+                    graph.component(callee) == graph.component(index))
+                    return false;
+                const Function &body = module.function(callee);
+                if (!body.block_count() || !body.laid_out())
+                    return false;
+                const uint32_t entry_end = body.block_end(0);
+                for (uint32_t value = 0; value < entry_end; ++value)
+                {
+                    if (body.opcode(value) == Opcode::FUNC_ENTRY)
+                        return false;
+                }
+                return true;
+            }
+
+            static uint32_t callee_size(const Function &body)
+            {
+                uint32_t size = 0;
+                for (uint32_t value = 0; value < body.size(); ++value)
+                    size += !is_prefix(body.opcode(value));
+                return size;
+            }
+
+            /**
+             * @brief Weighs the callee's size against what inlining saves: the call and its
+             * argument moves go, and each constant argument folds the uses of its parameter.
+             */
+            [[nodiscard]] bool profitable(const uint32_t site, const Function &body) const
+            {
+                const auto arguments = caller.operands(site);
+                auto saved = static_cast<int32_t>(arguments.size() + 1);
+                for (uint32_t value = 0; value < body.block_end(0); ++value)
+                {
+                    if (body.opcode(value) != Opcode::PARAM || body.immediate(value) >= arguments.size() ||
+                        caller.opcode(arguments[body.immediate(value)]) != Opcode::CONST)
+                        continue;
+                    saved += 2;
+                    for (uint32_t user = 0; user < body.size(); ++user)
+                        saved += static_cast<int32_t>(std::ranges::count(body.operands(user), value));
+                }
+                return static_cast<int32_t>(callee_size(body)) - saved <= inline_threshold;
+            }
+
+            /**
+             * @brief Replaces a call by a copy of the callee's blocks between the two halves of
+             * its block; returns become jumps to the second half, merging their values in a phi.
+             */
+            void expand(Builder &builder, const uint32_t site, const Function &body)
+            {
+                const uint32_t block = caller.block_of(site);
+                const uint32_t rest = builder.split_block(site);
+
+                // the edges out of the block now leave from the second half
+                const auto rest_values = builder.block_values(rest);
+                if (!rest_values.empty() && is_terminator(caller.opcode(rest_values.back())))
+                {
+                    for (const uint32_t successor: caller.targets(rest_values.back()))
+                    {
+                        for (const uint32_t phi: builder.block_values(successor))
+                        {
+                            if (caller.opcode(phi) != Opcode::PHI)
+                                break;
+                            const auto incoming = caller.targets(phi);
+                            for (uint32_t k = 0; k < incoming.size(); ++k)
+                            {
+                                if (incoming[k] == block)
+                                    caller.set_target(phi, k, rest);
+                            }
+                        }
+                    }
+                }
+
+                std::vector blocks(body.block_count(), no_block);
+                for (uint32_t b = 0; b < body.block_count(); ++b)
+                    blocks[b] = builder.create_block();
+
+                // copies keep the callee's operands until every value has its copy
+                std::vector values(body.size(), no_value);
+                std::vector<uint32_t> copies;
+                std::vector<std::pair<uint32_t, uint32_t>> returns; // value, block
+                const auto site_operands = caller.operands(site);
+                const std::vector arguments(site_operands.begin(), site_operands.end());
+                std::vector<uint32_t> targets;
+                for (uint32_t b = 0; b < body.block_count(); ++b)
+                {
+                    builder.set_insert_block(blocks[b]);
+                    for (uint32_t value = body.block_begin(b); value < body.block_end(b); ++value)
+                    {
+                        switch (body.opcode(value))
+                        {
+                            case Opcode::PARAM:
+                                values[value] = arguments[body.immediate(value)];
+                                break;
+                            case Opcode::CONST:
+                                values[value] = builder.constant(body.type(value), body.immediate(value));
+                                break;
+                            case Opcode::UNDEF:
+                                values[value] = builder.undef(body.type(value));
+                                break;
+                            case Opcode::RET:
+                            {
+                                const auto result = body.operands(value);
+                                returns.emplace_back(result.empty() ? no_value : result[0], blocks[b]);
+                                builder.jump(rest);
+                                break;
+                            }
+                            default:
+                            {
+                                targets.clear();
+                                for (const uint32_t target: body.targets(value))
+                                    targets.push_back(blocks[target]);
+                                values[value] = builder.copy(body, value, body.operands(value), targets);
+                                copies.push_back(values[value]);
+                                // a tail call of the callee is no tail call in the caller
+                                if (body.opcode(value) == Opcode::CALL)
+                                    caller.set_flags(values[value], body.flags(value) & ~TAIL);
+                                break;
+                            }
+                        }
+                    }
+                }
+                for (const uint32_t copy: copies)
+                {
+                    const auto operands = caller.operands(copy);
+                    for (uint32_t k = 0; k < operands.size(); ++k)
+                        caller.set_operand(copy, k, values[operands[k]]);
+                }
+
+                caller.remove(site);
+                builder.set_insert_block(block);
+                builder.jump(blocks[0]);
+
+                if (caller.type(site) == primitive(TypeKind::VOID))
+                    return;
+                if (returns.empty())
+                    replacement[site] = builder.undef(caller.type(site));
+                else if (returns.size() == 1)
+                    replacement[site] = values[returns[0].first];
+                else
+                {
+                    builder.set_insert_block(rest);
+                    const uint32_t merged = builder.phi(caller.type(site));
+                    for (const auto &[value, from]: returns)
+                        builder.add_incoming(merged, values[value], from);
+                    replacement[site] = merged;
+                }
+            }
+        };
+    }
+
+    bool inline_calls(Module &module, const uint32_t function, const CallGraph &graph)
+    {
+        if (!module.function(function).block_count())
+            return false;
+        return Inliner(module, function, graph).run();
+    }
+}
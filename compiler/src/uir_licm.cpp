@@ -0,0 +1,253 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <algorithm>
+#include <vector>
+#include "../include/uir_analysis.h"
+#include "../include/uir_builder.h"
+#include "../include/uir_passes.h"
+
+namespace yu::uir
+{
+    namespace
+    {
+        class LoopInvariantMotion
+        {
+        public:
+            LoopInvariantMotion(Module &module, const uint32_t index) : module(module), index(index),
+                                                                        function(module.function(index))
+            {
+            }
+
+            bool run()
+            {
+                bool changed = false;
+                {
+                    const DominatorTree tree(function);
+                    const LoopForest loops(function, tree);
+                    if (!loops.loop_count())
+                        return false;
+                    changed = add_preheaders(loops);
+                }
+
+                // the block ranges and predecessor lists go with the first move
+                const DominatorTree tree(function);
+                const LoopForest loops(function, tree);
+                std::vector<uint32_t> preheaders(loops.loop_count(), no_block);
+                std::vector<std::vector<uint32_t>> exiting(loops.loop_count());
+                clobbered.assign(loops.loop_count(), false);
+                for (uint32_t loop = 0; loop < loops.loop_count(); ++loop)
+                {
+                    const uint32_t header = loops.header(loop);
+                    for (const uint32_t predecessor: function.predecessors(header))
+                    {
+                        if (!loops.contains(loop, predecessor))
+                            preheaders[loop] = predecessor;
+                    }
+                    for (const uint32_t block: loops.blocks(loop))
+                    {
+                        const auto successors = function.successors(block);
+                        if (std::ranges::any_of(successors, [&](const uint32_t s) { return !loops.contains(loop, s); }))
+                            exiting[loop].push_back(block);
+                        for (uint32_t value = function.block_begin(block); value < function.block_end(block); ++value)
+                            clobbered[loop] = clobbered[loop] || writes_unversioned(module, function, value);
+                    }
+                }
+
+                Builder builder(module, index);
+                std::vector<uint32_t> values;
+                bool moved = false;
+                for (uint32_t loop = 0; loop < loops.loop_count(); ++loop)
+                {
+                    if (preheaders[loop] == no_block)
+                        continue;
+                    const auto leaves = [&](const uint32_t block)
+                    {
+                        return !exiting[loop].empty() && std::ranges::all_of(exiting[loop], [&](const uint32_t exit)
+                        {
+                            return tree.dominates(block, exit);
+                        });
+                    };
+                    // dominators first, so the operands of an invariant value have already moved
+                    for (const uint32_t block: loops.blocks(loop))
+                    {
+                        const auto current = builder.block_values(block);
+                        values.assign(current.begin(), current.end());
+                        for (const uint32_t value: values)
+                        {
+                            if (!invariant(loops, loop, value) || (speculative(value) && !leaves(block)))
+                                continue;
+                            builder.set_insert_before(builder.block_values(preheaders[loop]).back());
+                            builder.move(value);
+                            moved = true;
+                        }
+                    }
+                }
+                if (moved)
+                    builder.finish();
+                return changed || moved;
+            }
+
+        private:
+            Module &module;
+            uint32_t index;
+            Function &function;
+            std::vector<bool> clobbered; // loops writing memory without a new memory state
+
+            /**
+             * @brief Gives every loop header entered from more than one block outside the loop,
+             * or from a block with other successors, a block of its own to enter it from. The
+             * header phis' entries from outside move to phis there.
+             */
+            bool add_preheaders(const LoopForest &loops)
+            {
+                struct Entry
+                {
+                    uint32_t loop;
+                    std::vector<uint32_t> outside;
+                };
+                std::vector<Entry> entries;
+                for (uint32_t loop = 0; loop < loops.loop_count(); ++loop)
+                {
+                    const uint32_t header = loops.header(loop);
+                    if (header == 0)
+                        continue;
+                    Entry entry { loop, {} };
+                    for (const uint32_t predecessor: function.predecessors(header))
+                    {
+                        if (!loops.contains(loop, predecessor))
+                            entry.outside.push_back(predecessor);
+                    }
+                    if (entry.outside.size() == 1 && function.successors(entry.outside[0]).size() == 1)
+                        continue;
+                    std::ranges::sort(entry.outside);
+                    entry.outside.erase(std::ranges::unique(entry.outside).begin(), entry.outside.end());
+                    entries.push_back(std::move(entry));
+                }
+                if (entries.empty())
+                    return false;
+
+                // block ranges are gone after the first edit
+                const uint32_t block_count = function.block_count();
+                std::vector<uint32_t> terminators(block_count), phi_begins(block_count), phi_ends(block_count);
+                for (uint32_t block = 0; block < block_count; ++block)
+                {
+                    terminators[block] = function.terminator(block);
+                    phi_begins[block] = function.block_begin(block);
+                    uint32_t value = phi_begins[block];
+                    while (value < function.block_end(block) && function.opcode(value) == Opcode::PHI)
+                        ++value;
+                    phi_ends[block] = value;
+                }
+
+                Builder builder(module, index);
+                std::vector<uint32_t> entering;
+                for (const auto &[loop, outside]: entries)
+                {
+                    const uint32_t header = loops.header(loop);
+                    const uint32_t preheader = builder.create_block();
+                    builder.set_insert_block(preheader);
+                    for (uint32_t phi = phi_begins[header]; phi < phi_ends[header]; ++phi)
+                    {
+                        entering.clear();
+                        const auto incoming = function.targets(phi);
+                        for (uint32_t k = 0; k < incoming.size(); ++k)
+                        {
+                            if (std::ranges::binary_search(outside, incoming[k]))
+                                entering.push_back(k);
+                        }
+                        if (entering.size() == 1)
+                        {
+                            function.set_target(phi, entering[0], preheader);
+                            continue;
+                        }
+                        const uint32_t merged = builder.phi(function.type(phi));
+                        for (const uint32_t k: entering)
+                            builder.add_incoming(merged, function.operands(phi)[k], function.targets(phi)[k]);
+                        for (auto k = entering.rbegin(); k != entering.rend(); ++k)
+                            function.remove_incoming(phi, *k);
+                        builder.add_incoming(phi, merged, preheader);
+                    }
+                    builder.jump(header);
+
+                    for (const uint32_t block: outside)
+                    {
+                        const uint32_t terminator = terminators[block];
+                        const auto targets = function.targets(terminator);
+                        for (uint32_t k = 0; k < targets.size(); ++k)
+                        {
+                            if (targets[k] == header)
+                                function.set_target(terminator, k, preheader);
+                        }
+                    }
+                }
+                builder.finish();
+                return true;
+            }
+
+            /**
+             * @brief True for the values computing the same on every iteration of a loop: pure
+             * operations, loads from a memory state and `@pure` calls whose operands all come
+             * from outside the loop. A memory state from outside is one no store in the loop
+             * changed, since a store in the loop would version it there; the writes that do not
+             * version it, see writes_unversioned(), keep every load of the loop in place.
+             */
+            [[nodiscard]] bool invariant(const LoopForest &loops, const uint32_t loop, const uint32_t value) const
+            {
+                const Opcode opcode = function.opcode(value);
+                switch (opcode)
+                {
+                    case Opcode::NOP:
+                    case Opcode::PHI:
+                        return false;
+                    case Opcode::LOAD:
+                        if (function.operands(value).size() != 2 || clobbered[loop])
+                            return false;
+                        break;
+                    case Opcode::CALL:
+                        if (function.type(value) == primitive(TypeKind::VOID) ||
+                            !(module.function(static_cast<uint32_t>(function.immediate(value))).attributes() & PURE))
+                            return false;
+                        break;
+                    default:
+                        if (info(opcode).traits & (SIDE_EFFECTS | READS_MEMORY | NO_RESULT | TERMINATOR))
+                            return false;
+                        break;
+                }
+                return std::ranges::none_of(function.operands(value), [&](const uint32_t operand)
+                {
+                    return loops.contains(loop, function.block_of(operand));
+                });
+            }
+
+            /**
+             * @brief True for the invariant values that may fault or not terminate, which only
+             * move if their block runs on every iteration that leaves the loop: loads, calls, and
+             * integer divisions by anything but a constant other than 0 and -1.
+             */
+            [[nodiscard]] bool speculative(const uint32_t value) const
+            {
+                const Opcode opcode = function.opcode(value);
+                if (opcode == Opcode::LOAD || opcode == Opcode::CALL)
+                    return true;
+                if (opcode != Opcode::DIV && opcode != Opcode::MOD)
+                    return false;
+                const uint32_t divisor = function.operands(value)[1];
+                if (function.opcode(divisor) != Opcode::CONST)
+                    return true;
+                const TypeId type = function.type(divisor);
+                const uint32_t width = module.types.bits(type);
+                const uint64_t ones = width >= 64 ? ~0ULL : (1ULL << width) - 1;
+                return function.immediate(divisor) == 0 ||
+                       (module.types.is_signed(type) && function.immediate(divisor) == ones);
+            }
+        };
+    }
+
+    bool hoist_loop_invariants(Module &module, const uint32_t function)
+    {
+        if (!module.function(function).block_count())
+            return false;
+        return LoopInvariantMotion(module, function).run();
+    }
+}
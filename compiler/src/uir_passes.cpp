@@ -0,0 +1,33 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/uir_passes.h"
+
+namespace yu::uir
+{
+    void optimize_module(Module &module, std::vector<DiscardedResult> *discarded)
+    {
+        // discarded results are reported before inlining makes the calls disappear
+        if (discarded)
+        {
+            for (uint32_t function = 0; function < module.function_count(); ++function)
+                eliminate_dead_code(module, function, discarded);
+        }
+
+        const CallGraph graph(module);
+        for (const uint32_t function: graph.bottom_up())
+        {
+            if (!module.function(function).block_count())
+                continue;
+            inline_calls(module, function, graph);
+            eliminate_tail_calls(module, function);
+            propagate_constants(module, function);
+            number_values(module, function);
+            hoist_loop_invariants(module, function);
+            eliminate_dead_code(module, function);
+            // removing blocks can leave branches without a use for their condition
+            if (simplify_cfg(module, function))
+                eliminate_dead_code(module, function);
+        }
+    }
+}
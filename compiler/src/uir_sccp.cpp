@@ -0,0 +1,492 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <bit>
+#include <span>
+#include <vector>
+#include "../include/uir_builder.h"
+#include "../include/uir_passes.h"
+
+namespace yu::uir
+{
+    namespace
+    {
+        enum Lattice : uint8_t
+        {
+            UNKNOWN,
+            CONSTANT,
+            OVERDEFINED
+        };
+
+        uint64_t truncate(const uint64_t bits, const uint32_t width)
+        {
+            return width >= 64 ? bits : bits & ((1ULL << width) - 1);
+        }
+
+        int64_t sign_extend(const uint64_t bits, const uint32_t width)
+        {
+            return width == 0 || width >= 64 ? static_cast<int64_t>(bits)
+                                             : static_cast<int64_t>(bits << (64 - width)) >> (64 - width);
+        }
+
+        double float_value(const uint64_t bits, const TypeKind kind)
+        {
+            return kind == TypeKind::F32 ? std::bit_cast<float>(static_cast<uint32_t>(bits)) : std::bit_cast<double>(bits);
+        }
+
+        uint64_t float_bits(const double value, const TypeKind kind)
+        {
+            return kind == TypeKind::F32 ? std::bit_cast<uint32_t>(static_cast<float>(value)) : std::bit_cast<uint64_t>(value);
+        }
+
+        /**
+         * @brief Evaluates an arithmetic, comparison or conversion instruction on constant operands.
+         * @param from The type of the operands.
+         * @param to The type of the result.
+         * @return bool False if the result is not defined at compile time, e.g. a division by zero.
+         */
+        bool fold(const TypeTable &types, const Opcode opcode, const TypeId from, const TypeId to,
+                  const std::span<const uint64_t> in, uint64_t &out)
+        {
+            const uint32_t width = types.bits(from);
+            if (width == 0)
+                return false;
+            const bool is_signed = types.is_signed(from);
+            const uint64_t a = in[0];
+            const uint64_t b = in.size() > 1 ? in[1] : 0;
+            const int64_t sa = sign_extend(a, width);
+            const int64_t sb = sign_extend(b, width);
+            const TypeKind float_kind = types.kind(from);
+            const double fa = float_value(a, float_kind);
+            const double fb = float_value(b, float_kind);
+
+            uint64_t result;
+            switch (opcode)
+            {
+                case Opcode::ADD:
+                    result = a + b;
+                    break;
+                case Opcode::SUB:
+                    result = a - b;
+                    break;
+                case Opcode::MUL:
+                    result = a * b;
+                    break;
+                case Opcode::DIV:
+                case Opcode::MOD:
+                    if (truncate(b, width) == 0 || (is_signed && sb == -1 && sa == sign_extend(1ULL << (width - 1), width)))
+                        return false;
+                    if (is_signed)
+                        result = static_cast<uint64_t>(opcode == Opcode::DIV ? sa / sb : sa % sb);
+                    else
+                        result = opcode == Opcode::DIV ? a / b : a % b;
+                    break;
+                case Opcode::NEG:
+                    result = 0 - a;
+                    break;
+                case Opcode::AND:
+                    result = a & b;
+                    break;
+                case Opcode::OR:
+                    result = a | b;
+                    break;
+                case Opcode::XOR:
+                    result = a ^ b;
+                    break;
+                case Opcode::NOT:
+                    result = ~a;
+                    break;
+                case Opcode::SHL:
+                case Opcode::SHR:
+                case Opcode::SAR:
+                    if (b >= width)
+                        return false;
+                    result = opcode == Opcode::SHL ? a << b : opcode == Opcode::SHR ? a >> b : static_cast<uint64_t>(sa >> b);
+                    break;
+                case Opcode::CMP_EQ:
+                    result = a == b;
+                    break;
+                case Opcode::CMP_NE:
+                    result = a != b;
+                    break;
+                case Opcode::CMP_LT:
+                    result = is_signed ? sa < sb : a < b;
+                    break;
+                case Opcode::CMP_LE:
+                    result = is_signed ? sa <= sb : a <= b;
+                    break;
+                case Opcode::CMP_GT:
+                    result = is_signed ? sa > sb : a > b;
+                    break;
+                case Opcode::CMP_GE:
+                    result = is_signed ? sa >= sb : a >= b;
+                    break;
+                case Opcode::FADD:
+                    result = float_bits(fa + fb, float_kind);
+                    break;
+                case Opcode::FSUB:
+                    result = float_bits(fa - fb, float_kind);
+                    break;
+                case Opcode::FMUL:
+                    result = float_bits(fa * fb, float_kind);
+                    break;
+                case Opcode::FDIV:
+                    result = float_bits(fa / fb, float_kind);
+                    break;
+                case Opcode::FCMP_EQ:
+                    result = fa == fb;
+                    break;
+                case Opcode::FCMP_NE:
+                    result = fa != fb;
+                    break;
+                case Opcode::FCMP_LT:
+                    result = fa < fb;
+                    break;
+                case Opcode::FCMP_LE:
+                    result = fa <= fb;
+                    break;
+                case Opcode::FCMP_GT:
+                    result = fa > fb;
+                    break;
+                case Opcode::FCMP_GE:
+                    result = fa >= fb;
+                    break;
+                case Opcode::ZEXT:
+                case Opcode::TRUNC:
+                    result = a;
+                    break;
+                case Opcode::SEXT:
+                    result = static_cast<uint64_t>(sa);
+                    break;
+                case Opcode::BITCAST:
+                    if (types.bits(to) != width || width == 0)
+                        return false;
+                    result = a;
+                    break;
+                default:
+                    return false;
+            }
+            // integer results are kept zero-extended from their width, like the Builder's constants
+            out = types.is_float(to) ? result : truncate(result, types.bits(to));
+            return types.bits(to) != 0;
+        }
+
+        bool is_foldable(const Opcode opcode)
+        {
+            return opcode >= Opcode::ADD && opcode <= Opcode::BITCAST;
+        }
+
+        class ConstantPropagation
+        {
+        public:
+            ConstantPropagation(Module &module, const uint32_t index) : module(module), index(index),
+                                                                        function(module.function(index)) {}
+
+            bool run()
+            {
+                function.compute_uses();
+                const uint32_t block_count = function.block_count();
+                lattice.assign(function.size(), UNKNOWN);
+                constants.assign(function.size(), 0);
+                queued.assign(function.size(), 0);
+                executable.assign(block_count, 0);
+                edge_starts.assign(block_count + 1, 0);
+                for (uint32_t block = 0; block < block_count; ++block)
+                    edge_starts[block + 1] = edge_starts[block] + static_cast<uint32_t>(function.successors(block).size());
+                edges.assign(edge_starts.back(), 0);
+
+                executable[0] = 1;
+                block_work.push_back(0);
+                solve();
+                return rewrite();
+            }
+
+        private:
+            Module &module;
+            uint32_t index;
+            Function &function;
+
+            std::vector<uint8_t> lattice; // Lattice of each value
+            std::vector<uint64_t> constants;
+            std::vector<uint8_t> queued;
+            std::vector<uint8_t> executable; // per block
+            std::vector<uint32_t> edge_starts; // first edge of each block, one per successor
+            std::vector<uint8_t> edges;        // executable edges
+
+            std::vector<uint32_t> block_work;
+            std::vector<uint32_t> value_work;
+
+            void solve()
+            {
+                while (!block_work.empty() || !value_work.empty())
+                {
+                    while (!block_work.empty())
+                    {
+                        const uint32_t block = block_work.back();
+                        block_work.pop_back();
+                        for (uint32_t value = function.block_begin(block); value < function.block_end(block); ++value)
+                            visit(value);
+                    }
+                    while (!value_work.empty())
+                    {
+                        const uint32_t value = value_work.back();
+                        value_work.pop_back();
+                        queued[value] = 0;
+                        for (const uint32_t user: function.uses(value))
+                        {
+                            if (executable[function.block_of(user)])
+                                visit(user);
+                        }
+                    }
+                }
+            }
+
+            void raise(const uint32_t value, const Lattice state, const uint64_t bits)
+            {
+                if (state <= lattice[value])
+                    return;
+                lattice[value] = state;
+                constants[value] = bits;
+                if (!queued[value])
+                {
+                    queued[value] = 1;
+                    value_work.push_back(value);
+                }
+            }
+
+            void mark_edge(const uint32_t block, const uint32_t slot)
+            {
+                const uint32_t edge = edge_starts[block] + slot;
+                if (edges[edge])
+                    return;
+                edges[edge] = 1;
+
+                const uint32_t successor = function.successors(block)[slot];
+                if (!executable[successor])
+                {
+                    executable[successor] = 1;
+                    block_work.push_back(successor);
+                    return;
+                }
+                // a new edge into a visited block only changes its phis
+                for (uint32_t value = function.block_begin(successor);
+                     value < function.block_end(successor) && function.opcode(value) == Opcode::PHI; ++value)
+                    visit(value);
+            }
+
+            [[nodiscard]] bool edge_executable(const uint32_t from, const uint32_t to) const
+            {
+                const auto successors = function.successors(from);
+                for (uint32_t slot = 0; slot < successors.size(); ++slot)
+                {
+                    if (successors[slot] == to && edges[edge_starts[from] + slot])
+                        return true;
+                }
+                return false;
+            }
+
+            void visit(const uint32_t value)
+            {
+                const Opcode opcode = function.opcode(value);
+                const auto operands = function.operands(value);
+                switch (opcode)
+                {
+                    case Opcode::NOP:
+                        return;
+                    case Opcode::CONST:
+                        raise(value, CONSTANT, function.immediate(value));
+                        return;
+                    case Opcode::PHI:
+                    {
+                        const uint32_t block = function.block_of(value);
+                        const auto incoming = function.targets(value);
+                        for (uint32_t k = 0; k < operands.size(); ++k)
+                        {
+                            if (!edge_executable(incoming[k], block) || lattice[operands[k]] == UNKNOWN)
+                                continue;
+                            if (lattice[operands[k]] == OVERDEFINED ||
+                                (lattice[value] == CONSTANT && constants[value] != constants[operands[k]]))
+                            {
+                                raise(value, OVERDEFINED, 0);
+                                return;
+                            }
+                            raise(value, CONSTANT, constants[operands[k]]);
+                        }
+                        return;
+                    }
+                    case Opcode::JUMP:
+                        mark_edge(function.block_of(value), 0);
+                        return;
+                    case Opcode::BRANCH:
+                    case Opcode::SWITCH:
+                    {
+                        const uint32_t block = function.block_of(value);
+                        if (lattice[operands[0]] == UNKNOWN)
+                            return;
+                        if (lattice[operands[0]] == OVERDEFINED)
+                        {
+                            for (uint32_t slot = 0; slot < function.targets(value).size(); ++slot)
+                                mark_edge(block, slot);
+                            return;
+                        }
+                        mark_edge(block, taken_slot(value));
+                        return;
+                    }
+                    default:
+                        break;
+                }
+                if (is_terminator(opcode))
+                    return;
+                if (!is_foldable(opcode))
+                {
+                    raise(value, OVERDEFINED, 0);
+                    return;
+                }
+
+                uint64_t in[2] = {};
+                for (uint32_t k = 0; k < operands.size() && k < 2; ++k)
+                {
+                    if (lattice[operands[k]] != CONSTANT)
+                    {
+                        if (lattice[operands[k]] == OVERDEFINED)
+                            raise(value, OVERDEFINED, 0);
+                        return;
+                    }
+                    in[k] = constants[operands[k]];
+                }
+                uint64_t bits;
+                if (operands.empty() || !fold(module.types, opcode, function.type(operands[0]), function.type(value),
+                                              std::span(in, operands.size()), bits))
+                    raise(value, OVERDEFINED, 0);
+                else
+                    raise(value, CONSTANT, bits);
+            }
+
+            /**
+             * @brief The successor slot a branch or switch on a constant takes.
+             */
+            [[nodiscard]] uint32_t taken_slot(const uint32_t terminator) const
+            {
+                const auto operands = function.operands(terminator);
+                const uint64_t bits = constants[operands[0]];
+                if (function.opcode(terminator) == Opcode::BRANCH)
+                    return bits ? 0 : 1;
+                for (uint32_t k = 1; k < operands.size(); ++k)
+                {
+                    if (function.immediate(operands[k]) == bits)
+                        return k;
+                }
+                return 0;
+            }
+
+            bool rewrite()
+            {
+                // block ranges are gone after the first edit, so take them now, with the successor
+                // each branch or switch on a constant takes
+                const uint32_t block_count = function.block_count();
+                std::vector<uint32_t> starts(block_count + 1);
+                std::vector<uint32_t> terminators(block_count);
+                std::vector taken(block_count, no_value);
+                for (uint32_t block = 0; block < block_count; ++block)
+                {
+                    starts[block] = function.block_begin(block);
+                    terminators[block] = function.terminator(block);
+                    const Opcode opcode = function.opcode(terminators[block]);
+                    if ((opcode == Opcode::BRANCH || opcode == Opcode::SWITCH) &&
+                        lattice[function.operands(terminators[block])[0]] == CONSTANT)
+                        taken[block] = taken_slot(terminators[block]);
+                }
+                starts[block_count] = function.size();
+
+                Builder builder(module, index);
+                bool changed = false;
+
+                std::vector replacement(function.size(), no_value);
+                for (uint32_t value = 0; value < replacement.size(); ++value)
+                {
+                    if (lattice[value] == CONSTANT && function.opcode(value) != Opcode::CONST)
+                        replacement[value] = builder.constant(function.type(value), constants[value]);
+                }
+                for (uint32_t user = 0; user < function.size(); ++user)
+                {
+                    const auto operands = function.operands(user);
+                    for (uint32_t k = 0; k < operands.size(); ++k)
+                    {
+                        if (operands[k] < replacement.size() && replacement[operands[k]] != no_value)
+                            function.set_operand(user, k, replacement[operands[k]]);
+                    }
+                }
+                for (uint32_t value = 0; value < replacement.size(); ++value)
+                {
+                    if (replacement[value] != no_value)
+                    {
+                        function.remove(value);
+                        changed = true;
+                    }
+                }
+
+                // removing an edge removes the matching incoming value of the successor's phis
+                const auto drop_edge = [this, &starts](const uint32_t from, const uint32_t to)
+                {
+                    for (uint32_t value = starts[to]; value < starts[to + 1]; ++value)
+                    {
+                        const Opcode opcode = function.opcode(value);
+                        if (opcode != Opcode::PHI && opcode != Opcode::NOP)
+                            break;
+                        const auto incoming = function.targets(value);
+                        for (uint32_t k = 0; k < incoming.size(); ++k)
+                        {
+                            if (incoming[k] == from)
+                            {
+                                function.remove_incoming(value, k);
+                                break;
+                            }
+                        }
+                    }
+                };
+
+                for (uint32_t block = 0; block < block_count; ++block)
+                {
+                    const uint32_t terminator = terminators[block];
+                    const auto successors = function.targets(terminator);
+                    if (!executable[block])
+                    {
+                        if (starts[block + 1] - starts[block] == 1 && function.opcode(terminator) == Opcode::UNREACHABLE)
+                            continue;
+                        for (const uint32_t successor: successors)
+                            drop_edge(block, successor);
+                        for (uint32_t value = starts[block]; value < starts[block + 1]; ++value)
+                            function.remove(value);
+                        builder.set_insert_block(block);
+                        builder.unreachable();
+                        changed = true;
+                        continue;
+                    }
+
+                    if (taken[block] == no_value)
+                        continue;
+                    const uint32_t destination = successors[taken[block]];
+                    for (uint32_t slot = 0; slot < successors.size(); ++slot)
+                    {
+                        if (slot != taken[block])
+                            drop_edge(block, successors[slot]);
+                    }
+                    function.remove(terminator);
+                    builder.set_insert_block(block);
+                    builder.jump(destination);
+                    changed = true;
+                }
+
+                builder.finish();
+                return changed;
+            }
+        };
+    }
+
+    bool propagate_constants(Module &module, const uint32_t function)
+    {
+        if (!module.function(function).block_count())
+            return false;
+        return ConstantPropagation(module, function).run();
+    }
+}
@@ -0,0 +1,131 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <vector>
+#include "../include/uir_builder.h"
+#include "../include/uir_passes.h"
+
+namespace yu::uir
+{
+    namespace
+    {
+        /**
+         * @brief True if `call` is directly followed by `ret`, which returns its result, or
+         * returns nothing after a void call.
+         */
+        bool in_tail_position(const Function &function, const uint32_t call, const uint32_t ret)
+        {
+            const Opcode opcode = function.opcode(call);
+            if (opcode != Opcode::CALL && opcode != Opcode::CALL_INDIRECT)
+                return false;
+            const auto result = function.operands(ret);
+            return result.empty() ? function.type(call) == primitive(TypeKind::VOID) : result[0] == call;
+        }
+
+        /**
+         * @brief Turns the self tail calls into jumps to a loop header after the entry block,
+         * whose phis carry the parameters: the entry value, then each call's arguments.
+         */
+        void loop_self_calls(Module &module, const uint32_t index, const std::vector<uint32_t> &calls)
+        {
+            Function &function = module.function(index);
+            const std::vector successors(function.successors(0).begin(), function.successors(0).end());
+            Builder builder(module, index);
+            const uint32_t header = builder.move_instructions(0);
+            for (const uint32_t successor: successors)
+            {
+                for (const uint32_t phi: builder.block_values(successor))
+                {
+                    if (function.opcode(phi) != Opcode::PHI)
+                        break;
+                    const auto incoming = function.targets(phi);
+                    for (uint32_t k = 0; k < incoming.size(); ++k)
+                    {
+                        if (incoming[k] == 0)
+                            function.set_target(phi, k, header);
+                    }
+                }
+            }
+            builder.set_insert_block(0);
+            builder.jump(header);
+
+            const uint32_t param_count = static_cast<uint32_t>(function.params().size());
+            std::vector<uint32_t> params(param_count), phis(param_count);
+            builder.set_insert_block(header);
+            for (uint32_t i = 0; i < param_count; ++i)
+            {
+                params[i] = builder.param(i);
+                phis[i] = builder.phi(function.params()[i]);
+            }
+            for (const uint32_t call: calls)
+            {
+                const uint32_t block = function.block_of(call);
+                for (uint32_t i = 0; i < param_count; ++i)
+                    builder.add_incoming(phis[i], function.operands(call)[i], block);
+                function.remove(call);
+                function.remove(call + 1);
+                builder.set_insert_block(block);
+                builder.jump(header);
+            }
+
+            // the parameters now hold their value in the first iteration only
+            std::vector replacement(function.size(), no_value);
+            for (uint32_t i = 0; i < param_count; ++i)
+                replacement[params[i]] = phis[i];
+            for (uint32_t user = 0; user < function.size(); ++user)
+            {
+                const auto operands = function.operands(user);
+                for (uint32_t k = 0; k < operands.size(); ++k)
+                {
+                    if (operands[k] < replacement.size() && replacement[operands[k]] != no_value)
+                        function.set_operand(user, k, replacement[operands[k]]);
+                }
+            }
+            for (uint32_t i = 0; i < param_count; ++i)
+                builder.add_incoming(phis[i], params[i], 0);
+            builder.finish();
+        }
+    }
+
+    bool eliminate_tail_calls(Module &module, const uint32_t index)
+    {
+        Function &function = module.function(index);
+        const uint32_t block_count = function.block_count();
+        if (!block_count)
+            return false;
+
+        // a sibling call would release the stack slots its arguments may point to; a loop would
+        // need to merge the memory state, which calls do not name, of every iteration
+        bool entry_memory = false;
+        for (uint32_t value = 0; value < function.size(); ++value)
+        {
+            if (function.opcode(value) == Opcode::ALLOC)
+                return false;
+            entry_memory |= function.opcode(value) == Opcode::FUNC_ENTRY;
+        }
+        function.compute_predecessors();
+        const bool loop = !entry_memory && function.predecessors(0).empty();
+
+        bool changed = false;
+        std::vector<uint32_t> self_calls;
+        for (uint32_t block = 0; block < block_count; ++block)
+        {
+            const uint32_t ret = function.terminator(block);
+            if (ret == no_value || function.opcode(ret) != Opcode::RET || ret == function.block_begin(block) ||
+                !in_tail_position(function, ret - 1, ret))
+                continue;
+            const uint32_t call = ret - 1;
+            if (loop && function.opcode(call) == Opcode::CALL && function.immediate(call) == index)
+                self_calls.push_back(call);
+            else if (!(function.flags(call) & TAIL))
+            {
+                function.set_flags(call, function.flags(call) | TAIL);
+                changed = true;
+            }
+        }
+        if (self_calls.empty())
+            return changed;
+        loop_self_calls(module, index, self_calls);
+        return true;
+    }
+}
@@ -0,0 +1,1643 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/uir_text.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+#include "../include/hash.h"
+#include "../include/interner.h"
+
+namespace yu::uir
+{
+    namespace
+    {
+        using compiler::StringInterner;
+
+        constexpr std::string_view ordering_names[] = {
+            "unordered", "monotonic", "acquire", "release", "acq_rel", "seq_cst"
+        };
+
+        // indexed by the bit of each FunctionAttributes flag
+        constexpr std::array<std::string_view, 4> attribute_names = { "pure", "tailrec", "nodiscard", "inline" };
+
+        constexpr std::string_view primitive_names[primitive_type_count] = {
+            "void", "bool", "i8", "u8", "i16", "u16", "i32", "u32", "i64", "u64", "f32", "f64", "ptr", "mem"
+        };
+
+        bool is_binary(const Opcode opcode)
+        {
+            return (opcode >= Opcode::ADD && opcode <= Opcode::SAR && opcode != Opcode::NEG && opcode != Opcode::NOT) ||
+                   (opcode >= Opcode::CMP_EQ && opcode <= Opcode::FCMP_GE);
+        }
+
+        bool is_conversion(const Opcode opcode)
+        {
+            return opcode >= Opcode::ZEXT && opcode <= Opcode::PTRTOINT;
+        }
+
+        bool is_atomic_rmw(const Opcode opcode)
+        {
+            return opcode >= Opcode::ATOMIC_ADD && opcode <= Opcode::ATOMIC_XOR;
+        }
+
+        // the values Builder keeps at the top of the entry block
+        bool in_prefix(const Opcode opcode)
+        {
+            return opcode == Opcode::PARAM || opcode == Opcode::CONST || opcode == Opcode::UNDEF ||
+                   opcode == Opcode::FUNC_ENTRY;
+        }
+
+        constexpr std::array<uint8_t, 256> name_chars = []
+        {
+            std::array<uint8_t, 256> table {};
+            for (int i = 0; i < 256; ++i)
+            {
+                table[i] = (i >= 'a' && i <= 'z') || (i >= 'A' && i <= 'Z') || (i >= '0' && i <= '9') || i == '_' ||
+                           i == '.';
+            }
+            return table;
+        }();
+
+        bool is_name_char(const char c)
+        {
+            return name_chars[static_cast<uint8_t>(c)];
+        }
+
+        bool is_digits(const std::string_view text)
+        {
+            return !text.empty() && std::ranges::all_of(text, [](const char c) { return c >= '0' && c <= '9'; });
+        }
+
+        class FunctionPrinter
+        {
+        public:
+            FunctionPrinter(const Module &module, const uint32_t index, std::string &out,
+                            std::vector<std::string> &type_names) :
+                module(module), function(module.function(index)), out(out), type_names(type_names) {}
+
+            void print()
+            {
+                const StringInterner &interner = StringInterner::global();
+                out.reserve(out.size() + 64 + function.size() * 32);
+
+                // the first value with a name gets it plainly, later ones add their index
+                duplicate.assign(function.size(), false);
+                std::unordered_set<uint32_t> seen;
+                std::vector param_values(function.params().size(), no_value);
+                for (uint32_t value = 0; value < function.size(); ++value)
+                {
+                    if (const uint32_t name = function.value_name(value); name != StringInterner::empty_atom)
+                        duplicate[value] = !seen.insert(name).second;
+                    if (function.opcode(value) == Opcode::PARAM && function.immediate(value) < param_values.size() &&
+                        param_values[function.immediate(value)] == no_value)
+                        param_values[function.immediate(value)] = value;
+                }
+
+                put("func ");
+                put(interner.view(function.name()));
+                out += '(';
+                for (uint32_t i = 0; i < param_values.size(); ++i)
+                {
+                    if (i)
+                        put(", ");
+                    if (param_values[i] != no_value)
+                        value(param_values[i]);
+                    else
+                    {
+                        // past every value, so the name is free
+                        out += '%';
+                        put_number(function.size() + i);
+                    }
+                    put(": ");
+                    put(type(function.params()[i]));
+                }
+                put(") -> ");
+                put(type(function.return_type()));
+                for (uint32_t bit = 0; bit < attribute_names.size(); ++bit)
+                {
+                    if (function.attributes() & 1u << bit)
+                    {
+                        out += ' ';
+                        put(attribute_names[bit]);
+                    }
+                }
+                if (function.block_count() == 0)
+                {
+                    out += '\n';
+                    return;
+                }
+                if (!function.laid_out())
+                    throw std::logic_error("UIR function must be laid out to be printed");
+
+                put(":\n");
+                for (uint32_t block = 0; block < function.block_count(); ++block)
+                {
+                    put("    ");
+                    label(block);
+                    put(":\n");
+                    for (uint32_t value = function.block_begin(block); value < function.block_end(block); ++value)
+                    {
+                        if (function.opcode(value) == Opcode::PARAM || function.opcode(value) == Opcode::NOP)
+                            continue;
+                        put("        ");
+                        instruction(value);
+                        out += '\n';
+                    }
+                }
+            }
+
+        private:
+            const Module &module;
+            const Function &function;
+            std::string &out;
+            std::vector<std::string> &type_names; // cache, TypeTable::name() builds strings
+            std::vector<uint8_t> duplicate;
+
+            void put(const std::string_view text)
+            {
+                out.append(text);
+            }
+
+            void put_number(const uint64_t number, const int base = 10)
+            {
+                char buffer[24];
+                out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), number, base).ptr);
+            }
+
+            const std::string &type(const TypeId id)
+            {
+                if (type_names.size() <= id)
+                    type_names.resize(module.types.size());
+                if (type_names[id].empty())
+                    type_names[id] = module.types.name(id);
+                return type_names[id];
+            }
+
+            void value(const uint32_t id)
+            {
+                out += '%';
+                if (id >= function.size())
+                {
+                    out += '?';
+                    return;
+                }
+                const uint32_t name = function.value_name(id);
+                if (name == StringInterner::empty_atom)
+                {
+                    put_number(id);
+                    return;
+                }
+                put(StringInterner::global().view(name));
+                if (duplicate[id])
+                {
+                    out += '.';
+                    put_number(id);
+                }
+            }
+
+            void label(const uint32_t block)
+            {
+                put("bb");
+                put_number(block);
+            }
+
+            void typed(const uint32_t id)
+            {
+                put(type(function.type(id)));
+                out += ' ';
+                value(id);
+            }
+
+            void address(const uint32_t pointer, const uint64_t offset)
+            {
+                out += '[';
+                value(pointer);
+                if (offset)
+                {
+                    put(" + ");
+                    put_number(offset);
+                }
+                out += ']';
+            }
+
+            void literal(const TypeId id, const uint64_t bits)
+            {
+                const TypeTable &types = module.types;
+                if (id == primitive(TypeKind::BOOL))
+                    put(bits ? "true" : "false");
+                else if (types.is_float(id))
+                {
+                    char buffer[48];
+                    const bool single = id == primitive(TypeKind::F32);
+                    const double number = single ? std::bit_cast<float>(static_cast<uint32_t>(bits))
+                                                 : std::bit_cast<double>(bits);
+                    if (std::isnan(number))
+                    {
+                        // keeps the payload
+                        put("0x");
+                        put_number(bits, 16);
+                        return;
+                    }
+                    const auto result = single ? std::to_chars(buffer, buffer + sizeof(buffer), static_cast<float>(number))
+                                               : std::to_chars(buffer, buffer + sizeof(buffer), number);
+                    out.append(buffer, result.ptr);
+                }
+                else if (types.is_signed(id) && bits >> (types.bits(id) - 1) & 1)
+                {
+                    // sign-extended magnitude
+                    out += '-';
+                    put_number(types.bits(id) == 64 ? 0 - bits : (1ULL << types.bits(id)) - bits);
+                }
+                else
+                    put_number(bits);
+            }
+
+            void ordering(const Ordering order)
+            {
+                put(ordering_names[static_cast<uint8_t>(order)]);
+            }
+
+            void arguments(const std::span<const uint32_t> values)
+            {
+                out += '(';
+                for (uint32_t i = 0; i < values.size(); ++i)
+                {
+                    if (i)
+                        put(", ");
+                    typed(values[i]);
+                }
+                out += ')';
+            }
+
+            void instruction(const uint32_t id)
+            {
+                const Opcode opcode = function.opcode(id);
+                const std::span<const uint32_t> operands = function.operands(id);
+                const std::span<const uint32_t> targets = function.targets(id);
+                const TypeId result = function.type(id);
+                const uint64_t immediate = function.immediate(id);
+                const uint8_t flags = function.flags(id);
+
+                if (result != primitive(TypeKind::VOID))
+                {
+                    value(id);
+                    put(" = ");
+                }
+                if ((opcode == Opcode::CALL || opcode == Opcode::CALL_INDIRECT) && flags & TAIL)
+                    put("tail ");
+                if (opcode == Opcode::INTRINSIC)
+                {
+                    put("intrinsic.");
+                    put(StringInterner::global().view(static_cast<uint32_t>(immediate)));
+                }
+                else
+                    put(info(opcode).name);
+                out += ' ';
+
+                if (is_binary(opcode))
+                {
+                    typed(operands[0]);
+                    put(", ");
+                    value(operands[1]);
+                    return;
+                }
+                if (is_conversion(opcode))
+                {
+                    typed(operands[0]);
+                    put(" to ");
+                    put(type(result));
+                    return;
+                }
+                if (is_atomic_rmw(opcode))
+                {
+                    put(type(result));
+                    out += ' ';
+                    address(operands[0], immediate);
+                    put(", ");
+                    value(operands[1]);
+                    put(", ");
+                    ordering(success_ordering(flags));
+                    return;
+                }
+
+                switch (opcode)
+                {
+                    case Opcode::CONST:
+                        put(type(result));
+                        out += ' ';
+                        literal(result, immediate);
+                        break;
+                    case Opcode::UNDEF:
+                        put(type(result));
+                        break;
+                    case Opcode::NEG:
+                    case Opcode::NOT:
+                        typed(operands[0]);
+                        break;
+                    case Opcode::ALLOC:
+                        put(type(module.types.element(result)));
+                        break;
+                    case Opcode::LOAD:
+                    case Opcode::ATOMIC_LOAD:
+                        put(type(result));
+                        out += ' ';
+                        address(operands[0], immediate);
+                        if (opcode == Opcode::ATOMIC_LOAD)
+                        {
+                            put(", ");
+                            ordering(success_ordering(flags));
+                        }
+                        else if (operands.size() > 1)
+                        {
+                            put(", ");
+                            value(operands[1]);
+                        }
+                        break;
+                    case Opcode::STORE:
+                    case Opcode::ATOMIC_STORE:
+                        typed(operands[0]);
+                        put(", ");
+                        address(operands[1], immediate);
+                        if (opcode == Opcode::ATOMIC_STORE)
+                        {
+                            put(", ");
+                            ordering(success_ordering(flags));
+                        }
+                        else if (operands.size() > 2)
+                        {
+                            put(", ");
+                            value(operands[2]);
+                        }
+                        break;
+                    case Opcode::BARRIER:
+                    case Opcode::BARRIER_ACQ:
+                    case Opcode::BARRIER_REL:
+                        value(operands[0]);
+                        break;
+                    case Opcode::CMPXCHG:
+                        put(type(result));
+                        out += ' ';
+                        address(operands[0], immediate);
+                        put(", ");
+                        value(operands[1]);
+                        put(", ");
+                        value(operands[2]);
+                        put(", ");
+                        ordering(success_ordering(flags));
+                        put(", ");
+                        ordering(failure_ordering(flags));
+                        break;
+                    case Opcode::PHI:
+                        put(type(result));
+                        for (uint32_t i = 0; i < operands.size(); ++i)
+                        {
+                            put(i ? ", [" : " [");
+                            value(operands[i]);
+                            put(", ");
+                            label(targets[i]);
+                            out += ']';
+                        }
+                        break;
+                    case Opcode::CALL:
+                        put(type(result));
+                        put(" @");
+                        put(StringInterner::global().view(module.function(static_cast<uint32_t>(immediate)).name()));
+                        arguments(operands);
+                        break;
+                    case Opcode::CALL_INDIRECT:
+                        put(type(result));
+                        out += ' ';
+                        value(operands[0]);
+                        arguments(operands.subspan(1));
+                        break;
+                    case Opcode::INTRINSIC:
+                        put(type(result));
+                        for (uint32_t i = 0; i < operands.size(); ++i)
+                        {
+                            put(i ? ", " : " ");
+                            value(operands[i]);
+                        }
+                        break;
+                    case Opcode::JUMP:
+                        label(targets[0]);
+                        break;
+                    case Opcode::BRANCH:
+                        value(operands[0]);
+                        put(", ");
+                        label(targets[0]);
+                        put(", ");
+                        label(targets[1]);
+                        break;
+                    case Opcode::SWITCH:
+                        typed(operands[0]);
+                        put(", ");
+                        label(targets[0]);
+                        put(", [");
+                        for (uint32_t i = 1; i < operands.size(); ++i)
+                        {
+                            if (i > 1)
+                                put(", ");
+                            literal(function.type(operands[i]), function.immediate(operands[i]));
+                            put(": ");
+                            label(targets[i]);
+                        }
+                        out += ']';
+                        break;
+                    case Opcode::RET:
+                        if (!operands.empty())
+                            typed(operands[0]);
+                        break;
+                    default:
+                        break;
+                }
+                // no trailing space after bare mnemonics such as `ret` and `func_entry`
+                if (out.back() == ' ')
+                    out.pop_back();
+            }
+        };
+
+        struct SyntaxError
+        {
+            std::string message;
+            uint32_t line;
+            uint32_t column;
+        };
+
+        uint64_t hash_key(const std::string_view name)
+        {
+            return compiler::hash_bytes(name);
+        }
+
+        uint64_t hash_key(const std::pair<TypeId, uint64_t> &constant)
+        {
+            return compiler::hash_mix(compiler::hash_mix(constant.first) ^ constant.second);
+        }
+
+        /**
+         * @brief Open-addressing map for the reader's per-token lookups, by name or by constant;
+         * names are views into the text and must outlive the table.
+         */
+        template <typename Key, typename T>
+        class LookupTable
+        {
+        public:
+            [[nodiscard]] const T *find(const Key &key) const
+            {
+                const uint64_t hash = hash_key(key);
+                for (size_t i = hash & mask();; i = (i + 1) & mask())
+                {
+                    if (!slots[i].used)
+                        return nullptr;
+                    if (slots[i].hash == hash && slots[i].key == key)
+                        return &slots[i].value;
+                }
+            }
+
+            /**
+             * @return T & The entry of the key, added as `value` if it was missing.
+             */
+            T &try_emplace(const Key &key, const T &value)
+            {
+                if ((count + 1) * 2 > slots.size())
+                    grow();
+                const uint64_t hash = hash_key(key);
+                size_t i = hash & mask();
+                for (; slots[i].used; i = (i + 1) & mask())
+                {
+                    if (slots[i].hash == hash && slots[i].key == key)
+                        return slots[i].value;
+                }
+                ++count;
+                slots[i] = { hash, key, value, true };
+                return slots[i].value;
+            }
+
+        private:
+            struct Slot
+            {
+                uint64_t hash;
+                Key key;
+                T value;
+                bool used;
+            };
+
+            std::vector<Slot> slots = std::vector<Slot>(16);
+            size_t count = 0;
+
+            [[nodiscard]] size_t mask() const
+            {
+                return slots.size() - 1;
+            }
+
+            void grow()
+            {
+                std::vector<Slot> old(slots.size() * 2);
+                old.swap(slots);
+                for (const Slot &slot: old)
+                {
+                    if (!slot.used)
+                        continue;
+                    size_t i = slot.hash & mask();
+                    while (slots[i].used)
+                        i = (i + 1) & mask();
+                    slots[i] = slot;
+                }
+            }
+        };
+
+        template <typename T>
+        using NameTable = LookupTable<std::string_view, T>;
+    }
+
+    /**
+     * @brief Reads UIR text line by line; a syntax error is thrown as SyntaxError.
+     *
+     * A body is staged in the order it is read and then laid out once into the function's columns,
+     * the way Builder::finish() would lay it out; text as print_function() writes it is already in
+     * that order and is copied column by column.
+     */
+    class TextReader
+    {
+    public:
+        TextReader(const std::string_view text, Module &module) :
+            text_begin(text.data()), text_end(text.data() + text.size()), next(text.data()), module(module),
+            extending(module.function_count() != 0) {}
+
+        void read()
+        {
+            struct Header
+            {
+                uint32_t function;
+                const char *body;
+                uint32_t line;
+                uint32_t first_param; // in param_names
+            };
+            std::vector<Header> headers;
+            std::vector<std::string_view> param_names;
+
+            // declare every function first, then fill in the bodies
+            while (next_line())
+            {
+                if (!at_func())
+                {
+                    if (headers.empty() && p != line_end)
+                        fail("Expected a function header");
+                    continue;
+                }
+                Header header { 0, nullptr, line, static_cast<uint32_t>(param_names.size()) };
+                bool has_body = false;
+                header.function = read_header(param_names, has_body);
+                header.body = has_body ? next : nullptr;
+                headers.push_back(header);
+            }
+
+            for (const Header &header: headers)
+            {
+                if (!header.body)
+                    continue;
+                next = header.body;
+                line = header.line;
+                const size_t param_count = module.function(header.function).params().size();
+                read_body(header.function, std::span(param_names).subspan(header.first_param, param_count));
+            }
+        }
+
+    private:
+        struct Forward
+        {
+            std::string_view name;
+            uint32_t line;
+            uint32_t column;
+            TypeId expected;
+            uint32_t slot; // in the staged operand list
+        };
+
+        // names and constants outlive the body they were read in, so their entry is reused by the
+        // next body instead of being freed; `body` tells whose value an entry holds
+        struct Named
+        {
+            uint32_t body;
+            uint32_t value;
+            uint32_t atom; // of the name without its `.N` suffix, once interned
+        };
+
+        struct Constant
+        {
+            uint32_t body;
+            uint32_t value;
+        };
+
+        static constexpr TypeId any_type = no_value;
+
+        const char *const text_begin;
+        const char *const text_end;
+        const char *next;        // start of the next line
+        const char *line_start = nullptr;
+        const char *line_end = nullptr; // without comment and trailing space
+        const char *p = nullptr;
+        const char *token = nullptr; // start of the last token read, where errors point
+        uint32_t line = 0;
+
+        Module &module;
+        const bool extending; // the module had functions before this text
+        NameTable<uint32_t> functions; // declared by this text
+        std::unique_ptr<Function::Body> staged = Function::make_body(); // the body being read, in text order
+        uint32_t current_block = 0;
+        std::vector<uint8_t> terminated; // blocks already ending in a terminator
+        uint32_t entry_memory = no_value;
+        uint32_t body_index = no_function; // the function whose body is being read
+        LookupTable<std::pair<TypeId, uint64_t>, Constant> constants;
+        std::vector<uint32_t> numbered; // values named like `%12`, by number
+        NameTable<Named> named;
+        std::vector<Forward> forward; // operands used before their definition, in the order read
+        size_t placed = 0;            // forward operands already given a slot
+        std::vector<uint32_t> layout, remap, offsets;
+        std::vector<uint32_t> listed_operands, listed_targets; // of the instruction being read
+
+        [[noreturn]] void fail(std::string message) const
+        {
+            const char *const at = token ? token : p;
+            throw SyntaxError { std::move(message), line, static_cast<uint32_t>(at - line_start) + 1 };
+        }
+
+        // lines
+
+        /**
+         * @brief The next newline, or with `comments` the next '#' if that comes first, eight bytes
+         * at a time like the lexer's whitespace skipping.
+         */
+        [[nodiscard]] const char *find_newline(const char *from, const bool comments) const
+        {
+            // high bit set in the lowest byte that was the character (and maybe in later ones)
+            const auto matches = [](const uint64_t chunk, const uint64_t repeated)
+            {
+                const uint64_t x = chunk ^ repeated;
+                return (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+            };
+            const uint64_t hashes = comments ? 0x2323232323232323ULL : 0x0A0A0A0A0A0A0A0AULL;
+            while (from + 8 <= text_end)
+            {
+                uint64_t chunk;
+                std::memcpy(&chunk, from, sizeof(chunk));
+                if (const uint64_t found = matches(chunk, 0x0A0A0A0A0A0A0A0AULL) | matches(chunk, hashes))
+                    return from + std::countr_zero(found) / 8;
+                from += 8;
+            }
+            while (from < text_end && *from != '\n' && !(comments && *from == '#'))
+                ++from;
+            return from;
+        }
+
+        ALWAYS_INLINE void skip_spaces()
+        {
+            if (p < line_end && *p != ' ' && *p != '\t')
+                return;
+            while (p + 8 <= line_end)
+            {
+                uint64_t chunk;
+                std::memcpy(&chunk, p, sizeof(chunk));
+                if (chunk != 0x2020202020202020ULL)
+                    break;
+                p += 8;
+            }
+            while (p < line_end && (*p == ' ' || *p == '\t'))
+                ++p;
+        }
+
+        bool next_line()
+        {
+            if (next >= text_end)
+                return false;
+            line_start = next;
+            line_end = find_newline(next, true);
+            // a comment runs to the newline
+            const char *const newline = line_end < text_end && *line_end == '#' ? find_newline(line_end, false)
+                                                                                : line_end;
+            next = newline < text_end ? newline + 1 : text_end;
+            ++line;
+
+            while (line_end > line_start && (line_end[-1] == ' ' || line_end[-1] == '\t' || line_end[-1] == '\r'))
+                --line_end;
+            p = line_start;
+            token = nullptr;
+            skip_spaces();
+            return true;
+        }
+
+        [[nodiscard]] bool at_func() const
+        {
+            return line_end - p >= 5 && std::memcmp(p, "func", 4) == 0 && !is_name_char(p[4]);
+        }
+
+        // tokens
+
+        ALWAYS_INLINE bool eat(const char c)
+        {
+            skip_spaces();
+            token = p;
+            if (p == line_end || *p != c)
+                return false;
+            ++p;
+            return true;
+        }
+
+        void expect(const char c)
+        {
+            if (!eat(c))
+                fail(std::string("Expected '") + c + "'");
+        }
+
+        void expect_end()
+        {
+            skip_spaces();
+            if (p != line_end)
+                fail("Unexpected '" + std::string(p, line_end) + "'");
+        }
+
+        ALWAYS_INLINE std::string_view word()
+        {
+            skip_spaces();
+            token = p;
+            while (p < line_end && is_name_char(*p))
+                ++p;
+            return { token, static_cast<size_t>(p - token) };
+        }
+
+        uint64_t number()
+        {
+            const std::string_view digits = word();
+            const bool hex = digits.starts_with("0x");
+            uint64_t result = 0;
+            const char *const first = digits.data() + (hex ? 2 : 0);
+            const auto [end, status] = std::from_chars(first, digits.data() + digits.size(), result, hex ? 16 : 10);
+            if (digits.empty() || status != std::errc() || end != digits.data() + digits.size())
+                fail("Expected a number");
+            return result;
+        }
+
+        TypeId type()
+        {
+            TypeTable &types = module.types;
+            const std::string_view name = word();
+            if (const TypeId *const kind = primitives().find(name))
+            {
+                if (*kind != primitive(TypeKind::PTR) || !eat('<'))
+                    return *kind;
+                const TypeId element = type();
+                expect('>');
+                return types.pointer_to(element);
+            }
+            if (name == "array" || name == "vector")
+            {
+                expect('<');
+                const TypeId element = type();
+                expect(',');
+                const uint64_t count = number();
+                expect('>');
+                if (count > std::numeric_limits<uint32_t>::max())
+                    fail("Too many elements");
+                return name == "array" ? types.array_of(element, static_cast<uint32_t>(count))
+                                       : types.vector_of(element, static_cast<uint32_t>(count));
+            }
+            if (name == "struct")
+            {
+                expect('<');
+                expect('{');
+                std::vector<TypeId> fields;
+                if (!eat('}'))
+                {
+                    do
+                        fields.push_back(type());
+                    while (eat(','));
+                    expect('}');
+                }
+                expect('>');
+                return types.structure(fields);
+            }
+            fail("Unknown type '" + std::string(name) + "'");
+        }
+
+        /**
+         * @brief The bits of a constant of the given type, as printed by FunctionPrinter::literal().
+         */
+        uint64_t literal(const TypeId id)
+        {
+            const TypeTable &types = module.types;
+            skip_spaces();
+            const char *const start = token = p;
+            while (p < line_end && (is_name_char(*p) || *p == '-' || *p == '+'))
+                ++p;
+            std::string_view token(start, p - start);
+            if (token.empty())
+                fail("Expected a literal");
+
+            if (id == primitive(TypeKind::BOOL))
+            {
+                if (token != "true" && token != "false")
+                    fail("Expected 'true' or 'false'");
+                return token == "true";
+            }
+
+            const bool negative = token.starts_with('-');
+            if (types.is_float(id) && !token.starts_with("0x"))
+            {
+                char buffer[64] {};
+                if (token.size() >= sizeof(buffer))
+                    fail("Invalid floating-point literal");
+                std::memcpy(buffer, token.data(), token.size());
+                char *end = nullptr;
+                const uint64_t bits = id == primitive(TypeKind::F32)
+                                          ? std::bit_cast<uint32_t>(std::strtof(buffer, &end))
+                                          : std::bit_cast<uint64_t>(std::strtod(buffer, &end));
+                if (end != buffer + token.size())
+                    fail("Invalid floating-point literal");
+                return bits;
+            }
+
+            if (negative)
+                token.remove_prefix(1);
+            const bool hex = token.starts_with("0x");
+            uint64_t magnitude = 0;
+            const auto [end, status] = std::from_chars(token.data() + (hex ? 2 : 0), token.data() + token.size(),
+                                                       magnitude, hex ? 16 : 10);
+            if (status != std::errc() || end != token.data() + token.size())
+                fail("Invalid integer literal");
+
+            const uint32_t width = types.bits(id) ? types.bits(id) : 64;
+            const uint64_t mask = width == 64 ? ~0ULL : (1ULL << width) - 1;
+            if (negative)
+            {
+                if (!types.is_signed(id) || magnitude > 1ULL << (width - 1))
+                    fail("Literal out of range");
+                return (0 - magnitude) & mask;
+            }
+            if (magnitude > mask)
+                fail("Literal out of range");
+            return magnitude;
+        }
+
+        Ordering ordering()
+        {
+            const std::string_view name = word();
+            for (uint8_t i = 0; i < std::size(ordering_names); ++i)
+            {
+                if (ordering_names[i] == name)
+                    return static_cast<Ordering>(i);
+            }
+            fail("Unknown memory ordering '" + std::string(name) + "'");
+        }
+
+        // values and blocks
+
+        std::string_view value_name()
+        {
+            expect('%');
+            const std::string_view name = word();
+            if (name.empty())
+                fail("Expected a value name");
+            return name;
+        }
+
+        /**
+         * @param expected The type the value must have, or any_type.
+         */
+        uint32_t operand(const TypeId expected)
+        {
+            skip_spaces();
+            const char *const start = p;
+            const std::string_view name = value_name();
+            if (const uint32_t value = find(name); value != no_value)
+            {
+                if (expected != any_type && staged->types[value] != expected)
+                {
+                    token = start;
+                    fail("%" + std::string(name) + " has type " + module.types.name(staged->types[value]) +
+                         ", expected " + module.types.name(expected));
+                }
+                return value;
+            }
+            // defined further down: append() gives it its slot, patched once the body is read
+            forward.push_back({ name, line, static_cast<uint32_t>(start - line_start) + 1, expected, no_value });
+            return no_value;
+        }
+
+        /**
+         * @brief Whether a value name is a plain number small enough to index `numbered`.
+         */
+        static bool numeric(const std::string_view name, uint32_t &number)
+        {
+            if (name.empty())
+                return false;
+            number = 0;
+            for (const char c: name)
+            {
+                if (c < '0' || c > '9')
+                    return false;
+                number = number * 10 + static_cast<uint32_t>(c - '0');
+                if (number >= 1U << 24)
+                    return false;
+            }
+            return true;
+        }
+
+        [[nodiscard]] uint32_t find(const std::string_view name) const
+        {
+            if (uint32_t number; numeric(name, number))
+                return number < numbered.size() ? numbered[number] : no_value;
+            const Named *const entry = named.find(name);
+            return entry && entry->body == body_index ? entry->value : no_value;
+        }
+
+        void define(const std::string_view name, const uint32_t value)
+        {
+            if (uint32_t number; numeric(name, number))
+            {
+                if (numbered.size() <= number)
+                    numbered.resize(number + 1, no_value);
+                if (numbered[number] != no_value)
+                    fail("%" + std::string(name) + " is defined twice");
+                numbered[number] = value;
+                return;
+            }
+            Named &entry = named.try_emplace(name, Named { no_function, 0, StringInterner::no_atom });
+            if (entry.body == body_index)
+                fail("%" + std::string(name) + " is defined twice");
+            entry.body = body_index;
+            entry.value = value;
+            if (is_digits(name))
+                return;
+
+            if (entry.atom == StringInterner::no_atom)
+            {
+                std::string_view base = name;
+                if (const size_t dot = name.rfind('.'); dot != std::string_view::npos && dot > 0 &&
+                    is_digits(name.substr(dot + 1)))
+                    base = name.substr(0, dot);
+                entry.atom = StringInterner::global().intern(base);
+            }
+            if (staged->names[value] == StringInterner::empty_atom)
+                staged->names[value] = entry.atom;
+        }
+
+        uint32_t ensure_block(const uint64_t block)
+        {
+            // bounded by the text size, so a bad number cannot make the block tables huge
+            if (block > static_cast<uint64_t>(text_end - text_begin))
+                fail("Block number out of range");
+            if (terminated.size() <= block)
+                terminated.resize(block + 1, 0);
+            return static_cast<uint32_t>(block);
+        }
+
+        /**
+         * @brief Appends an instruction to the staged body. Operands still undefined take the slots
+         * of their forward references, which are read in operand order.
+         */
+        uint32_t append(const Opcode opcode, const TypeId type, const std::span<const uint32_t> operands,
+                        const std::span<const uint32_t> targets = {}, const uint64_t immediate = 0,
+                        const uint8_t flags = 0)
+        {
+            const bool prefix = in_prefix(opcode);
+            if (!prefix && opcode != Opcode::PHI && terminated[current_block])
+            {
+                token = line_start;
+                fail("UIR block already ends in a terminator");
+            }
+            terminated[current_block] |= is_terminator(opcode);
+
+            Function::Body &body = *staged;
+            const auto value = static_cast<uint32_t>(body.opcodes.size());
+            body.opcodes.push_back(opcode);
+            body.types.push_back(type);
+            body.immediates.push_back(immediate);
+            body.flags.push_back(flags);
+            body.names.push_back(StringInterner::empty_atom);
+            body.blocks.push_back(prefix ? 0 : current_block);
+
+            body.operand_starts.push_back(static_cast<uint32_t>(body.operand_list.size()));
+            body.operand_counts.push_back(static_cast<uint32_t>(operands.size()));
+            for (const uint32_t operand: operands)
+            {
+                if (operand == no_value)
+                    forward[placed++].slot = static_cast<uint32_t>(body.operand_list.size());
+                body.operand_list.push_back(operand);
+            }
+            body.target_starts.push_back(static_cast<uint32_t>(body.target_list.size()));
+            body.target_counts.push_back(static_cast<uint32_t>(targets.size()));
+            for (const uint32_t target: targets)
+                body.target_list.push_back(target);
+            return value;
+        }
+
+        uint32_t constant(const TypeId type, const uint64_t bits)
+        {
+            Constant &entry = constants.try_emplace({ type, bits }, Constant { no_function, 0 });
+            if (entry.body != body_index)
+                entry = { body_index, append(Opcode::CONST, type, {}, {}, bits) };
+            return entry.value;
+        }
+
+        uint32_t label()
+        {
+            skip_spaces();
+            if (line_end - p < 3 || p[0] != 'b' || p[1] != 'b')
+                fail("Expected a block label");
+            p += 2;
+            return ensure_block(number());
+        }
+
+        uint32_t address(uint32_t &offset)
+        {
+            expect('[');
+            const uint32_t pointer = operand(any_type);
+            offset = 0;
+            if (eat('+'))
+            {
+                const uint64_t bytes = number();
+                if (bytes > std::numeric_limits<uint32_t>::max())
+                    fail("Offset out of range");
+                offset = static_cast<uint32_t>(bytes);
+            }
+            expect(']');
+            return pointer;
+        }
+
+        uint32_t atomic_address()
+        {
+            uint32_t offset;
+            const uint32_t pointer = address(offset);
+            if (offset)
+                fail("Atomic accesses take no offset");
+            return pointer;
+        }
+
+        /**
+         * @brief Reads `(type %a, ...)` onto listed_operands.
+         */
+        void call_arguments()
+        {
+            expect('(');
+            if (eat(')'))
+                return;
+            do
+            {
+                const TypeId argument = type();
+                listed_operands.push_back(operand(argument));
+            }
+            while (eat(','));
+            expect(')');
+        }
+
+        // functions
+
+        uint32_t read_header(std::vector<std::string_view> &param_names, bool &has_body)
+        {
+            p += 4;
+            const std::string_view name = word();
+            if (name.empty())
+                fail("Expected a function name");
+            if (find_function(name) != no_function)
+                fail("Function '" + std::string(name) + "' is already defined");
+
+            std::vector<TypeId> params;
+            expect('(');
+            if (!eat(')'))
+            {
+                do
+                {
+                    eat('%');
+                    param_names.push_back(word());
+                    if (param_names.back().empty())
+                        fail("Expected a parameter name");
+                    expect(':');
+                    params.push_back(type());
+                }
+                while (eat(','));
+                expect(')');
+            }
+            TypeId result = primitive(TypeKind::VOID);
+            if (eat('-'))
+            {
+                expect('>');
+                result = type();
+            }
+            uint8_t attributes = 0;
+            for (std::string_view attribute = word(); !attribute.empty(); attribute = word())
+            {
+                const auto found = std::ranges::find(attribute_names, attribute);
+                if (found == attribute_names.end())
+                    fail("Unknown function attribute '" + std::string(attribute) + "'");
+                attributes |= static_cast<uint8_t>(1u << (found - attribute_names.begin()));
+            }
+            has_body = eat(':');
+            expect_end();
+            const uint32_t index = module.add_function(name, std::move(params), result);
+            module.function(index).set_attributes(attributes);
+            functions.try_emplace(name, index);
+            return index;
+        }
+
+        [[nodiscard]] uint32_t find_function(const std::string_view name) const
+        {
+            if (const uint32_t *const found = functions.find(name))
+                return *found;
+            return extending ? module.find_function(name) : no_function;
+        }
+
+        void read_body(const uint32_t index, const std::span<const std::string_view> param_names)
+        {
+            Function::Body &body = *staged;
+            body.opcodes.clear();
+            body.types.clear();
+            body.immediates.clear();
+            body.flags.clear();
+            body.names.clear();
+            body.blocks.clear();
+            body.operand_starts.clear();
+            body.operand_counts.clear();
+            body.operand_list.clear();
+            body.target_starts.clear();
+            body.target_counts.clear();
+            body.target_list.clear();
+            terminated.assign(1, 0);
+            current_block = 0;
+            entry_memory = no_value;
+            body_index = index;
+            numbered.clear();
+            forward.clear();
+            placed = 0;
+
+            const Function &function = module.function(index);
+            for (uint32_t i = 0; i < param_names.size(); ++i)
+                define(param_names[i], append(Opcode::PARAM, function.params()[i], {}, {}, i));
+
+            bool in_block = false;
+            while (next_line())
+            {
+                if (p == line_end)
+                    continue;
+                if (at_func())
+                {
+                    next = line_start;
+                    --line;
+                    break;
+                }
+                if (line_end[-1] == ':')
+                {
+                    current_block = label();
+                    expect(':');
+                    expect_end();
+                    in_block = true;
+                    continue;
+                }
+                if (!in_block)
+                    fail("Expected a block label");
+                instruction();
+            }
+
+            for (const auto &[name, at_line, column, expected, slot]: forward)
+            {
+                const uint32_t value = find(name);
+                if (value == no_value || (expected != any_type && body.types[value] != expected))
+                {
+                    throw SyntaxError {
+                        value == no_value ? "Unknown value %" + std::string(name)
+                                          : "%" + std::string(name) + " has type " +
+                                            module.types.name(body.types[value]) + ", expected " +
+                                            module.types.name(expected),
+                        at_line, column
+                    };
+                }
+                body.operand_list[slot] = value;
+            }
+            lay_out(module.function(index));
+        }
+
+        /**
+         * @brief Moves the staged body into the function: the entry block's parameters and constants
+         * first, then each block's phis, then the rest, each in the order read.
+         */
+        void lay_out(Function &function)
+        {
+            const Function::Body &body = *staged;
+            const auto count = static_cast<uint32_t>(body.opcodes.size());
+            const auto block_count = static_cast<uint32_t>(terminated.size());
+            const auto key = [&body](const uint32_t value)
+            {
+                const Opcode opcode = body.opcodes[value];
+                return body.blocks[value] * 3 + (in_prefix(opcode) ? 0 : opcode == Opcode::PHI ? 1 : 2);
+            };
+
+            // a stable counting sort by block and kind
+            offsets.assign(block_count * 3 + 1, 0);
+            bool in_order = true;
+            for (uint32_t value = 0; value < count; ++value)
+            {
+                ++offsets[key(value) + 1];
+                in_order = in_order && (value == 0 || key(value - 1) <= key(value));
+            }
+            for (uint32_t k = 1; k < offsets.size(); ++k)
+                offsets[k] += offsets[k - 1];
+
+            Function::Body &out = *function.body;
+            out.block_count = block_count;
+            out.block_starts.reserve(block_count + 1);
+            for (uint32_t block = 0; block <= block_count; ++block)
+                out.block_starts.push_back(offsets[block * 3]);
+
+            if (in_order)
+            {
+                out.opcodes.assign(body.opcodes.begin(), body.opcodes.end());
+                out.types.assign(body.types.begin(), body.types.end());
+                out.immediates.assign(body.immediates.begin(), body.immediates.end());
+                out.flags.assign(body.flags.begin(), body.flags.end());
+                out.names.assign(body.names.begin(), body.names.end());
+                out.blocks.assign(body.blocks.begin(), body.blocks.end());
+                out.operand_starts.assign(body.operand_starts.begin(), body.operand_starts.end());
+                out.operand_counts.assign(body.operand_counts.begin(), body.operand_counts.end());
+                out.operand_list.assign(body.operand_list.begin(), body.operand_list.end());
+                out.target_starts.assign(body.target_starts.begin(), body.target_starts.end());
+                out.target_counts.assign(body.target_counts.begin(), body.target_counts.end());
+                out.target_list.assign(body.target_list.begin(), body.target_list.end());
+                return;
+            }
+
+            layout.resize(count);
+            remap.resize(count);
+            for (uint32_t value = 0; value < count; ++value)
+            {
+                layout[offsets[key(value)]] = value;
+                remap[value] = offsets[key(value)]++;
+            }
+            out.opcodes.reserve(count);
+            out.types.reserve(count);
+            out.immediates.reserve(count);
+            out.flags.reserve(count);
+            out.names.reserve(count);
+            out.blocks.reserve(count);
+            out.operand_starts.reserve(count);
+            out.operand_counts.reserve(count);
+            out.operand_list.reserve(body.operand_list.size());
+            out.target_starts.reserve(count);
+            out.target_counts.reserve(count);
+            out.target_list.reserve(body.target_list.size());
+            for (const uint32_t value: layout)
+            {
+                out.opcodes.push_back(body.opcodes[value]);
+                out.types.push_back(body.types[value]);
+                out.immediates.push_back(body.immediates[value]);
+                out.flags.push_back(body.flags[value]);
+                out.names.push_back(body.names[value]);
+                out.blocks.push_back(body.blocks[value]);
+                out.operand_starts.push_back(static_cast<uint32_t>(out.operand_list.size()));
+                out.operand_counts.push_back(body.operand_counts[value]);
+                for (uint32_t k = 0; k < body.operand_counts[value]; ++k)
+                    out.operand_list.push_back(remap[body.operand_list[body.operand_starts[value] + k]]);
+                out.target_starts.push_back(static_cast<uint32_t>(out.target_list.size()));
+                out.target_counts.push_back(body.target_counts[value]);
+                for (uint32_t k = 0; k < body.target_counts[value]; ++k)
+                    out.target_list.push_back(body.target_list[body.target_starts[value] + k]);
+            }
+        }
+
+        static const NameTable<TypeId> &primitives()
+        {
+            static const NameTable<TypeId> table = []
+            {
+                NameTable<TypeId> result;
+                for (uint32_t kind = 0; kind < primitive_type_count; ++kind)
+                    result.try_emplace(primitive_names[kind], kind);
+                return result;
+            }();
+            return table;
+        }
+
+        static const NameTable<Opcode> &mnemonics()
+        {
+            static const NameTable<Opcode> table = []
+            {
+                NameTable<Opcode> result;
+                for (uint8_t i = 0; i < static_cast<uint8_t>(Opcode::COUNT); ++i)
+                {
+                    const auto opcode = static_cast<Opcode>(i);
+                    if (opcode != Opcode::NOP && opcode != Opcode::PARAM && opcode != Opcode::CALL_INDIRECT &&
+                        opcode != Opcode::INTRINSIC)
+                        result.try_emplace(info(opcode).name, opcode);
+                }
+                return result;
+            }();
+            return table;
+        }
+
+        void instruction()
+        {
+            std::string_view result;
+            if (*p == '%')
+            {
+                result = value_name();
+                expect('=');
+            }
+
+            std::string_view mnemonic = word();
+            const bool tail = mnemonic == "tail";
+            if (tail && (mnemonic = word()) != "call")
+                fail("Only calls can be tail calls");
+
+            Opcode opcode;
+            if (mnemonic.starts_with("intrinsic.") && mnemonic.size() > 10)
+                opcode = Opcode::INTRINSIC;
+            else if (const Opcode *const found = mnemonics().find(mnemonic))
+                opcode = *found;
+            else
+                fail("Unknown instruction '" + std::string(mnemonic) + "'");
+
+            const TypeId void_type = primitive(TypeKind::VOID);
+            const TypeId memory_type = primitive(TypeKind::MEM);
+            uint32_t value;
+            uint32_t offset = 0;
+            if (is_binary(opcode))
+            {
+                const TypeId operand_type = type();
+                const uint32_t a = operand(operand_type);
+                expect(',');
+                const uint32_t operands[] = { a, operand(operand_type) };
+                const bool compare = opcode >= Opcode::CMP_EQ && opcode <= Opcode::FCMP_GE;
+                value = append(opcode, compare ? primitive(TypeKind::BOOL) : operand_type, operands);
+            }
+            else if (is_conversion(opcode))
+            {
+                const uint32_t from[] = { operand(type()) };
+                if (word() != "to")
+                    fail("Expected 'to'");
+                value = append(opcode, type(), from);
+            }
+            else if (is_atomic_rmw(opcode))
+            {
+                const TypeId operand_type = type();
+                const uint32_t pointer = atomic_address();
+                expect(',');
+                const uint32_t operands[] = { pointer, operand(operand_type) };
+                expect(',');
+                value = append(opcode, operand_type, operands, {}, 0, ordering_flags(ordering()));
+            }
+            else
+            {
+                switch (opcode)
+                {
+                    case Opcode::CONST:
+                    {
+                        const TypeId constant_type = type();
+                        value = constant(constant_type, literal(constant_type));
+                        break;
+                    }
+                    case Opcode::UNDEF:
+                        value = append(Opcode::UNDEF, type(), {});
+                        break;
+                    case Opcode::FUNC_ENTRY:
+                        if (entry_memory == no_value)
+                            entry_memory = append(Opcode::FUNC_ENTRY, memory_type, {});
+                        value = entry_memory;
+                        break;
+                    case Opcode::NEG:
+                    case Opcode::NOT:
+                    {
+                        const TypeId operand_type = type();
+                        const uint32_t operands[] = { operand(operand_type) };
+                        value = append(opcode, operand_type, operands);
+                        break;
+                    }
+                    case Opcode::ALLOC:
+                        value = append(Opcode::ALLOC, module.types.pointer_to(type()), {});
+                        break;
+                    case Opcode::LOAD:
+                    {
+                        const TypeId loaded = type();
+                        const uint32_t pointer = address(offset);
+                        const bool ordered = eat(',');
+                        const uint32_t operands[] = { pointer, ordered ? operand(memory_type) : no_value };
+                        value = append(Opcode::LOAD, loaded, std::span(operands, ordered ? 2 : 1), {}, offset);
+                        break;
+                    }
+                    case Opcode::STORE:
+                    {
+                        const uint32_t stored = operand(type());
+                        expect(',');
+                        const uint32_t pointer = address(offset);
+                        const bool ordered = eat(',');
+                        const uint32_t operands[] = { stored, pointer, ordered ? operand(memory_type) : no_value };
+                        value = append(Opcode::STORE, memory_type, std::span(operands, ordered ? 3 : 2), {}, offset);
+                        break;
+                    }
+                    case Opcode::BARRIER:
+                    case Opcode::BARRIER_ACQ:
+                    case Opcode::BARRIER_REL:
+                    {
+                        const uint32_t operands[] = { operand(memory_type) };
+                        value = append(opcode, memory_type, operands);
+                        break;
+                    }
+                    case Opcode::ATOMIC_LOAD:
+                    {
+                        const TypeId loaded = type();
+                        const uint32_t operands[] = { atomic_address() };
+                        expect(',');
+                        value = append(Opcode::ATOMIC_LOAD, loaded, operands, {}, 0, ordering_flags(ordering()));
+                        break;
+                    }
+                    case Opcode::ATOMIC_STORE:
+                    {
+                        const uint32_t stored = operand(type());
+                        expect(',');
+                        const uint32_t operands[] = { stored, atomic_address() };
+                        expect(',');
+                        value = append(Opcode::ATOMIC_STORE, void_type, operands, {}, 0, ordering_flags(ordering()));
+                        break;
+                    }
+                    case Opcode::CMPXCHG:
+                    {
+                        const TypeId operand_type = type();
+                        const uint32_t pointer = atomic_address();
+                        expect(',');
+                        const uint32_t expected = operand(operand_type);
+                        expect(',');
+                        const uint32_t desired = operand(operand_type);
+                        expect(',');
+                        const Ordering success = ordering();
+                        expect(',');
+                        const uint32_t operands[] = { pointer, expected, desired };
+                        const uint8_t orderings = ordering_flags(success, ordering());
+                        value = append(Opcode::CMPXCHG, operand_type, operands, {}, 0, orderings);
+                        break;
+                    }
+                    case Opcode::PHI:
+                    {
+                        const TypeId phi_type = type();
+                        listed_operands.clear();
+                        listed_targets.clear();
+                        skip_spaces();
+                        if (p != line_end)
+                        {
+                            do
+                            {
+                                expect('[');
+                                listed_operands.push_back(operand(phi_type));
+                                expect(',');
+                                listed_targets.push_back(label());
+                                expect(']');
+                            }
+                            while (eat(','));
+                        }
+                        value = append(Opcode::PHI, phi_type, listed_operands, listed_targets);
+                        break;
+                    }
+                    case Opcode::CALL:
+                    {
+                        const TypeId returned = type();
+                        if (eat('@'))
+                        {
+                            const std::string_view name = word();
+                            const uint32_t callee = find_function(name);
+                            if (callee == no_function)
+                                fail("Unknown function '" + std::string(name) + "'");
+                            if (module.function(callee).return_type() != returned)
+                                fail("'" + std::string(name) + "' does not return " + module.types.name(returned));
+                            listed_operands.clear();
+                            call_arguments();
+                            value = append(Opcode::CALL, returned, listed_operands, {}, callee, tail ? TAIL : 0);
+                        }
+                        else
+                        {
+                            listed_operands.assign(1, operand(any_type));
+                            call_arguments();
+                            value = append(Opcode::CALL_INDIRECT, returned, listed_operands, {}, 0, tail ? TAIL : 0);
+                        }
+                        break;
+                    }
+                    case Opcode::INTRINSIC:
+                    {
+                        const TypeId returned = type();
+                        listed_operands.clear();
+                        skip_spaces();
+                        if (p != line_end)
+                        {
+                            do
+                                listed_operands.push_back(operand(any_type));
+                            while (eat(','));
+                        }
+                        value = append(Opcode::INTRINSIC, returned, listed_operands, {},
+                                       StringInterner::global().intern(mnemonic.substr(10)));
+                        break;
+                    }
+                    case Opcode::JUMP:
+                    {
+                        const uint32_t targets[] = { label() };
+                        value = append(Opcode::JUMP, void_type, {}, targets);
+                        break;
+                    }
+                    case Opcode::BRANCH:
+                    {
+                        const uint32_t condition = operand(primitive(TypeKind::BOOL));
+                        expect(',');
+                        const uint32_t taken = label();
+                        expect(',');
+                        const uint32_t operands[] = { condition };
+                        const uint32_t targets[] = { taken, label() };
+                        value = append(Opcode::BRANCH, void_type, operands, targets);
+                        break;
+                    }
+                    case Opcode::SWITCH:
+                    {
+                        const TypeId case_type = type();
+                        const uint32_t switched = operand(case_type);
+                        expect(',');
+                        const uint32_t default_block = label();
+                        expect(',');
+                        expect('[');
+                        listed_operands.assign(1, switched);
+                        listed_targets.assign(1, default_block);
+                        if (!eat(']'))
+                        {
+                            do
+                            {
+                                listed_operands.push_back(constant(case_type, literal(case_type)));
+                                expect(':');
+                                listed_targets.push_back(label());
+                            }
+                            while (eat(','));
+                            expect(']');
+                        }
+                        value = append(Opcode::SWITCH, void_type, listed_operands, listed_targets);
+                        break;
+                    }
+                    case Opcode::RET:
+                    {
+                        skip_spaces();
+                        const bool returns = p != line_end;
+                        const uint32_t operands[] = { returns ? operand(type()) : no_value };
+                        value = append(Opcode::RET, void_type, std::span(operands, returns ? 1 : 0));
+                        break;
+                    }
+                    default: // UNREACHABLE
+                        value = append(Opcode::UNREACHABLE, void_type, {});
+                        break;
+                }
+            }
+
+            expect_end();
+
+            if (!result.empty())
+            {
+                if (staged->types[value] == void_type)
+                    fail("'" + std::string(mnemonic) + "' has no result");
+                define(result, value);
+            }
+        }
+    };
+
+    void print_function(const Module &module, const uint32_t function, std::string &out)
+    {
+        std::vector<std::string> type_names;
+        FunctionPrinter(module, function, out, type_names).print();
+    }
+
+    std::string print_module(const Module &module)
+    {
+        size_t estimate = 0;
+        for (uint32_t i = 0; i < module.function_count(); ++i)
+            estimate += 64 + module.function(i).size() * 32;
+
+        std::string out;
+        out.reserve(estimate);
+        std::vector<std::string> type_names;
+        for (uint32_t i = 0; i < module.function_count(); ++i)
+        {
+            if (i)
+                out += '\n';
+            FunctionPrinter(module, i, out, type_names).print();
+        }
+        return out;
+    }
+
+    std::string read_text(const std::string_view text, Module &module)
+    {
+        try
+        {
+            TextReader reader(text, module);
+            reader.read();
+            return {};
+        }
+        catch (const SyntaxError &error)
+        {
+            return "line " + std::to_string(error.line) + ", column " + std::to_string(error.column) + ": " +
+                   error.message;
+        }
+    }
+}
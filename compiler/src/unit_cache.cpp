@@ -0,0 +1,259 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include "../include/unit_cache.h"
+#include <array>
+#include <cstring>
+#include <type_traits>
+#include "../include/hash.h"
+#include "../include/interner.h"
+#include "../include/mapped_file.h"
+#include "../include/version.h"
+
+namespace yu::compiler
+{
+    namespace
+    {
+        constexpr uint32_t cache_magic = 0x31435559; // "YUC1"
+        constexpr uint32_t cache_endian = 0x01020304;
+
+        constexpr uint32_t null_view = 0xFFFFFFFF;
+        constexpr uint32_t literal_view = 0x80000000;
+
+        /**
+         * @brief Views the parser creates from string literals rather than from the source: the
+         * function type name and the spelling of builtin types it infers.
+         */
+        constexpr auto known_literals = []
+        {
+            std::array<std::string_view, std::size(lang::token_map) + 1> literals {};
+            literals[0] = "function";
+            for (size_t i = 0; i < std::size(lang::token_map); ++i)
+                literals[i + 1] = lang::token_map[i].first;
+            return literals;
+        }();
+
+        struct CacheHeader
+        {
+            uint32_t magic;
+            uint32_t endian;
+            uint64_t source_hash;
+            uint64_t version_hash;
+            uint32_t source_size;
+            uint32_t column_count;
+        };
+
+        struct CacheColumn
+        {
+            uint64_t offset;
+            uint32_t count;
+            uint32_t element_size;
+        };
+
+        struct EncodedView
+        {
+            uint32_t offset;
+            uint32_t length;
+        };
+
+        template<typename T>
+        constexpr uint32_t stored_size()
+        {
+            return std::is_same_v<T, std::string_view> ? sizeof(EncodedView) : sizeof(T);
+        }
+
+        uint64_t version_hash()
+        {
+            static const uint64_t hash = hash_bytes(compiler_version, sizeof(CacheHeader));
+            return hash;
+        }
+
+        uint32_t column_count()
+        {
+            static const uint32_t count = []
+            {
+                uint32_t n = 0;
+                CompilationUnit unit;
+                for_each_column(unit, [&n](auto &) { ++n; });
+                return n;
+            }();
+            return count;
+        }
+
+        size_t align8(const size_t n)
+        {
+            return (n + 7) & ~static_cast<size_t>(7);
+        }
+    }
+
+    UnitCache::UnitCache(std::filesystem::path directory) : directory(std::move(directory))
+    {
+        std::filesystem::create_directories(this->directory);
+    }
+
+    std::filesystem::path UnitCache::entry_path(const std::string_view source) const
+    {
+        static constexpr char hex[] = "0123456789abcdef";
+        const uint64_t key = hash_bytes(source, version_hash());
+
+        std::string name(16, '0');
+        for (int i = 0; i < 16; ++i)
+            name[15 - i] = hex[key >> (i * 4) & 0xF];
+        return directory / (name + ".yuc");
+    }
+
+    bool UnitCache::load(SourceBuffer &source, CompilationUnit &unit) const
+    {
+        MappedFile file;
+        if (!file.open(entry_path(source.view()).string()) || file.size() < sizeof(CacheHeader))
+            return false;
+
+        CacheHeader header {};
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (header.magic != cache_magic || header.endian != cache_endian ||
+            header.version_hash != version_hash() || header.source_size != source.size() ||
+            header.column_count != column_count() ||
+            header.source_hash != hash_bytes(source.view()))
+            return false;
+
+        const size_t table_end = sizeof(CacheHeader) + sizeof(CacheColumn) * header.column_count;
+        if (file.size() < table_end)
+            return false;
+
+        CompilationUnit result;
+        const char *base = source.data();
+        const auto *columns = file.data() + sizeof(CacheHeader);
+        uint32_t index = 0;
+        bool valid = true;
+
+        for_each_column(result, [&]<typename T>(CountedVector<T> &column)
+        {
+            CacheColumn entry {};
+            std::memcpy(&entry, columns + sizeof(CacheColumn) * index++, sizeof(entry));
+            if (!valid || entry.element_size != stored_size<T>() ||
+                entry.offset + static_cast<uint64_t>(entry.count) * entry.element_size > file.size())
+            {
+                valid = false;
+                return;
+            }
+
+            column.resize(entry.count);
+            const std::byte *data = file.data() + entry.offset;
+            if constexpr (std::is_same_v<T, std::string_view>)
+            {
+                for (uint32_t i = 0; i < entry.count; ++i)
+                {
+                    EncodedView view {};
+                    std::memcpy(&view, data + sizeof(EncodedView) * i, sizeof(view));
+                    if (view.offset == null_view)
+                        column[i] = {};
+                    else if (view.offset & literal_view && (view.offset & ~literal_view) < known_literals.size())
+                        column[i] = known_literals[view.offset & ~literal_view];
+                    else if (static_cast<uint64_t>(view.offset) + view.length <= header.source_size)
+                        column[i] = { base + view.offset, view.length };
+                    else
+                        valid = false;
+                }
+            }
+            else
+            {
+                std::memcpy(column.data(), data, sizeof(T) * entry.count);
+            }
+        });
+
+        if (!valid)
+            return false;
+
+        // atoms are only meaningful in the process that produced them
+        auto &interner = StringInterner::global();
+        for (auto [names, atoms]: { std::pair { &result.var_decls.names, &result.var_decls.name_atoms },
+                                    std::pair { &result.types.names, &result.types.name_atoms },
+                                    std::pair { &result.symbols.names, &result.symbols.name_atoms } })
+        {
+            atoms->resize(names->size());
+            for (size_t i = 0; i < names->size(); ++i)
+                (*atoms)[i] = interner.intern((*names)[i]);
+        }
+
+        result.source = std::move(source);
+        result.success = true;
+        unit = std::move(result);
+        return true;
+    }
+
+    bool UnitCache::store(const CompilationUnit &unit) const
+    {
+        if (!unit.success || !unit.warnings.empty())
+            return false;
+
+        const char *base = unit.source.data();
+        const uint32_t size = unit.source.size();
+
+        CacheHeader header {
+            cache_magic,
+            cache_endian,
+            hash_bytes(unit.source.view()),
+            version_hash(),
+            size,
+            column_count()
+        };
+
+        std::vector<CacheColumn> columns;
+        columns.reserve(header.column_count);
+        size_t offset = align8(sizeof(CacheHeader) + sizeof(CacheColumn) * header.column_count);
+        for_each_column(unit, [&]<typename T>(const CountedVector<T> &column)
+        {
+            columns.push_back({ offset, static_cast<uint32_t>(column.size()), stored_size<T>() });
+            offset = align8(offset + column.size() * stored_size<T>());
+        });
+
+        std::vector<std::byte> image(offset);
+        std::memcpy(image.data(), &header, sizeof(header));
+        std::memcpy(image.data() + sizeof(header), columns.data(), sizeof(CacheColumn) * columns.size());
+
+        bool encodable = true;
+        uint32_t index = 0;
+        for_each_column(unit, [&]<typename T>(const CountedVector<T> &column)
+        {
+            std::byte *data = image.data() + columns[index++].offset;
+            if constexpr (std::is_same_v<T, std::string_view>)
+            {
+                for (size_t i = 0; i < column.size(); ++i)
+                {
+                    const std::string_view view = column[i];
+                    EncodedView encoded { null_view, 0 };
+                    if (view.data() >= base && view.data() + view.size() <= base + size)
+                    {
+                        // such an offset would read back as a known literal
+                        if (static_cast<uint32_t>(view.data() - base) & literal_view)
+                        {
+                            encodable = false;
+                            return;
+                        }
+                        encoded = { static_cast<uint32_t>(view.data() - base), static_cast<uint32_t>(view.size()) };
+                    }
+                    else if (view.data() != nullptr)
+                    {
+                        const auto *it = std::ranges::find(known_literals, view);
+                        if (it == known_literals.end())
+                        {
+                            encodable = false;
+                            return;
+                        }
+                        encoded.offset = literal_view | static_cast<uint32_t>(it - known_literals.begin());
+                    }
+                    std::memcpy(data + sizeof(EncodedView) * i, &encoded, sizeof(encoded));
+                }
+            }
+            else
+            {
+                std::memcpy(data, column.data(), sizeof(T) * column.size());
+            }
+        });
+
+        if (!encodable)
+            return false;
+
+        return write_file_atomically(entry_path(unit.source.view()), image);
+    }
+}
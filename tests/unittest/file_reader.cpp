@@ -0,0 +1,78 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <gtest/gtest.h>
+#include "../../compiler/include/file_reader.h"
+#include "../../compiler/include/thread_pool.h"
+
+using namespace yu::compiler;
+
+class FileReaderTest : public testing::TestWithParam<ReadBackend>
+{
+protected:
+    std::filesystem::path root;
+    std::vector<std::string> paths;
+
+    static std::string contents(const uint32_t file)
+    {
+        // a few sizes around the buffer padding and one large enough for several reads
+        return std::string(file * 997 % 5000 + (file == 7 ? 1 << 20 : 0), static_cast<char>('a' + file % 26));
+    }
+
+    void SetUp() override
+    {
+        root = std::filesystem::temp_directory_path() / "yu-file-reader-test";
+        std::filesystem::remove_all(root);
+        std::filesystem::create_directories(root);
+        for (uint32_t file = 0; file < 24; ++file)
+        {
+            const auto path = root / ("f" + std::to_string(file) + ".yu");
+            std::ofstream(path, std::ios::binary) << contents(file);
+            paths.push_back(path.string());
+        }
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(root);
+    }
+};
+
+TEST_P(FileReaderTest, ReadsFilesInAnyOrder)
+{
+    FileReader reader(paths, 4, GetParam());
+    for (const uint32_t file: { 0u, 1u, 23u, 7u, 2u, 3u })
+    {
+        const SourceBuffer buffer = reader.take(file);
+        EXPECT_EQ(buffer.view(), contents(file));
+        EXPECT_STREQ(buffer.name(), paths[file].c_str());
+    }
+    EXPECT_THROW(reader.take(1), std::logic_error);
+}
+
+TEST_P(FileReaderTest, FeedsAPoolOfWorkers)
+{
+    FileReader reader(paths, 2, GetParam());
+    std::vector<uint32_t> sizes(paths.size());
+    ThreadPool pool(4);
+    for (uint32_t file = 0; file < paths.size(); ++file)
+        pool.submit([&, file] { sizes[file] = reader.take(file).size(); });
+    pool.wait();
+
+    for (uint32_t file = 0; file < paths.size(); ++file)
+        EXPECT_EQ(sizes[file], contents(file).size());
+}
+
+TEST_P(FileReaderTest, ReportsMissingFilesWhenTaken)
+{
+    paths.insert(paths.begin() + 1, (root / "missing.yu").string());
+    FileReader reader(paths, 0, GetParam());
+    EXPECT_EQ(reader.take(0).view(), contents(0));
+    EXPECT_THROW(reader.take(1), std::runtime_error);
+    EXPECT_EQ(reader.take(2).view(), contents(1));
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, FileReaderTest, testing::Values(ReadBackend::AUTO, ReadBackend::THREADS));
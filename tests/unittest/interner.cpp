@@ -0,0 +1,84 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "../../compiler/include/compilation_unit.h"
+#include "../../compiler/include/interner.h"
+
+using namespace yu::compiler;
+
+class InternerTest : public testing::Test
+{
+protected:
+    void SetUp() override {}
+
+    void TearDown() override {}
+};
+
+TEST_F(InternerTest, EqualStringsShareAnAtom)
+{
+    StringInterner interner;
+    const std::string name = "identifier";
+    const uint32_t atom = interner.intern(name);
+
+    EXPECT_EQ(interner.intern(std::string("identifier")), atom);
+    EXPECT_NE(interner.intern("identifiers"), atom);
+    EXPECT_EQ(interner.find("identifier"), atom);
+    EXPECT_EQ(interner.find("never interned"), StringInterner::no_atom);
+    EXPECT_EQ(interner.intern(""), StringInterner::empty_atom);
+    EXPECT_EQ(interner.view(StringInterner::empty_atom), "");
+
+    // the interner keeps its own copy
+    EXPECT_EQ(interner.view(atom), "identifier");
+    EXPECT_NE(interner.view(atom).data(), name.data());
+    EXPECT_EQ(interner.size(), 3);
+    EXPECT_EQ(interner.bytes(), 21);
+}
+
+TEST_F(InternerTest, AtomsAreStableUnderConcurrentInterning)
+{
+    StringInterner interner;
+    constexpr uint32_t threads = 8, names = 20000;
+    std::vector<std::vector<uint32_t>> atoms(threads, std::vector<uint32_t>(names));
+    std::vector<std::thread> workers;
+    for (uint32_t t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&interner, &atoms, t]
+        {
+            // every thread interns the same names in a different order
+            for (uint32_t i = 0; i < names; ++i)
+            {
+                const uint32_t n = (i * 7919 + t * 104729) % names;
+                atoms[t][n] = interner.intern("name_" + std::to_string(n));
+            }
+        });
+    }
+    for (auto &worker: workers)
+        worker.join();
+
+    EXPECT_EQ(interner.size(), names + 1);
+    for (uint32_t n = 0; n < names; ++n)
+    {
+        for (uint32_t t = 1; t < threads; ++t)
+            ASSERT_EQ(atoms[t][n], atoms[0][n]) << n;
+        ASSERT_EQ(interner.view(atoms[0][n]), "name_" + std::to_string(n));
+    }
+}
+
+TEST_F(InternerTest, UnitsShareAtomsAcrossFiles)
+{
+    const auto first = parse_unit(SourceBuffer("a.yu", "var shared = 1;\nfunction f(x: i32) -> i32 { return x; }\n"));
+    const auto second = parse_unit(SourceBuffer("b.yu", "const shared: i32 = 2;\n"));
+    ASSERT_TRUE(first.success) << first.error_message;
+    ASSERT_TRUE(second.success) << second.error_message;
+
+    EXPECT_EQ(first.var_decls.name_atoms[0], second.var_decls.name_atoms[0]);
+    EXPECT_EQ(StringInterner::global().view(first.var_decls.name_atoms[0]), "shared");
+    ASSERT_EQ(first.symbols.name_atoms.size(), first.symbols.names.size());
+    EXPECT_EQ(first.symbols.name_atoms[0], second.symbols.name_atoms[0]);
+    ASSERT_FALSE(second.types.name_atoms.empty());
+    EXPECT_EQ(StringInterner::global().view(second.types.name_atoms[0]), "i32");
+}
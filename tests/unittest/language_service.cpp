@@ -0,0 +1,106 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <gtest/gtest.h>
+#include "../../compiler/include/language_service.h"
+
+using namespace yu::compiler;
+
+class LanguageServiceTest : public testing::Test
+{
+protected:
+    LanguageService service;
+
+    void SetUp() override {}
+
+    void TearDown() override {}
+};
+
+TEST_F(LanguageServiceTest, ListsTopLevelDeclarations)
+{
+    const auto &unit = service.open("doc", "test.yu", "var x = 4;\nfunction f(a: i32) -> i32 { return a; }\nconst y: i32 = 5;\n");
+    ASSERT_TRUE(unit.success) << unit.error_message;
+
+    const auto symbols = LanguageService::document_symbols(unit);
+    ASSERT_EQ(symbols.size(), 3);
+    EXPECT_EQ(symbols[0].name, "x");
+    EXPECT_EQ(symbols[0].kind, SymbolKind::VARIABLE);
+    EXPECT_EQ(symbols[1].name, "f");
+    EXPECT_EQ(symbols[1].kind, SymbolKind::FUNCTION);
+    EXPECT_EQ(symbols[1].selection_range.start.line, 1);
+    EXPECT_EQ(symbols[1].selection_range.start.character, 9);
+    EXPECT_EQ(symbols[1].range.end.character, 39);
+    EXPECT_EQ(symbols[2].kind, SymbolKind::CONSTANT);
+}
+
+TEST_F(LanguageServiceTest, FindsDefinitionOfUse)
+{
+    const auto &unit = service.open("doc", "test.yu", "var x = 4;\nvar y = x;\n");
+    ASSERT_TRUE(unit.success) << unit.error_message;
+
+    const auto range = LanguageService::definition(unit, { 1, 8 });
+    ASSERT_TRUE(range.has_value());
+    EXPECT_EQ(range->start.line, 0);
+    EXPECT_EQ(range->start.character, 4);
+    EXPECT_FALSE(LanguageService::definition(unit, { 1, 6 }).has_value());
+}
+
+TEST_F(LanguageServiceTest, FindsDefinitionInEnclosingScope)
+{
+    const auto &unit = service.open("doc", "test.yu",
+                                    "var a = 1;\n"
+                                    "function f(a: i32) -> i32 {\n"
+                                    "    var n: i32 = a;\n"
+                                    "    return n;\n"
+                                    "}\n"
+                                    "function g(b: i32) -> i32 {\n"
+                                    "    var n: i32 = a + b;\n"
+                                    "    return n;\n"
+                                    "}\n");
+    ASSERT_TRUE(unit.success) << unit.error_message;
+
+    auto range = LanguageService::definition(unit, { 3, 11 });
+    ASSERT_TRUE(range.has_value());
+    EXPECT_EQ(range->start.line, 2);
+    range = LanguageService::definition(unit, { 7, 11 });
+    ASSERT_TRUE(range.has_value());
+    EXPECT_EQ(range->start.line, 6);
+    EXPECT_EQ(range->start.character, 8);
+
+    // the parameter shadows the global in its own function only
+    range = LanguageService::definition(unit, { 2, 17 });
+    ASSERT_TRUE(range.has_value());
+    EXPECT_EQ(range->start.line, 1);
+    EXPECT_EQ(range->start.character, 11);
+    range = LanguageService::definition(unit, { 6, 17 });
+    ASSERT_TRUE(range.has_value());
+    EXPECT_EQ(range->start.line, 0);
+    EXPECT_EQ(range->start.character, 4);
+}
+
+TEST_F(LanguageServiceTest, EditsUpdateDiagnostics)
+{
+    service.open("doc", "test.yu", "var x = 4;\n");
+
+    const auto *unit = service.change("doc", Range { { 0, 4 }, { 0, 5 } }, "");
+    ASSERT_NE(unit, nullptr);
+    auto diagnostics = LanguageService::diagnostics(*unit);
+    ASSERT_FALSE(diagnostics.empty());
+    EXPECT_EQ(diagnostics[0].severity, ErrorSeverity::ERROR);
+    EXPECT_EQ(diagnostics[0].range.start.line, 0);
+
+    unit = service.change("doc", Range { { 0, 4 }, { 0, 4 } }, "z");
+    EXPECT_TRUE(unit->success);
+    EXPECT_TRUE(LanguageService::diagnostics(*unit).empty());
+    EXPECT_EQ(service.change("missing", std::nullopt, ""), nullptr);
+}
+
+TEST_F(LanguageServiceTest, PositionsCountUtf16Units)
+{
+    const auto &unit = service.open("doc", "test.yu", "var s = \"\xC3\xA9\xF0\x9F\x98\x80\";\nvar t = 1;\n");
+
+    EXPECT_EQ(LanguageService::offset_at(unit, { 0, 10 }), 11);
+    EXPECT_EQ(LanguageService::offset_at(unit, { 0, 12 }), 15);
+    EXPECT_EQ(LanguageService::position_at(unit, 15).character, 12);
+    EXPECT_EQ(LanguageService::offset_at(unit, { 1, 100 }), 28);
+}
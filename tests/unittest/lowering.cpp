@@ -0,0 +1,160 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <string>
+#include <gtest/gtest.h>
+#include "../../compiler/include/lowering.h"
+
+using namespace yu::compiler;
+using namespace yu::uir;
+
+class LoweringTest : public testing::Test
+{
+protected:
+    CompilationUnit unit;
+    Module module;
+
+    void SetUp() override {}
+
+    void TearDown() override {}
+
+    bool lower(const std::string_view source)
+    {
+        unit = parse_unit(SourceBuffer("lower.yu", source), false);
+        EXPECT_TRUE(unit.success) << unit.error_message;
+        return lower_unit(unit, module);
+    }
+
+    static uint32_t count(const Function &function, const Opcode opcode)
+    {
+        uint32_t found = 0;
+        for (uint32_t value = 0; value < function.size(); ++value)
+            found += function.opcode(value) == opcode;
+        return found;
+    }
+};
+
+TEST_F(LoweringTest, BuildsPhisForLoopCarriedVariables)
+{
+    ASSERT_TRUE(lower("function sum(n: i32) -> i32 {\n"
+                      "    var total = 0;\n"
+                      "    var i: i32 = 0;\n"
+                      "    while (i < n) {\n"
+                      "        total += i;\n"
+                      "        i = i + 1;\n"
+                      "    }\n"
+                      "    return total;\n"
+                      "}\n")) << unit.error_message;
+
+    const Function &sum = module.function(module.find_function("sum"));
+    ASSERT_TRUE(sum.laid_out());
+    EXPECT_EQ(sum.verify(module.types), "");
+    EXPECT_EQ(count(sum, Opcode::LOAD) + count(sum, Opcode::STORE) + count(sum, Opcode::ALLOC), 0);
+
+    // one phi per loop-carried variable, both in the loop header; n needs none
+    EXPECT_EQ(count(sum, Opcode::PHI), 2);
+    const uint32_t header = 1;
+    EXPECT_EQ(sum.opcode(sum.block_begin(header)), Opcode::PHI);
+    EXPECT_EQ(sum.opcode(sum.block_begin(header) + 1), Opcode::PHI);
+    EXPECT_EQ(sum.operands(sum.block_begin(header)).size(), 2);
+    EXPECT_EQ(sum.opcode(sum.terminator(header)), Opcode::BRANCH);
+}
+
+TEST_F(LoweringTest, MergesBranchesAndRemovesTrivialPhis)
+{
+    ASSERT_TRUE(lower("function pick(a: i64, b: i64, flag: boolean) -> i64 {\n"
+                      "    var r = a;\n"
+                      "    var same = b * 2;\n"
+                      "    if (flag && a > b) { r = b; } else { r = r - 1; }\n"
+                      "    while (r > 100) { r = r / 2; }\n"
+                      "    return r + same;\n"
+                      "}\n")) << unit.error_message;
+
+    const Function &pick = module.function(0);
+    EXPECT_EQ(pick.verify(module.types), "");
+    // r merges after the if and in the loop, && merges a boolean; `same` never changes
+    EXPECT_EQ(count(pick, Opcode::PHI), 3);
+    const uint32_t ret = pick.terminator(pick.block_count() - 1);
+    ASSERT_EQ(pick.opcode(ret), Opcode::RET);
+    EXPECT_EQ(pick.opcode(pick.operands(pick.operands(ret)[0])[1]), Opcode::MUL);
+    EXPECT_EQ(pick.type(pick.operands(ret)[0]), primitive(TypeKind::I64));
+}
+
+TEST_F(LoweringTest, CallsFunctionsDeclaredLater)
+{
+    ASSERT_TRUE(lower("function twice(x: f64) -> f64 { return half(x) * 4; }\n"
+                      "function half(x: f64) -> f64 { return x / 2; }\n"
+                      "function nothing() -> void { }\n")) << unit.error_message;
+
+    ASSERT_EQ(module.function_count(), 3);
+    const Function &twice = module.function(0);
+    EXPECT_EQ(twice.verify(module.types), "");
+    EXPECT_EQ(count(twice, Opcode::CALL), 1);
+    EXPECT_EQ(count(twice, Opcode::FMUL), 1);
+    for (uint32_t value = 0; value < twice.size(); ++value)
+    {
+        if (twice.opcode(value) == Opcode::CALL)
+            EXPECT_EQ(twice.immediate(value), module.find_function("half"));
+    }
+    EXPECT_EQ(module.function(2).opcode(0), Opcode::RET);
+}
+
+TEST_F(LoweringTest, ReportsTypeErrors)
+{
+    EXPECT_FALSE(lower("function bad(x: i32, f: f32) -> i32 {\n"
+                       "    return x + f;\n"
+                       "}\n"
+                       "function good() -> u8 { return 255; }\n"));
+    ASSERT_FALSE(unit.errors.empty());
+    EXPECT_NE(unit.errors[0].message.find("Mismatched types"), std::string::npos);
+    EXPECT_EQ(unit.errors[0].line, 2);
+
+    // the failing function is left as a declaration, the others are lowered
+    EXPECT_EQ(module.function(0).size(), 0);
+    EXPECT_EQ(module.function(1).verify(module.types), "");
+
+    Module other;
+    unit = parse_unit(SourceBuffer("lower.yu", "function small() -> u8 { return 256; }\n"
+                                               "function open(x: i32) -> i32 { if (x > 0) { return 1; } }\n"), false);
+    EXPECT_FALSE(lower_unit(unit, other));
+    ASSERT_EQ(unit.errors.size(), 2);
+    EXPECT_NE(unit.errors[0].message.find("does not fit"), std::string::npos);
+    EXPECT_NE(unit.errors[1].message.find("without returning"), std::string::npos);
+}
+
+TEST_F(LoweringTest, ReportsNonTailCallsOfTailrecFunctions)
+{
+    ASSERT_TRUE(lower("@tailrec function sum(n: i64, acc: i64) -> i64 {\n"
+                      "    if (n == 0) { return acc; }\n"
+                      "    return sum(n - 1, acc + n);\n"
+                      "}\n"));
+    EXPECT_EQ(module.function(0).verify(module.types), "");
+
+    Module other;
+    unit = parse_unit(SourceBuffer("lower.yu", "@tailrec function fact(n: i64) -> i64 {\n"
+                                               "    if (n < 2) { return 1; }\n"
+                                               "    return n * fact(n - 1);\n"
+                                               "}\n"
+                                               "function plain(n: i64) -> i64 { return n * plain(n - 1); }\n"), false);
+    EXPECT_FALSE(lower_unit(unit, other));
+    ASSERT_EQ(unit.errors.size(), 1);
+    EXPECT_NE(unit.errors[0].message.find("not a tail call"), std::string::npos);
+    EXPECT_EQ(unit.errors[0].line, 3);
+    EXPECT_EQ(other.function(0).size(), 0);
+    EXPECT_EQ(other.function(1).verify(other.types), "");
+}
+
+TEST_F(LoweringTest, WarnsAboutUnsupportedConstructs)
+{
+    ASSERT_TRUE(lower("function greet() -> void { var s = \"hi\"; }\n"
+                      "function <T> id(x: T) -> T { return x; }\n"
+                      "function name(s: string) -> void { }\n"));
+
+    EXPECT_TRUE(unit.errors.empty());
+    ASSERT_EQ(unit.warnings.size(), 2);
+    EXPECT_NE(unit.warnings[0].message.find("name"), std::string::npos);
+    EXPECT_NE(unit.warnings[1].message.find("String literals"), std::string::npos);
+
+    ASSERT_EQ(module.function_count(), 1);
+    EXPECT_EQ(module.function(0).size(), 0);
+}
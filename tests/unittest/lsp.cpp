@@ -0,0 +1,36 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <sstream>
+#include <string>
+#include <gtest/gtest.h>
+#include "../../cli/lsp.h"
+
+class LspTest : public testing::Test
+{
+protected:
+    void SetUp() override {}
+
+    void TearDown() override {}
+
+    static std::string frame(const std::string &body)
+    {
+        return "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    }
+};
+
+TEST_F(LspTest, OpensDocumentWithMalformedEscape)
+{
+    std::istringstream in(
+        frame(R"({"jsonrpc":"2.0","method":"textDocument/didOpen","params":{"textDocument":)"
+              R"({"uri":"file:///tmp/a%zz%41.yu","text":"var x = 4;\n"}}})") +
+        frame(R"({"jsonrpc":"2.0","id":1,"method":"textDocument/documentSymbol","params":)"
+              R"({"textDocument":{"uri":"file:///tmp/a%zz%41.yu"}}})") +
+        frame(R"({"jsonrpc":"2.0","method":"exit"})"));
+    std::ostringstream out;
+    run_language_server(in, out, nullptr);
+
+    const std::string written = out.str();
+    EXPECT_NE(written.find("textDocument/publishDiagnostics"), std::string::npos);
+    EXPECT_NE(written.find("\"x\""), std::string::npos);
+}
@@ -0,0 +1,110 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <gtest/gtest.h>
+#include "../../compiler/include/module_interface.h"
+
+using namespace yu::compiler;
+
+class ModuleInterfaceTest : public testing::Test
+{
+protected:
+    std::filesystem::path root;
+
+    static CompilationUnit parse(const std::string_view source)
+    {
+        return parse_unit(SourceBuffer("lib.yu", source), false);
+    }
+
+    void SetUp() override
+    {
+        root = std::filesystem::temp_directory_path() / "yu-module-interface-test";
+        std::filesystem::remove_all(root);
+        std::filesystem::create_directories(root);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(root);
+    }
+};
+
+TEST_F(ModuleInterfaceTest, ExportsTopLevelDeclarationsWithSignatures)
+{
+    const auto unit = parse("import { x } from 'other';\nconst limit: u32 = 4;\n"
+                            "function <T> scale(v: T, k: i32, n: i32) -> T { return v; }\nvar total = 0;\n");
+    ASSERT_TRUE(unit.success) << unit.error_message;
+
+    const auto interface = ModuleInterface::build(unit);
+    ASSERT_EQ(interface.symbol_count(), 3);
+    EXPECT_EQ(interface.find("x"), ModuleInterface::no_symbol);
+    EXPECT_EQ(interface.find("v"), ModuleInterface::no_symbol);
+
+    const uint32_t limit = interface.find("limit");
+    ASSERT_NE(limit, ModuleInterface::no_symbol);
+    EXPECT_EQ(interface.symbol_name(limit), "limit");
+    EXPECT_EQ(interface.type_name(interface.symbol_type(limit)), "u32");
+
+    const uint32_t scale = interface.find("scale");
+    ASSERT_NE(scale, ModuleInterface::no_symbol);
+    const uint32_t signature = interface.symbol_type(scale);
+    ASSERT_NE(signature, ModuleInterface::no_type);
+    EXPECT_EQ(interface.type_name(signature), "function");
+    const auto params = interface.type_params(signature);
+    ASSERT_EQ(params.size(), 3);
+    ASSERT_EQ(interface.type_generics(signature).size(), 1);
+    EXPECT_EQ(interface.type_name(interface.type_generics(signature)[0]), "T");
+    EXPECT_EQ(interface.type_name(params[1]), "i32");
+    // structurally equal types share a row
+    EXPECT_EQ(params[0], interface.type_generics(signature)[0]);
+    EXPECT_EQ(interface.type_return(signature), params[0]);
+    EXPECT_EQ(params[1], params[2]);
+    EXPECT_NE(interface.find("total"), ModuleInterface::no_symbol);
+}
+
+TEST_F(ModuleInterfaceTest, PerfectHashFindsEverySymbol)
+{
+    std::string source;
+    for (uint32_t i = 0; i < 2000; ++i)
+        source += "var symbol_" + std::to_string(i) + " = " + std::to_string(i) + ";\n";
+    const auto unit = parse(source);
+    ASSERT_TRUE(unit.success) << unit.error_message;
+
+    const auto interface = ModuleInterface::build(unit);
+    ASSERT_EQ(interface.symbol_count(), 2000);
+    for (uint32_t i = 0; i < 2000; ++i)
+    {
+        const std::string name = "symbol_" + std::to_string(i);
+        const uint32_t symbol = interface.find(name);
+        ASSERT_NE(symbol, ModuleInterface::no_symbol) << name;
+        EXPECT_EQ(interface.symbol_name(symbol), name);
+    }
+    EXPECT_EQ(interface.find("symbol_2000"), ModuleInterface::no_symbol);
+    EXPECT_EQ(interface.find(""), ModuleInterface::no_symbol);
+}
+
+TEST_F(ModuleInterfaceTest, WritesAndMapsImages)
+{
+    const auto unit = parse("function id(v: i64) -> i64 { return v; }\n");
+    ASSERT_TRUE(unit.success) << unit.error_message;
+
+    const auto path = (root / "lib.yui").string();
+    const auto built = ModuleInterface::build(unit, { 42, 7 });
+    ASSERT_TRUE(built.write(path));
+
+    ModuleInterface mapped;
+    ASSERT_TRUE(mapped.open(path));
+    EXPECT_TRUE(std::ranges::equal(mapped.image(), built.image()));
+    EXPECT_EQ(mapped.source_stamp(), (SourceStamp { 42, 7 }));
+    EXPECT_EQ(mapped.type_name(mapped.type_return(mapped.symbol_type(mapped.find("id")))), "i64");
+    EXPECT_EQ(ModuleInterface::interface_path("a/lib.yu"), std::filesystem::path("a/lib.yui"));
+
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "YUI1 but not an interface";
+    EXPECT_FALSE(mapped.open(path));
+    EXPECT_FALSE(mapped);
+    EXPECT_FALSE(mapped.open((root / "missing.yui").string()));
+}
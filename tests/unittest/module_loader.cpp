@@ -0,0 +1,167 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <gtest/gtest.h>
+#include "../../compiler/include/module_loader.h"
+
+using namespace yu::compiler;
+
+class ModuleLoaderTest : public testing::Test
+{
+protected:
+    std::filesystem::path root;
+    std::atomic<uint32_t> parses = 0;
+    std::mutex order_mutex;
+    std::vector<std::string> order; // file names in compile order
+
+    void write(const std::filesystem::path &relative, const std::string &contents) const
+    {
+        std::filesystem::create_directories((root / relative).parent_path());
+        std::ofstream(root / relative) << contents;
+    }
+
+    void run(ModuleLoader &loader, const uint32_t threads = 4)
+    {
+        ThreadPool pool(threads);
+        loader.run(pool, [this](uint32_t, const std::string &path)
+        {
+            ++parses;
+            return parse_unit(SourceBuffer::from_file(path), false);
+        }, [this](uint32_t, const Module &module)
+        {
+            std::lock_guard lock(order_mutex);
+            order.push_back(std::filesystem::path(module.path).filename().string());
+        });
+    }
+
+    [[nodiscard]] size_t position(const std::string &file) const
+    {
+        return std::ranges::find(order, file) - order.begin();
+    }
+
+    void SetUp() override
+    {
+        root = std::filesystem::temp_directory_path() / "yu-module-loader-test";
+        std::filesystem::remove_all(root);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(root);
+    }
+};
+
+TEST_F(ModuleLoaderTest, CompilesImportsFirstAndParsesEachOnce)
+{
+    write("main.yu", "import { a } from './a';\nimport './b';\nvar m = 1;\n");
+    write("a.yu", "import 'shared/c';\nvar a = 1;\n");
+    write("b.yu", "import './a.yu';\nimport 'shared/c';\nvar b = 1;\n");
+    write("lib/shared/c.yu", "var c = 1;\n");
+
+    ModuleLoader loader({ root / "lib" });
+    EXPECT_EQ(loader.add_root((root / "main.yu").string()), 0);
+    run(loader);
+
+    ASSERT_EQ(loader.size(), 4);
+    EXPECT_EQ(parses, 4);
+    ASSERT_EQ(order.size(), 4);
+    EXPECT_LT(position("c.yu"), position("a.yu"));
+    EXPECT_LT(position("a.yu"), position("b.yu"));
+    EXPECT_EQ(order.back(), "main.yu");
+
+    const Module &main = loader.module(0);
+    EXPECT_TRUE(main.unit.success) << main.unit.error_message;
+    ASSERT_EQ(main.imports.size(), 2);
+    EXPECT_EQ(main.dependencies, main.imports);
+    const uint32_t a = main.imports[0], c = loader.module(a).imports[0];
+    EXPECT_EQ(loader.module(main.imports[1]).dependencies, (std::vector { a, c }));
+}
+
+TEST_F(ModuleLoaderTest, ReportsUnresolvedImports)
+{
+    write("main.yu", "var m = 1;\nimport 'missing';\n");
+    write("other/missing.yu", "var x = 1;\n");
+
+    ModuleLoader loader;
+    loader.add_root((root / "main.yu").string());
+    run(loader);
+
+    const Module &main = loader.module(0);
+    EXPECT_FALSE(main.unit.success);
+    ASSERT_EQ(main.unit.errors.size(), 1);
+    EXPECT_EQ(main.unit.errors[0].flags, ParseErrorFlags::UNRESOLVED_IMPORT);
+    EXPECT_EQ(main.unit.errors[0].line, 2);
+    EXPECT_EQ(main.unit.errors[0].column, 9);
+    EXPECT_EQ(main.imports, std::vector { ModuleLoader::no_module });
+    EXPECT_EQ(order, std::vector<std::string> { "main.yu" });
+}
+
+TEST_F(ModuleLoaderTest, CutsImportCycles)
+{
+    write("a.yu", "import './b';\nvar a = 1;\n");
+    write("b.yu", "import './c';\nvar b = 1;\n");
+    write("c.yu", "import './a';\nvar c = 1;\n");
+
+    ModuleLoader loader;
+    loader.add_root((root / "a.yu").string());
+    loader.add_root((root / "c.yu").string());
+    run(loader, 2);
+
+    ASSERT_EQ(loader.size(), 3);
+    EXPECT_EQ(parses, 3);
+    ASSERT_EQ(order.size(), 3);
+
+    uint32_t cycles = 0;
+    for (uint32_t module = 0; module < loader.size(); ++module)
+    {
+        for (const auto &error: loader.module(module).unit.errors)
+        {
+            EXPECT_EQ(error.flags, ParseErrorFlags::UNRESOLVED_IMPORT);
+            EXPECT_TRUE(error.message.starts_with("Import cycle: ")) << error.message;
+            ++cycles;
+        }
+    }
+    EXPECT_EQ(cycles, 1);
+}
+
+TEST_F(ModuleLoaderTest, ImportsPrecompiledInterfaces)
+{
+    write("lib/math.yu", "function twice(v: i32) -> i32 { return v; }\nconst pi = 3;\n");
+    const auto library = (root / "lib/math.yu").string();
+    ASSERT_TRUE(ModuleInterface::build(parse_unit(SourceBuffer::from_file(library), false),
+                                       ModuleInterface::stamp(library))
+        .write(ModuleInterface::interface_path(library).string()));
+    write("main.yu", "import { twice, pi } from 'math';\nimport { tau } from 'math';\nvar m = 1;\n");
+
+    ModuleLoader loader({ root / "lib" });
+    loader.add_root((root / "main.yu").string());
+    run(loader);
+
+    ASSERT_EQ(loader.size(), 2);
+    EXPECT_EQ(parses, 1);
+    EXPECT_EQ(order, std::vector<std::string> { "main.yu" });
+    EXPECT_TRUE(loader.module(1).precompiled);
+    EXPECT_NE(loader.module(1).interface.find("twice"), ModuleInterface::no_symbol);
+
+    const auto &errors = loader.module(0).unit.errors;
+    ASSERT_EQ(errors.size(), 1);
+    EXPECT_EQ(errors[0].message, "Module 'math' has no export 'tau'");
+    EXPECT_EQ(errors[0].line, 2);
+    EXPECT_EQ(errors[0].column, 10);
+
+    // a changed source makes the interface stale, the module is parsed again
+    write("lib/math.yu", "function twice(v: i32) -> i32 { return v; }\nconst pi = 3;\nconst tau = 6;\n");
+    ModuleLoader reloaded({ root / "lib" });
+    reloaded.add_root((root / "main.yu").string());
+    order.clear();
+    run(reloaded);
+
+    EXPECT_FALSE(reloaded.module(1).precompiled);
+    EXPECT_TRUE(reloaded.module(0).unit.success) << reloaded.module(0).unit.error_message;
+    EXPECT_EQ(order.size(), 2);
+}
@@ -0,0 +1,209 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <filesystem>
+#include <gtest/gtest.h>
+#include "../../compiler/include/compilation_unit.h"
+#include "../../compiler/include/incremental.h"
+#include "../../compiler/include/unit_cache.h"
+
+using namespace yu::compiler;
+using namespace yu::lang;
+
+class ParserTest : public testing::Test
+{
+protected:
+    static CompilationUnit parse(const std::string_view source)
+    {
+        return parse_unit(SourceBuffer("test.yu", source));
+    }
+
+    void SetUp() override {}
+
+    void TearDown() override {}
+};
+
+TEST_F(ParserTest, UnitOwnsParsedTables)
+{
+    auto unit = parse("var x = 4;\nconst y: i32 = 5;\n");
+
+    ASSERT_TRUE(unit.success) << unit.error_message;
+    ASSERT_EQ(unit.var_decls.names.size(), 2);
+    EXPECT_EQ(unit.var_decls.names[0], "x");
+    EXPECT_EQ(unit.var_decls.names[1], "y");
+    EXPECT_EQ(unit.var_decls.flags[1], 1);
+    EXPECT_STREQ(unit.file_name(), "test.yu");
+}
+
+TEST_F(ParserTest, MovingUnitKeepsViewsValid)
+{
+    // short sources would live in a std::string's inline buffer, which a move relocates
+    auto unit = parse("var a = 1;");
+    const char *data = unit.source.data();
+
+    std::vector<CompilationUnit> units;
+    units.emplace_back(std::move(unit));
+    units.resize(16);
+
+    const auto &moved = units.front();
+    ASSERT_TRUE(moved.success);
+    EXPECT_EQ(moved.source.data(), data);
+    EXPECT_EQ(moved.var_decls.names[0].data(), data + 4);
+    EXPECT_EQ(moved.var_decls.names[0], "a");
+}
+
+TEST_F(ParserTest, FailedParseReportsError)
+{
+    const auto unit = parse("var = 4;");
+
+    EXPECT_FALSE(unit.success);
+    EXPECT_FALSE(unit.error_message.empty());
+}
+
+TEST_F(ParserTest, ParsesImports)
+{
+    const auto unit = parse("import { Vec, dot } from 'math/linear';\nimport 'io' as IO;\nimport * from \"./util\";\n"
+                            "var v = 1;\n");
+
+    ASSERT_TRUE(unit.success) << unit.error_message;
+    ASSERT_EQ(unit.imports.paths.size(), 3);
+    EXPECT_EQ(unit.imports.paths[0], "math/linear");
+    EXPECT_EQ(unit.imports.paths[1], "io");
+    EXPECT_EQ(unit.imports.paths[2], "./util");
+    EXPECT_EQ(unit.imports.aliases[1], "IO");
+    EXPECT_EQ(unit.imports.name_counts[0], 2);
+    EXPECT_EQ(unit.imports.names[unit.imports.name_starts[0] + 1], "dot");
+    EXPECT_EQ(unit.imports.name_counts[2], 0);
+    EXPECT_EQ(unit.var_decls.names.size(), 1);
+
+    EXPECT_FALSE(parse("import { A } 'm';").success);
+    EXPECT_FALSE(parse("import 'm'").success);
+}
+
+TEST_F(ParserTest, UnitCacheRoundTrip)
+{
+    const auto directory = std::filesystem::temp_directory_path() / "yu-unit-cache-test";
+    std::filesystem::remove_all(directory);
+    const UnitCache cache(directory);
+
+    constexpr std::string_view source = "var x = 4;\nfunction f(a: i32) -> i32 { return a; }\n";
+    const auto unit = parse(source);
+    ASSERT_TRUE(unit.success) << unit.error_message;
+    ASSERT_TRUE(cache.store(unit));
+
+    SourceBuffer buffer("test.yu", source);
+    const char *data = buffer.data();
+    CompilationUnit cached;
+    ASSERT_TRUE(cache.load(buffer, cached));
+
+    EXPECT_EQ(cached.source.data(), data);
+    EXPECT_EQ(cached.tokens.types, unit.tokens.types);
+    EXPECT_EQ(cached.tokens.starts, unit.tokens.starts);
+    EXPECT_EQ(cached.line_starts, unit.line_starts);
+    EXPECT_EQ(cached.types.names, unit.types.names);
+    EXPECT_EQ(cached.symbols.names, unit.symbols.names);
+    ASSERT_EQ(cached.var_decls.names.size(), 1);
+    EXPECT_EQ(cached.var_decls.names[0].data(), data + 4);
+
+    SourceBuffer edited("test.yu", "var y = 4;");
+    CompilationUnit miss;
+    EXPECT_FALSE(cache.load(edited, miss));
+    EXPECT_NE(edited.data(), nullptr);
+
+    std::filesystem::remove_all(directory);
+}
+
+namespace
+{
+    std::vector<std::string> dump_columns(const CompilationUnit &unit)
+    {
+        std::vector<std::string> columns;
+        for_each_column(unit, [&columns](const auto &column)
+        {
+            std::string dump;
+            for (const auto &value : column)
+            {
+                if constexpr (std::is_same_v<std::decay_t<decltype(value)>, std::string_view>)
+                    dump += value;
+                else
+                    dump += std::to_string(static_cast<uint64_t>(value));
+                dump += ',';
+            }
+            columns.emplace_back(std::move(dump));
+        });
+        return columns;
+    }
+}
+
+TEST_F(ParserTest, IncrementalReparseMatchesFullParse)
+{
+    constexpr std::string_view source = "var x = 4;\n"
+                                        "function f(a: i32) -> i32 { return a; }\n"
+                                        "var y = x;\n"
+                                        "const z: i32 = 5;\n";
+
+    struct Case
+    {
+        TextEdit edit;
+        bool incremental;
+    };
+    const Case cases[] = {
+        { { 8, 1, "42" }, true },                     // x is used by y, which is reparsed too
+        { { 77, 1, "7" }, true },                     // only z
+        { { 38, 0, "\n\n" }, true },                  // lines after f move
+        { { 51, 0, "var w = 1;\n" }, true },          // new declaration before y
+        { { 11, 0, "/* " }, false },                  // comment runs into later declarations
+        { { 11, 8, "" }, false },                     // syntax error, reported by a full parse
+        { { 0, static_cast<uint32_t>(source.size()), "" }, true },
+    };
+
+    for (const auto &[edit, incremental] : cases)
+    {
+        std::string edited(source);
+        edited.replace(edit.offset, edit.removed, edit.inserted);
+        const auto expected = parse(edited);
+
+        auto unit = parse(source);
+        ASSERT_TRUE(unit.success) << unit.error_message;
+        const auto stats = reparse(unit, edit);
+
+        EXPECT_EQ(stats.incremental, incremental) << edited;
+        EXPECT_EQ(unit.success, expected.success) << edited;
+        EXPECT_EQ(unit.source.view(), edited);
+        EXPECT_EQ(dump_columns(unit), dump_columns(expected)) << edited;
+    }
+}
+
+TEST_F(ParserTest, IncrementalReparseOnlyTouchesEditedDeclaration)
+{
+    auto unit = parse("var a = 1;\nvar b = 2;\nvar c = 3;\n");
+    ASSERT_TRUE(unit.success) << unit.error_message;
+
+    const auto stats = reparse(unit, { 19, 1, "20" });
+
+    EXPECT_TRUE(stats.incremental);
+    EXPECT_EQ(stats.first_decl, 1);
+    EXPECT_EQ(stats.reparsed_decls, 1);
+    ASSERT_EQ(unit.var_decls.names.size(), 3);
+    EXPECT_EQ(unit.expressions.values[1], "20");
+    EXPECT_EQ(unit.var_decls.names[2].data(), unit.source.data() + 27);
+    EXPECT_THROW(reparse(unit, { 100, 0, "x" }), std::out_of_range);
+}
+
+TEST_F(ParserTest, ParsesDeclarationAttributes)
+{
+    auto unit = parse("@pure @nodiscard function f(x: i32) -> i32 { return x; }\n"
+                      "@align(8) var a = 1;\n"
+                      "inline function g() -> i32 { return 1; }\n");
+    ASSERT_TRUE(unit.success) << unit.error_message;
+    ASSERT_EQ(unit.decls.token_starts.size(), 3);
+    EXPECT_EQ(unit.tokens.types[decl_keyword(unit, 0)], token_i::FUNCTION);
+    EXPECT_EQ(decl_attributes(unit, 0), static_cast<uint8_t>(DeclAttributes::PURE) |
+                                        static_cast<uint8_t>(DeclAttributes::NO_DISCARD));
+    EXPECT_EQ(unit.tokens.types[decl_keyword(unit, 1)], token_i::VAR);
+    EXPECT_EQ(decl_attributes(unit, 1), 0);
+    EXPECT_EQ(decl_attributes(unit, 2), static_cast<uint8_t>(DeclAttributes::INLINE));
+
+    EXPECT_FALSE(parse("inline var b = 1;").success);
+    EXPECT_FALSE(parse("@align(8 var c = 1;").success);
+}
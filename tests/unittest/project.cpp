@@ -0,0 +1,87 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <gtest/gtest.h>
+#include "../../compiler/include/project.h"
+
+using namespace yu::compiler;
+
+class ProjectTest : public testing::Test
+{
+protected:
+    std::filesystem::path root;
+
+    void write(const std::filesystem::path &relative, const std::string &contents) const
+    {
+        std::filesystem::create_directories((root / relative).parent_path());
+        std::ofstream(root / relative) << contents;
+    }
+
+    void SetUp() override
+    {
+        root = std::filesystem::temp_directory_path() / "yu-project-test";
+        std::filesystem::remove_all(root);
+        write("src/a.yu", "var a = 1;\n");
+        write("src/nested/b.yu", "var b = 2;\nvar c = 3;\n");
+        write("src/notes.txt", "not a source");
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(root);
+    }
+};
+
+TEST_F(ProjectTest, ScansDirectoriesForSources)
+{
+    Project project;
+    project.add(root / "src");
+
+    ASSERT_EQ(project.files().size(), 2);
+    EXPECT_EQ(project.files()[0].path, (root / "src/a.yu").string());
+    EXPECT_EQ(project.files()[0].size, 11);
+    EXPECT_EQ(project.files()[1].path, (root / "src/nested/b.yu").string());
+}
+
+TEST_F(ProjectTest, ReadsManifestsAndSkipsDuplicates)
+{
+    write("yu.project", "# sources\nsrc/nested\n\nsrc/a.yu\nsrc/./a.yu\nmissing.yu\n");
+
+    Project project;
+    project.add(root);
+
+    ASSERT_EQ(project.files().size(), 3);
+    EXPECT_EQ(project.files()[0].path, (root / "src/nested/b.yu").string());
+    EXPECT_EQ(project.files()[2].size, 0);
+    EXPECT_THROW(project.add(root / "nowhere"), std::runtime_error);
+}
+
+TEST_F(ProjectTest, ReadsNestedManifestsOfListedDirectories)
+{
+    // src/nested lists only c.yu, so b.yu is not scanned; the cycle back to the root ends there
+    write("yu.project", "src/nested\nsrc/a.yu\n");
+    write("src/nested/yu.project", "c.yu\n../..\n");
+    write("src/nested/c.yu", "var d = 4;\n");
+
+    Project project;
+    project.add(root);
+
+    ASSERT_EQ(project.files().size(), 2);
+    EXPECT_EQ(project.files()[0].path, (root / "src/nested/c.yu").string());
+    EXPECT_EQ(project.files()[1].path, (root / "src/a.yu").string());
+}
+
+TEST_F(ProjectTest, SchedulesLargestFirst)
+{
+    Project project;
+    project.add_file(root / "src/a.yu");
+    project.add_file(root / "src/nested/b.yu");
+
+    const auto order = project.schedule();
+    ASSERT_EQ(order.size(), 2);
+    EXPECT_EQ(order[0], 1);
+    EXPECT_EQ(order[1], 0);
+}
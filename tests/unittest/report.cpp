@@ -0,0 +1,109 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "../../cli/json.h"
+#include "../../cli/report.h"
+
+using namespace yu::compiler;
+
+class ReportTest : public testing::Test
+{
+protected:
+    void SetUp() override {}
+
+    void TearDown() override {}
+
+    static FileReport render(const std::string &name, const std::string &source, const OutputFormat format)
+    {
+        const CompilationUnit unit = parse_unit(SourceBuffer(name, source), false);
+        FileReport report;
+        render_report(unit, format, report);
+        return report;
+    }
+};
+
+TEST_F(ReportTest, RendersTextLines)
+{
+    const FileReport parsed = render("a.yu", "var a = 1;\nvar b = 2;\n", OutputFormat::TEXT);
+    EXPECT_EQ(parsed.out, "File: a.yu\nParsed variable: a\nParsed variable: b\n");
+    EXPECT_EQ(parsed.err, "");
+
+    const FileReport failed = render("bad.yu", "var = ;\n", OutputFormat::TEXT);
+    EXPECT_EQ(failed.out, "File: bad.yu\n");
+    EXPECT_NE(failed.err.find("error"), std::string::npos);
+    EXPECT_NE(failed.err.find("bad.yu:1:"), std::string::npos);
+    EXPECT_NE(failed.err.find("\nError parsing bad.yu: "), std::string::npos);
+    EXPECT_EQ(failed.err.back(), '\n');
+}
+
+TEST_F(ReportTest, KeepsDiagnosticsOfEachFileTogether)
+{
+    std::vector<FileReport> reports;
+    reports.push_back(render("first.yu", "var a = 1;\nvar = ;\n", OutputFormat::TEXT));
+    reports.push_back(render("second.yu", "var = ;\n", OutputFormat::TEXT));
+    const std::vector<uint32_t> file_modules = { 1, 0 };
+
+    std::vector<const std::string *> out, err;
+    gather_reports(reports, file_modules, out, err);
+    std::string written;
+    for (const std::string *buffer: err)
+        written += *buffer;
+
+    // everything about second.yu, which is listed first, comes before anything about first.yu
+    const size_t first = written.find("first.yu");
+    ASSERT_NE(first, std::string::npos);
+    ASSERT_NE(written.find("second.yu"), std::string::npos);
+    EXPECT_EQ(written.rfind("second.yu"), written.rfind("second.yu", first));
+    EXPECT_NE(written.find("first.yu:2:"), std::string::npos);
+}
+
+TEST_F(ReportTest, RendersOneJsonObjectPerFile)
+{
+    const FileReport parsed = render("a \"quoted\".yu", "var a = 1;\nvar b = 2;\n", OutputFormat::JSON);
+    ASSERT_EQ(parsed.out.back(), '\n');
+    EXPECT_EQ(parsed.out.find('\n'), parsed.out.size() - 1);
+    EXPECT_EQ(parsed.err, "");
+    const Json json = Json::parse(parsed.out);
+    EXPECT_EQ(json["file"].as_string(), "a \"quoted\".yu");
+    EXPECT_EQ(json["success"].dump(), "true");
+    ASSERT_EQ(json["variables"].as_array().size(), 2);
+    EXPECT_EQ(json["variables"].as_array()[1].as_string(), "b");
+    EXPECT_TRUE(json["diagnostics"].as_array().empty());
+    EXPECT_TRUE(json["error"].is_null());
+
+    const FileReport failed = render("bad.yu", "var = ;\n", OutputFormat::JSON);
+    const Json error = Json::parse(failed.out);
+    EXPECT_EQ(error["success"].dump(), "false");
+    EXPECT_FALSE(error["error"].as_string().empty());
+    ASSERT_FALSE(error["diagnostics"].as_array().empty());
+    const Json &diagnostic = error["diagnostics"].as_array()[0];
+    EXPECT_EQ(diagnostic["severity"].as_string(), "error");
+    EXPECT_EQ(diagnostic["line"].as_number(), 1);
+    EXPECT_FALSE(diagnostic["code"].as_string().empty());
+}
+
+TEST_F(ReportTest, GathersReportsInFileOrder)
+{
+    // modules numbered in the order workers finished; module 3 is only imported, module 1 named twice
+    std::vector<FileReport> reports(4);
+    for (uint32_t module = 0; module < reports.size(); ++module)
+    {
+        reports[module].out = "out" + std::to_string(module);
+        reports[module].err = "err" + std::to_string(module);
+    }
+    const std::vector<uint32_t> file_modules = { 2, 0, 1, 1 };
+
+    std::vector<const std::string *> out, err;
+    gather_reports(reports, file_modules, out, err);
+
+    std::string out_order, err_order;
+    for (const std::string *buffer: out)
+        out_order += *buffer + ' ';
+    for (const std::string *buffer: err)
+        err_order += *buffer + ' ';
+    EXPECT_EQ(out_order, "out2 out0 out1 out3 ");
+    EXPECT_EQ(err_order, "err2 err0 err1 err3 ");
+}
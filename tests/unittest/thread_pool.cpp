@@ -0,0 +1,100 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+#include <gtest/gtest.h>
+#include "../../compiler/include/thread_pool.h"
+
+using namespace yu::compiler;
+
+class ThreadPoolTest : public testing::Test
+{
+protected:
+    void SetUp() override {}
+
+    void TearDown() override {}
+};
+
+TEST_F(ThreadPoolTest, RunsEveryTask)
+{
+    ThreadPool pool(4);
+    std::atomic<uint32_t> sum = 0;
+    for (uint32_t i = 1; i <= 1000; ++i)
+        pool.submit([&sum, i] { sum += i; });
+    pool.wait();
+
+    EXPECT_EQ(sum, 500500);
+    EXPECT_EQ(pool.size(), 4);
+}
+
+TEST_F(ThreadPoolTest, TasksCanSubmitTasks)
+{
+    ThreadPool pool(2);
+    std::atomic<uint32_t> count = 0;
+    std::atomic<bool> on_worker = true;
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        pool.submit([&]
+        {
+            on_worker = on_worker && ThreadPool::worker_index() < pool.size();
+            for (uint32_t j = 0; j < 8; ++j)
+                pool.submit([&count] { ++count; });
+        });
+    }
+    pool.wait();
+
+    EXPECT_EQ(count, 64);
+    EXPECT_TRUE(on_worker);
+    EXPECT_EQ(ThreadPool::worker_index(), UINT32_MAX);
+}
+
+TEST_F(ThreadPoolTest, RunsOutsideTasksInSubmissionOrder)
+{
+    ThreadPool pool(1);
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < 20; ++i)
+    {
+        pool.submit([&, i]
+        {
+            order.push_back(i);
+            // nested tasks go ahead of the outside ones still queued
+            if (i == 0)
+                pool.submit([&order] { order.push_back(100); });
+        });
+    }
+    pool.wait();
+
+    std::vector<uint32_t> expected = { 0, 100 };
+    for (uint32_t i = 1; i < 20; ++i)
+        expected.push_back(i);
+    EXPECT_EQ(order, expected);
+}
+
+TEST_F(ThreadPoolTest, RunsOwnTasksNewestFirst)
+{
+    ThreadPool pool(1);
+    std::vector<uint32_t> order;
+    pool.submit([&]
+    {
+        for (uint32_t i = 0; i < 4; ++i)
+            pool.submit([&order, i] { order.push_back(i); });
+    });
+    pool.wait();
+
+    EXPECT_EQ(order, (std::vector<uint32_t> { 3, 2, 1, 0 }));
+}
+
+TEST_F(ThreadPoolTest, WaitRethrowsTaskFailure)
+{
+    ThreadPool pool(2);
+    std::atomic<uint32_t> count = 0;
+    pool.submit([] { throw std::runtime_error("task failed"); });
+    for (uint32_t i = 0; i < 10; ++i)
+        pool.submit([&count] { ++count; });
+
+    EXPECT_THROW(pool.wait(), std::runtime_error);
+    EXPECT_EQ(count, 10);
+    EXPECT_NO_THROW(pool.wait());
+}
@@ -0,0 +1,164 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include "../../compiler/include/compilation_unit.h"
+#include "../../compiler/include/thread_pool.h"
+#include "../../compiler/include/timer.h"
+
+using namespace yu::compiler;
+
+class TimerTest : public testing::Test
+{
+protected:
+    void SetUp() override {}
+
+    void TearDown() override {}
+};
+
+static const PhaseStats *find_phase(const std::vector<PhaseStats> &phases, const std::string_view path)
+{
+    const auto it = std::ranges::find_if(phases, [&](const PhaseStats &phase) { return phase.path == path; });
+    return it == phases.end() ? nullptr : &*it;
+}
+
+TEST_F(TimerTest, NestsScopesAndSamplesPerOutermostScope)
+{
+    Timer::reset();
+    Timer::set_enabled(true);
+    for (uint32_t file = 0; file < 3; ++file)
+    {
+        const Timer timer("test-file");
+        timer.add_bytes(100);
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            const Timer inner("test-step");
+            inner.add_tokens(2);
+        }
+    }
+    Timer::set_enabled(false);
+    {
+        const Timer ignored("test-file");
+    }
+
+    const auto phases = Timer::collect();
+    const PhaseStats *file = find_phase(phases, "test-file");
+    const PhaseStats *step = find_phase(phases, "test-file/test-step");
+    ASSERT_NE(file, nullptr);
+    ASSERT_NE(step, nullptr);
+    EXPECT_LT(file, step); // parents come first
+
+    EXPECT_EQ(file->depth, 0);
+    EXPECT_EQ(file->calls, 3);
+    EXPECT_EQ(file->samples, 3);
+    EXPECT_EQ(file->bytes, 300);
+
+    EXPECT_EQ(step->depth, 1);
+    EXPECT_EQ(step->name, "test-step");
+    EXPECT_EQ(step->calls, 12);
+    EXPECT_EQ(step->samples, 3);
+    EXPECT_EQ(step->tokens, 24);
+    EXPECT_LE(step->min_ns, step->avg_ns());
+    EXPECT_LE(step->avg_ns(), step->max_ns);
+    EXPECT_LE(step->total_ns, file->total_ns);
+}
+
+TEST_F(TimerTest, MergesThreadsAndTimesFrontEndPhases)
+{
+    Timer::reset();
+    Timer::set_enabled(true);
+    {
+        ThreadPool pool(4);
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            pool.submit([]
+            {
+                const Timer timer("test-unit");
+                auto unit = parse_unit(SourceBuffer("test.yu", "var x = 1;\nvar y = true;"), false);
+                EXPECT_TRUE(unit.success);
+            });
+        }
+        pool.wait();
+    }
+    Timer::set_enabled(false);
+
+    const auto phases = Timer::collect();
+    const PhaseStats *lex = find_phase(phases, "test-unit/lex");
+    const PhaseStats *infer = find_phase(phases, "test-unit/parse/infer");
+    ASSERT_NE(lex, nullptr);
+    ASSERT_NE(infer, nullptr);
+    EXPECT_EQ(lex->samples, 16);
+    EXPECT_EQ(lex->bytes, 16 * 24);
+    EXPECT_GT(lex->tokens, 0);
+    EXPECT_EQ(infer->calls, 32);
+    EXPECT_EQ(infer->samples, 16);
+}
+
+TEST_F(TimerTest, ReadsHardwareCountersWhenAvailable)
+{
+    Timer::reset();
+    Timer::set_enabled(true);
+    Timer::set_counters_enabled(true);
+    {
+        const Timer timer("test-counted");
+        auto unit = parse_unit(SourceBuffer("test.yu", "var x = 1;"), false);
+        EXPECT_TRUE(unit.success);
+    }
+    Timer::set_counters_enabled(false);
+    Timer::set_enabled(false);
+
+    const PerfCounters counters;
+    const auto phases = Timer::collect();
+    const PhaseStats *phase = find_phase(phases, "test-counted");
+    ASSERT_NE(phase, nullptr);
+    EXPECT_EQ(phase->counter_mask, counters.mask());
+    if (!counters.mask())
+    {
+        // no PMU here: timings are still recorded and the reason is kept
+        EXPECT_FALSE(counters.error().empty());
+        EXPECT_FALSE(Timer::counters_error().empty());
+        EXPECT_EQ(phase->calls, 1);
+    }
+    else if (counters.mask() & 1u << static_cast<uint32_t>(PerfCounter::INSTRUCTIONS))
+        EXPECT_GT(phase->counters[static_cast<uint32_t>(PerfCounter::INSTRUCTIONS)], 0);
+}
+
+TEST_F(TimerTest, RecordsPeakAndRetainedMemoryPerScope)
+{
+    Timer::reset();
+    Timer::set_enabled(true);
+    Timer::set_memory_enabled(true);
+    CountedVector<uint32_t> kept;
+    {
+        const Timer timer("test-memory");
+        {
+            const Timer inner("test-scratch");
+            CountedVector<uint32_t> scratch(1024);
+        }
+        kept.resize(256);
+        timer.add_tokens(256);
+        timer.add_declarations(4);
+    }
+    Timer::set_memory_enabled(false);
+    Timer::set_enabled(false);
+
+    const auto phases = Timer::collect();
+    const PhaseStats *outer = find_phase(phases, "test-memory");
+    const PhaseStats *inner = find_phase(phases, "test-memory/test-scratch");
+    ASSERT_NE(outer, nullptr);
+    ASSERT_NE(inner, nullptr);
+    EXPECT_TRUE(outer->memory_tracked);
+    EXPECT_EQ(outer->declarations, 4);
+
+    // the scratch vector is gone when the scope ends but still counts towards both peaks
+    EXPECT_GE(inner->peak_bytes, 1024 * 4);
+    if (global_new_tracked)
+        EXPECT_LT(inner->retained_bytes, 1024 * 4); // the Timer's own bookkeeping is counted too
+    else
+        EXPECT_EQ(inner->retained_bytes, 0);
+    EXPECT_GE(outer->peak_bytes, inner->peak_bytes);
+    EXPECT_GE(outer->retained_bytes, 256 * 4);
+    EXPECT_GE(outer->allocated_bytes, (1024 + 256) * 4);
+    EXPECT_GE(outer->allocations, 2);
+}
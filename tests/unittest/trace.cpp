@@ -0,0 +1,89 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <algorithm>
+#include <string_view>
+#include <gtest/gtest.h>
+#include "../../compiler/include/thread_pool.h"
+#include "../../compiler/include/timer.h"
+#include "../../compiler/include/trace.h"
+
+using namespace yu::compiler;
+
+class TraceTest : public testing::Test
+{
+protected:
+    void SetUp() override {}
+
+    void TearDown() override {}
+};
+
+TEST_F(TraceTest, RecordsNestedTimersAsSpansPerThread)
+{
+    Tracer::reset();
+    Tracer::set_enabled(true);
+    {
+        ThreadPool pool(2);
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            pool.submit([]
+            {
+                const Timer outer("test-outer", "unit.yu");
+                const Timer inner("test-inner");
+            });
+        }
+        pool.wait();
+    }
+    Tracer::set_enabled(false);
+
+    uint32_t outer_spans = 0, inner_spans = 0, queue_samples = 0;
+    for (const auto &thread: Tracer::collect())
+    {
+        EXPECT_FALSE(thread.name.empty());
+        const TraceEvent *last_inner = nullptr;
+        for (const auto &event: thread.events)
+        {
+            if (event.type == TraceEventType::COUNTER)
+            {
+                queue_samples += std::string_view(event.name) == "queue depth";
+                continue;
+            }
+
+            if (std::string_view(event.name) == "test-inner")
+            {
+                ++inner_spans;
+                last_inner = &event;
+            }
+            else if (std::string_view(event.name) == "test-outer")
+            {
+                ++outer_spans;
+                EXPECT_EQ(event.detail, "unit.yu");
+                // the inner span closes first and lies within the outer one
+                ASSERT_NE(last_inner, nullptr);
+                EXPECT_GE(last_inner->start_ns, event.start_ns);
+                EXPECT_LE(last_inner->start_ns + last_inner->duration_ns, event.start_ns + event.duration_ns);
+            }
+        }
+    }
+
+    EXPECT_EQ(outer_spans, 8);
+    EXPECT_EQ(inner_spans, 8);
+    EXPECT_EQ(queue_samples, 16); // every submit and every take
+}
+
+TEST_F(TraceTest, RecordsNothingWhileDisabled)
+{
+    Tracer::reset();
+    {
+        const Timer timer("test-untraced");
+        Tracer::counter("test-counter", 1);
+    }
+
+    for (const auto &thread: Tracer::collect())
+    {
+        EXPECT_TRUE(std::ranges::none_of(thread.events, [](const TraceEvent &event)
+        {
+            return std::string_view(event.name) == "test-untraced";
+        }));
+    }
+}
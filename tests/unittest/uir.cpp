@@ -0,0 +1,179 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <stdexcept>
+#include <vector>
+#include <gtest/gtest.h>
+#include "../../compiler/include/uir.h"
+#include "../../compiler/include/uir_builder.h"
+
+using namespace yu::uir;
+
+class UirTest : public testing::Test
+{
+protected:
+    void SetUp() override {}
+
+    void TearDown() override {}
+
+    static constexpr TypeId i32 = primitive(TypeKind::I32);
+
+    /**
+     * @brief Builds `max(a, b)` as a diamond joined by a phi.
+     */
+    static uint32_t build_max(Module &module)
+    {
+        const uint32_t index = module.add_function("max", { i32, i32 }, i32);
+        Builder builder(module, index);
+        const uint32_t entry = builder.create_block();
+        const uint32_t left = builder.create_block();
+        const uint32_t right = builder.create_block();
+        const uint32_t join = builder.create_block();
+
+        builder.set_insert_block(entry);
+        const uint32_t a = builder.param(0);
+        const uint32_t b = builder.param(1);
+        builder.branch(builder.binary(Opcode::CMP_GT, a, b), left, right);
+
+        builder.set_insert_block(join);
+        const uint32_t result = builder.phi(i32);
+        builder.set_name(result, "result");
+        builder.ret(result);
+
+        // incoming values are added as the predecessors are filled
+        builder.set_insert_block(left);
+        builder.jump(join);
+        builder.add_incoming(result, a, left);
+        builder.set_insert_block(right);
+        const uint32_t bumped = builder.binary(Opcode::ADD, b, builder.constant(i32, 0));
+        builder.jump(join);
+        builder.add_incoming(result, bumped, right);
+
+        builder.finish();
+        return index;
+    }
+};
+
+TEST_F(UirTest, BuildsAndVerifiesAFunction)
+{
+    Module module;
+    const Function &max = module.function(build_max(module));
+
+    ASSERT_TRUE(max.laid_out());
+    EXPECT_EQ(max.verify(module.types), "");
+    EXPECT_EQ(max.block_count(), 4);
+    EXPECT_EQ(max.size(), 10);
+
+    // parameters and constants lead the entry block, whatever order they were created in
+    EXPECT_EQ(max.opcode(0), Opcode::PARAM);
+    EXPECT_EQ(max.opcode(1), Opcode::PARAM);
+    EXPECT_EQ(max.opcode(2), Opcode::CONST);
+    EXPECT_EQ(max.opcode(3), Opcode::CMP_GT);
+    EXPECT_EQ(max.type(3), primitive(TypeKind::BOOL));
+    EXPECT_EQ(max.terminator(0), 4);
+
+    const uint32_t phi = max.block_begin(3);
+    EXPECT_EQ(max.opcode(phi), Opcode::PHI);
+    EXPECT_EQ(max.operands(phi).size(), 2);
+    EXPECT_EQ(max.targets(phi)[0], 1);
+    EXPECT_EQ(max.operands(phi)[0], 0);
+    EXPECT_EQ(max.opcode(max.operands(phi)[1]), Opcode::ADD);
+    EXPECT_EQ(max.block_of(phi), 3);
+    EXPECT_EQ(max.block_of(2), 0);
+}
+
+TEST_F(UirTest, ComputesUsesAndPredecessors)
+{
+    Module module;
+    Function &max = module.function(build_max(module));
+    max.compute_uses();
+    max.compute_predecessors();
+
+    // a is used by the comparison and the phi
+    ASSERT_EQ(max.uses(0).size(), 2);
+    EXPECT_EQ(max.uses(0)[0], 3);
+    EXPECT_EQ(max.opcode(max.uses(0)[1]), Opcode::PHI);
+
+    EXPECT_TRUE(max.predecessors(0).empty());
+    EXPECT_EQ(max.predecessors(1).size(), 1);
+    ASSERT_EQ(max.predecessors(3).size(), 2);
+    EXPECT_EQ(max.predecessors(3)[0], 1);
+    EXPECT_EQ(max.predecessors(3)[1], 2);
+    ASSERT_EQ(max.successors(0).size(), 2);
+    EXPECT_EQ(max.successors(0)[1], 2);
+}
+
+TEST_F(UirTest, EditsAndRelaysOut)
+{
+    Module module;
+    Function &max = module.function(build_max(module));
+    const uint32_t add = max.block_begin(2);
+    ASSERT_EQ(max.opcode(add), Opcode::ADD);
+
+    // b + 0 is b: forward it and drop the add
+    Builder builder(module, 0);
+    max.replace_all_uses(add, 1);
+    max.remove(add);
+    builder.set_insert_before(max.terminator(1));
+    const uint32_t doubled = builder.binary(Opcode::MUL, 0, builder.constant(i32, 2));
+    const std::vector<uint32_t> remap = builder.finish();
+
+    EXPECT_EQ(remap[add], no_value);
+    EXPECT_EQ(max.verify(module.types), "");
+    EXPECT_EQ(max.size(), 11);
+    EXPECT_EQ(max.opcode(remap[doubled]), Opcode::MUL);
+    EXPECT_EQ(max.block_of(remap[doubled]), 1);
+    EXPECT_EQ(max.opcode(max.block_begin(1) + 1), Opcode::JUMP);
+    EXPECT_EQ(max.operands(max.block_begin(3))[1], 1);
+
+    // the existing constant 0 is shared
+    EXPECT_EQ(builder.constant(i32, 0), 2);
+}
+
+TEST_F(UirTest, RejectsMalformedFunctions)
+{
+    Module module;
+    const uint32_t index = module.add_function("broken", {}, i32);
+    Builder builder(module, index);
+    builder.set_insert_block(builder.create_block());
+    const uint32_t one = builder.constant(i32, 1);
+    builder.ret(one);
+    EXPECT_THROW(builder.ret(one), std::logic_error);
+
+    const uint32_t dangling = builder.create_block();
+    builder.set_insert_block(dangling);
+    builder.binary(Opcode::ADD, one, one);
+    builder.finish();
+
+    EXPECT_NE(module.function(index).verify(module.types).find("terminator"), std::string::npos);
+    EXPECT_EQ(module.find_function("broken"), index);
+
+    const uint32_t caller = module.add_function("caller", {}, i32);
+    Builder calls(module, caller);
+    calls.set_insert_block(calls.create_block());
+    const uint32_t result = calls.call(index, {}, true);
+    calls.ret(calls.binary(Opcode::ADD, result, result));
+    calls.finish();
+    EXPECT_NE(module.function(caller).verify(module.types).find("tail call"), std::string::npos);
+    EXPECT_EQ(module.find_function("missing"), no_function);
+}
+
+TEST_F(UirTest, InternsCompoundTypes)
+{
+    TypeTable types;
+    const TypeId bytes = types.pointer_to(primitive(TypeKind::U8));
+    EXPECT_EQ(types.pointer_to(primitive(TypeKind::U8)), bytes);
+    EXPECT_NE(types.pointer_to(primitive(TypeKind::I8)), bytes);
+
+    const TypeId fields[] = { bytes, primitive(TypeKind::U64) };
+    const TypeId slice = types.structure(fields);
+    EXPECT_EQ(types.structure(fields), slice);
+    EXPECT_EQ(types.name(types.array_of(bytes, 4)), "array<ptr<u8>, 4>");
+    EXPECT_EQ(types.name(slice), "struct<{ptr<u8>, u64}>");
+    EXPECT_EQ(types.name(types.vector_of(primitive(TypeKind::F32), 4)), "vector<f32, 4>");
+
+    EXPECT_TRUE(types.is_signed(primitive(TypeKind::I16)));
+    EXPECT_FALSE(types.is_signed(primitive(TypeKind::U16)));
+    EXPECT_EQ(types.bits(primitive(TypeKind::U64)), 64);
+    EXPECT_TRUE(types.is_pointer(bytes));
+}
@@ -0,0 +1,164 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "../../compiler/include/uir_image.h"
+#include "../../compiler/include/uir_text.h"
+
+using namespace yu::uir;
+
+class UirImageTest : public testing::Test
+{
+protected:
+    std::filesystem::path root;
+
+    static constexpr std::string_view text = "func sum(%p: ptr<struct<{i32, array<f64, 2>}>>, %n: i64) -> i64:\n"
+                                             "    bb0:\n"
+                                             "        %m = func_entry\n"
+                                             "        %zero = const i64 0\n"
+                                             "        %neg = const i64 -3\n"
+                                             "        %x = load i64 [%p + 8], %m\n"
+                                             "        %t = intrinsic.x86.rdtsc u64\n"
+                                             "        jump bb1\n"
+                                             "    bb1:\n"
+                                             "        %i = phi i64 [%zero, bb0], [%next, bb2]\n"
+                                             "        %done = cmp.ge i64 %i, %n\n"
+                                             "        branch %done, bb3, bb2\n"
+                                             "    bb2:\n"
+                                             "        %next = add i64 %i, %x\n"
+                                             "        switch i64 %next, bb1, [-3: bb3]\n"
+                                             "    bb3:\n"
+                                             "        %r = tail call i64 @twice(i64 %i)\n"
+                                             "        ret i64 %r\n"
+                                             "\n"
+                                             "func twice(%v: i64) -> i64:\n"
+                                             "    bb0:\n"
+                                             "        %2 = add i64 %v, %v\n"
+                                             "        ret i64 %2\n"
+                                             "\n"
+                                             "func external(%0: f32) -> void\n";
+
+    void SetUp() override
+    {
+        root = std::filesystem::temp_directory_path() / "yu-uir-image-test";
+        std::filesystem::remove_all(root);
+        std::filesystem::create_directories(root);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(root);
+    }
+};
+
+TEST_F(UirImageTest, RoundTripsModules)
+{
+    Module module;
+    ASSERT_EQ(read_text(text, module), "");
+    const ModuleImage built = ModuleImage::build(module);
+
+    // the importing module already has functions and types of its own, so indices shift
+    Module loaded;
+    loaded.add_function("first", { loaded.types.pointer_to(primitive(TypeKind::U8)) }, primitive(TypeKind::VOID));
+    ModuleImage image = ModuleImage::build(module);
+    ASSERT_TRUE(image.attach(loaded));
+    EXPECT_EQ(image.materialize_all(), 0);
+    ASSERT_EQ(loaded.function_count(), 4);
+    EXPECT_EQ(image.module_index(0), 1);
+
+    for (uint32_t i = 0; i < module.function_count(); ++i)
+    {
+        std::string expected, actual;
+        print_function(module, i, expected);
+        print_function(loaded, image.module_index(i), actual);
+        EXPECT_EQ(actual, expected);
+    }
+    EXPECT_EQ(loaded.function(1).verify(loaded.types), "");
+    EXPECT_TRUE(std::ranges::equal(image.image(), built.image()));
+
+    // names must not clash with the module's
+    EXPECT_FALSE(image.attach(loaded));
+}
+
+TEST_F(UirImageTest, MaterializesFunctionsOnDemand)
+{
+    Module module;
+    ASSERT_EQ(read_text(text, module), "");
+    const auto path = (root / "cache.yub").string();
+    ASSERT_TRUE(ModuleImage::build(module).write(path));
+
+    ModuleImage image;
+    ASSERT_TRUE(image.open(path));
+    ASSERT_EQ(image.function_count(), 3);
+    EXPECT_EQ(image.function_name(1), "twice");
+    EXPECT_EQ(image.module_index(0), no_function);
+    EXPECT_FALSE(image.materialize(0));
+
+    Module loaded;
+    ASSERT_TRUE(image.attach(loaded));
+    EXPECT_EQ(loaded.function(1).block_count(), 0);
+    ASSERT_TRUE(image.materialize(1));
+    ASSERT_TRUE(image.materialize(1));
+    EXPECT_EQ(loaded.function(0).block_count(), 0);
+    EXPECT_EQ(loaded.function(1).block_count(), 1);
+    EXPECT_EQ(loaded.function(1).verify(loaded.types), "");
+    EXPECT_TRUE(image.materialize(2));
+    EXPECT_EQ(loaded.function(2).block_count(), 0);
+
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "YUR1 but not an image";
+    EXPECT_FALSE(image.open(path));
+    EXPECT_FALSE(image);
+    EXPECT_FALSE(image.open((root / "missing.yub").string()));
+}
+
+TEST_F(UirImageTest, RejectsCorruptBodies)
+{
+    Module module;
+    ASSERT_EQ(read_text(text, module), "");
+    const ModuleImage built = ModuleImage::build(module);
+    const std::vector<std::byte> good(built.image().begin(), built.image().end());
+    const auto path = (root / "corrupt.yub").string();
+
+    // flipping bytes near the end lands in the last body; every outcome must be a clean
+    // failure or a function that reads back without crashing
+    uint32_t failures = 0;
+    for (size_t offset = 1; offset <= 40; ++offset)
+    {
+        std::vector<std::byte> bad = good;
+        bad[bad.size() - offset] ^= std::byte { 0xFF };
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(bad.data()), static_cast<std::streamsize>(bad.size()));
+        }
+
+        ModuleImage image;
+        ASSERT_TRUE(image.open(path));
+        Module loaded;
+        ASSERT_TRUE(image.attach(loaded));
+        failures += image.materialize_all();
+    }
+    EXPECT_GT(failures, 0);
+}
+
+TEST_F(UirImageTest, RejectsMissingOperands)
+{
+    Module module;
+    ASSERT_EQ(read_text(text, module), "");
+    Function &twice = module.function(1);
+    uint32_t add = 0;
+    while (twice.opcode(add) != Opcode::ADD)
+        ++add;
+    twice.set_operand(add, 1, no_value);
+
+    ModuleImage image = ModuleImage::build(module);
+    Module loaded;
+    ASSERT_TRUE(image.attach(loaded));
+    EXPECT_TRUE(image.materialize(0));
+    EXPECT_FALSE(image.materialize(1));
+    EXPECT_EQ(loaded.function(1).block_count(), 0);
+}
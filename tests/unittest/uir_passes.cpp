@@ -0,0 +1,784 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "../../compiler/include/lowering.h"
+#include "../../compiler/include/uir_passes.h"
+#include "../../compiler/include/uir_text.h"
+
+using namespace yu::uir;
+
+class UirPassesTest : public testing::Test
+{
+protected:
+    Module module;
+
+    void SetUp() override {}
+
+    void TearDown() override {}
+
+    /**
+     * @brief Reads UIR text into the module and returns the index of its first function.
+     */
+    uint32_t read(const std::string &text)
+    {
+        EXPECT_EQ(read_text(text, module), "");
+        return 0;
+    }
+
+    std::string print(const uint32_t function)
+    {
+        EXPECT_EQ(module.function(function).verify(module.types), "");
+        std::string out;
+        print_function(module, function, out);
+        return out;
+    }
+
+    uint32_t count(const uint32_t function, const Opcode opcode)
+    {
+        const Function &body = module.function(function);
+        uint32_t found = 0;
+        for (uint32_t value = 0; value < body.size(); ++value)
+            found += body.opcode(value) == opcode;
+        return found;
+    }
+};
+
+TEST_F(UirPassesTest, PropagatesConstantsAlongReachableEdges)
+{
+    const uint32_t f = read("func f(%x: i32) -> i32:\n"
+                            "    bb0:\n"
+                            "        %a = const i32 6\n"
+                            "        %b = const i32 7\n"
+                            "        %c = mul i32 %a, %b\n"
+                            "        %k = cmp.gt i32 %c, %a\n"
+                            "        branch %k, bb1, bb2\n"
+                            "    bb1:\n"
+                            "        jump bb3\n"
+                            "    bb2:\n"
+                            "        %y = add i32 %x, %a\n"
+                            "        jump bb3\n"
+                            "    bb3:\n"
+                            "        %p = phi i32 [%c, bb1], [%y, bb2]\n"
+                            "        %q = sub i32 %p, %b\n"
+                            "        ret i32 %q\n");
+    ASSERT_TRUE(propagate_constants(module, f));
+
+    const std::string expected = "func f(%x: i32) -> i32:\n"
+                                 "    bb0:\n"
+                                 "        %a = const i32 6\n"
+                                 "        %b = const i32 7\n"
+                                 "        %3 = const i32 42\n"
+                                 "        %4 = const bool true\n"
+                                 "        %5 = const i32 35\n"
+                                 "        jump bb1\n"
+                                 "    bb1:\n"
+                                 "        jump bb3\n"
+                                 "    bb2:\n"
+                                 "        unreachable\n"
+                                 "    bb3:\n"
+                                 "        ret i32 %5\n";
+    EXPECT_EQ(print(f), expected);
+    EXPECT_FALSE(propagate_constants(module, f));
+}
+
+TEST_F(UirPassesTest, PropagatesConstantsAroundLoops)
+{
+    // i only ever holds 1, which a pessimistic analysis could not prove through the back edge
+    const uint32_t f = read("func f(%n: i32) -> i32:\n"
+                            "    bb0:\n"
+                            "        %one = const i32 1\n"
+                            "        %zero = const i32 0\n"
+                            "        %two = const i32 2\n"
+                            "        jump bb1\n"
+                            "    bb1:\n"
+                            "        %i = phi i32 [%one, bb0], [%j, bb2], [%j, bb2]\n"
+                            "        %c = cmp.lt i32 %i, %n\n"
+                            "        branch %c, bb2, bb3\n"
+                            "    bb2:\n"
+                            "        %j = mul i32 %i, %one\n"
+                            "        %d = div i32 %j, %zero\n"
+                            "        switch i32 %two, bb1, [1: bb3, 2: bb1]\n"
+                            "    bb3:\n"
+                            "        ret i32 %i\n"
+                            "    bb4:\n"
+                            "        %e = sub i32 %n, %n\n"
+                            "        ret i32 %e\n");
+    ASSERT_TRUE(propagate_constants(module, f));
+    const std::string printed = print(f);
+
+    EXPECT_EQ(count(f, Opcode::PHI), 0);
+    EXPECT_EQ(count(f, Opcode::SWITCH), 0);
+    EXPECT_EQ(count(f, Opcode::BRANCH), 1);
+    EXPECT_EQ(count(f, Opcode::DIV), 1); // division by zero is left to run time
+    EXPECT_NE(printed.find("        ret i32 %one\n"), std::string::npos);
+    EXPECT_NE(printed.find("    bb4:\n        unreachable\n"), std::string::npos);
+}
+
+TEST_F(UirPassesTest, FoldsConstantConditionsOfLoweredCode)
+{
+    auto unit = yu::compiler::parse_unit(yu::compiler::SourceBuffer("sccp.yu",
+        "function scale(x: i64) -> i64 {\n"
+        "    const factor: i64 = 4;\n"
+        "    var shift: i64 = -factor;\n"
+        "    if (factor > 2 && shift < 0) { return x * factor; }\n"
+        "    return x;\n"
+        "}\n"), false);
+    ASSERT_TRUE(yu::compiler::lower_unit(unit, module)) << unit.error_message;
+    ASSERT_GT(count(0, Opcode::BRANCH), 0);
+
+    optimize_module(module);
+    EXPECT_EQ(count(0, Opcode::BRANCH), 0);
+    EXPECT_EQ(count(0, Opcode::CMP_GT) + count(0, Opcode::CMP_LT), 0);
+    EXPECT_EQ(count(0, Opcode::UNREACHABLE), 0); // the dead return is removed with its block
+    EXPECT_EQ(module.function(0).block_count(), 1);
+    print(0);
+}
+
+TEST_F(UirPassesTest, NumbersValuesAcrossDominatingBlocks)
+{
+    const uint32_t f = read("func f(%x: i32, %y: i32, %c: bool) -> i32:\n"
+                            "    bb0:\n"
+                            "        %a = add i32 %x, %y\n"
+                            "        branch %c, bb1, bb2\n"
+                            "    bb1:\n"
+                            "        %b = add i32 %y, %x\n"
+                            "        %d = mul i32 %b, %b\n"
+                            "        jump bb3\n"
+                            "    bb2:\n"
+                            "        %e = mul i32 %a, %a\n"
+                            "        jump bb3\n"
+                            "    bb3:\n"
+                            "        %p = phi i32 [%d, bb1], [%e, bb2]\n"
+                            "        %s = add i32 %x, %y\n"
+                            "        %g = sub i32 %p, %s\n"
+                            "        ret i32 %g\n");
+    ASSERT_TRUE(number_values(module, f));
+
+    // %d and %e compute the same, but neither block dominates the other
+    const std::string expected = "func f(%x: i32, %y: i32, %c: bool) -> i32:\n"
+                                 "    bb0:\n"
+                                 "        %a = add i32 %x, %y\n"
+                                 "        branch %c, bb1, bb2\n"
+                                 "    bb1:\n"
+                                 "        %d = mul i32 %a, %a\n"
+                                 "        jump bb3\n"
+                                 "    bb2:\n"
+                                 "        %e = mul i32 %a, %a\n"
+                                 "        jump bb3\n"
+                                 "    bb3:\n"
+                                 "        %p = phi i32 [%d, bb1], [%e, bb2]\n"
+                                 "        %g = sub i32 %p, %a\n"
+                                 "        ret i32 %g\n";
+    EXPECT_EQ(print(f), expected);
+    EXPECT_FALSE(number_values(module, f));
+}
+
+TEST_F(UirPassesTest, NumbersPureCallsAndVersionedLoads)
+{
+    read("func h(%p: ptr<i64>, %v: i64) -> i64:\n"
+         "    bb0:\n"
+         "        %m = func_entry\n"
+         "        %a = call i64 @square(i64 %v)\n"
+         "        %b = call i64 @square(i64 %v)\n"
+         "        %x = load i64 [%p], %m\n"
+         "        %y = load i64 [%p], %m\n"
+         "        %m1 = store i64 %a, [%p], %m\n"
+         "        %z = load i64 [%p], %m1\n"
+         "        %w = load i64 [%p]\n"
+         "        %u = load i64 [%p]\n"
+         "        %s1 = add i64 %a, %b\n"
+         "        %s4 = add i64 %s1, %x\n"
+         "        %s5 = add i64 %s4, %y\n"
+         "        %s6 = add i64 %s5, %z\n"
+         "        %s7 = add i64 %s6, %w\n"
+         "        %s8 = add i64 %s7, %u\n"
+         "        ret i64 %s8\n"
+         "\n"
+         "func square(%v: i64) -> i64 pure:\n"
+         "    bb0:\n"
+         "        %r = mul i64 %v, %v\n"
+         "        ret i64 %r\n");
+    ASSERT_TRUE(number_values(module, 0));
+    print(0);
+
+    EXPECT_EQ(count(0, Opcode::CALL), 1);
+    EXPECT_EQ(count(0, Opcode::LOAD), 4); // one per memory state, and both loads without one
+
+    std::string printed;
+    print_function(module, 1, printed);
+    EXPECT_EQ(printed.substr(0, printed.find('\n')), "func square(%v: i64) -> i64 pure:");
+}
+
+TEST_F(UirPassesTest, KeepsLoadsAcrossUnversionedWrites)
+{
+    read("func h(%p: ptr<i64>, %v: i64) -> i64:\n"
+         "    bb0:\n"
+         "        %m = func_entry\n"
+         "        %a = call i64 @square(i64 %v)\n"
+         "        %x = load i64 [%p], %m\n"
+         "        %c = call i64 @tick(ptr<i64> %p)\n"
+         "        %d = call i64 @tick(ptr<i64> %p)\n"
+         "        %b = call i64 @square(i64 %v)\n"
+         "        %y = load i64 [%p], %m\n"
+         "        %s1 = add i64 %a, %b\n"
+         "        %s2 = add i64 %s1, %c\n"
+         "        %s3 = add i64 %s2, %d\n"
+         "        %s4 = add i64 %s3, %x\n"
+         "        %s5 = add i64 %s4, %y\n"
+         "        ret i64 %s5\n"
+         "\n"
+         "func square(%v: i64) -> i64 pure:\n"
+         "    bb0:\n"
+         "        %r = mul i64 %v, %v\n"
+         "        ret i64 %r\n"
+         "\n"
+         "func tick(%p: ptr<i64>) -> i64\n");
+    ASSERT_TRUE(number_values(module, 0));
+    print(0);
+
+    // @tick may store to %p between the loads, and each call of it counts
+    EXPECT_EQ(count(0, Opcode::CALL), 3);
+    EXPECT_EQ(count(0, Opcode::LOAD), 2);
+}
+
+TEST_F(UirPassesTest, EliminatesRepeatedPureCallsOfLoweredCode)
+{
+    auto unit = yu::compiler::parse_unit(yu::compiler::SourceBuffer("gvn.yu",
+        "@pure function cube(x: i64) -> i64 { return x * x * x; }\n"
+        "function volume(a: i64) -> i64 {\n"
+        "    var first: i64 = cube(a) + 1;\n"
+        "    var second: i64 = cube(a) + 1;\n"
+        "    return first * second;\n"
+        "}\n"), false);
+    ASSERT_TRUE(yu::compiler::lower_unit(unit, module)) << unit.error_message;
+    const uint32_t volume = module.find_function("volume");
+    EXPECT_EQ(module.function(module.find_function("cube")).attributes(), PURE);
+    ASSERT_EQ(count(volume, Opcode::CALL), 2);
+
+    ASSERT_TRUE(number_values(module, volume));
+    EXPECT_EQ(count(volume, Opcode::CALL), 1);
+    EXPECT_EQ(count(volume, Opcode::ADD), 1);
+    print(volume);
+}
+
+TEST_F(UirPassesTest, EliminatesDeadCodeUntilProvenLive)
+{
+    read("func f(%n: i32, %p: ptr<i32>) -> i32:\n"
+         "    bb0:\n"
+         "        %m = func_entry\n"
+         "        %zero = const i32 0\n"
+         "        %one = const i32 1\n"
+         "        %dead = mul i32 %n, %n\n"
+         "        %s = call i32 @square(i32 %n)\n"
+         "        %t = call i32 @tick(i32 %n)\n"
+         "        %m1 = store i32 %n, [%p], %m\n"
+         "        jump bb1\n"
+         "    bb1:\n"
+         "        %i = phi i32 [%zero, bb0], [%i1, bb1]\n"
+         "        %acc = phi i32 [%zero, bb0], [%acc1, bb1]\n"
+         "        %acc1 = add i32 %acc, %dead\n"
+         "        %i1 = add i32 %i, %one\n"
+         "        %c = cmp.lt i32 %i1, %n\n"
+         "        branch %c, bb1, bb2\n"
+         "    bb2:\n"
+         "        ret i32 %i1\n"
+         "\n"
+         "func square(%v: i32) -> i32 pure\n"
+         "\n"
+         "func tick(%v: i32) -> i32 nodiscard\n");
+    std::vector<DiscardedResult> discarded;
+    ASSERT_TRUE(eliminate_dead_code(module, 0, &discarded));
+    print(0);
+
+    // the accumulator only feeds itself, which a use count would never notice
+    EXPECT_EQ(count(0, Opcode::PHI), 1);
+    EXPECT_EQ(count(0, Opcode::ADD), 1);
+    EXPECT_EQ(count(0, Opcode::MUL), 0);
+    EXPECT_EQ(count(0, Opcode::CALL), 1);
+    EXPECT_EQ(count(0, Opcode::STORE), 1);
+    ASSERT_EQ(discarded.size(), 1);
+    EXPECT_EQ(discarded[0].caller, 0);
+    EXPECT_EQ(discarded[0].callee, 2);
+    EXPECT_FALSE(eliminate_dead_code(module, 0));
+}
+
+TEST_F(UirPassesTest, SimplifiesControlFlow)
+{
+    const uint32_t f = read("func f(%c: bool, %x: i32) -> i32:\n"
+                            "    bb0:\n"
+                            "        branch %c, bb1, bb2\n"
+                            "    bb1:\n"
+                            "        jump bb3\n"
+                            "    bb2:\n"
+                            "        jump bb3\n"
+                            "    bb3:\n"
+                            "        %y = add i32 %x, %x\n"
+                            "        jump bb4\n"
+                            "    bb4:\n"
+                            "        ret i32 %y\n"
+                            "    bb5:\n"
+                            "        ret i32 %x\n");
+    ASSERT_TRUE(simplify_cfg(module, f));
+    EXPECT_EQ(print(f), "func f(%c: bool, %x: i32) -> i32:\n"
+                        "    bb0:\n"
+                        "        %y = add i32 %x, %x\n"
+                        "        ret i32 %y\n");
+    EXPECT_FALSE(simplify_cfg(module, f));
+}
+
+TEST_F(UirPassesTest, SimplifiesControlFlowAroundPhis)
+{
+    const uint32_t f = read("func f(%c: bool, %x: i32, %n: i32) -> i32:\n"
+                            "    bb0:\n"
+                            "        branch %c, bb1, bb2\n"
+                            "    bb1:\n"
+                            "        %a = add i32 %x, %x\n"
+                            "        jump bb3\n"
+                            "    bb2:\n"
+                            "        jump bb3\n"
+                            "    bb3:\n"
+                            "        %p = phi i32 [%a, bb1], [%x, bb2]\n"
+                            "        jump bb4\n"
+                            "    bb4:\n"
+                            "        %i = phi i32 [%p, bb3], [%j, bb5]\n"
+                            "        %j = add i32 %i, %x\n"
+                            "        %k = cmp.lt i32 %j, %n\n"
+                            "        branch %k, bb5, bb6\n"
+                            "    bb5:\n"
+                            "        jump bb4\n"
+                            "    bb6:\n"
+                            "        ret i32 %j\n");
+    ASSERT_TRUE(simplify_cfg(module, f));
+    EXPECT_EQ(print(f), "func f(%c: bool, %x: i32, %n: i32) -> i32:\n"
+                        "    bb0:\n"
+                        "        branch %c, bb1, bb2\n"
+                        "    bb1:\n"
+                        "        %a = add i32 %x, %x\n"
+                        "        jump bb2\n"
+                        "    bb2:\n"
+                        "        %p = phi i32 [%a, bb1], [%x, bb0]\n"
+                        "        jump bb3\n"
+                        "    bb3:\n"
+                        "        %i = phi i32 [%p, bb2], [%j, bb3]\n"
+                        "        %j = add i32 %i, %x\n"
+                        "        %k = cmp.lt i32 %j, %n\n"
+                        "        branch %k, bb3, bb4\n"
+                        "    bb4:\n"
+                        "        ret i32 %j\n");
+}
+
+TEST_F(UirPassesTest, CleansUpLoweredCode)
+{
+    auto unit = yu::compiler::parse_unit(yu::compiler::SourceBuffer("dce.yu",
+        "@nodiscard function checked(x: i64) -> i64 { return x + 1; }\n"
+        "function clamp(x: i64) -> i64 {\n"
+        "    checked(x);\n"
+        "    var unused: i64 = x * 3;\n"
+        "    var kept = checked(x);\n"
+        "    var widened: i64 = checked(x) + 1;\n"
+        "    if (x > 10) { return 10; }\n"
+        "    return x;\n"
+        "}\n"), false);
+    ASSERT_TRUE(yu::compiler::lower_unit(unit, module)) << unit.error_message;
+    const uint32_t clamp = module.find_function("clamp");
+    const uint32_t blocks = module.function(clamp).block_count();
+
+    std::vector<DiscardedResult> discarded;
+    optimize_module(module, &discarded);
+    ASSERT_EQ(discarded.size(), 1);
+    EXPECT_EQ(discarded[0].caller, clamp);
+    EXPECT_EQ(discarded[0].callee, module.find_function("checked"));
+    EXPECT_EQ(count(clamp, Opcode::MUL), 0);
+    EXPECT_EQ(module.function(module.find_function("checked")).block_count(), 1);
+    EXPECT_LE(module.function(clamp).block_count(), blocks);
+    EXPECT_LE(module.function(clamp).block_count(), 3);
+    print(clamp);
+}
+
+TEST_F(UirPassesTest, InlinesCallsWithSeveralReturns)
+{
+    read("func f(%c: bool, %x: i32) -> i32:\n"
+         "    bb0:\n"
+         "        branch %c, bb1, bb2\n"
+         "    bb1:\n"
+         "        %a = call i32 @clamp(i32 %x)\n"
+         "        %b = add i32 %a, %x\n"
+         "        jump bb2\n"
+         "    bb2:\n"
+         "        %p = phi i32 [%b, bb1], [%x, bb0]\n"
+         "        ret i32 %p\n"
+         "\n"
+         "func clamp(%v: i32) -> i32:\n"
+         "    bb0:\n"
+         "        %z = const i32 0\n"
+         "        %k = cmp.lt i32 %v, %z\n"
+         "        branch %k, bb1, bb2\n"
+         "    bb1:\n"
+         "        ret i32 %z\n"
+         "    bb2:\n"
+         "        ret i32 %v\n");
+    const CallGraph graph(module);
+    ASSERT_TRUE(inline_calls(module, 0, graph));
+    EXPECT_EQ(print(0), "func f(%c: bool, %x: i32) -> i32:\n"
+                        "    bb0:\n"
+                        "        %2 = const i32 0\n"
+                        "        branch %c, bb1, bb2\n"
+                        "    bb1:\n"
+                        "        jump bb4\n"
+                        "    bb2:\n"
+                        "        %p = phi i32 [%b, bb3], [%x, bb0]\n"
+                        "        ret i32 %p\n"
+                        "    bb3:\n"
+                        "        %7 = phi i32 [%2, bb5], [%x, bb6]\n"
+                        "        %b = add i32 %7, %x\n"
+                        "        jump bb2\n"
+                        "    bb4:\n"
+                        "        %k = cmp.lt i32 %x, %2\n"
+                        "        branch %k, bb5, bb6\n"
+                        "    bb5:\n"
+                        "        jump bb3\n"
+                        "    bb6:\n"
+                        "        jump bb3\n");
+}
+
+TEST_F(UirPassesTest, InlinesCallsWithConstantArgumentsFirst)
+{
+    // 17 instructions: too many to inline, unless a constant `k` folds its four uses
+    std::string text = "func f(%x: i64) -> i64:\n"
+                       "    bb0:\n"
+                       "        %k = const i64 3\n"
+                       "        %a = call i64 @scale(i64 %k, i64 %x)\n"
+                       "        %b = call i64 @scale(i64 %x, i64 %x)\n"
+                       "        %s = add i64 %a, %b\n"
+                       "        ret i64 %s\n"
+                       "\n"
+                       "func scale(%k: i64, %x: i64) -> i64:\n"
+                       "    bb0:\n"
+                       "        %v0 = mul i64 %x, %k\n";
+    for (int i = 1; i < 16; ++i)
+    {
+        const std::string operand = i % 4 == 0 ? "%k" : "%x";
+        text += "        %v" + std::to_string(i) + " = add i64 %v" + std::to_string(i - 1) + ", " + operand + "\n";
+    }
+    text += "        ret i64 %v15\n";
+    read(text);
+
+    const CallGraph graph(module);
+    ASSERT_TRUE(inline_calls(module, 0, graph));
+    print(0);
+    ASSERT_EQ(count(0, Opcode::CALL), 1);
+    const Function &body = module.function(0);
+    for (uint32_t value = 0; value < body.size(); ++value)
+    {
+        if (body.opcode(value) == Opcode::CALL)
+            EXPECT_NE(body.opcode(body.operands(value)[0]), Opcode::CONST);
+    }
+    EXPECT_EQ(count(0, Opcode::ADD), 16);
+}
+
+TEST_F(UirPassesTest, InlinesWithinTheCallersBudget)
+{
+    // every call is worth inlining, but the caller only grows by 64 instructions
+    std::string text = "func f(%x: i64) -> i64:\n"
+                       "    bb0:\n"
+                       "        %s0 = call i64 @step(i64 %x)\n";
+    for (int i = 1; i < 10; ++i)
+    {
+        text += "        %c" + std::to_string(i) + " = call i64 @step(i64 %x)\n";
+        text += "        %s" + std::to_string(i) + " = add i64 %s" + std::to_string(i - 1) + ", %c" +
+                std::to_string(i) + "\n";
+    }
+    text += "        ret i64 %s9\n"
+            "\n"
+            "func step(%x: i64) -> i64:\n"
+            "    bb0:\n"
+            "        %v0 = mul i64 %x, %x\n";
+    for (int i = 1; i < 13; ++i)
+        text += "        %v" + std::to_string(i) + " = add i64 %v" + std::to_string(i - 1) + ", %x\n";
+    text += "        ret i64 %v12\n";
+    read(text);
+
+    const CallGraph graph(module);
+    ASSERT_TRUE(inline_calls(module, 0, graph));
+    print(0);
+    EXPECT_EQ(count(0, Opcode::CALL), 6);
+}
+
+TEST_F(UirPassesTest, InlinesLoweredCallsBottomUp)
+{
+    auto unit = yu::compiler::parse_unit(yu::compiler::SourceBuffer("inline.yu",
+        "function x_of(p: i64) -> i64 { return p + 1; }\n"
+        "inline function mix(x: i64) -> i64 {\n"
+        "    var a: i64 = x * 3 + 1;\n"
+        "    var b: i64 = a * a - x;\n"
+        "    var c: i64 = b / 7 + a;\n"
+        "    var d: i64 = c * b - a;\n"
+        "    return d * c - b + a;\n"
+        "}\n"
+        "function churn(x: i64) -> i64 {\n"
+        "    var a: i64 = x * 3 + 1;\n"
+        "    var b: i64 = a * a - x;\n"
+        "    var c: i64 = b / 7 + a;\n"
+        "    var d: i64 = c * b - a;\n"
+        "    return d * c - b + a - x * x * 5;\n"
+        "}\n"
+        "function fact(n: i64) -> i64 { if (n < 2) { return 1; } return n * fact(n - 1); }\n"
+        "function use(a: i64) -> i64 { return x_of(a) + mix(a) + churn(a) + fact(a); }\n"), false);
+    ASSERT_TRUE(yu::compiler::lower_unit(unit, module)) << unit.error_message;
+    const uint32_t use = module.find_function("use");
+    EXPECT_EQ(module.function(module.find_function("mix")).attributes(), INLINE);
+    ASSERT_EQ(count(use, Opcode::CALL), 4);
+
+    optimize_module(module);
+    print(use);
+    const Function &body = module.function(use);
+    std::vector<uint32_t> callees;
+    for (uint32_t value = 0; value < body.size(); ++value)
+    {
+        if (body.opcode(value) == Opcode::CALL)
+            callees.push_back(static_cast<uint32_t>(body.immediate(value)));
+    }
+    EXPECT_EQ(callees, (std::vector { module.find_function("churn"), module.find_function("fact") }));
+    EXPECT_EQ(module.function(use).block_count(), 1);
+}
+
+TEST_F(UirPassesTest, TurnsSelfTailCallsIntoLoops)
+{
+    read("func f(%n: i32, %acc: i32) -> i32:\n"
+         "    bb0:\n"
+         "        %zero = const i32 0\n"
+         "        %one = const i32 1\n"
+         "        %done = cmp.eq i32 %n, %zero\n"
+         "        branch %done, bb1, bb2\n"
+         "    bb1:\n"
+         "        %g = call i32 @g(i32 %acc)\n"
+         "        ret i32 %g\n"
+         "    bb2:\n"
+         "        %m = sub i32 %n, %one\n"
+         "        %a = add i32 %acc, %n\n"
+         "        %r = call i32 @f(i32 %m, i32 %a)\n"
+         "        ret i32 %r\n"
+         "\n"
+         "func g(%v: i32) -> i32\n");
+    ASSERT_TRUE(eliminate_tail_calls(module, 0));
+    EXPECT_EQ(print(0), "func f(%n: i32, %acc: i32) -> i32:\n"
+                        "    bb0:\n"
+                        "        %zero = const i32 0\n"
+                        "        %one = const i32 1\n"
+                        "        jump bb3\n"
+                        "    bb1:\n"
+                        "        %g = tail call i32 @g(i32 %11)\n"
+                        "        ret i32 %g\n"
+                        "    bb2:\n"
+                        "        %m = sub i32 %10, %one\n"
+                        "        %a = add i32 %11, %10\n"
+                        "        jump bb3\n"
+                        "    bb3:\n"
+                        "        %10 = phi i32 [%m, bb2], [%n, bb0]\n"
+                        "        %11 = phi i32 [%a, bb2], [%acc, bb0]\n"
+                        "        %done = cmp.eq i32 %10, %zero\n"
+                        "        branch %done, bb1, bb2\n");
+    EXPECT_FALSE(eliminate_tail_calls(module, 0));
+}
+
+TEST_F(UirPassesTest, RunsTailrecFunctionsInConstantStack)
+{
+    auto unit = yu::compiler::parse_unit(yu::compiler::SourceBuffer("tce.yu",
+        "@tailrec function gcd(a: i64, b: i64) -> i64 { if (b == 0) { return a; } return gcd(b, a % b); }\n"
+        "function depth(n: i64) -> i64 { if (n == 0) { return 0; } return depth(n - 1) + 1; }\n"
+        "function outer(x: i64) -> i64 { return gcd(x * 3, x); }\n"), false);
+    ASSERT_TRUE(yu::compiler::lower_unit(unit, module)) << unit.error_message;
+    const uint32_t gcd = module.find_function("gcd"), depth = module.find_function("depth");
+    const uint32_t outer = module.find_function("outer");
+
+    optimize_module(module);
+    print(gcd);
+    EXPECT_EQ(count(gcd, Opcode::CALL), 0);
+    EXPECT_EQ(count(gcd, Opcode::PHI), 2);
+    EXPECT_EQ(count(depth, Opcode::CALL), 1); // the addition follows the call
+    const Function &body = module.function(outer);
+    ASSERT_EQ(count(outer, Opcode::CALL), 1);
+    EXPECT_EQ(body.flags(body.terminator(0) - 1), TAIL);
+}
+
+TEST_F(UirPassesTest, FindsNestedNaturalLoops)
+{
+    const uint32_t f = read("func f(%n: i32) -> i32:\n"
+                            "    bb0:\n"
+                            "        %z = const i32 0\n"
+                            "        %one = const i32 1\n"
+                            "        jump bb1\n"
+                            "    bb1:\n"
+                            "        %i = phi i32 [%z, bb0], [%i2, bb4]\n"
+                            "        %c = cmp.lt i32 %i, %n\n"
+                            "        branch %c, bb2, bb5\n"
+                            "    bb2:\n"
+                            "        %j = phi i32 [%z, bb1], [%j2, bb3]\n"
+                            "        %j2 = add i32 %j, %one\n"
+                            "        %d = cmp.lt i32 %j2, %n\n"
+                            "        branch %d, bb3, bb4\n"
+                            "    bb3:\n"
+                            "        jump bb2\n"
+                            "    bb4:\n"
+                            "        %i2 = add i32 %i, %one\n"
+                            "        jump bb1\n"
+                            "    bb5:\n"
+                            "        ret i32 %i\n");
+    const DominatorTree tree(module.function(f));
+    const LoopForest loops(module.function(f), tree);
+    ASSERT_EQ(loops.loop_count(), 2);
+    EXPECT_EQ(loops.header(0), 2);
+    EXPECT_EQ(loops.header(1), 1);
+    EXPECT_EQ(loops.parent(0), 1);
+    EXPECT_EQ(loops.parent(1), no_loop);
+    EXPECT_EQ(loops.depth(0), 2);
+    EXPECT_EQ(loops.depth(1), 1);
+    EXPECT_EQ(std::vector(loops.blocks(0).begin(), loops.blocks(0).end()), (std::vector<uint32_t> { 2, 3 }));
+    EXPECT_EQ(std::vector(loops.blocks(1).begin(), loops.blocks(1).end()), (std::vector<uint32_t> { 1, 2, 3, 4 }));
+    EXPECT_EQ(loops.loop_of(3), 0);
+    EXPECT_EQ(loops.loop_of(4), 1);
+    EXPECT_EQ(loops.loop_of(5), no_loop);
+    EXPECT_TRUE(loops.contains(1, 3));
+    EXPECT_FALSE(loops.contains(0, 4));
+    EXPECT_FALSE(loops.contains(1, 0));
+}
+
+TEST_F(UirPassesTest, HoistsLoadsTheLoopDoesNotClobber)
+{
+    const uint32_t f = read("func f(%p: ptr<i32>, %q: ptr<i32>, %n: i32, %c: bool) -> i32:\n"
+                            "    bb0:\n"
+                            "        %m = func_entry\n"
+                            "        %z = const i32 0\n"
+                            "        %one = const i32 1\n"
+                            "        branch %c, bb1, bb4\n"
+                            "    bb1:\n"
+                            "        %i = phi i32 [%z, bb0], [%one, bb4], [%i2, bb2]\n"
+                            "        %mem = phi mem [%m, bb0], [%m, bb4], [%m2, bb2]\n"
+                            "        %a = load i32 [%p], %m\n"
+                            "        %b = load i32 [%q], %mem\n"
+                            "        %x = div i32 %a, %n\n"
+                            "        %s = add i32 %a, %b\n"
+                            "        %k = cmp.lt i32 %i, %n\n"
+                            "        branch %k, bb2, bb3\n"
+                            "    bb2:\n"
+                            "        %w = div i32 %n, %a\n"
+                            "        %m2 = store i32 %w, [%q], %mem\n"
+                            "        %i2 = add i32 %i, %one\n"
+                            "        jump bb1\n"
+                            "    bb3:\n"
+                            "        %r = add i32 %x, %s\n"
+                            "        ret i32 %r\n"
+                            "    bb4:\n"
+                            "        jump bb1\n");
+    ASSERT_TRUE(hoist_loop_invariants(module, f));
+    EXPECT_EQ(print(f), "func f(%p: ptr<i32>, %q: ptr<i32>, %n: i32, %c: bool) -> i32:\n"
+                        "    bb0:\n"
+                        "        %m = func_entry\n"
+                        "        %z = const i32 0\n"
+                        "        %one = const i32 1\n"
+                        "        branch %c, bb5, bb4\n"
+                        "    bb1:\n"
+                        "        %i = phi i32 [%i2, bb2], [%21, bb5]\n"
+                        "        %mem = phi mem [%m2, bb2], [%22, bb5]\n"
+                        "        %b = load i32 [%q], %mem\n"
+                        "        %s = add i32 %a, %b\n"
+                        "        %k = cmp.lt i32 %i, %n\n"
+                        "        branch %k, bb2, bb3\n"
+                        "    bb2:\n"
+                        "        %w = div i32 %n, %a\n"
+                        "        %m2 = store i32 %w, [%q], %mem\n"
+                        "        %i2 = add i32 %i, %one\n"
+                        "        jump bb1\n"
+                        "    bb3:\n"
+                        "        %r = add i32 %x, %s\n"
+                        "        ret i32 %r\n"
+                        "    bb4:\n"
+                        "        jump bb5\n"
+                        "    bb5:\n"
+                        "        %21 = phi i32 [%z, bb0], [%one, bb4]\n"
+                        "        %22 = phi mem [%m, bb0], [%m, bb4]\n"
+                        "        %a = load i32 [%p], %m\n"
+                        "        %x = div i32 %a, %n\n"
+                        "        jump bb1\n");
+    EXPECT_FALSE(hoist_loop_invariants(module, f));
+}
+
+TEST_F(UirPassesTest, KeepsLoadsInLoopsWithUnversionedWrites)
+{
+    const uint32_t f = read("func f(%p: ptr<i32>, %n: i32) -> i32:\n"
+                            "    bb0:\n"
+                            "        %m = func_entry\n"
+                            "        %z = const i32 0\n"
+                            "        %one = const i32 1\n"
+                            "        jump bb1\n"
+                            "    bb1:\n"
+                            "        %i = phi i32 [%z, bb0], [%i2, bb1]\n"
+                            "        %t = phi i32 [%z, bb0], [%t2, bb1]\n"
+                            "        %a = load i32 [%p], %m\n"
+                            "        %d = mul i32 %n, %n\n"
+                            "        call void @clobber(ptr<i32> %p)\n"
+                            "        %s = add i32 %t, %a\n"
+                            "        %t2 = add i32 %s, %d\n"
+                            "        %i2 = add i32 %i, %one\n"
+                            "        %k = cmp.lt i32 %i2, %n\n"
+                            "        branch %k, bb1, bb2\n"
+                            "    bb2:\n"
+                            "        ret i32 %t2\n"
+                            "\n"
+                            "func clobber(%p: ptr<i32>)\n");
+    ASSERT_TRUE(hoist_loop_invariants(module, f));
+    print(f);
+
+    // the call may store to %p on every iteration; the multiplication still leaves
+    Function &body = module.function(f);
+    for (uint32_t value = 0; value < body.size(); ++value)
+    {
+        if (body.opcode(value) == Opcode::LOAD)
+            EXPECT_EQ(body.block_of(value), 1);
+        if (body.opcode(value) == Opcode::MUL)
+            EXPECT_NE(body.block_of(value), 1);
+    }
+}
+
+TEST_F(UirPassesTest, HoistsInvariantsOutOfLoweredLoopNests)
+{
+    auto unit = yu::compiler::parse_unit(yu::compiler::SourceBuffer("licm.yu",
+        "function sum(n: i64, k: i64) -> i64 {\n"
+        "    var total: i64 = 0;\n"
+        "    var i: i64 = 0;\n"
+        "    while (i < n) {\n"
+        "        var j: i64 = 0;\n"
+        "        while (j < n) {\n"
+        "            total = total + k * k + j / 7 + i * k;\n"
+        "            j = j + 1;\n"
+        "        }\n"
+        "        i = i + 1;\n"
+        "    }\n"
+        "    return total;\n"
+        "}\n"), false);
+    ASSERT_TRUE(yu::compiler::lower_unit(unit, module)) << unit.error_message;
+    optimize_module(module);
+    print(0);
+
+    // k * k leaves both loops, i * k the inner one
+    Function &body = module.function(0);
+    const DominatorTree tree(body);
+    const LoopForest loops(body, tree);
+    ASSERT_EQ(loops.loop_count(), 2);
+    std::vector<uint32_t> depths;
+    for (uint32_t value = 0; value < body.size(); ++value)
+    {
+        if (body.opcode(value) == Opcode::MUL)
+        {
+            const uint32_t loop = loops.loop_of(body.block_of(value));
+            depths.push_back(loop == no_loop ? 0 : loops.depth(loop));
+        }
+    }
+    std::ranges::sort(depths);
+    EXPECT_EQ(depths, (std::vector<uint32_t> { 0, 1 }));
+    EXPECT_EQ(count(0, Opcode::DIV), 1);
+}
@@ -0,0 +1,205 @@
+// This file is part of the Yu programming language and is licensed under MIT License;
+// See LICENSE.txt for details
+
+#include <string>
+#include <gtest/gtest.h>
+#include "../../compiler/include/lowering.h"
+#include "../../compiler/include/uir_builder.h"
+#include "../../compiler/include/uir_text.h"
+
+using namespace yu::uir;
+
+class UirTextTest : public testing::Test
+{
+protected:
+    void SetUp() override {}
+
+    void TearDown() override {}
+
+    static constexpr TypeId i32 = primitive(TypeKind::I32);
+
+    /**
+     * @brief Reads text into a fresh module and prints it again.
+     */
+    static std::string reprint(const std::string &text)
+    {
+        Module module;
+        const std::string error = read_text(text, module);
+        EXPECT_EQ(error, "");
+        for (uint32_t i = 0; i < module.function_count(); ++i)
+        {
+            if (module.function(i).block_count())
+                EXPECT_EQ(module.function(i).verify(module.types), "") << i;
+        }
+        return print_module(module);
+    }
+};
+
+TEST_F(UirTextTest, PrintsTheSpecSyntax)
+{
+    Module module;
+    const uint32_t index = module.add_function("clamp", { i32 }, i32);
+    Builder builder(module, index);
+    const uint32_t entry = builder.create_block();
+    const uint32_t low = builder.create_block();
+    const uint32_t high = builder.create_block();
+
+    builder.set_insert_block(entry);
+    const uint32_t x = builder.param(0);
+    builder.set_name(x, "x");
+    const uint32_t limit = builder.constant(i32, 10);
+    builder.branch(builder.binary(Opcode::CMP_GT, x, limit), low, high);
+    builder.set_insert_block(low);
+    builder.ret(limit);
+    builder.set_insert_block(high);
+    builder.ret(x);
+    builder.finish();
+    module.add_function("external", { primitive(TypeKind::F64) }, primitive(TypeKind::VOID));
+
+    const std::string expected = "func clamp(%x: i32) -> i32:\n"
+                                 "    bb0:\n"
+                                 "        %1 = const i32 10\n"
+                                 "        %2 = cmp.gt i32 %x, %1\n"
+                                 "        branch %2, bb1, bb2\n"
+                                 "    bb1:\n"
+                                 "        ret i32 %1\n"
+                                 "    bb2:\n"
+                                 "        ret i32 %x\n"
+                                 "\n"
+                                 "func external(%0: f64) -> void\n";
+    EXPECT_EQ(print_module(module), expected);
+    EXPECT_EQ(reprint(expected), expected);
+}
+
+TEST_F(UirTextTest, RoundTripsEveryInstructionKind)
+{
+    const std::string text = "# every kind of instruction\n"
+                             "func memory(%p: ptr<i32>, %q: ptr) -> i32:\n"
+                             "    bb0:\n"
+                             "        %m0 = func_entry\n"
+                             "        %zero = const i32 0\n"
+                             "        %neg = const i32 -5   # shared by the switch below\n"
+                             "        %seven = const i32 7\n"
+                             "        %nan = const f32 0x7fc00001\n"
+                             "        %half = const f64 0.1\n"
+                             "        %big = const u64 18446744073709551615\n"
+                             "        %slot = alloc array<i32, 4>\n"
+                             "        %m1 = store i32 %neg, [%p + 8], %m0\n"
+                             "        %x = load i32 [%p + 8], %m1\n"
+                             "        %m2 = barrier.acq %m1\n"
+                             "        %a = atomic.load i32 [%p], acquire\n"
+                             "        atomic.store i32 %x, [%p], seq_cst\n"
+                             "        %old = cmpxchg i32 [%p], %x, %zero, acq_rel, monotonic\n"
+                             "        %sum = atomic.add i32 [%p], %old, seq_cst\n"
+                             "        %wide = sext i32 %sum to i64\n"
+                             "        %t = intrinsic.x86.rdtsc u64\n"
+                             "        intrinsic.x86.clflush void %p\n"
+                             "        %c = cmp.lt i32 %x, %zero\n"
+                             "        branch %c, bb1, bb3\n"
+                             "    bb1:\n"
+                             "        switch i32 %x, bb3, [-5: bb2, 7: bb3]\n"
+                             "    bb2:\n"
+                             "        %ind = call i32 %q(i32 %x)\n"
+                             "        %v = tail call i32 @later(i32 %ind)\n"
+                             "        ret i32 %v\n"
+                             "    bb3:\n"
+                             "        %y = phi i32 [%zero, bb0], [%x, bb1], [%x, bb1], [%next, bb3]\n"
+                             "        %next = add i32 %y, %seven\n"
+                             "        %more = cmp.lt i32 %next, %x\n"
+                             "        branch %more, bb3, bb4\n"
+                             "    bb4:\n"
+                             "        ret i32 %next\n"
+                             "\n"
+                             "func later(%n: i32) -> i32:\n"
+                             "    bb0:\n"
+                             "        %n = neg i32 %n\n"
+                             "        ret i32 %n.1\n"
+                             "\n"
+                             "func external(%0: f64) -> void\n";
+
+    // `%n` is defined twice above; the second definition is written %n.1 when printed
+    Module rejected;
+    EXPECT_NE(read_text(text, rejected).find("defined twice"), std::string::npos);
+
+    std::string valid = text;
+    valid.replace(valid.find("%n = neg"), 2, "%n.1");
+    const std::string printed = reprint(valid);
+    EXPECT_EQ(reprint(printed), printed);
+
+    EXPECT_NE(printed.find("%neg = const i32 -5\n"), std::string::npos);
+    EXPECT_NE(printed.find("%nan = const f32 0x7fc00001\n"), std::string::npos);
+    EXPECT_NE(printed.find("%half = const f64 0.1\n"), std::string::npos);
+    EXPECT_NE(printed.find("%m1 = store i32 %neg, [%p + 8], %m0\n"), std::string::npos);
+    EXPECT_NE(printed.find("switch i32 %x, bb3, [-5: bb2, 7: bb3]\n"), std::string::npos);
+    EXPECT_NE(printed.find("%v = tail call i32 @later(i32 %ind)\n"), std::string::npos);
+    EXPECT_NE(printed.find("%n.1 = neg i32 %n\n"), std::string::npos);
+    EXPECT_NE(printed.find("func external(%0: f64) -> void\n"), std::string::npos);
+    EXPECT_EQ(printed.find('#'), std::string::npos);
+}
+
+TEST_F(UirTextTest, LaysOutBodiesWrittenOutOfOrder)
+{
+    // blocks out of order, a constant outside the entry block and a phi after other values
+    const std::string text = "func f(%a: i32) -> i32:\n"
+                             "    bb1:\n"
+                             "        %z = add i32 %y, %one\n"
+                             "        %y = phi i32 [%a, bb0], [%z, bb1]\n"
+                             "        %one = const i32 1\n"
+                             "        %more = cmp.lt i32 %z, %a\n"
+                             "        branch %more, bb1, bb2\n"
+                             "    bb0:\n"
+                             "        jump bb1\n"
+                             "    bb2:\n"
+                             "        ret i32 %z\n";
+    const std::string expected = "func f(%a: i32) -> i32:\n"
+                                 "    bb0:\n"
+                                 "        %one = const i32 1\n"
+                                 "        jump bb1\n"
+                                 "    bb1:\n"
+                                 "        %y = phi i32 [%a, bb0], [%z, bb1]\n"
+                                 "        %z = add i32 %y, %one\n"
+                                 "        %more = cmp.lt i32 %z, %a\n"
+                                 "        branch %more, bb1, bb2\n"
+                                 "    bb2:\n"
+                                 "        ret i32 %z\n";
+    EXPECT_EQ(reprint(text), expected);
+}
+
+TEST_F(UirTextTest, RoundTripsLoweredFunctions)
+{
+    auto unit = yu::compiler::parse_unit(yu::compiler::SourceBuffer("text.yu",
+        "function collatz(n: u64) -> u32 {\n"
+        "    var steps: u32 = 0;\n"
+        "    while (n != 1) {\n"
+        "        if (n % 2 == 0) { n = n / 2; } else { n = 3 * n + 1; }\n"
+        "        steps += 1;\n"
+        "    }\n"
+        "    return steps;\n"
+        "}\n"), false);
+    Module module;
+    ASSERT_TRUE(yu::compiler::lower_unit(unit, module)) << unit.error_message;
+
+    const std::string printed = print_module(module);
+    EXPECT_EQ(reprint(printed), printed);
+    EXPECT_NE(printed.find("%steps = add u32"), std::string::npos);
+}
+
+TEST_F(UirTextTest, ReportsSyntaxErrors)
+{
+    const auto error = [](const std::string &text)
+    {
+        Module module;
+        return read_text(text, module);
+    };
+    const std::string header = "func f(%a: i32) -> i32:\n    bb0:\n";
+
+    EXPECT_EQ(error(header + "        %1 = frob i32\n"), "line 3, column 14: Unknown instruction 'frob'");
+    EXPECT_EQ(error(header + "        ret i32 %nope\n"), "line 3, column 17: Unknown value %nope");
+    EXPECT_NE(error(header + "        %b = const i64 1\n        ret i32 %b\n").find("line 4, column 17: %b has type i64"),
+              std::string::npos);
+    EXPECT_NE(error(header + "        ret i32 %a\n        ret i32 %a\n").find("line 4"), std::string::npos);
+    EXPECT_NE(error("func f() -> i32:\n        ret i32 %a\n").find("Expected a block label"), std::string::npos);
+    EXPECT_NE(error("bb0:\n").find("Expected a function header"), std::string::npos);
+    EXPECT_NE(error(header + "        %c = const u8 256\n").find("out of range"), std::string::npos);
+    EXPECT_NE(error(header + "        %c = load i32 [%a], %a\n").find("expected mem"), std::string::npos);
+}